@@ -0,0 +1,277 @@
+/**
+ * Benchmark of decompressing a large gzip-compressed volume. A synthetic 16-bit volume is
+ * compressed both as a single-member gzip stream (as written by ITK for .nii.gz files) and
+ * as BGZF blocks. Reading with zlib's gzread, which is what ITK's reader does, is timed against
+ * the block-parallel decompression of \c inflateGzipFile on the shared thread pool.
+ *
+ * Usage: GzipInflationBenchmark [compressed size in MiB] [directory for temporary files]
+ */
+
+#include "itkdetails/ImageDecompression.hpp"
+#include "util/ThreadPool.h"
+
+#include <itk_zlib.h>
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+
+namespace fs = boost::filesystem;
+
+namespace
+{
+
+/// Number of uncompressed bytes in each BGZF block, as used by htslib
+static constexpr size_t sk_bgzfBlockInputSize = 0xff00;
+
+/// Number of uncompressed bytes generated at once
+static constexpr size_t sk_sliceSize = size_t{ 16 } << 20;
+
+/// Compression level, which does not much affect the decompression speed
+static constexpr int sk_compressionLevel = 1;
+
+
+/// Fill a slice of a synthetic 16-bit volume: smooth intensities with a few bits of noise,
+/// which compress to roughly half their size
+void createSlice( size_t sliceIndex, std::mt19937& generator, std::vector<uint8_t>& slice )
+{
+    const size_t numPixels = slice.size() / sizeof( uint16_t );
+
+    for ( size_t i = 0; i < numPixels; ++i )
+    {
+        const uint16_t smooth = static_cast<uint16_t>( ( ( i >> 6 ) + 37 * sliceIndex ) & 0xfff );
+        const uint16_t value = static_cast<uint16_t>( smooth + ( generator() & 0x3f ) );
+
+        std::memcpy( slice.data() + i * sizeof( uint16_t ), &value, sizeof( uint16_t ) );
+    }
+}
+
+
+void writeLittleEndian16( uint8_t* p, uint32_t value )
+{
+    p[0] = static_cast<uint8_t>( value );
+    p[1] = static_cast<uint8_t>( value >> 8 );
+}
+
+
+void writeLittleEndian32( uint8_t* p, uint32_t value )
+{
+    writeLittleEndian16( p, value );
+    writeLittleEndian16( p + 2, value >> 16 );
+}
+
+
+/// Compress data as BGZF blocks: gzip members of at most 64 KiB with the 'BC' extra subfield
+/// that holds the compressed size of the member
+/// @return False on a compression error
+bool writeBgzfBlocks( const uint8_t* data, size_t numBytes, std::FILE* file )
+{
+    static constexpr size_t sk_headerSize = 18;
+    static constexpr size_t sk_trailerSize = 8;
+
+    std::vector<uint8_t> block( 65536 );
+
+    for ( size_t begin = 0; begin < numBytes; begin += sk_bgzfBlockInputSize )
+    {
+        const size_t n = std::min( sk_bgzfBlockInputSize, numBytes - begin );
+
+        z_stream stream;
+        stream.zalloc = Z_NULL;
+        stream.zfree = Z_NULL;
+        stream.opaque = Z_NULL;
+
+        // Raw deflate stream, since the gzip header is written here
+        if ( Z_OK != deflateInit2( &stream, sk_compressionLevel, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) )
+        {
+            return false;
+        }
+
+        stream.next_in = const_cast< Bytef* >( data + begin );
+        stream.avail_in = static_cast<uInt>( n );
+        stream.next_out = block.data() + sk_headerSize;
+        stream.avail_out = static_cast<uInt>( block.size() - sk_headerSize - sk_trailerSize );
+
+        const int ret = deflate( &stream, Z_FINISH );
+        const size_t compressedSize = stream.total_out;
+        deflateEnd( &stream );
+
+        if ( Z_STREAM_END != ret )
+        {
+            return false;
+        }
+
+        const size_t blockSize = sk_headerSize + compressedSize + sk_trailerSize;
+
+        const uint8_t header[12] = { 0x1f, 0x8b, Z_DEFLATED, 4, 0, 0, 0, 0, 0, 0xff, 6, 0 };
+        std::memcpy( block.data(), header, sizeof( header ) );
+
+        block[12] = 'B';
+        block[13] = 'C';
+        writeLittleEndian16( block.data() + 14, 2 );
+        writeLittleEndian16( block.data() + 16, static_cast<uint32_t>( blockSize - 1 ) );
+
+        uint8_t* trailer = block.data() + sk_headerSize + compressedSize;
+        writeLittleEndian32( trailer, static_cast<uint32_t>( crc32( crc32( 0, Z_NULL, 0 ), data + begin, static_cast<uInt>( n ) ) ) );
+        writeLittleEndian32( trailer + 4, static_cast<uint32_t>( n ) );
+
+        if ( blockSize != std::fwrite( block.data(), 1, blockSize, file ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/// Decompress a whole gzip file with zlib's gzread
+/// @return False on a read error or if the file does not hold exactly \c numBytes bytes
+bool readGzipFile( const std::string& fileName, size_t numBytes, uint8_t* dest )
+{
+    gzFile file = gzopen( fileName.c_str(), "rb" );
+
+    if ( ! file )
+    {
+        return false;
+    }
+
+    gzbuffer( file, 256 * 1024 );
+
+    size_t numRead = 0;
+
+    while ( numRead < numBytes )
+    {
+        const unsigned int n = static_cast<unsigned int>( std::min< size_t >( numBytes - numRead, 1u << 30 ) );
+        const int ret = gzread( file, dest + numRead, n );
+
+        if ( ret <= 0 )
+        {
+            break;
+        }
+
+        numRead += static_cast<size_t>( ret );
+    }
+
+    gzclose( file );
+    return ( numRead == numBytes );
+}
+
+
+template< class Func >
+double timeSeconds( Func func )
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+} // anonymous
+
+
+int main( int argc, char* argv[] )
+{
+    const size_t compressedMiB = ( argc > 1 ) ? std::strtoul( argv[1], nullptr, 10 ) : 500;
+    const fs::path directory = ( argc > 2 ) ? fs::path( argv[2] ) : fs::temp_directory_path();
+
+    if ( 0 == compressedMiB )
+    {
+        std::cerr << "Usage: " << argv[0] << " [compressed size in MiB] [directory for temporary files]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::string plainFileName = ( directory / fs::unique_path( "plain-%%%%%%%%.gz" ) ).string();
+    const std::string bgzfFileName = ( directory / fs::unique_path( "bgzf-%%%%%%%%.gz" ) ).string();
+
+    // Compress slices of the volume until the BGZF file reaches the requested size
+    size_t numBytes = 0;
+    bool written = true;
+
+    {
+        gzFile plainFile = gzopen( plainFileName.c_str(), ( "wb" + std::to_string( sk_compressionLevel ) ).c_str() );
+        std::FILE* bgzfFile = std::fopen( bgzfFileName.c_str(), "wb" );
+
+        std::mt19937 generator( 1234 );
+        std::vector<uint8_t> slice( sk_sliceSize );
+
+        written = ( plainFile && bgzfFile );
+
+        for ( size_t s = 0; written && fs::file_size( bgzfFileName ) < ( compressedMiB << 20 ); ++s )
+        {
+            createSlice( s, generator, slice );
+
+            written = ( static_cast<int>( slice.size() ) == gzwrite( plainFile, slice.data(), static_cast<unsigned int>( slice.size() ) ) &&
+                        writeBgzfBlocks( slice.data(), slice.size(), bgzfFile ) &&
+                        0 == std::fflush( bgzfFile ) );
+
+            numBytes += slice.size();
+        }
+
+        if ( plainFile ) gzclose( plainFile );
+        if ( bgzfFile ) std::fclose( bgzfFile );
+    }
+
+    if ( ! written )
+    {
+        std::cerr << "Error writing the compressed volumes to " << directory << std::endl;
+        fs::remove( plainFileName );
+        fs::remove( bgzfFileName );
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Decompressing " << ( numBytes >> 20 ) << " MiB volume from "
+              << ( fs::file_size( plainFileName ) >> 20 ) << " MiB gzip and "
+              << ( fs::file_size( bgzfFileName ) >> 20 ) << " MiB BGZF files using "
+              << imageio::parallel::maxConcurrency() << " threads" << std::endl;
+
+    std::vector<uint8_t> reference( numBytes );
+    std::vector<uint8_t> dest( numBytes );
+
+    using itkdetails::decompression::inflateGzipFile;
+
+    bool success = true;
+
+    const double plainReadSeconds = timeSeconds( [&] ()
+    {
+        success &= readGzipFile( plainFileName, numBytes, reference.data() );
+    } );
+
+    const double bgzfReadSeconds = timeSeconds( [&] ()
+    {
+        success &= readGzipFile( bgzfFileName, numBytes, dest.data() );
+    } );
+
+    success &= ( reference == dest );
+    std::fill( dest.begin(), dest.end(), 0 );
+
+    const double bgzfInflateSeconds = timeSeconds( [&] ()
+    {
+        success &= inflateGzipFile( bgzfFileName, 0, numBytes, dest.data() );
+    } );
+
+    success &= ( reference == dest );
+
+    fs::remove( plainFileName );
+    fs::remove( bgzfFileName );
+
+    std::cout << "gzread of gzip:            " << plainReadSeconds << " s" << std::endl
+              << "gzread of BGZF:            " << bgzfReadSeconds << " s" << std::endl
+              << "Parallel inflate of BGZF:  " << bgzfInflateSeconds << " s" << std::endl
+              << "Speedup over gzip gzread:  " << plainReadSeconds / bgzfInflateSeconds << "x" << std::endl;
+
+    if ( ! success )
+    {
+        std::cerr << "Error: the decompressed volumes differ" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
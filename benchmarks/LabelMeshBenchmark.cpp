@@ -0,0 +1,301 @@
+/**
+ * Benchmark of generating the surface meshes of all labels of a parcellation, as done by
+ * \c data::generateAllLabelMeshes with its two methods. The discrete surfaces method (which
+ * extracts the surfaces of all labels in one parallel sweep over slabs of the parcellation,
+ * then smooths the surface of each label) is timed against the marching cubes method that it
+ * is meant to replace (which runs marching cubes over the bounding box of each label).
+ * Both methods run on the shared thread pool, with the same workers as the application.
+ *
+ * The synthetic parcellation is a grid of labeled cells whose walls are warped by sinusoids,
+ * so that the label surfaces are curved and every label touches its neighbors.
+ *
+ * Usage: LabelMeshBenchmark [size in pixels of each dimension] [number of cells per dimension]
+ */
+
+#include "mesh/MeshCpuRecord.h"
+#include "mesh/MeshLoading.h"
+
+#include "imageio/HZeeTypes.hpp"
+#include "imageio/ImageHeader.h"
+#include "util/ThreadPool.h"
+
+#include <vtkImageData.h>
+#include <vtkMultiThreader.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <vector>
+
+
+namespace
+{
+
+using IndexType = uint16_t;
+
+/// Number of slabs of slices per worker, as in data::generateAllLabelMeshes
+static constexpr size_t sk_numSlabsPerWorker = 4;
+
+/// Amplitude in pixels of the warping of the cell walls
+static constexpr double sk_warpAmplitude = 3.0;
+
+
+/// Create a parcellation of cubic cells of label indices 1 to numCells^3
+vtkSmartPointer<vtkImageData> createParcellation( int size, int numCells )
+{
+    vtkSmartPointer<vtkImageData> imageData = vtkSmartPointer<vtkImageData>::New();
+    imageData->SetDimensions( size, size, size );
+    imageData->AllocateScalars( VTK_UNSIGNED_SHORT, 1 );
+
+    IndexType* pixels = static_cast<IndexType*>( imageData->GetScalarPointer() );
+
+    auto cell = [size, numCells] ( double c )
+    {
+        return std::clamp( static_cast<int>( c * numCells / size ), 0, numCells - 1 );
+    };
+
+    imageio::parallel::forEachIndex( static_cast<size_t>( size ), [&] ( size_t, size_t zi )
+    {
+        const int z = static_cast<int>( zi );
+
+        for ( int y = 0; y < size; ++y )
+        {
+            for ( int x = 0; x < size; ++x )
+            {
+                const int cx = cell( x + sk_warpAmplitude * std::sin( y / 7.0 ) );
+                const int cy = cell( y + sk_warpAmplitude * std::sin( z / 9.0 ) );
+                const int cz = cell( z + sk_warpAmplitude * std::sin( x / 11.0 ) );
+
+                pixels[ ( static_cast<size_t>( z ) * size + y ) * size + x ] =
+                        static_cast<IndexType>( 1 + ( cz * numCells + cy ) * numCells + cx );
+            }
+        }
+    } );
+
+    return imageData;
+}
+
+
+imageio::ImageHeader createHeader( int size )
+{
+    imageio::ImageHeader header;
+    header.m_componentType = imageio::ComponentType::UInt16;
+    header.m_pixelType = imageio::PixelType::Scalar;
+    header.m_numComponents = 1;
+    header.m_numDimensions = 3;
+    header.m_pixelDimensions = glm::u64vec3{ static_cast<uint64_t>( size ) };
+    header.m_origin = glm::dvec3{ 0.0 };
+    header.m_spacing = glm::dvec3{ 1.0 };
+    header.m_directions = glm::dmat3{ 1.0 };
+    return header;
+}
+
+
+/// Bounding box of each label as a VTK extent, found in one pass over the parcellation
+/// (as done by the label index of the application's parcellation records)
+std::vector< std::array<int, 6> > labelBoundingBoxes( vtkImageData* imageData, size_t numLabels )
+{
+    int dims[3];
+    imageData->GetDimensions( dims );
+
+    const IndexType* pixels = static_cast<const IndexType*>( imageData->GetScalarPointer() );
+
+    std::vector< std::array<int, 6> > boxes( numLabels + 1, std::array<int, 6>{ {
+        std::numeric_limits<int>::max(), -1, std::numeric_limits<int>::max(), -1,
+        std::numeric_limits<int>::max(), -1 } } );
+
+    for ( int z = 0; z < dims[2]; ++z )
+    {
+        for ( int y = 0; y < dims[1]; ++y )
+        {
+            for ( int x = 0; x < dims[0]; ++x )
+            {
+                auto& box = boxes[ *pixels++ ];
+                box[0] = std::min( box[0], x ); box[1] = std::max( box[1], x );
+                box[2] = std::min( box[2], y ); box[3] = std::max( box[3], y );
+                box[4] = std::min( box[4], z ); box[5] = std::max( box[5], z );
+            }
+        }
+    }
+
+    return boxes;
+}
+
+
+/// VTK images for the workers. VTK pipelines update the information of their input data
+/// objects, so each worker meshes its own image. The images share the pixel buffer.
+std::vector< vtkSmartPointer<vtkImageData> > workerImages( vtkImageData* imageData, size_t numWorkers )
+{
+    std::vector< vtkSmartPointer<vtkImageData> > images( numWorkers );
+
+    for ( auto& image : images )
+    {
+        image = vtkSmartPointer<vtkImageData>::New();
+        image->ShallowCopy( imageData );
+    }
+
+    return images;
+}
+
+
+/// Generate the meshes with the marching cubes method
+std::vector< std::unique_ptr<MeshCpuRecord> > meshMarchingCubes(
+        vtkImageData* imageData, const imageio::ImageHeader& header, const std::vector<uint32_t>& labels )
+{
+    const auto boxes = labelBoundingBoxes( imageData, labels.size() );
+
+    const size_t numWorkers = imageio::parallel::numWorkers( labels.size() );
+    const auto images = workerImages( imageData, numWorkers );
+
+    std::vector< std::unique_ptr<MeshCpuRecord> > meshes( labels.size() );
+
+    imageio::parallel::forEachIndex( labels.size(), [&] ( size_t worker, size_t i )
+    {
+        meshes[i] = meshgen::generateLabelMesh( images[worker].Get(), header, labels[i], boxes[ labels[i] ] );
+    } );
+
+    return meshes;
+}
+
+
+/// Generate the meshes with the discrete surfaces method
+std::vector< std::unique_ptr<MeshCpuRecord> > meshDiscreteSurfaces(
+        vtkImageData* imageData, const imageio::ImageHeader& header, const std::vector<uint32_t>& labels )
+{
+    const size_t numSlices = static_cast<size_t>( header.m_pixelDimensions.z );
+    const size_t numWorkers = imageio::parallel::numWorkers( std::max( labels.size(), numSlices ) );
+    const size_t numSlabs = std::min( numSlices, sk_numSlabsPerWorker * numWorkers );
+
+    const auto images = workerImages( imageData, numWorkers );
+
+    std::vector< std::map< uint32_t, vtkSmartPointer<vtkPolyData> > > slabSurfaces( numSlabs );
+
+    imageio::parallel::forEachIndex( numSlabs, [&] ( size_t worker, size_t s )
+    {
+        const std::array<int, 2> slices{ {
+                static_cast<int>( s * numSlices / numSlabs ),
+                static_cast<int>( ( s + 1 ) * numSlices / numSlabs ) } };
+
+        slabSurfaces[s] = meshgen::extractLabelSurfaces( images[worker].Get(), header, labels, slices );
+    }, numWorkers );
+
+    std::vector< std::unique_ptr<MeshCpuRecord> > meshes( labels.size() );
+
+    imageio::parallel::forEachIndex( labels.size(), [&] ( size_t worker, size_t i )
+    {
+        std::vector< vtkSmartPointer<vtkPolyData> > surfacePieces;
+
+        for ( auto& surfaces : slabSurfaces )
+        {
+            const auto piece = surfaces.find( labels[i] );
+
+            if ( std::end( surfaces ) != piece )
+            {
+                surfacePieces.emplace_back( std::move( piece->second ) );
+            }
+        }
+
+        if ( ! surfacePieces.empty() )
+        {
+            meshes[i] = meshgen::generateLabelMeshFromSurfaces(
+                        surfacePieces, images[worker].Get(), header, labels[i] );
+        }
+    }, numWorkers );
+
+    return meshes;
+}
+
+
+/// Count the meshes generated and their triangles
+std::pair<size_t, size_t> countMeshes( const std::vector< std::unique_ptr<MeshCpuRecord> >& meshes )
+{
+    size_t numMeshes = 0;
+    size_t numTriangles = 0;
+
+    for ( const auto& mesh : meshes )
+    {
+        if ( mesh && mesh->polyData() )
+        {
+            ++numMeshes;
+            numTriangles += static_cast<size_t>( mesh->polyData()->GetNumberOfPolys() );
+        }
+    }
+
+    return { numMeshes, numTriangles };
+}
+
+
+template< class Func >
+double timeSeconds( Func func )
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+} // anonymous
+
+
+int main( int argc, char* argv[] )
+{
+    const int size = ( argc > 1 ) ? std::atoi( argv[1] ) : 256;
+    const int numCells = ( argc > 2 ) ? std::atoi( argv[2] ) : 7;
+
+    if ( size <= 0 || numCells <= 0 || size < 2 * numCells ||
+         numCells * numCells * numCells >= std::numeric_limits<IndexType>::max() )
+    {
+        std::cerr << "Usage: " << argv[0] << " [size in pixels >= 2 * number of cells] "
+                  << "[number of cells per dimension]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<uint32_t> labels( static_cast<size_t>( numCells * numCells * numCells ) );
+
+    for ( size_t i = 0; i < labels.size(); ++i )
+    {
+        labels[i] = static_cast<uint32_t>( i + 1 );
+    }
+
+    std::cout << "Meshing " << labels.size() << " labels of " << size << "^3 parcellation using "
+              << imageio::parallel::maxConcurrency() << " threads" << std::endl;
+
+    const vtkSmartPointer<vtkImageData> imageData = createParcellation( size, numCells );
+    const imageio::ImageHeader header = createHeader( size );
+
+    // The VTK filters of a worker do not start threads of their own, since every core runs a worker
+    vtkMultiThreader::SetGlobalMaximumNumberOfThreads( 1 );
+
+    std::vector< std::unique_ptr<MeshCpuRecord> > marchingCubesMeshes;
+    std::vector< std::unique_ptr<MeshCpuRecord> > discreteMeshes;
+
+    const double marchingCubesSeconds = timeSeconds( [&] () {
+        marchingCubesMeshes = meshMarchingCubes( imageData.Get(), header, labels ); } );
+
+    const double discreteSeconds = timeSeconds( [&] () {
+        discreteMeshes = meshDiscreteSurfaces( imageData.Get(), header, labels ); } );
+
+    const auto marchingCubesCounts = countMeshes( marchingCubesMeshes );
+    const auto discreteCounts = countMeshes( discreteMeshes );
+
+    std::cout << "Marching cubes:    " << marchingCubesSeconds << " s, "
+              << marchingCubesCounts.first << " meshes, " << marchingCubesCounts.second << " triangles" << std::endl
+              << "Discrete surfaces: " << discreteSeconds << " s, "
+              << discreteCounts.first << " meshes, " << discreteCounts.second << " triangles" << std::endl
+              << "Speedup:           " << marchingCubesSeconds / discreteSeconds << "x" << std::endl;
+
+    if ( labels.size() != marchingCubesCounts.first || labels.size() != discreteCounts.first )
+    {
+        std::cerr << "Error: not every label has a mesh" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
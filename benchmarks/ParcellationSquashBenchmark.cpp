@@ -0,0 +1,165 @@
+/**
+ * Benchmark of squashing a parcellation: finding its unique label values and remapping its
+ * pixels to label indices. The parallel squash of \c createSquashedImage (which scans with
+ * per-worker tables and remaps through a lookup table on the shared thread pool) is timed
+ * against the serial squash that it replaced (which collects the labels in a std::set and
+ * remaps each pixel through a std::unordered_map).
+ *
+ * Usage: ParcellationSquashBenchmark [size in pixels of each dimension] [number of labels]
+ */
+
+#include "util/CreateParcellationImage.h"
+#include "util/ThreadPool.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+
+namespace
+{
+
+using LabelType = int32_t;
+using IndexType = uint16_t;
+
+/// Side length in pixels of the cubes of constant label in the synthetic parcellation
+static constexpr size_t sk_blobSize = 8;
+
+
+/// Create a parcellation of cubes with random labels, which are spread over a wide range
+/// of values, on a background of label 0
+std::vector<LabelType> createParcellation( size_t size, size_t numLabels )
+{
+    std::mt19937 generator( 1234 );
+    std::uniform_int_distribution<size_t> labelDist( 0, numLabels );
+
+    const size_t numBlobs = ( size + sk_blobSize - 1 ) / sk_blobSize;
+    std::vector<LabelType> blobLabels( numBlobs * numBlobs * numBlobs );
+
+    for ( auto& label : blobLabels )
+    {
+        const size_t l = labelDist( generator );
+        label = ( 0 == l ) ? 0 : static_cast<LabelType>( 1000 * l + 7 );
+    }
+
+    std::vector<LabelType> pixels( size * size * size );
+
+    for ( size_t z = 0; z < size; ++z )
+    {
+        for ( size_t y = 0; y < size; ++y )
+        {
+            for ( size_t x = 0; x < size; ++x )
+            {
+                const size_t blob = ( ( z / sk_blobSize ) * numBlobs + y / sk_blobSize ) * numBlobs + x / sk_blobSize;
+                pixels[ ( z * size + y ) * size + x ] = blobLabels[blob];
+            }
+        }
+    }
+
+    return pixels;
+}
+
+
+/// Squash as done before the parallel squash: serially, through a std::set and std::unordered_map
+std::vector<IndexType> squashSerial( const std::vector<LabelType>& pixels )
+{
+    std::set<LabelType> labels;
+    for ( const LabelType p : pixels )
+    {
+        labels.insert( p );
+    }
+
+    std::unordered_map<LabelType, size_t> labelToIndex;
+    labelToIndex.insert( std::make_pair( 0, 0 ) );
+
+    size_t index = 1;
+    for ( const LabelType l : labels )
+    {
+        if ( 0 != l )
+        {
+            labelToIndex.insert( std::make_pair( l, index++ ) );
+        }
+    }
+
+    std::vector<IndexType> indices( pixels.size() );
+    for ( size_t i = 0; i < pixels.size(); ++i )
+    {
+        indices[i] = static_cast<IndexType>( labelToIndex.at( pixels[i] ) );
+    }
+
+    return indices;
+}
+
+
+/// Squash as done by \c createSquashedImage
+std::vector<IndexType> squashParallel( const std::vector<LabelType>& pixels )
+{
+    const std::vector<LabelType> sortedLabels =
+            findUniqueLabels( pixels.data(), pixels.size(), sk_maxNumLabels );
+
+    std::vector<LabelType> indexedLabels{ 0 };
+    for ( const LabelType l : sortedLabels )
+    {
+        if ( 0 != l )
+        {
+            indexedLabels.push_back( l );
+        }
+    }
+
+    std::vector<IndexType> indices( pixels.size() );
+    remapLabelsToIndices( pixels.data(), indices.data(), pixels.size(), indexedLabels );
+
+    return indices;
+}
+
+
+template< class Func >
+double timeSeconds( Func func )
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+} // anonymous
+
+
+int main( int argc, char* argv[] )
+{
+    const size_t size = ( argc > 1 ) ? std::strtoul( argv[1], nullptr, 10 ) : 512;
+    const size_t numLabels = ( argc > 2 ) ? std::strtoul( argv[2], nullptr, 10 ) : 500;
+
+    if ( 0 == size || 0 == numLabels || numLabels >= sk_maxNumLabels )
+    {
+        std::cerr << "Usage: " << argv[0] << " [size in pixels] [number of labels < "
+                  << sk_maxNumLabels << "]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Squashing " << size << "^3 parcellation of " << numLabels << " labels using "
+              << imageio::parallel::maxConcurrency() << " threads" << std::endl;
+
+    const std::vector<LabelType> pixels = createParcellation( size, numLabels );
+
+    std::vector<IndexType> serial;
+    std::vector<IndexType> parallel;
+
+    const double serialSeconds = timeSeconds( [&] () { serial = squashSerial( pixels ); } );
+    const double parallelSeconds = timeSeconds( [&] () { parallel = squashParallel( pixels ); } );
+
+    std::cout << "Serial set and map: " << serialSeconds << " s" << std::endl
+              << "Parallel:           " << parallelSeconds << " s" << std::endl
+              << "Speedup:            " << serialSeconds / parallelSeconds << "x" << std::endl;
+
+    if ( serial != parallel )
+    {
+        std::cerr << "Error: the squashed parcellations differ" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+/**
+ * Benchmark of converting a region of premultiplied ARGB slide pixels, as returned by OpenSlide,
+ * to straight-alpha RGBA, BGRA, and gray. The vectorized \c convertPremultipliedArgb is timed
+ * against a naive per-pixel loop for each format.
+ *
+ * Usage: SlidePixelConversionBenchmark [region width and height in pixels]
+ */
+
+#include "slideio/SlidePixelConversion.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+
+namespace
+{
+
+using slideio::SlidePixelFormat;
+
+
+/// Create premultiplied ARGB pixels: no color channel exceeds the alpha. A quarter of the
+/// pixels are opaque and a few are fully transparent, as in slides with a background.
+std::vector<uint32_t> createPixels( size_t numPixels )
+{
+    std::mt19937 generator( 1234 );
+    std::vector<uint32_t> pixels( numPixels );
+
+    for ( auto& p : pixels )
+    {
+        const uint32_t bits = generator();
+        const uint32_t a = ( 0 == ( bits & 3 ) ) ? 255u : ( bits >> 24 );
+
+        const uint32_t r = ( a * ( ( bits >> 16 ) & 0xff ) ) / 255;
+        const uint32_t g = ( a * ( ( bits >> 8 ) & 0xff ) ) / 255;
+        const uint32_t b = ( a * ( bits & 0xff ) ) / 255;
+
+        p = ( a << 24 ) | ( r << 16 ) | ( g << 8 ) | b;
+    }
+
+    return pixels;
+}
+
+
+/// Convert pixels one at a time with integer division
+void convertNaive( const uint32_t* src, size_t numPixels, uint8_t* dst, const SlidePixelFormat& format )
+{
+    for ( size_t i = 0; i < numPixels; ++i )
+    {
+        const uint32_t a = ( src[i] >> 24 );
+        uint32_t c[3] = { ( src[i] >> 16 ) & 0xff, ( src[i] >> 8 ) & 0xff, src[i] & 0xff };
+
+        for ( auto& x : c )
+        {
+            x = ( 0 == a ) ? 0 : std::min( ( 255 * x + a / 2 ) / a, uint32_t( 255 ) );
+        }
+
+        switch ( format )
+        {
+        case SlidePixelFormat::RGBA:
+        {
+            dst[4*i + 0] = static_cast<uint8_t>( c[0] );
+            dst[4*i + 1] = static_cast<uint8_t>( c[1] );
+            dst[4*i + 2] = static_cast<uint8_t>( c[2] );
+            dst[4*i + 3] = static_cast<uint8_t>( a );
+            break;
+        }
+        case SlidePixelFormat::BGRA:
+        {
+            dst[4*i + 0] = static_cast<uint8_t>( c[2] );
+            dst[4*i + 1] = static_cast<uint8_t>( c[1] );
+            dst[4*i + 2] = static_cast<uint8_t>( c[0] );
+            dst[4*i + 3] = static_cast<uint8_t>( a );
+            break;
+        }
+        case SlidePixelFormat::Gray:
+        {
+            dst[i] = static_cast<uint8_t>( ( 77 * c[0] + 150 * c[1] + 29 * c[2] + 128 ) >> 8 );
+            break;
+        }
+        }
+    }
+}
+
+
+template< class Func >
+double timeSeconds( Func func )
+{
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+}
+
+} // anonymous
+
+
+int main( int argc, char* argv[] )
+{
+    const size_t size = ( argc > 1 ) ? std::strtoul( argv[1], nullptr, 10 ) : 16384;
+
+    if ( 0 == size )
+    {
+        std::cerr << "Usage: " << argv[0] << " [region width and height in pixels]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+#if defined(__AVX2__)
+    const char* instructionSet = "AVX2";
+#elif defined(__SSE4_1__)
+    const char* instructionSet = "SSE4.1";
+#else
+    const char* instructionSet = "scalar";
+#endif
+
+    const size_t numPixels = size * size;
+
+    std::cout << "Converting " << size << " x " << size << " premultiplied ARGB region ("
+              << instructionSet << " path)" << std::endl;
+
+    const std::vector<uint32_t> pixels = createPixels( numPixels );
+
+    const std::pair< SlidePixelFormat, const char* > formats[] = {
+        { SlidePixelFormat::RGBA, "RGBA" },
+        { SlidePixelFormat::BGRA, "BGRA" },
+        { SlidePixelFormat::Gray, "Gray" } };
+
+    bool identical = true;
+
+    for ( const auto& format : formats )
+    {
+        const size_t numBytes = numPixels * slideio::bytesPerPixel( format.first );
+
+        std::vector<uint8_t> naive( numBytes );
+        std::vector<uint8_t> vectorized( numBytes );
+
+        const double naiveSeconds = timeSeconds( [&] ()
+        {
+            convertNaive( pixels.data(), numPixels, naive.data(), format.first );
+        } );
+
+        const double vectorizedSeconds = timeSeconds( [&] ()
+        {
+            slideio::convertPremultipliedArgb( pixels.data(), numPixels, vectorized.data(), format.first );
+        } );
+
+        std::cout << format.second << ": naive " << naiveSeconds << " s, vectorized "
+                  << vectorizedSeconds << " s, speedup " << naiveSeconds / vectorizedSeconds
+                  << "x" << std::endl;
+
+        if ( naive != vectorized )
+        {
+            std::cerr << "Error: the " << format.second << " conversions differ" << std::endl;
+            identical = false;
+        }
+    }
+
+    return ( identical ) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
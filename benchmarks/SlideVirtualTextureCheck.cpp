@@ -0,0 +1,359 @@
+/**
+ * Check of the CPU side of the slide virtual texture, which needs no OpenGL context: the
+ * assignment of tiles to slots of the tile atlas, their eviction, the residency versions of
+ * slides, and the pages of the page tables, as laid out by \c SlideAtlasLayout and uploaded
+ * by \c SlideTileAtlas and \c SlidePageTable.
+ *
+ * The pages of a synthetic three-level slide are compared with a brute-force reference that
+ * maps each page to the finest resident tile that covers it.
+ *
+ * Usage: SlideVirtualTextureCheck
+ */
+
+#include "rendering/records/SlideAtlasLayout.h"
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+
+/// Tile size of the synthetic slide and of the atlas
+static constexpr int64_t sk_tileSize = 4;
+
+/// Dimensions of the levels of the synthetic slide. The last tiles of each level are partial.
+const std::vector<glm::i64vec2> sk_levelDims{ { 10, 7 }, { 5, 4 }, { 3, 2 } };
+
+
+int s_numFailures = 0;
+
+void check( bool condition, const std::string& what )
+{
+    if ( ! condition )
+    {
+        std::cerr << "Failed: " << what << std::endl;
+        ++s_numFailures;
+    }
+}
+
+
+slideio::SlideTileKey key( const UID& slideUid, int level, int64_t x, int64_t y )
+{
+    return slideio::SlideTileKey{ slideUid, level, glm::i64vec2{ x, y } };
+}
+
+
+bool isResident( const SlideAtlasLayout& layout, const slideio::SlideTileKey& tileKey )
+{
+    for ( const auto& t : layout.residentTiles( tileKey.m_slideUid ) )
+    {
+        if ( t.first == tileKey )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+/// Check that tiles are evicted in order of their last request, and never while requested
+/// in the current set of requests
+void checkEviction()
+{
+    SlideAtlasLayout layout( sk_tileSize, 2 );
+    const UID slide;
+
+    layout.beginRequests();
+
+    std::vector< std::optional<glm::i64vec2> > origins;
+
+    for ( int64_t i = 0; i < 4; ++i )
+    {
+        origins.push_back( layout.insertTile( key( slide, 0, i, 0 ) ) );
+        check( origins.back().has_value(), "insert tile into free slot" );
+    }
+
+    // All four slots hold tiles of the current requests
+    check( ! layout.insertTile( key( slide, 0, 0, 1 ) ), "no eviction of tiles of the current requests" );
+    check( 4 == layout.residentTiles( slide ).size(), "four resident tiles" );
+
+    // Inserting a resident tile only requests it
+    check( layout.insertTile( key( slide, 0, 2, 0 ) ) == origins[2], "insertion of resident tile keeps its slot" );
+
+    layout.beginRequests();
+    layout.requestTile( key( slide, 0, 1, 0 ) );
+    layout.requestTile( key( slide, 0, 2, 0 ) );
+
+    layout.beginRequests();
+    layout.requestTile( key( slide, 0, 2, 0 ) );
+
+    // Tiles 0 and 3 were last requested in the first set, tile 1 in the second and tile 2 in
+    // the third, so they are evicted in the order 0, 3, 1, 2. (Of slots that were last
+    // requested together, the first is evicted first.)
+    layout.beginRequests();
+
+    check( layout.insertTile( key( slide, 0, 0, 1 ) ) == origins[0], "evicted slot is reused" );
+    check( ! isResident( layout, key( slide, 0, 0, 0 ) ), "least recently requested tile is evicted" );
+
+    check( layout.insertTile( key( slide, 0, 1, 1 ) ) == origins[3], "second eviction" );
+    check( ! isResident( layout, key( slide, 0, 3, 0 ) ), "next least recently requested tile is evicted" );
+    check( isResident( layout, key( slide, 0, 1, 0 ) ), "more recently requested tile stays" );
+
+    check( layout.insertTile( key( slide, 0, 2, 1 ) ) == origins[1], "third eviction" );
+    check( ! isResident( layout, key( slide, 0, 1, 0 ) ), "tile of the second set is evicted third" );
+
+    // Once requested in the current set, the last tile of the first four is not evicted either
+    layout.requestTile( key( slide, 0, 2, 0 ) );
+    check( ! layout.insertTile( key( slide, 1, 0, 0 ) ), "no eviction of requested tiles" );
+    check( isResident( layout, key( slide, 0, 2, 0 ) ), "requested tile stays" );
+
+    // Tile origins are distinct and lie inside the borders of their slots
+    std::set< std::pair<int64_t, int64_t> > distinctOrigins;
+
+    for ( const auto& t : layout.residentTiles( slide ) )
+    {
+        const glm::i64vec2 slotOffset = ( t.second - SlideAtlasLayout::sk_slotBorder ) %
+                ( sk_tileSize + 2 * SlideAtlasLayout::sk_slotBorder );
+
+        check( glm::all( glm::equal( slotOffset, glm::i64vec2{ 0 } ) ), "tile origin is inside slot border" );
+        distinctOrigins.emplace( t.second.x, t.second.y );
+    }
+
+    check( 4 == distinctOrigins.size(), "resident tiles have distinct slots" );
+}
+
+
+/// Check that residency versions change iff the residency of a slide changes, are unique
+/// across slides, and are zero for slides without resident tiles
+void checkResidencyVersions()
+{
+    SlideAtlasLayout layout( sk_tileSize, 2 );
+    const UID slideA;
+    const UID slideB;
+
+    check( 0 == layout.residencyVersion( slideA ), "version of slide without tiles is zero" );
+
+    std::set<uint64_t> seenVersions{ 0 };
+
+    auto newVersion = [&] ( const UID& slide, const std::string& what )
+    {
+        const uint64_t v = layout.residencyVersion( slide );
+        check( seenVersions.insert( v ).second, what );
+    };
+
+    layout.beginRequests();
+    layout.insertTile( key( slideA, 0, 0, 0 ) );
+    newVersion( slideA, "insertion changes the version" );
+
+    layout.insertTile( key( slideB, 0, 0, 0 ) );
+    newVersion( slideB, "versions are unique across slides" );
+
+    const uint64_t versionA = layout.residencyVersion( slideA );
+    layout.insertTile( key( slideB, 0, 1, 0 ) );
+    check( versionA == layout.residencyVersion( slideA ), "insertion for another slide keeps the version" );
+
+    layout.requestTile( key( slideA, 0, 0, 0 ) );
+    check( versionA == layout.residencyVersion( slideA ), "requests keep the version" );
+
+    // Fill the last slot, then evict slide A's only tile
+    layout.insertTile( key( slideB, 0, 2, 0 ) );
+
+    layout.beginRequests();
+    layout.requestTile( key( slideB, 0, 0, 0 ) );
+    layout.requestTile( key( slideB, 0, 1, 0 ) );
+    layout.requestTile( key( slideB, 0, 2, 0 ) );
+
+    layout.insertTile( key( slideB, 1, 0, 0 ) );
+    check( 0 == layout.residencyVersion( slideA ), "version is zero once all tiles are evicted" );
+    newVersion( slideB, "eviction for another slide changes its version" );
+
+    // Slide A is tracked again with a version that has not been used before
+    layout.beginRequests();
+    layout.insertTile( key( slideA, 0, 0, 0 ) );
+    newVersion( slideA, "version of re-inserted slide is new" );
+    newVersion( slideB, "eviction changes the version" );
+}
+
+
+/// Reference page of a level: the map to the finest resident tile (of the level or coarser)
+/// that covers the whole page, or zero
+glm::vec4 referencePage( const SlideAtlasLayout& layout, const UID& slide, int level, const glm::i64vec2& page )
+{
+    const int64_t T = sk_tileSize;
+    const glm::i64vec2 L = sk_levelDims[ static_cast<size_t>( level ) ];
+    const glm::dvec2 atlasDims{ layout.dims() };
+
+    const auto tiles = layout.residentTiles( slide );
+
+    for ( int tileLevel = level; tileLevel < static_cast<int>( sk_levelDims.size() ); ++tileLevel )
+    {
+        const glm::i64vec2 K = sk_levelDims[ static_cast<size_t>( tileLevel ) ];
+
+        for ( const auto& t : tiles )
+        {
+            if ( t.first.m_level != tileLevel )
+            {
+                continue;
+            }
+
+            const glm::i64vec2 i = t.first.m_index;
+            bool covers = true;
+
+            for ( int a = 0; a < 2; ++a )
+            {
+                // In normalized slide coordinates, the page spans [p T / L, min((p + 1) T / L, 1)]
+                // and the tile spans [i T / K, min((i + 1) T / K, 1)]. Compare exactly in integers.
+                const int64_t pageBegin = page[a] * T * K[a];
+                const int64_t pageEnd = std::min( ( page[a] + 1 ) * T, L[a] ) * K[a];
+                const int64_t tileBegin = i[a] * T * L[a];
+                const int64_t tileEnd = std::min( ( i[a] + 1 ) * T, K[a] ) * L[a];
+
+                covers = covers && ( tileBegin <= pageBegin ) && ( pageEnd <= tileEnd );
+            }
+
+            if ( covers )
+            {
+                return glm::vec4{ static_cast<double>( K.x ) / atlasDims.x,
+                                  static_cast<double>( K.y ) / atlasDims.y,
+                                  static_cast<double>( t.second.x - i.x * T ) / atlasDims.x,
+                                  static_cast<double>( t.second.y - i.y * T ) / atlasDims.y };
+            }
+        }
+    }
+
+    return glm::vec4{ 0.0f };
+}
+
+
+/// Check the pages of all levels of a slide against the reference, and check that each page
+/// maps its part of the slide into the texels of its tile in the atlas
+void checkPages( const SlideAtlasLayout& layout, const UID& slide, const std::string& what )
+{
+    const int64_t T = sk_tileSize;
+
+    for ( int level = 0; level < static_cast<int>( sk_levelDims.size() ); ++level )
+    {
+        const glm::i64vec2 L = sk_levelDims[ static_cast<size_t>( level ) ];
+        const glm::i64vec2 counts = ( L + T - int64_t( 1 ) ) / T;
+
+        const std::vector<glm::vec4> pages = layout.pageTable( slide, sk_levelDims, T, level );
+
+        if ( pages.size() != static_cast<size_t>( counts.x * counts.y ) )
+        {
+            check( false, what + ": one page per tile of level " + std::to_string( level ) );
+            continue;
+        }
+
+        for ( int64_t y = 0; y < counts.y; ++y )
+        {
+            for ( int64_t x = 0; x < counts.x; ++x )
+            {
+                const glm::vec4& page = pages[ static_cast<size_t>( y * counts.x + x ) ];
+                const glm::vec4 expected = referencePage( layout, slide, level, glm::i64vec2{ x, y } );
+
+                const std::string where = what + ": page (" + std::to_string( x ) + ", " +
+                        std::to_string( y ) + ") of level " + std::to_string( level );
+
+                check( glm::all( glm::lessThan( glm::abs( page - expected ), glm::vec4{ 1.0e-6f } ) ),
+                       where + " matches reference" );
+
+                if ( page.x <= 0.0f )
+                {
+                    continue;
+                }
+
+                // Pixel centers of the page, in normalized slide coordinates, must map to texels
+                // of a tile whose slot contains them
+                for ( int64_t py = y * T; py < std::min( ( y + 1 ) * T, L.y ); ++py )
+                {
+                    for ( int64_t px = x * T; px < std::min( ( x + 1 ) * T, L.x ); ++px )
+                    {
+                        const glm::dvec2 slideCoords = ( glm::dvec2{ glm::i64vec2{ px, py } } + 0.5 ) / glm::dvec2{ L };
+                        const glm::dvec2 atlasTexel{
+                            ( slideCoords.x * page.x + page.z ) * layout.dims().x,
+                            ( slideCoords.y * page.y + page.w ) * layout.dims().y };
+
+                        const glm::dvec2 slotSize{ static_cast<double>( T + 2 * SlideAtlasLayout::sk_slotBorder ) };
+                        const glm::dvec2 inSlot = atlasTexel - glm::floor( atlasTexel / slotSize ) * slotSize;
+
+                        check( glm::all( glm::greaterThanEqual( inSlot, glm::dvec2{ 1.0 } ) ) &&
+                               glm::all( glm::lessThanEqual( inSlot, glm::dvec2{ 1.0 + T } ) ),
+                               where + " maps its pixels into the tile of a slot" );
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+void checkPageTables()
+{
+    SlideAtlasLayout layout( sk_tileSize, 3 );
+    const UID slide;
+    const UID otherSlide;
+
+    check( layout.pageTable( slide, sk_levelDims, sk_tileSize, 3 ).empty(), "no pages of missing level" );
+    checkPages( layout, slide, "empty atlas" );
+
+    layout.beginRequests();
+
+    // A coarse tile that covers the whole slide, a level 1 tile that covers the right half,
+    // and full-resolution tiles at the partial right and bottom edges of level 0
+    layout.insertTile( key( slide, 2, 0, 0 ) );
+    checkPages( layout, slide, "coarsest tile" );
+
+    layout.insertTile( key( slide, 1, 1, 0 ) );
+    layout.insertTile( key( slide, 0, 2, 1 ) );
+    layout.insertTile( key( slide, 0, 0, 0 ) );
+    layout.insertTile( key( otherSlide, 0, 1, 0 ) );
+    checkPages( layout, slide, "mixed levels" );
+
+    const std::vector<glm::vec4> level0 = layout.pageTable( slide, sk_levelDims, sk_tileSize, 0 );
+    check( 6 == level0.size(), "level 0 has 3 x 2 pages" );
+
+    // Page (1, 0) is covered by neither the level 1 tile (which starts at pixel 8 of level 0)
+    // nor a level 0 tile of this slide, so it falls back to the coarsest tile
+    const glm::vec4 coarsest = referencePage( layout, slide, 2, glm::i64vec2{ 0, 0 } );
+    check( 6 == level0.size() && level0[1] == coarsest, "page (1, 0) of level 0 maps to the coarsest tile" );
+
+    // Evict everything but the level 1 tile
+    layout.beginRequests();
+    layout.requestTile( key( slide, 1, 1, 0 ) );
+
+    for ( int64_t i = 0; i < 8; ++i )
+    {
+        layout.insertTile( key( otherSlide, 1, i, 1 ) );
+    }
+
+    check( 1 == layout.residentTiles( slide ).size(), "only the requested tile of the slide stays" );
+    checkPages( layout, slide, "after eviction" );
+}
+
+} // anonymous
+
+
+int main()
+{
+    checkEviction();
+    checkResidencyVersions();
+    checkPageTables();
+
+    if ( s_numFailures > 0 )
+    {
+        std::cerr << s_numFailures << " checks failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "All slide virtual texture checks passed" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,595 @@
+/**
+ * Check of the slide virtual texture as rendered by OpenGL, in an offscreen EGL context
+ * (e.g. with Mesa's llvmpipe software rasterizer, by setting LIBGL_ALWAYS_SOFTWARE=1).
+ *
+ * The tiles of a synthetic three-level slide are padded into the slots of an atlas texture and
+ * the pages of a page table texture are laid out by \c SlideAtlasLayout, as \c SlideTileAtlas and
+ * \c SlidePageTable do. Each level of the slide is then rendered pixel by pixel with the
+ * sampleImage2d() function of the Mesh and MeshPeel fragment shaders. Every rendered pixel is
+ * compared with a bilinear sample of the finest resident tile that covers its page, or with
+ * the non-virtual image texture if no resident tile covers the page.
+ *
+ * Usage: SlideVirtualTextureRenderCheck
+ */
+
+#define GL_GLEXT_PROTOTYPES
+#define EGL_EGLEXT_PROTOTYPES
+
+#include "rendering/records/SlideAtlasLayout.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+
+namespace
+{
+
+const char* sk_meshFragSource =
+    #include "rendering/shaders/Mesh.frag"
+        ;
+
+const char* sk_meshPeelFragSource =
+    #include "rendering/shaders/MeshPeel.frag"
+        ;
+
+/// Tile size of the synthetic slide and of the atlas
+static constexpr int64_t sk_tileSize = 8;
+
+/// Dimensions of the levels of the synthetic slide. The last tiles of each level are partial.
+const std::vector<glm::i64vec2> sk_levelDims{ { 20, 13 }, { 10, 7 }, { 5, 4 } };
+
+/// Color of the non-virtual image texture, which is sampled where no resident tile covers a page
+static constexpr uint32_t sk_fallbackColor = 0xFFFF00FF;
+
+/// Largest difference of a color component from its expected value
+static constexpr int sk_tolerance = 3;
+
+
+int s_numFailures = 0;
+
+void check( bool condition, const std::string& what )
+{
+    if ( ! condition )
+    {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++s_numFailures;
+    }
+}
+
+
+/// ARGB pixel of a slide tile. The components vary over the tile and differ between tiles,
+/// so that samples of the wrong tile or of the wrong texels are detected.
+uint32_t tilePixel( const slideio::SlideTileKey& key, int64_t x, int64_t y )
+{
+    const uint32_t a = static_cast<uint32_t>( 100 + 20 * y );
+    const uint32_t r = static_cast<uint32_t>( 20 + 60 * key.m_level );
+    const uint32_t g = static_cast<uint32_t>( 10 + 80 * key.m_index.x + 40 * key.m_index.y );
+    const uint32_t b = static_cast<uint32_t>( 10 + 20 * x );
+    return ( a << 24 ) | ( r << 16 ) | ( g << 8 ) | b;
+}
+
+slideio::SlideTile makeTile( const slideio::SlideTileKey& key )
+{
+    const glm::i64vec2 levelDims = sk_levelDims[ static_cast<size_t>( key.m_level ) ];
+
+    slideio::SlideTile tile;
+    tile.m_level = key.m_level;
+    tile.m_index = key.m_index;
+    tile.m_dims = glm::min( levelDims - key.m_index * sk_tileSize, glm::i64vec2{ sk_tileSize } );
+    tile.m_data = std::make_unique< uint32_t[] >( static_cast<size_t>( tile.m_dims.x * tile.m_dims.y ) );
+
+    for ( int64_t y = 0; y < tile.m_dims.y; ++y )
+    {
+        for ( int64_t x = 0; x < tile.m_dims.x; ++x )
+        {
+            tile.m_data[ static_cast<size_t>( y * tile.m_dims.x + x ) ] = tilePixel( key, x, y );
+        }
+    }
+
+    return tile;
+}
+
+/// Components of an ARGB pixel in RGBA order
+glm::dvec4 rgba( uint32_t argb )
+{
+    return glm::dvec4{ ( argb >> 16 ) & 0xFF, ( argb >> 8 ) & 0xFF, argb & 0xFF, ( argb >> 24 ) & 0xFF };
+}
+
+/// Bilinear sample of a tile at continuous tile pixel coordinates, with the tile edges clamped.
+/// This is what the atlas returns inside a padded slot.
+glm::dvec4 sampleTile( const slideio::SlideTile& tile, const glm::dvec2& coords )
+{
+    const glm::dvec2 c = coords - 0.5;
+    const glm::dvec2 c0 = glm::floor( c );
+    const glm::dvec2 f = c - c0;
+
+    auto texel = [&tile] ( int64_t x, int64_t y )
+    {
+        x = std::clamp( x, int64_t( 0 ), tile.m_dims.x - 1 );
+        y = std::clamp( y, int64_t( 0 ), tile.m_dims.y - 1 );
+        return rgba( tile.m_data[ static_cast<size_t>( y * tile.m_dims.x + x ) ] );
+    };
+
+    const int64_t x0 = static_cast<int64_t>( c0.x );
+    const int64_t y0 = static_cast<int64_t>( c0.y );
+
+    return glm::mix( glm::mix( texel( x0, y0 ), texel( x0 + 1, y0 ), f.x ),
+                     glm::mix( texel( x0, y0 + 1 ), texel( x0 + 1, y0 + 1 ), f.x ), f.y );
+}
+
+
+/// Finest resident tile at or coarser than a level that entirely covers a page of the level.
+/// Coverage is tested in exact integer arithmetic on the normalized slide extents.
+const slideio::SlideTileKey* coveringTile(
+        const std::vector<slideio::SlideTileKey>& residentKeys, int level, const glm::i64vec2& page )
+{
+    const glm::i64vec2 pageLevelDims = sk_levelDims[ static_cast<size_t>( level ) ];
+    const glm::i64vec2 pageMin = page * sk_tileSize;
+    const glm::i64vec2 pageMax = glm::min( ( page + int64_t( 1 ) ) * sk_tileSize, pageLevelDims );
+
+    const slideio::SlideTileKey* best = nullptr;
+
+    for ( const auto& key : residentKeys )
+    {
+        if ( key.m_level < level || ( best && best->m_level <= key.m_level ) )
+        {
+            continue;
+        }
+
+        const glm::i64vec2 tileLevelDims = sk_levelDims[ static_cast<size_t>( key.m_level ) ];
+        const glm::i64vec2 tileMin = key.m_index * sk_tileSize;
+        const glm::i64vec2 tileMax = glm::min( ( key.m_index + int64_t( 1 ) ) * sk_tileSize, tileLevelDims );
+
+        bool covers = true;
+
+        for ( int i = 0; i < 2; ++i )
+        {
+            covers &= ( pageMin[i] * tileLevelDims[i] >= tileMin[i] * pageLevelDims[i] );
+            covers &= ( pageMax[i] * tileLevelDims[i] <= tileMax[i] * pageLevelDims[i] );
+        }
+
+        if ( covers )
+        {
+            best = &key;
+        }
+    }
+
+    return best;
+}
+
+
+/// Extract a function definition from shader source by matching its braces
+std::string extractFunction( const std::string& source, const std::string& signature )
+{
+    const size_t begin = source.find( signature );
+
+    if ( std::string::npos == begin )
+    {
+        return std::string{};
+    }
+
+    int depth = 0;
+
+    for ( size_t i = source.find( '{', begin ); i < source.size(); ++i )
+    {
+        if ( '{' == source[i] )
+        {
+            ++depth;
+        }
+        else if ( '}' == source[i] && 0 == --depth )
+        {
+            return source.substr( begin, i + 1 - begin );
+        }
+    }
+
+    return std::string{};
+}
+
+
+const char* sk_vertexSource = R"(
+#version 330 core
+
+out VS_OUT
+{
+    vec2 TexCoords2D;
+} vs_out;
+
+void main()
+{
+    // Triangle that covers the viewport
+    vec2 pos = vec2( ( gl_VertexID == 1 ) ? 3.0 : -1.0, ( gl_VertexID == 2 ) ? 3.0 : -1.0 );
+    vs_out.TexCoords2D = 0.5 * pos + 0.5;
+    gl_Position = vec4( pos, 0.0, 1.0 );
+}
+)";
+
+const char* sk_fragmentHeader = R"(
+#version 330 core
+
+in VS_OUT
+{
+    vec2 TexCoords2D;
+} fs_in;
+
+out vec4 OutColor;
+
+uniform sampler2D tex2D;
+uniform sampler2D tex2DAtlas;
+uniform sampler2D tex2DPageTable;
+uniform vec2 tex2DPageScale;
+uniform bool tex2DVirtual;
+
+)";
+
+const char* sk_fragmentMain = R"(
+
+void main()
+{
+    OutColor = sampleImage2d();
+}
+)";
+
+
+GLuint compileShader( GLenum type, const std::string& source )
+{
+    const GLuint shader = glCreateShader( type );
+    const char* s = source.c_str();
+    glShaderSource( shader, 1, &s, nullptr );
+    glCompileShader( shader );
+
+    GLint status = GL_FALSE;
+    glGetShaderiv( shader, GL_COMPILE_STATUS, &status );
+
+    if ( GL_TRUE != status )
+    {
+        std::array<char, 4096> log{};
+        glGetShaderInfoLog( shader, static_cast<GLsizei>( log.size() ), nullptr, log.data() );
+        std::cerr << "Shader compilation failed: " << log.data() << std::endl;
+        return 0;
+    }
+
+    return shader;
+}
+
+GLuint linkProgram( const std::string& sampleFunction )
+{
+    const GLuint vs = compileShader( GL_VERTEX_SHADER, sk_vertexSource );
+    const GLuint fs = compileShader( GL_FRAGMENT_SHADER,
+                                     sk_fragmentHeader + sampleFunction + sk_fragmentMain );
+    if ( ! vs || ! fs )
+    {
+        return 0;
+    }
+
+    const GLuint program = glCreateProgram();
+    glAttachShader( program, vs );
+    glAttachShader( program, fs );
+    glLinkProgram( program );
+    glDeleteShader( vs );
+    glDeleteShader( fs );
+
+    GLint status = GL_FALSE;
+    glGetProgramiv( program, GL_LINK_STATUS, &status );
+
+    if ( GL_TRUE != status )
+    {
+        std::cerr << "Shader program linking failed" << std::endl;
+        return 0;
+    }
+
+    return program;
+}
+
+
+GLuint createTexture( GLenum filter )
+{
+    GLuint texture = 0;
+    glGenTextures( 1, &texture );
+
+    // Use a texture unit that the shader does not sample, so that no sampled texture is unbound
+    glActiveTexture( GL_TEXTURE3 );
+    glBindTexture( GL_TEXTURE_2D, texture );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, static_cast<GLint>( filter ) );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, static_cast<GLint>( filter ) );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0 );
+    return texture;
+}
+
+
+/// Insert tiles of the synthetic slide into an atlas, upload their padded slots and the page
+/// tables of all levels, then render each level with a sampleImage2d() function and compare
+/// every pixel with its expected value
+void checkRendering( const std::string& name,
+                     const std::string& sampleFunction,
+                     const std::vector<slideio::SlideTileKey>& insertedKeys,
+                     int numSlotsPerSide )
+{
+    const GLuint program = linkProgram( sampleFunction );
+    check( 0 != program, name + ": shader program builds" );
+
+    if ( ! program )
+    {
+        return;
+    }
+
+    const UID slideUid = insertedKeys.front().m_slideUid;
+
+    SlideAtlasLayout layout( sk_tileSize, numSlotsPerSide );
+
+    // Atlas texture, allocated without data and written slot by slot, as by SlideTileAtlas
+    const glm::i64vec2 atlasDims = layout.dims();
+    const GLuint atlasTexture = createTexture( GL_LINEAR );
+    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, static_cast<GLsizei>( atlasDims.x ),
+                  static_cast<GLsizei>( atlasDims.y ), 0, GL_BGRA, GL_UNSIGNED_BYTE, nullptr );
+
+    std::vector<slideio::SlideTile> tiles;
+    std::vector<uint32_t> slotBuffer;
+
+    for ( const auto& key : insertedKeys )
+    {
+        tiles.emplace_back( makeTile( key ) );
+
+        // Insert each tile in its own set of requests, so that it may evict earlier tiles
+        layout.beginRequests();
+        const auto tileOrigin = layout.insertTile( key );
+        check( tileOrigin.has_value(), name + ": tile inserted" );
+
+        if ( ! tileOrigin )
+        {
+            continue;
+        }
+
+        layout.padTile( tiles.back(), slotBuffer );
+
+        const GLsizei slotSize = static_cast<GLsizei>( sk_tileSize + 2 * SlideAtlasLayout::sk_slotBorder );
+        const glm::i64vec2 origin = *tileOrigin - SlideAtlasLayout::sk_slotBorder;
+
+        glTexSubImage2D( GL_TEXTURE_2D, 0, static_cast<GLint>( origin.x ), static_cast<GLint>( origin.y ),
+                         slotSize, slotSize, GL_BGRA, GL_UNSIGNED_BYTE, slotBuffer.data() );
+    }
+
+    std::vector<slideio::SlideTileKey> residentKeys;
+
+    for ( const auto& t : layout.residentTiles( slideUid ) )
+    {
+        residentKeys.push_back( t.first );
+    }
+
+    const GLuint fallbackTexture = createTexture( GL_NEAREST );
+    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_BGRA, GL_UNSIGNED_BYTE, &sk_fallbackColor );
+
+    const GLuint pageTableTexture = createTexture( GL_NEAREST );
+
+    glUseProgram( program );
+    glUniform1i( glGetUniformLocation( program, "tex2D" ), 0 );
+    glUniform1i( glGetUniformLocation( program, "tex2DAtlas" ), 1 );
+    glUniform1i( glGetUniformLocation( program, "tex2DPageTable" ), 2 );
+    glUniform1i( glGetUniformLocation( program, "tex2DVirtual" ), GL_TRUE );
+
+    glActiveTexture( GL_TEXTURE0 );
+    glBindTexture( GL_TEXTURE_2D, fallbackTexture );
+    glActiveTexture( GL_TEXTURE1 );
+    glBindTexture( GL_TEXTURE_2D, atlasTexture );
+
+    for ( int level = 0; level < static_cast<int>( sk_levelDims.size() ); ++level )
+    {
+        const glm::i64vec2 levelDims = sk_levelDims[ static_cast<size_t>( level ) ];
+        const glm::i64vec2 numPages = ( levelDims + sk_tileSize - int64_t( 1 ) ) / sk_tileSize;
+        const std::vector<glm::vec4> pages = layout.pageTable( slideUid, sk_levelDims, sk_tileSize, level );
+
+        glActiveTexture( GL_TEXTURE2 );
+        glBindTexture( GL_TEXTURE_2D, pageTableTexture );
+        glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA32F, static_cast<GLsizei>( numPages.x ),
+                      static_cast<GLsizei>( numPages.y ), 0, GL_RGBA, GL_FLOAT, pages.data() );
+
+        const glm::vec2 pageScale{ glm::dvec2{ levelDims } / double( sk_tileSize ) };
+        glUniform2f( glGetUniformLocation( program, "tex2DPageScale" ), pageScale.x, pageScale.y );
+
+        // Render one fragment per pixel of the level
+        GLuint colorTexture = createTexture( GL_NEAREST );
+        glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, static_cast<GLsizei>( levelDims.x ),
+                      static_cast<GLsizei>( levelDims.y ), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr );
+
+        GLuint fbo = 0;
+        glGenFramebuffers( 1, &fbo );
+        glBindFramebuffer( GL_FRAMEBUFFER, fbo );
+        glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0 );
+
+        check( GL_FRAMEBUFFER_COMPLETE == glCheckFramebufferStatus( GL_FRAMEBUFFER ),
+               name + ": framebuffer complete" );
+
+        glViewport( 0, 0, static_cast<GLsizei>( levelDims.x ), static_cast<GLsizei>( levelDims.y ) );
+        glDrawArrays( GL_TRIANGLES, 0, 3 );
+
+        std::vector<uint8_t> pixels( static_cast<size_t>( 4 * levelDims.x * levelDims.y ) );
+        glReadPixels( 0, 0, static_cast<GLsizei>( levelDims.x ), static_cast<GLsizei>( levelDims.y ),
+                      GL_RGBA, GL_UNSIGNED_BYTE, pixels.data() );
+
+        int numWrongPixels = 0;
+
+        for ( int64_t y = 0; y < levelDims.y; ++y )
+        {
+            for ( int64_t x = 0; x < levelDims.x; ++x )
+            {
+                const glm::i64vec2 page{ x / sk_tileSize, y / sk_tileSize };
+                const slideio::SlideTileKey* key = coveringTile( residentKeys, level, page );
+
+                glm::dvec4 expected = rgba( sk_fallbackColor );
+
+                if ( key )
+                {
+                    const auto tile = std::find_if( std::begin( tiles ), std::end( tiles ),
+                                                    [key] ( const slideio::SlideTile& t ) {
+                        return ( t.m_level == key->m_level && t.m_index == key->m_index ); } );
+
+                    // Pixel center in the pixel coordinates of the tile
+                    const glm::dvec2 slideCoords = ( glm::dvec2{ x, y } + 0.5 ) / glm::dvec2{ levelDims };
+                    const glm::dvec2 tileLevelDims{ sk_levelDims[ static_cast<size_t>( key->m_level ) ] };
+                    const glm::dvec2 tileCoords = slideCoords * tileLevelDims -
+                            glm::dvec2{ key->m_index } * double( sk_tileSize );
+
+                    expected = sampleTile( *tile, tileCoords );
+                }
+
+                const uint8_t* p = pixels.data() + 4 * ( y * levelDims.x + x );
+                bool match = true;
+
+                for ( int c = 0; c < 4; ++c )
+                {
+                    match &= ( std::abs( static_cast<double>( p[c] ) - expected[c] ) <= sk_tolerance );
+                }
+
+                if ( ! match && numWrongPixels++ < 5 )
+                {
+                    std::cerr << name << ": level " << level << " pixel (" << x << ", " << y << ") is ("
+                              << int( p[0] ) << ", " << int( p[1] ) << ", " << int( p[2] ) << ", " << int( p[3] )
+                              << "), expected (" << expected[0] << ", " << expected[1] << ", "
+                              << expected[2] << ", " << expected[3] << ")" << std::endl;
+                }
+            }
+        }
+
+        check( 0 == numWrongPixels, name + ": level " + std::to_string( level ) + " renders as expected" );
+
+        glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+        glDeleteFramebuffers( 1, &fbo );
+        glDeleteTextures( 1, &colorTexture );
+    }
+
+    glDeleteTextures( 1, &pageTableTexture );
+    glDeleteTextures( 1, &fallbackTexture );
+    glDeleteTextures( 1, &atlasTexture );
+    glDeleteProgram( program );
+}
+
+
+bool makeContextCurrent()
+{
+    EGLDisplay display = EGL_NO_DISPLAY;
+
+    // Prefer a display that needs no window system
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+                eglGetProcAddress( "eglGetPlatformDisplayEXT" ) );
+
+    if ( getPlatformDisplay )
+    {
+        display = getPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr );
+    }
+
+    if ( EGL_NO_DISPLAY == display )
+    {
+        display = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+    }
+
+    if ( EGL_NO_DISPLAY == display || ! eglInitialize( display, nullptr, nullptr ) )
+    {
+        std::cerr << "Unable to initialize an EGL display" << std::endl;
+        return false;
+    }
+
+    if ( ! eglBindAPI( EGL_OPENGL_API ) )
+    {
+        std::cerr << "Unable to bind the OpenGL API" << std::endl;
+        return false;
+    }
+
+    // Rendering is into a framebuffer object, so any configuration will do. A surfaceless
+    // display may have no configurations, in which case the context is created without one.
+    const EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+
+    EGLConfig config = EGL_NO_CONFIG_KHR;
+    EGLint numConfigs = 0;
+
+    if ( ! eglChooseConfig( display, configAttribs, &config, 1, &numConfigs ) || numConfigs < 1 )
+    {
+        config = EGL_NO_CONFIG_KHR;
+    }
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE };
+
+    EGLContext context = eglCreateContext( display, config, EGL_NO_CONTEXT, contextAttribs );
+
+    if ( EGL_NO_CONTEXT == context || ! eglMakeCurrent( display, EGL_NO_SURFACE, EGL_NO_SURFACE, context ) )
+    {
+        std::cerr << "Unable to make an OpenGL 3.3 core context current" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+} // anonymous
+
+
+int main()
+{
+    if ( ! makeContextCurrent() )
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "Renderer: " << glGetString( GL_RENDERER ) << std::endl;
+
+    // A vertex array must be bound to draw in a core context
+    GLuint vao = 0;
+    glGenVertexArrays( 1, &vao );
+    glBindVertexArray( vao );
+
+    const UID slideUid;
+    auto key = [&slideUid] ( int level, int64_t x, int64_t y ) {
+        return slideio::SlideTileKey{ slideUid, level, glm::i64vec2{ x, y } };
+    };
+
+    const std::vector< std::pair<std::string, std::string> > sampleFunctions{
+        { "Mesh.frag", extractFunction( sk_meshFragSource, "vec4 sampleImage2d()" ) },
+        { "MeshPeel.frag", extractFunction( sk_meshPeelFragSource, "vec4 sampleImage2d()" ) } };
+
+    for ( const auto& f : sampleFunctions )
+    {
+        check( ! f.second.empty(), f.first + ": sampleImage2d() found" );
+
+        if ( f.second.empty() )
+        {
+            continue;
+        }
+
+        // Coarsest level, one tile of the middle level, and a full and a partial tile
+        // of the finest level: every page is covered
+        checkRendering( f.first + " with coarse tiles", f.second,
+                        { key( 2, 0, 0 ), key( 1, 1, 0 ), key( 0, 0, 0 ), key( 0, 2, 1 ) }, 3 );
+
+        // A single finest tile: all other pages fall back to the image texture
+        checkRendering( f.first + " with one fine tile", f.second, { key( 0, 1, 0 ) }, 2 );
+
+        // More tiles than slots: the first tiles are evicted, and their pages fall back
+        checkRendering( f.first + " after eviction", f.second,
+                        { key( 0, 0, 0 ), key( 0, 1, 0 ), key( 1, 0, 0 ), key( 0, 2, 1 ), key( 0, 1, 1 ) }, 2 );
+    }
+
+    if ( 0 != s_numFailures )
+    {
+        std::cerr << s_numFailures << " checks failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "All checks passed" << std::endl;
+    return EXIT_SUCCESS;
+}
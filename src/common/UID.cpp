@@ -10,8 +10,10 @@
 namespace
 {
 
-/// @note equivalent to boost::uuids::basic_random_generator<boost::mt19937>:
-static boost::uuids::random_generator s_randomGen;
+/// @note equivalent to boost::uuids::basic_random_generator<boost::mt19937>.
+/// The generator is not thread safe and UIDs are created on worker threads
+/// (e.g. while reading project files), so each thread has its own generator.
+static thread_local boost::uuids::random_generator s_randomGen;
 static boost::uuids::string_generator s_stringGen;
 
 } // anonymous
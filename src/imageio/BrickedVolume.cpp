@@ -0,0 +1,630 @@
+#include "BrickedVolume.h"
+#include "ImageHeader.h"
+
+#include "itkbridge/ITKBridge.hpp"
+#include "itkdetails/ImageMapping.hpp"
+#include "util/ThreadPool.h"
+
+#include <boost/filesystem.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+
+namespace
+{
+
+/// Size of the region at the start of the brick file that holds the header. Bricks start
+/// at a page boundary.
+static constexpr uint64_t sk_headerRegionSize = 4096;
+
+static constexpr uint32_t sk_brickFileVersion = 1;
+static constexpr std::array< char, 8 > sk_brickFileMagic{ { 'H', 'Z', 'B', 'R', 'I', 'C', 'K', '\0' } };
+
+
+/// Header of a brick file
+struct BrickFileHeader
+{
+    std::array< char, 8 > m_magic;
+    uint32_t m_version;
+    uint32_t m_componentType;
+    std::array< uint64_t, 3 > m_pixelDimensions;
+    uint32_t m_brickSize;
+    uint32_t m_reserved;
+    double m_minimum;
+    double m_maximum;
+};
+
+static_assert( 64 == sizeof( BrickFileHeader ), "Brick file header must not be padded" );
+
+
+/// Get the number of bricks along each axis of a volume
+glm::u64vec3 computeNumBricks( const glm::u64vec3& pixelDimensions, uint32_t brickSize )
+{
+    return ( pixelDimensions + glm::u64vec3{ brickSize - 1 } ) / glm::u64vec3{ brickSize };
+}
+
+
+/// Convert a pixel component to double-precision floating point
+double componentToDouble( const uint8_t* component, const imageio::ComponentType& componentType )
+{
+    using imageio::ComponentType;
+
+    auto read = [component] ( auto value ) -> double
+    {
+        std::memcpy( &value, component, sizeof( value ) );
+        return static_cast<double>( value );
+    };
+
+    switch ( componentType )
+    {
+    case ComponentType::Int8:     return read( int8_t{} );
+    case ComponentType::UInt8:    return read( uint8_t{} );
+    case ComponentType::Int16:    return read( int16_t{} );
+    case ComponentType::UInt16:   return read( uint16_t{} );
+    case ComponentType::Int32:    return read( int32_t{} );
+    case ComponentType::UInt32:   return read( uint32_t{} );
+    case ComponentType::Int64:    return read( int64_t{} );
+    case ComponentType::UInt64:   return read( uint64_t{} );
+    case ComponentType::Float32:  return read( float{} );
+    case ComponentType::Double64: return read( double{} );
+    }
+
+    return 0.0;
+}
+
+
+/// Widen a range of values to the values of a row of pixels. NaN values are ignored.
+void updateValueRange( const uint8_t* row, uint64_t count, const imageio::ComponentType& componentType,
+                       double& minimum, double& maximum )
+{
+    using imageio::ComponentType;
+
+    auto update = [row, count, &minimum, &maximum] ( auto value )
+    {
+        const auto* pixels = reinterpret_cast<const decltype( value )*>( row );
+
+        for ( uint64_t i = 0; i < count; ++i )
+        {
+            const double v = static_cast<double>( pixels[i] );
+            if ( v < minimum ) minimum = v;
+            if ( v > maximum ) maximum = v;
+        }
+    };
+
+    switch ( componentType )
+    {
+    case ComponentType::Int8:     update( int8_t{} ); break;
+    case ComponentType::UInt8:    update( uint8_t{} ); break;
+    case ComponentType::Int16:    update( int16_t{} ); break;
+    case ComponentType::UInt16:   update( uint16_t{} ); break;
+    case ComponentType::Int32:    update( int32_t{} ); break;
+    case ComponentType::UInt32:   update( uint32_t{} ); break;
+    case ComponentType::Int64:    update( int64_t{} ); break;
+    case ComponentType::UInt64:   update( uint64_t{} ); break;
+    case ComponentType::Float32:  update( float{} ); break;
+    case ComponentType::Double64: update( double{} ); break;
+    }
+}
+
+
+/// Read bytes at an offset of a file, continuing after partial reads
+bool readFully( int fd, uint64_t offset, size_t numBytes, uint8_t* dest )
+{
+    while ( numBytes > 0 )
+    {
+        const ssize_t n = ::pread( fd, dest, numBytes, static_cast<off_t>( offset ) );
+
+        if ( n <= 0 )
+        {
+            return false;
+        }
+
+        dest += n;
+        offset += static_cast<uint64_t>( n );
+        numBytes -= static_cast<size_t>( n );
+    }
+
+    return true;
+}
+
+} // anonymous
+
+
+namespace imageio
+{
+
+struct BrickedVolume::Impl
+{
+    ~Impl()
+    {
+        if ( m_fd >= 0 )
+        {
+            ::close( m_fd );
+        }
+    }
+
+    int m_fd = -1;
+
+    ComponentType m_componentType = ComponentType::UInt8;
+    uint32_t m_componentSize = 1;
+    glm::u64vec3 m_pixelDimensions{ 0 };
+    uint32_t m_brickSize = 0;
+    glm::u64vec3 m_numBricks{ 0 };
+    size_t m_brickSizeInBytes = 0;
+    std::pair<double, double> m_valueRange{ 0.0, 0.0 };
+
+    /// Maximum number of cached bricks
+    size_t m_cacheCapacity = 1;
+
+    /// Cached bricks, keyed by linear brick index, and the recency order of their keys
+    /// (most recently used first)
+    using BrickPtr = std::shared_ptr< const std::vector<uint8_t> >;
+    mutable std::unordered_map< uint64_t, std::pair< BrickPtr, std::list<uint64_t>::iterator > > m_cache;
+    mutable std::list<uint64_t> m_recency;
+    mutable std::mutex m_cacheMutex;
+};
+
+
+BrickedVolume::BrickedVolume()
+    : m_impl( std::make_unique<Impl>() )
+{}
+
+BrickedVolume::~BrickedVolume() = default;
+
+
+bool BrickedVolume::createBrickFile(
+        const void* buffer,
+        const ComponentType& componentType,
+        const glm::u64vec3& pixelDimensions,
+        const std::string& brickFileName,
+        uint32_t brickSize )
+{
+    if ( ! buffer || 0 == brickSize || glm::any( glm::equal( pixelDimensions, glm::u64vec3{ 0 } ) ) )
+    {
+        return false;
+    }
+
+    const uint64_t compSize = itkbridge::k_bytesPerComponentMap.at( componentType );
+    const uint64_t B = brickSize;
+    const glm::u64vec3 numBricks = computeNumBricks( pixelDimensions, brickSize );
+    const size_t brickSizeInBytes = static_cast<size_t>( B * B * B * compSize );
+
+    BrickFileHeader header;
+    header.m_magic = sk_brickFileMagic;
+    header.m_version = sk_brickFileVersion;
+    header.m_componentType = static_cast<uint32_t>( componentType );
+    header.m_pixelDimensions = { { pixelDimensions.x, pixelDimensions.y, pixelDimensions.z } };
+    header.m_brickSize = brickSize;
+    header.m_reserved = 0;
+    header.m_minimum = std::numeric_limits<double>::max();
+    header.m_maximum = std::numeric_limits<double>::lowest();
+
+    // Write to a temporary file, so that an interrupted write does not leave a
+    // brick file that looks valid
+    const std::string tempFileName = brickFileName + ".tmp";
+
+    std::ofstream file( tempFileName, std::ios::binary | std::ios::trunc );
+
+    if ( ! file )
+    {
+        std::cerr << "Unable to create brick file '" << tempFileName << "'" << std::endl;
+        return false;
+    }
+
+    // The header is written once the value range is known. Until then, its region is zero,
+    // so the file is not valid.
+    std::vector<char> headerRegion( sk_headerRegionSize, 0 );
+    file.write( headerRegion.data(), static_cast<std::streamsize>( headerRegion.size() ) );
+
+    const uint8_t* source = static_cast<const uint8_t*>( buffer );
+    const uint64_t rowSize = pixelDimensions.x * compSize;
+
+    // One row of bricks along x is assembled at a time, so only a few slices of a
+    // memory-mapped volume are touched at once
+    std::vector<uint8_t> brickRow( static_cast<size_t>( numBricks.x ) * brickSizeInBytes );
+
+    for ( uint64_t bz = 0; bz < numBricks.z && file; ++bz )
+    {
+        for ( uint64_t by = 0; by < numBricks.y && file; ++by )
+        {
+            std::fill( std::begin( brickRow ), std::end( brickRow ), 0 );
+
+            const uint64_t zEnd = std::min( ( bz + 1 ) * B, pixelDimensions.z );
+            const uint64_t yEnd = std::min( ( by + 1 ) * B, pixelDimensions.y );
+
+            for ( uint64_t z = bz * B; z < zEnd; ++z )
+            {
+                for ( uint64_t y = by * B; y < yEnd; ++y )
+                {
+                    const uint8_t* sourceRow = source + ( z * pixelDimensions.y + y ) * rowSize;
+                    const uint64_t localRow = ( ( z - bz * B ) * B + ( y - by * B ) ) * B * compSize;
+
+                    updateValueRange( sourceRow, pixelDimensions.x, componentType,
+                                      header.m_minimum, header.m_maximum );
+
+                    for ( uint64_t bx = 0; bx < numBricks.x; ++bx )
+                    {
+                        const uint64_t xBegin = bx * B;
+                        const uint64_t count = std::min( B, pixelDimensions.x - xBegin );
+
+                        std::memcpy( brickRow.data() + bx * brickSizeInBytes + localRow,
+                                     sourceRow + xBegin * compSize,
+                                     static_cast<size_t>( count * compSize ) );
+                    }
+                }
+            }
+
+            file.write( reinterpret_cast<const char*>( brickRow.data() ),
+                        static_cast<std::streamsize>( brickRow.size() ) );
+        }
+    }
+
+    if ( header.m_minimum > header.m_maximum )
+    {
+        // All values are NaN
+        header.m_minimum = 0.0;
+        header.m_maximum = 0.0;
+    }
+
+    std::memcpy( headerRegion.data(), &header, sizeof( header ) );
+    file.seekp( 0 );
+    file.write( headerRegion.data(), static_cast<std::streamsize>( headerRegion.size() ) );
+    file.close();
+
+    if ( ! file )
+    {
+        std::cerr << "Error writing brick file '" << tempFileName << "'" << std::endl;
+        boost::system::error_code ec;
+        boost::filesystem::remove( tempFileName, ec );
+        return false;
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::rename( tempFileName, brickFileName, ec );
+
+    if ( ec )
+    {
+        std::cerr << "Unable to rename brick file '" << tempFileName << "' to '"
+                  << brickFileName << "': " << ec.message() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool BrickedVolume::createBrickFile(
+        const ImageHeader& header,
+        const std::string& brickFileName,
+        uint32_t brickSize )
+{
+    if ( 1 != header.m_numComponents )
+    {
+        std::cerr << "Brick files can only be created for scalar images, but image '"
+                  << header.m_fileName << "' has " << header.m_numComponents
+                  << " components" << std::endl;
+        return false;
+    }
+
+    const auto mapped = itkdetails::mapping::mapPixelData(
+                header.m_fileName, header.m_imageSizeInBytes, header.m_componentSizeInBytes );
+
+    if ( ! mapped )
+    {
+        std::cerr << "Unable to map the pixels of image '" << header.m_fileName
+                  << "' for creating a brick file" << std::endl;
+        return false;
+    }
+
+    return createBrickFile( mapped->m_pixels, header.m_componentType,
+                            header.m_pixelDimensions, brickFileName, brickSize );
+}
+
+
+std::unique_ptr<BrickedVolume> BrickedVolume::open(
+        const std::string& brickFileName,
+        size_t cacheSizeInBytes )
+{
+    const int fd = ::open( brickFileName.c_str(), O_RDONLY );
+
+    if ( fd < 0 )
+    {
+        std::cerr << "Unable to open brick file '" << brickFileName << "'" << std::endl;
+        return nullptr;
+    }
+
+    // The volume owns the descriptor from here on
+    std::unique_ptr<BrickedVolume> volume( new BrickedVolume() );
+    Impl& impl = *volume->m_impl;
+    impl.m_fd = fd;
+
+    BrickFileHeader header;
+
+    if ( ! readFully( fd, 0, sizeof( header ), reinterpret_cast<uint8_t*>( &header ) ) ||
+         header.m_magic != sk_brickFileMagic ||
+         sk_brickFileVersion != header.m_version ||
+         header.m_componentType > static_cast<uint32_t>( ComponentType::Double64 ) ||
+         0 == header.m_brickSize )
+    {
+        std::cerr << "File '" << brickFileName << "' is not a valid brick file" << std::endl;
+        return nullptr;
+    }
+
+    impl.m_componentType = static_cast<ComponentType>( header.m_componentType );
+    impl.m_componentSize = itkbridge::k_bytesPerComponentMap.at( impl.m_componentType );
+
+    impl.m_pixelDimensions = glm::u64vec3{ header.m_pixelDimensions[0],
+                                           header.m_pixelDimensions[1],
+                                           header.m_pixelDimensions[2] };
+
+    impl.m_valueRange = std::make_pair( header.m_minimum, header.m_maximum );
+    impl.m_brickSize = header.m_brickSize;
+    impl.m_numBricks = computeNumBricks( impl.m_pixelDimensions, impl.m_brickSize );
+
+    const size_t B = impl.m_brickSize;
+    impl.m_brickSizeInBytes = B * B * B * impl.m_componentSize;
+    impl.m_cacheCapacity = std::max( cacheSizeInBytes / impl.m_brickSizeInBytes, size_t( 1 ) );
+
+    return volume;
+}
+
+
+const ComponentType& BrickedVolume::componentType() const
+{
+    return m_impl->m_componentType;
+}
+
+uint32_t BrickedVolume::componentSizeInBytes() const
+{
+    return m_impl->m_componentSize;
+}
+
+const glm::u64vec3& BrickedVolume::pixelDimensions() const
+{
+    return m_impl->m_pixelDimensions;
+}
+
+uint32_t BrickedVolume::brickSize() const
+{
+    return m_impl->m_brickSize;
+}
+
+const glm::u64vec3& BrickedVolume::numBricks() const
+{
+    return m_impl->m_numBricks;
+}
+
+size_t BrickedVolume::brickSizeInBytes() const
+{
+    return m_impl->m_brickSizeInBytes;
+}
+
+std::pair<double, double> BrickedVolume::valueRange() const
+{
+    return m_impl->m_valueRange;
+}
+
+
+std::shared_ptr< const std::vector<uint8_t> >
+BrickedVolume::brick( const glm::u64vec3& brickIndex ) const
+{
+    const Impl& impl = *m_impl;
+
+    if ( glm::any( glm::greaterThanEqual( brickIndex, impl.m_numBricks ) ) )
+    {
+        return nullptr;
+    }
+
+    const uint64_t key = ( brickIndex.z * impl.m_numBricks.y + brickIndex.y ) *
+            impl.m_numBricks.x + brickIndex.x;
+
+    {
+        std::lock_guard< std::mutex > lock( impl.m_cacheMutex );
+
+        const auto it = impl.m_cache.find( key );
+
+        if ( std::end( impl.m_cache ) != it )
+        {
+            impl.m_recency.splice( std::begin( impl.m_recency ), impl.m_recency, it->second.second );
+            return it->second.first;
+        }
+    }
+
+    // The brick is read without holding the lock, so that other bricks can be
+    // accessed meanwhile
+    auto data = std::make_shared< std::vector<uint8_t> >( impl.m_brickSizeInBytes );
+
+    if ( ! readFully( impl.m_fd, sk_headerRegionSize + key * impl.m_brickSizeInBytes,
+                      impl.m_brickSizeInBytes, data->data() ) )
+    {
+        std::cerr << "Error reading brick " << key << " of brick file" << std::endl;
+        return nullptr;
+    }
+
+    std::lock_guard< std::mutex > lock( impl.m_cacheMutex );
+
+    const auto it = impl.m_cache.find( key );
+
+    if ( std::end( impl.m_cache ) != it )
+    {
+        // Another thread read the brick meanwhile
+        return it->second.first;
+    }
+
+    while ( impl.m_cache.size() >= impl.m_cacheCapacity )
+    {
+        impl.m_cache.erase( impl.m_recency.back() );
+        impl.m_recency.pop_back();
+    }
+
+    impl.m_recency.push_front( key );
+    impl.m_cache.emplace( key, std::make_pair( data, std::begin( impl.m_recency ) ) );
+
+    return data;
+}
+
+
+bool BrickedVolume::pixelValue( const glm::u64vec3& pixelIndex, double& value ) const
+{
+    const Impl& impl = *m_impl;
+
+    if ( glm::any( glm::greaterThanEqual( pixelIndex, impl.m_pixelDimensions ) ) )
+    {
+        return false;
+    }
+
+    const glm::u64vec3 B{ impl.m_brickSize };
+    const auto data = brick( pixelIndex / B );
+
+    if ( ! data )
+    {
+        return false;
+    }
+
+    const glm::u64vec3 local = pixelIndex % B;
+    const uint64_t offset = ( ( local.z * B.y + local.y ) * B.x + local.x ) * impl.m_componentSize;
+
+    value = componentToDouble( data->data() + offset, impl.m_componentType );
+    return true;
+}
+
+
+bool BrickedVolume::extractSlice( uint32_t axis, uint64_t sliceIndex, void* dest ) const
+{
+    const Impl& impl = *m_impl;
+
+    if ( axis > 2 || sliceIndex >= impl.m_pixelDimensions[axis] || ! dest )
+    {
+        return false;
+    }
+
+    // Axes spanned by the slice: u varies fastest
+    const uint32_t u = ( 0 == axis ) ? 1 : 0;
+    const uint32_t v = ( 2 == axis ) ? 1 : 2;
+
+    const uint64_t B = impl.m_brickSize;
+    const uint64_t compSize = impl.m_componentSize;
+    const uint64_t sliceWidth = impl.m_pixelDimensions[u];
+
+    // Strides in bytes within a brick along each axis
+    const glm::u64vec3 brickStrides{ compSize, B * compSize, B * B * compSize };
+
+    uint8_t* out = static_cast<uint8_t*>( dest );
+
+    glm::u64vec3 brickIndex;
+    brickIndex[axis] = sliceIndex / B;
+
+    const uint64_t localSliceOffset = ( sliceIndex % B ) * brickStrides[axis];
+
+    for ( uint64_t bv = 0; bv < impl.m_numBricks[v]; ++bv )
+    {
+        for ( uint64_t bu = 0; bu < impl.m_numBricks[u]; ++bu )
+        {
+            brickIndex[u] = bu;
+            brickIndex[v] = bv;
+
+            const auto data = brick( brickIndex );
+
+            if ( ! data )
+            {
+                return false;
+            }
+
+            const uint64_t uCount = std::min( B, sliceWidth - bu * B );
+            const uint64_t vCount = std::min( B, impl.m_pixelDimensions[v] - bv * B );
+
+            for ( uint64_t lv = 0; lv < vCount; ++lv )
+            {
+                const uint8_t* src = data->data() + localSliceOffset + lv * brickStrides[v];
+                uint8_t* dst = out + ( ( bv * B + lv ) * sliceWidth + bu * B ) * compSize;
+
+                if ( 0 == u )
+                {
+                    // Rows along x are contiguous in the brick
+                    std::memcpy( dst, src, static_cast<size_t>( uCount * compSize ) );
+                }
+                else
+                {
+                    for ( uint64_t lu = 0; lu < uCount; ++lu )
+                    {
+                        std::memcpy( dst + lu * compSize, src + lu * brickStrides[u],
+                                     static_cast<size_t>( compSize ) );
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+
+bool BrickedVolume::extractSlab( uint64_t zBegin, uint64_t zEnd, void* dest, size_t numThreads ) const
+{
+    const Impl& impl = *m_impl;
+
+    if ( zBegin >= zEnd || zEnd > impl.m_pixelDimensions.z || ! dest )
+    {
+        return false;
+    }
+
+    const uint64_t B = impl.m_brickSize;
+    const uint64_t compSize = impl.m_componentSize;
+    const glm::u64vec3& dims = impl.m_pixelDimensions;
+
+    const uint64_t bzBegin = zBegin / B;
+    const uint64_t bzEnd = ( zEnd - 1 ) / B + 1;
+    const uint64_t numBricksPerLayer = impl.m_numBricks.x * impl.m_numBricks.y;
+
+    uint8_t* out = static_cast<uint8_t*>( dest );
+    std::atomic<bool> extracted{ true };
+
+    // Each brick fills its own part of the slab
+    parallel::forEachIndex( static_cast<size_t>( ( bzEnd - bzBegin ) * numBricksPerLayer ),
+                            [&] ( size_t, size_t i )
+    {
+        const glm::u64vec3 brickIndex{ i % impl.m_numBricks.x,
+                                       ( i / impl.m_numBricks.x ) % impl.m_numBricks.y,
+                                       bzBegin + i / numBricksPerLayer };
+
+        const auto data = brick( brickIndex );
+
+        if ( ! data )
+        {
+            extracted = false;
+            return;
+        }
+
+        const glm::u64vec3 origin = brickIndex * B;
+        const uint64_t xCount = std::min( B, dims.x - origin.x );
+        const uint64_t yCount = std::min( B, dims.y - origin.y );
+
+        for ( uint64_t z = std::max( zBegin, origin.z ); z < std::min( zEnd, origin.z + B ); ++z )
+        {
+            for ( uint64_t ly = 0; ly < yCount; ++ly )
+            {
+                const uint8_t* src = data->data() + ( ( z - origin.z ) * B + ly ) * B * compSize;
+                uint8_t* dst = out + ( ( ( z - zBegin ) * dims.y + origin.y + ly ) * dims.x + origin.x ) * compSize;
+
+                std::memcpy( dst, src, static_cast<size_t>( xCount * compSize ) );
+            }
+        }
+    }, numThreads );
+
+    return extracted;
+}
+
+} // namespace imageio
@@ -0,0 +1,181 @@
+#ifndef IMAGEIO_BRICKED_VOLUME_H
+#define IMAGEIO_BRICKED_VOLUME_H
+
+#include "HZeeTypes.hpp"
+
+#include <glm/vec3.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace imageio
+{
+
+class ImageHeader;
+
+
+/**
+ * @brief Out-of-core storage of a scalar image volume as cubic bricks in a file on disk.
+ * Bricks are read on demand into a cache of bounded size, so that volumes larger than memory
+ * can be accessed.
+ *
+ * The brick file holds a header followed by the bricks in order of brick index, with the
+ * x index varying fastest. The pixels of each brick are likewise ordered with x fastest.
+ * Bricks on the far edges of the volume are padded with zeros to the full brick size,
+ * so that the offset of every brick in the file is a multiple of the brick size.
+ * The header also holds the range of pixel values, which is found while the bricks are written.
+ */
+class BrickedVolume
+{
+public:
+
+    /// Default number of pixels along each edge of a brick
+    static constexpr uint32_t sk_defaultBrickSize = 64;
+
+    /// Default capacity of the brick cache (1 GiB)
+    static constexpr size_t sk_defaultCacheSizeInBytes = size_t( 1 ) << 30;
+
+
+    /**
+     * @brief Write a brick file for a scalar volume that is stored contiguously in memory.
+     * The volume may be memory-mapped: it is traversed one row of bricks at a time.
+     *
+     * @param[in] buffer Volume pixels, with x varying fastest
+     * @param[in] componentType Pixel component type
+     * @param[in] pixelDimensions Volume dimensions in pixels
+     * @param[in] brickFileName Name of the brick file to create
+     * @param[in] brickSize Number of pixels along each edge of a brick
+     *
+     * @return True iff the brick file was written
+     */
+    static bool createBrickFile(
+            const void* buffer,
+            const ComponentType& componentType,
+            const glm::u64vec3& pixelDimensions,
+            const std::string& brickFileName,
+            uint32_t brickSize = sk_defaultBrickSize );
+
+    /**
+     * @brief Write a brick file for the scalar image file described by a header, without
+     * reading the image into memory. The pixels of the image file are memory-mapped, so the
+     * file must be uncompressed (see \c itkdetails::mapping::mapPixelData).
+     *
+     * @param[in] header Header of the image file, as created by \c ImageLoader::probe
+     * @param[in] brickFileName Name of the brick file to create
+     * @param[in] brickSize Number of pixels along each edge of a brick
+     *
+     * @return True iff the brick file was written
+     */
+    static bool createBrickFile(
+            const ImageHeader& header,
+            const std::string& brickFileName,
+            uint32_t brickSize = sk_defaultBrickSize );
+
+    /**
+     * @brief Open a brick file
+     *
+     * @param[in] brickFileName Name of the brick file
+     * @param[in] cacheSizeInBytes Capacity of the brick cache
+     *
+     * @return Bricked volume; null if the file cannot be opened or is not a valid brick file
+     */
+    static std::unique_ptr<BrickedVolume> open(
+            const std::string& brickFileName,
+            size_t cacheSizeInBytes = sk_defaultCacheSizeInBytes );
+
+
+    BrickedVolume( const BrickedVolume& ) = delete;
+    BrickedVolume& operator=( const BrickedVolume& ) = delete;
+
+    BrickedVolume( BrickedVolume&& ) = delete;
+    BrickedVolume& operator=( BrickedVolume&& ) = delete;
+
+    ~BrickedVolume();
+
+
+    const ComponentType& componentType() const;
+    uint32_t componentSizeInBytes() const;
+
+    /// Get the volume dimensions in pixels
+    const glm::u64vec3& pixelDimensions() const;
+
+    /// Get the number of pixels along each edge of a brick
+    uint32_t brickSize() const;
+
+    /// Get the number of bricks along each axis
+    const glm::u64vec3& numBricks() const;
+
+    /// Get the number of bytes of a brick
+    size_t brickSizeInBytes() const;
+
+    /// Get the minimum and maximum pixel values of the volume
+    std::pair<double, double> valueRange() const;
+
+
+    /**
+     * @brief Get the pixels of a brick. The brick is read from the file if it is not cached.
+     * It remains valid while it is held, even if it is evicted from the cache.
+     *
+     * @param[in] brickIndex Index of the brick along each axis
+     *
+     * @return Brick pixels; null if the index is outside the volume or the brick cannot be read
+     */
+    std::shared_ptr< const std::vector<uint8_t> > brick( const glm::u64vec3& brickIndex ) const;
+
+    /**
+     * @brief Get a single pixel value. The function returns false if a pixel
+     * index outside the image was requested or if its brick cannot be read.
+     *
+     * @param[in] pixelIndex Pixel index in image matrix
+     * @param[out] value Pixel value cast to double-precision floating point
+     *
+     * @return True iff the pixel value was retrieved successfully
+     */
+    bool pixelValue( const glm::u64vec3& pixelIndex, double& value ) const;
+
+    /**
+     * @brief Extract an axis-aligned slice of the volume. The slice spans the two other
+     * axes in increasing order, with the lower axis varying fastest.
+     *
+     * @param[in] axis Axis normal to the slice (0, 1, or 2)
+     * @param[in] sliceIndex Index of the slice along the axis
+     * @param[out] dest Buffer of at least as many pixels as the slice
+     *
+     * @return True iff the slice was extracted
+     */
+    bool extractSlice( uint32_t axis, uint64_t sliceIndex, void* dest ) const;
+
+    /**
+     * @brief Extract a slab of consecutive slices normal to the z axis. Each brick that the slab
+     * intersects is read once, so this is much faster than extracting its slices one by one
+     * when a layer of bricks does not fit in the cache. The bricks are read concurrently on the
+     * shared thread pool.
+     *
+     * @param[in] zBegin Index of the first slice of the slab
+     * @param[in] zEnd Index one past the last slice of the slab
+     * @param[out] dest Buffer of at least as many pixels as the slab, which is stored with
+     * x varying fastest
+     * @param[in] numThreads Maximum number of threads; if zero, the whole shared thread pool is used
+     *
+     * @return True iff the slab was extracted
+     */
+    bool extractSlab( uint64_t zBegin, uint64_t zEnd, void* dest, size_t numThreads = 0 ) const;
+
+
+private:
+
+    BrickedVolume();
+
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace imageio
+
+#endif // IMAGEIO_BRICKED_VOLUME_H
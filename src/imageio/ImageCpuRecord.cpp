@@ -1,4 +1,8 @@
 #include "ImageCpuRecord.h"
+#include "BrickedVolume.h"
+#include "VolumePyramid.h"
+
+#include <cstring>
 
 namespace imageio
 {
@@ -10,6 +14,20 @@ ImageCpuRecord::ImageCpuRecord(
         ImageTransformations tx )
     :
       m_data( std::move( data ) ),
+      m_brickedVolume( nullptr ),
+      m_header( std::move( info ) ),
+      m_settings( std::move( settings ) ),
+      m_transformations( std::move( tx ) )
+{}
+
+ImageCpuRecord::ImageCpuRecord(
+        std::shared_ptr<const BrickedVolume> volume,
+        ImageHeader info,
+        ImageSettings settings,
+        ImageTransformations tx )
+    :
+      m_data( nullptr ),
+      m_brickedVolume( std::move( volume ) ),
       m_header( std::move( info ) ),
       m_settings( std::move( settings ) ),
       m_transformations( std::move( tx ) )
@@ -20,19 +38,97 @@ const ::itkdetails::ImageBaseData* ImageCpuRecord::imageBaseData() const
     return m_data.get();
 }
 
+const std::shared_ptr<const BrickedVolume>& ImageCpuRecord::brickedVolume() const
+{
+    return m_brickedVolume;
+}
+
 const uint8_t* ImageCpuRecord::buffer() const
 {
-    return m_data->bufferPointer();
+    return ( m_data ) ? m_data->bufferPointer() : nullptr;
 }
 
 const uint8_t* ImageCpuRecord::buffer( uint32_t componentIndex ) const
 {
-    return m_data->bufferPointer( componentIndex );
+    return ( m_data ) ? m_data->bufferPointer( componentIndex ) : nullptr;
 }
 
 bool ImageCpuRecord::pixelValue( uint32_t componentIndex, const glm::uvec3& pixelIndex, double& value ) const
 {
-    return m_data->getPixelAsDouble( componentIndex, pixelIndex[0], pixelIndex[1], pixelIndex[2], value );
+    if ( m_brickedVolume )
+    {
+        // Bricked volumes are scalar
+        return ( 0 == componentIndex && m_brickedVolume->pixelValue( glm::u64vec3{ pixelIndex }, value ) );
+    }
+
+    return ( m_data && m_data->getPixelAsDouble(
+                 componentIndex, pixelIndex[0], pixelIndex[1], pixelIndex[2], value ) );
+}
+
+bool ImageCpuRecord::extractSlice( uint32_t componentIndex, uint32_t axis, uint64_t sliceIndex, void* dest ) const
+{
+    if ( m_brickedVolume )
+    {
+        return ( 0 == componentIndex && m_brickedVolume->extractSlice( axis, sliceIndex, dest ) );
+    }
+
+    const uint8_t* src = buffer( componentIndex );
+    const glm::u64vec3& dims = m_header.m_pixelDimensions;
+
+    if ( ! src || ! dest || axis > 2 || sliceIndex >= dims[axis] )
+    {
+        return false;
+    }
+
+    // Axes spanned by the slice: u varies fastest
+    const uint32_t u = ( 0 == axis ) ? 1 : 0;
+    const uint32_t v = ( 2 == axis ) ? 1 : 2;
+
+    const uint64_t compSize = m_header.m_bufferComponentSizeInBytes;
+    const glm::u64vec3 strides{ compSize, dims.x * compSize, dims.x * dims.y * compSize };
+
+    uint8_t* out = static_cast<uint8_t*>( dest );
+
+    for ( uint64_t j = 0; j < dims[v]; ++j )
+    {
+        const uint8_t* row = src + sliceIndex * strides[axis] + j * strides[v];
+
+        if ( 0 == u )
+        {
+            // Rows along x are contiguous in the buffer
+            std::memcpy( out, row, static_cast<size_t>( dims.x * compSize ) );
+            out += dims.x * compSize;
+            continue;
+        }
+
+        for ( uint64_t i = 0; i < dims[u]; ++i )
+        {
+            std::memcpy( out, row + i * strides[u], static_cast<size_t>( compSize ) );
+            out += compSize;
+        }
+    }
+
+    return true;
+}
+
+void ImageCpuRecord::setPyramid( uint32_t componentIndex, std::shared_ptr<const VolumePyramid> pyramid )
+{
+    if ( componentIndex >= m_pyramids.size() )
+    {
+        m_pyramids.resize( componentIndex + 1 );
+    }
+
+    m_pyramids[componentIndex] = std::move( pyramid );
+}
+
+std::shared_ptr<const VolumePyramid> ImageCpuRecord::pyramid( uint32_t componentIndex ) const
+{
+    if ( componentIndex < m_pyramids.size() )
+    {
+        return m_pyramids[componentIndex];
+    }
+
+    return nullptr;
 }
 
 const ImageHeader& ImageCpuRecord::header() const
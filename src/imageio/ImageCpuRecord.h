@@ -11,15 +11,25 @@
 #include <glm/gtc/quaternion.hpp>
 
 #include <memory>
+#include <vector>
 
 
 namespace imageio
 {
 
+class BrickedVolume;
+class VolumePyramid;
+
+
 /**
  * @brief Record of an image stored in this class: it consists of the
  * image data itself, the header information, and associated spatial transformations.
  *
+ * The image data are either held in memory as one contiguous buffer per component or, for
+ * scalar images too large for memory, stored out of core as a bricked volume. Records of
+ * bricked volumes have no \c ImageBaseData or buffer: their pixels are read through the
+ * brick cache and they are displayed from their pyramid.
+ *
  * @note Due to unique data ownership, image records cannot be copied
  *
  * @todo ImageCpuRecord and ParcellationCpuRecord do NOT belong in the imageio library.
@@ -43,6 +53,20 @@ public:
                     ImageSettings,
                     ImageTransformations );
 
+    /**
+     * @brief Construct a record of a scalar image that is stored out of core
+     *
+     * @param[in] volume Bricked volume of the image, whose dimensions and component type
+     * match the header
+     * @param[in] Header information object
+     * @param[in] Settings information object
+     * @param[in] Image spatial transformations object
+     */
+    ImageCpuRecord( std::shared_ptr<const BrickedVolume> volume,
+                    ImageHeader,
+                    ImageSettings,
+                    ImageTransformations );
+
     ImageCpuRecord( const ImageCpuRecord& ) = delete;
     ImageCpuRecord& operator=( const ImageCpuRecord& ) = delete;
 
@@ -51,12 +75,19 @@ public:
 
     virtual ~ImageCpuRecord() = default;
 
+    /// Get the image data held in memory; null if the image is stored out of core
     const ::itkdetails::ImageBaseData* imageBaseData() const;
 
-    /// Get raw pointer to the pixel buffer of the whole image
+    /// Get the bricked volume of an image stored out of core; null if the image is held in memory
+    const std::shared_ptr<const BrickedVolume>& brickedVolume() const;
+
+    /// Get raw pointer to the pixel buffer of the whole image. The components of
+    /// multi-component images are in planar order: all pixels of component 0, then all
+    /// pixels of component 1, etc. Null if the image is stored out of core.
     const uint8_t* buffer() const;
 
-    /// Get raw pointer to the pixel buffer of a given component of the image
+    /// Get raw pointer to the pixel buffer of a given component of the image;
+    /// null if the image is stored out of core
     const uint8_t* buffer( uint32_t componentIndex ) const;
 
     /**
@@ -71,6 +102,32 @@ public:
      */
     bool pixelValue( uint32_t componentIndex, const glm::uvec3& pixelIndex, double& value ) const;
 
+    /**
+     * @brief Extract an axis-aligned slice of an image component, whether it is held in memory
+     * or stored out of core. The slice spans the two other axes in increasing order, with the
+     * lower axis varying fastest.
+     *
+     * @param[in] componentIndex Image component
+     * @param[in] axis Axis normal to the slice (0, 1, or 2)
+     * @param[in] sliceIndex Index of the slice along the axis
+     * @param[out] dest Buffer of at least as many pixels of the buffer component type as the slice
+     *
+     * @return True iff the slice was extracted
+     */
+    bool extractSlice( uint32_t componentIndex, uint32_t axis, uint64_t sliceIndex, void* dest ) const;
+
+    /**
+     * @brief Set the multi-resolution pyramid of an image component, from which the
+     * component is displayed at reduced resolution
+     *
+     * @param[in] componentIndex Image component
+     * @param[in] pyramid Pyramid of the component; null to unset
+     */
+    void setPyramid( uint32_t componentIndex, std::shared_ptr<const VolumePyramid> pyramid );
+
+    /// Get the pyramid of an image component; null if it is not set
+    std::shared_ptr<const VolumePyramid> pyramid( uint32_t componentIndex ) const;
+
     const ImageHeader& header() const;
     const ImageSettings& settings() const;
     const ImageTransformations& transformations() const;
@@ -108,10 +165,12 @@ public:
 
 private:
 
-    std::unique_ptr< ::itkdetails::ImageBaseData > m_data; //!< Image data
+    std::unique_ptr< ::itkdetails::ImageBaseData > m_data; //!< Image data held in memory
+    std::shared_ptr<const BrickedVolume> m_brickedVolume; //!< Image data stored out of core
     ImageHeader m_header; //!< Image header
     ImageSettings m_settings; //!< Image settings
     ImageTransformations m_transformations; //!< Image transformations
+    std::vector< std::shared_ptr<const VolumePyramid> > m_pyramids; //!< Optional pyramid per component
 
     /// @todo also hold ImageDicomInfo in here for dicom images
 };
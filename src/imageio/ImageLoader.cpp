@@ -1,9 +1,12 @@
 #include "ImageLoader.h"
+#include "BrickedVolume.h"
 #include "ImageHeader.h"
+#include "ImageProbe.h"
 #include "ImageSettings.h"
 #include "ImageTransformations.h"
 #include "ImageCpuRecord.h"
 #include "ParcellationCpuRecord.h"
+#include "VolumePyramid.h"
 
 #include "HZeeTypes.hpp"
 
@@ -19,6 +22,7 @@
 #include <boost/filesystem.hpp>
 
 #include <algorithm>
+#include <cmath>
 #include <functional>
 #include <iostream>
 #include <sstream>
@@ -31,6 +35,83 @@ namespace
 static const glm::vec3 sk_origin{ 0.0f, 0.0f, 0.0f };
 static const glm::quat sk_ident{ 1.0f, 0.0f, 0.0f, 0.0f };
 
+
+/// Get the display name of an image: the stem of its (first) file name, without any extensions
+std::string imageDisplayName( const std::string& fileName )
+{
+    auto baseName = boost::filesystem::path( fileName ).stem();
+
+    while ( baseName != baseName.stem() )
+    {
+        baseName = baseName.stem();
+    }
+
+    return baseName.string();
+}
+
+
+/// Get the default interpolation mode of images of a component type
+imageio::ImageSettings::InterpolationMode defaultInterpolationMode( const imageio::ComponentType& componentType )
+{
+    return ( imageio::isFloatingType( componentType ) )
+            ? imageio::ImageSettings::InterpolationMode::Linear
+            : imageio::ImageSettings::InterpolationMode::NearestNeighbor;
+}
+
+
+/**
+ * @brief Compute the pixel statistics of a scalar bricked image from the finest level of its
+ * pyramid, which has an eighth of its pixels. The minimum and maximum are those of the image.
+ */
+std::vector< ::itkdetails::utility::PixelStatistics<double> > brickedPixelStatistics(
+        const imageio::BrickedVolume& volume,
+        const imageio::VolumePyramid& pyramid )
+{
+    using imageio::ComponentType;
+
+    const auto& level = pyramid.level( 0 );
+    const size_t numPixels = static_cast<size_t>(
+                level.m_pixelDimensions.x * level.m_pixelDimensions.y * level.m_pixelDimensions.z );
+
+    ::itkdetails::utility::PixelStatistics<double> cs;
+
+    auto compute = [&level, numPixels, &cs] ( auto value )
+    {
+        using T = decltype( value );
+
+        auto stats = ::itkdetails::utility::computePixelStatistics<T>(
+                    reinterpret_cast<const T*>( level.m_data.data() ), numPixels );
+
+        cs.m_mean = stats.m_mean;
+        cs.m_stdDeviation = stats.m_stdDeviation;
+        cs.m_variance = stats.m_variance;
+        cs.m_histogram = std::move( stats.m_histogram );
+        cs.m_quantiles = std::move( stats.m_quantiles );
+    };
+
+    switch ( volume.componentType() )
+    {
+    case ComponentType::Int8:     compute( int8_t{} ); break;
+    case ComponentType::UInt8:    compute( uint8_t{} ); break;
+    case ComponentType::Int16:    compute( int16_t{} ); break;
+    case ComponentType::UInt16:   compute( uint16_t{} ); break;
+    case ComponentType::Int32:    compute( int32_t{} ); break;
+    case ComponentType::UInt32:   compute( uint32_t{} ); break;
+    case ComponentType::Int64:    compute( int64_t{} ); break;
+    case ComponentType::UInt64:   compute( uint64_t{} ); break;
+    case ComponentType::Float32:  compute( float{} ); break;
+    case ComponentType::Double64: compute( double{} ); break;
+    }
+
+    const glm::u64vec3& dims = volume.pixelDimensions();
+
+    cs.m_minimum = volume.valueRange().first;
+    cs.m_maximum = volume.valueRange().second;
+    cs.m_sum = cs.m_mean * static_cast<double>( dims.x * dims.y * dims.z );
+
+    return { cs };
+}
+
 /**
  * @brief Get the collection of image file names associated with a single input image file
  * and an optional DICOM series UID. For the case of regular image files, the output collection
@@ -72,18 +153,17 @@ getImageFileNames( const std::string& inputFileName,
         /// @todo Logging
         std::cout << "> Loading DICOM series" << std::endl;
 
-        std::vector< std::string > foundDicomSeriesUIDs;
-        ::itkdetails::utility::dicom::NameGeneratorType::Pointer nameGenerator;
-
-        std::tie( foundDicomSeriesUIDs, nameGenerator ) =
+        const auto seriesIndex =
                 ::itkdetails::utility::dicom::seriesSearch( inputFileName.c_str() );
 
-        if ( nameGenerator.IsNull() )
+        if ( ! seriesIndex )
         {
-            std::cerr << "DICOM file name generator is invalid." << std::endl;
+            std::cerr << "DICOM series index is invalid." << std::endl;
             return EMPTY;
         }
 
+        const std::vector< std::string > foundDicomSeriesUIDs = seriesIndex->seriesUIDs();
+
         std::string selectedSeriesUID;
 
         if ( inputDicomSeriesUID )
@@ -132,7 +212,7 @@ getImageFileNames( const std::string& inputFileName,
 
         std::cout << "> Selected series UID: " << selectedSeriesUID << std::endl << std::endl;
 
-        fileNames = nameGenerator->GetFileNames( selectedSeriesUID );
+        fileNames = seriesIndex->fileNames( selectedSeriesUID );
 
         if ( fileNames.empty() )
         {
@@ -151,6 +231,61 @@ getImageFileNames( const std::string& inputFileName,
     return std::make_pair( fileNames, isDicom );
 }
 
+
+/**
+ * @brief Set the size and space information of a DICOM series from the information of its
+ * first file, which describes a single slice. The slices are stacked along the third axis.
+ * As in the ITK series reader, the slice spacing is the distance between the origins of the
+ * first and last slices divided by the number of gaps between slices (or 1.0 if they coincide),
+ * so only the header of the last file is read in addition.
+ *
+ * @param[in] fileNames Sorted file names of the series
+ * @param[in,out] ioInfo Image IO information of the first file
+ *
+ * @return True iff the information was set
+ */
+bool setDicomSeriesInfo( const std::vector< std::string >& fileNames,
+                         ::itkdetails::io::ImageIoInfo& ioInfo )
+{
+    auto& spaceInfo = ioInfo.m_spaceInfo;
+
+    if ( fileNames.size() < 2 || 3 != spaceInfo.m_numDimensions || 1 != spaceInfo.m_dimensions[2] )
+    {
+        /// @internal Single files and multi-frame files are described by their own information
+        return true;
+    }
+
+    const ::itk::ImageIOBase::Pointer lastImageIO =
+            ::itkdetails::utility::dicom::createDicomImageIO( fileNames.back().c_str() );
+
+    if ( lastImageIO.IsNull() )
+    {
+        return false;
+    }
+
+    double distance = 0.0;
+
+    for ( uint32_t i = 0; i < 3; ++i )
+    {
+        const double d = lastImageIO->GetOrigin( i ) - spaceInfo.m_origin[i];
+        distance += d * d;
+    }
+
+    const size_t numSlices = fileNames.size();
+
+    spaceInfo.m_dimensions[2] = numSlices;
+
+    spaceInfo.m_spacing[2] = ( distance > 0.0 )
+            ? std::sqrt( distance ) / static_cast<double>( numSlices - 1 )
+            : 1.0;
+
+    ioInfo.m_sizeInfo.m_imageSizeInComponents *= numSlices;
+    ioInfo.m_sizeInfo.m_imageSizeInPixels *= numSlices;
+    ioInfo.m_sizeInfo.m_imageSizeInBytes *= numSlices;
+
+    return true;
+}
+
 } // anonymous namespace
 
 
@@ -184,6 +319,189 @@ std::unique_ptr<ImageCpuRecord> ImageLoader::load(
 }
 
 
+std::unique_ptr<ImageProbe> ImageLoader::probe(
+        const std::string& inputFileName,
+        const std::optional<std::string>& inputDicomSeriesUID ) const
+{
+    if ( ! m_imageDataFactory )
+    {
+        return nullptr;
+    }
+
+    std::vector< std::string > fileNames;
+    bool isDicom = false;
+
+    /// @internal The I/O object that identifies a standard image file also holds its header,
+    /// so the header is read only once
+    ::itk::ImageIOBase::Pointer imageIO =
+            ::itkdetails::utility::createStandardImageIO( inputFileName.c_str() );
+
+    if ( imageIO.IsNotNull() )
+    {
+        fileNames = { inputFileName };
+    }
+    else
+    {
+        std::tie( fileNames, isDicom ) =
+                getImageFileNames( inputFileName, inputDicomSeriesUID );
+
+        if ( fileNames.empty() || ! isDicom )
+        {
+            return nullptr;
+        }
+
+        imageIO = ::itkdetails::utility::dicom::createDicomImageIO( fileNames[0].c_str() );
+
+        if ( imageIO.IsNull() )
+        {
+            std::cerr << "Error creating GDCMImageIO." << std::endl;
+            return nullptr;
+        }
+    }
+
+    ::itkdetails::io::ImageIoInfo ioInfo;
+
+    if ( ! ioInfo.set( imageIO ) )
+    {
+        std::cerr << "Error setting imageIO information" << std::endl;
+        return nullptr;
+    }
+
+    if ( isDicom && ! setDicomSeriesInfo( fileNames, ioInfo ) )
+    {
+        std::cerr << "Error reading information of DICOM series starting with file '"
+                  << fileNames[0] << "'" << std::endl;
+        return nullptr;
+    }
+
+    ImageHeader header;
+
+    if ( ! itkbridge::createImageHeader(
+             ioInfo,
+             std::bind( &ImageDataFactory::getComponentTypeCast,
+                        m_imageDataFactory.get(), std::placeholders::_1 ),
+             header ) )
+    {
+        std::cerr << "Error while creating ImageInfo." << std::endl;
+        return nullptr;
+    }
+
+    try
+    {
+        ImageTransformations tx( header.m_pixelDimensions, header.m_spacing,
+                                 header.m_origin, header.m_directions,
+                                 sk_origin, sk_ident );
+
+        return std::make_unique<ImageProbe>(
+                    std::move( ioInfo ),
+                    std::move( header ),
+                    std::move( tx ),
+                    std::move( fileNames ),
+                    isDicom );
+    }
+    catch ( const std::exception& e )
+    {
+        std::cerr << "Error while creating ImageProbe: " << e.what() << std::endl;
+        return nullptr;
+    }
+    catch ( ... )
+    {
+        std::cerr << "Error while creating ImageProbe." << std::endl;
+        return nullptr;
+    }
+}
+
+
+std::unique_ptr<ImageCpuRecord> ImageLoader::loadBricked(
+        const ImageProbe& probe,
+        const std::string& brickFileName ) const
+{
+    namespace fs = boost::filesystem;
+
+    const ImageHeader& header = probe.m_header;
+
+    if ( probe.m_isDicom || 1 != header.m_numComponents ||
+         header.m_componentType != header.m_bufferComponentType )
+    {
+        std::cerr << "Image '" << header.m_fileName << "' cannot be stored out of core: only scalar, "
+                  << "non-DICOM images whose component type is not cast can be bricked" << std::endl;
+        return nullptr;
+    }
+
+    auto matchesImage = [&header] ( const BrickedVolume& volume )
+    {
+        return ( volume.componentType() == header.m_componentType &&
+                 volume.pixelDimensions() == header.m_pixelDimensions );
+    };
+
+    std::shared_ptr<const BrickedVolume> volume;
+
+    // Reuse the brick file if it was created after the image file was last modified
+    boost::system::error_code brickError;
+    boost::system::error_code imageError;
+
+    if ( fs::exists( brickFileName, brickError ) &&
+         fs::last_write_time( brickFileName, brickError ) >= fs::last_write_time( header.m_fileName, imageError ) &&
+         ! brickError && ! imageError )
+    {
+        volume = BrickedVolume::open( brickFileName );
+
+        if ( volume && ! matchesImage( *volume ) )
+        {
+            volume.reset();
+        }
+    }
+
+    if ( ! volume )
+    {
+        std::cout << "Creating brick file '" << brickFileName << "' for image '"
+                  << header.m_fileName << "'" << std::endl;
+
+        if ( ! BrickedVolume::createBrickFile( header, brickFileName ) )
+        {
+            return nullptr;
+        }
+
+        volume = BrickedVolume::open( brickFileName );
+
+        if ( ! volume || ! matchesImage( *volume ) )
+        {
+            std::cerr << "Error opening brick file '" << brickFileName << "'" << std::endl;
+            return nullptr;
+        }
+    }
+
+    std::shared_ptr<const VolumePyramid> pyramid = VolumePyramid::create( *volume );
+
+    if ( ! pyramid || 0 == pyramid->numLevels() )
+    {
+        std::cerr << "Error creating pyramid of bricked image '" << header.m_fileName << "'" << std::endl;
+        return nullptr;
+    }
+
+    try
+    {
+        ImageSettings settings(
+                    imageDisplayName( header.m_fileName ),
+                    brickedPixelStatistics( *volume, *pyramid ),
+                    header.m_bufferComponentType,
+                    defaultInterpolationMode( header.m_bufferComponentType ) );
+
+        auto record = std::make_unique<ImageCpuRecord>(
+                    std::move( volume ), header, std::move( settings ), probe.m_transformations );
+
+        record->setPyramid( 0, std::move( pyramid ) );
+
+        return record;
+    }
+    catch ( const std::exception& e )
+    {
+        std::cerr << "Error while creating bricked ImageRecord: " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+
 std::unique_ptr<ParcellationCpuRecord> ImageLoader::generateClearParcellationRecord(
         const ImageCpuRecord* sourceRecord ) const
 {
@@ -192,6 +510,15 @@ std::unique_ptr<ParcellationCpuRecord> ImageLoader::generateClearParcellationRec
         return nullptr;
     }
 
+    if ( ! sourceRecord->imageBaseData() )
+    {
+        // A clear parcellation would need as many pixels in memory as the image, which is
+        // stored out of core because it does not fit
+        std::cerr << "Cannot generate a clear parcellation for image '"
+                  << sourceRecord->header().m_fileName << "', which is stored out of core" << std::endl;
+        return nullptr;
+    }
+
     // Get ImageIOInfo from source record. Modify it to match the clear label image.
     // ioInfo.m_spaceInfo is unchanged.
     itkdetails::io::ImageIoInfo ioInfo = sourceRecord->imageBaseData()->imageIOInfo();
@@ -328,24 +655,11 @@ std::unique_ptr<ImageCpuRecord> ImageLoader::doLoadFiles(
                                  sk_origin, sk_ident );
 
         // Use stem of first image filename as its "display name"
-        const boost::filesystem::path path( fileNames[0] );
-
-        const auto interpMode = ( isFloatingType( *componentType ) )
-                ? ImageSettings::InterpolationMode::Linear
-                : ImageSettings::InterpolationMode::NearestNeighbor;
-
-        // Remove all extensions to create image's display name
-        auto baseName = path.stem();
-        while ( baseName != baseName.stem() )
-        {
-            baseName = baseName.stem();
-        }
-
         ImageSettings settings(
-                    baseName.string(),
+                    imageDisplayName( fileNames[0] ),
                     imageBaseData->pixelStatistics(),
                     header.m_bufferComponentType,
-                    interpMode );
+                    defaultInterpolationMode( *componentType ) );
 
         return std::make_unique<ImageCpuRecord>(
                     std::move( imageBaseData ),
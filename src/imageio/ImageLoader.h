@@ -16,6 +16,7 @@ class ImageDataFactory;
 class ImageCpuRecord;
 class ImageTransformations;
 class ParcellationCpuRecord;
+struct ImageProbe;
 
 
 class ImageLoader
@@ -53,6 +54,44 @@ public:
             const ComponentNormalizationPolicy& normalizationPolicy ) const;
 
 
+    /**
+     * @brief Read the information of an image from the header(s) of its file(s) without
+     * reading its pixels. This is much faster than loading the image, so it suits validating
+     * images and deciding whether and how to load them. An optional series UID can be
+     * supplied for DICOM images.
+     *
+     * @param[in] inputFileName Input image file name
+     * @param[in] inputDicomSeriesUID Optional input DICOM series UID
+     *
+     * @return Image information, with the header and transformations that \c load would
+     * create for the image; null if the image cannot be read
+     */
+    std::unique_ptr<ImageProbe> probe(
+            const std::string& inputFileName,
+            const std::optional<std::string>& inputDicomSeriesUID ) const;
+
+
+    /**
+     * @brief Load a scalar image that is too large for memory as a bricked volume that is stored
+     * out of core in a brick file. The brick file is reused if it was created after the image
+     * file was last modified. Otherwise, it is created from the memory-mapped pixels of the
+     * image file, so the image is never read into memory.
+     *
+     * The record holds no contiguous buffer. Its pyramid is built from the bricks, and its
+     * default display settings follow from the finest pyramid level and the range of pixel values.
+     *
+     * @param[in] probe Information of the image, as read by \c probe
+     * @param[in] brickFileName Name of the brick file of the image
+     *
+     * @return Record of the bricked image; null if the image cannot be bricked: it is a DICOM
+     * series, it has multiple components or a component type that is cast when loaded, or its
+     * file is compressed (see \c BrickedVolume::createBrickFile)
+     */
+    std::unique_ptr<ImageCpuRecord> loadBricked(
+            const ImageProbe& probe,
+            const std::string& brickFileName ) const;
+
+
     /**
      * @brief generateClearParcellationRecord
      *
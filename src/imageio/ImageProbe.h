@@ -0,0 +1,50 @@
+#ifndef IMAGEIO_IMAGE_PROBE_H
+#define IMAGEIO_IMAGE_PROBE_H
+
+#include "ImageHeader.h"
+#include "ImageTransformations.h"
+
+#include "itkdetails/ImageIOInfo.hpp"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace imageio
+{
+
+/**
+ * @brief Information about an image that is read from the header(s) of its file(s)
+ * without reading its pixels: the ITK image IO information, the image header derived from it,
+ * and the associated spatial transformations. This describes the image exactly as
+ * \c ImageLoader::load would, except for its pixel statistics.
+ */
+struct ImageProbe
+{
+    ImageProbe( ::itkdetails::io::ImageIoInfo ioInfo,
+                ImageHeader header,
+                ImageTransformations transformations,
+                std::vector< std::string > fileNames,
+                bool isDicom )
+        : m_ioInfo( std::move( ioInfo ) ),
+          m_header( std::move( header ) ),
+          m_transformations( std::move( transformations ) ),
+          m_fileNames( std::move( fileNames ) ),
+          m_isDicom( isDicom )
+    {}
+
+    ::itkdetails::io::ImageIoInfo m_ioInfo; //!< ITK image IO information
+    ImageHeader m_header; //!< Image header
+    ImageTransformations m_transformations; //!< Image transformations
+
+    /// Image file names: a single file for standard images or the files of a DICOM series
+    std::vector< std::string > m_fileNames;
+
+    /// Flag equal to true iff the image is a DICOM series
+    bool m_isDicom;
+};
+
+} // namespace imageio
+
+#endif // IMAGEIO_IMAGE_PROBE_H
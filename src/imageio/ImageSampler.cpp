@@ -0,0 +1,436 @@
+#include "ImageSampler.h"
+#include "BrickedVolume.h"
+#include "ImageCpuRecord.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+
+namespace
+{
+
+/// Get whether a position in Pixel space is inside the image, i.e. whether its nearest pixel is.
+/// Positions with non-finite coordinates are outside.
+bool isInside( const glm::vec3& pixelPos, const glm::u64vec3& pixelDimensions )
+{
+    for ( int a = 0; a < 3; ++a )
+    {
+        const double c = static_cast<double>( pixelPos[a] );
+
+        if ( ! ( c >= -0.5 && c < static_cast<double>( pixelDimensions[a] ) - 0.5 ) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+/// Clamp a pixel index to the image along one axis
+uint64_t clampIndex( int64_t index, uint64_t size )
+{
+    return static_cast<uint64_t>( std::clamp<int64_t>( index, 0, static_cast<int64_t>( size ) - 1 ) );
+}
+
+
+template< typename T >
+void sampleNearest( const void* buffer,
+                    const glm::u64vec3& pixelDimensions,
+                    const glm::vec3* pixelPositions,
+                    size_t numPositions,
+                    std::optional<double>* values )
+{
+    const T* data = static_cast<const T*>( buffer );
+
+    const uint64_t strides[3] = { 1, pixelDimensions.x, pixelDimensions.x * pixelDimensions.y };
+
+    for ( size_t s = 0; s < numPositions; ++s )
+    {
+        const glm::vec3& p = pixelPositions[s];
+
+        if ( ! isInside( p, pixelDimensions ) )
+        {
+            values[s] = std::nullopt;
+            continue;
+        }
+
+        uint64_t offset = 0;
+
+        for ( int a = 0; a < 3; ++a )
+        {
+            const int64_t i = static_cast<int64_t>( std::floor( static_cast<double>( p[a] ) + 0.5 ) );
+            offset += clampIndex( i, pixelDimensions[a] ) * strides[a];
+        }
+
+        values[s] = static_cast<double>( data[offset] );
+    }
+}
+
+
+template< typename T >
+void sampleLinear( const void* buffer,
+                   const glm::u64vec3& pixelDimensions,
+                   const glm::vec3* pixelPositions,
+                   size_t numPositions,
+                   std::optional<double>* values )
+{
+    const T* data = static_cast<const T*>( buffer );
+
+    const uint64_t strides[3] = { 1, pixelDimensions.x, pixelDimensions.x * pixelDimensions.y };
+
+    for ( size_t s = 0; s < numPositions; ++s )
+    {
+        const glm::vec3& p = pixelPositions[s];
+
+        if ( ! isInside( p, pixelDimensions ) )
+        {
+            values[s] = std::nullopt;
+            continue;
+        }
+
+        // Offsets of the two pixels that bracket the position along each axis,
+        // and the weight of the second one
+        uint64_t lo[3];
+        uint64_t hi[3];
+        double w[3];
+
+        for ( int a = 0; a < 3; ++a )
+        {
+            const double c = static_cast<double>( p[a] );
+            const double f = std::floor( c );
+            const int64_t i = static_cast<int64_t>( f );
+
+            lo[a] = clampIndex( i, pixelDimensions[a] ) * strides[a];
+            hi[a] = clampIndex( i + 1, pixelDimensions[a] ) * strides[a];
+            w[a] = c - f;
+        }
+
+        auto at = [data] ( uint64_t x, uint64_t y, uint64_t z ) {
+            return static_cast<double>( data[x + y + z] ); };
+
+        const double c00 = at( lo[0], lo[1], lo[2] ) + w[0] * ( at( hi[0], lo[1], lo[2] ) - at( lo[0], lo[1], lo[2] ) );
+        const double c10 = at( lo[0], hi[1], lo[2] ) + w[0] * ( at( hi[0], hi[1], lo[2] ) - at( lo[0], hi[1], lo[2] ) );
+        const double c01 = at( lo[0], lo[1], hi[2] ) + w[0] * ( at( hi[0], lo[1], hi[2] ) - at( lo[0], lo[1], hi[2] ) );
+        const double c11 = at( lo[0], hi[1], hi[2] ) + w[0] * ( at( hi[0], hi[1], hi[2] ) - at( lo[0], hi[1], hi[2] ) );
+
+        const double c0 = c00 + w[1] * ( c10 - c00 );
+        const double c1 = c01 + w[1] * ( c11 - c01 );
+
+        values[s] = c0 + w[2] * ( c1 - c0 );
+    }
+}
+
+/// Sample a bricked volume (passed as the buffer) with nearest neighbor interpolation.
+/// Pixels are read through the brick cache; positions whose brick cannot be read have no value.
+void sampleBrickedNearest( const void* buffer,
+                           const glm::u64vec3& pixelDimensions,
+                           const glm::vec3* pixelPositions,
+                           size_t numPositions,
+                           std::optional<double>* values )
+{
+    const auto* volume = static_cast<const imageio::BrickedVolume*>( buffer );
+
+    for ( size_t s = 0; s < numPositions; ++s )
+    {
+        const glm::vec3& p = pixelPositions[s];
+        values[s] = std::nullopt;
+
+        if ( ! isInside( p, pixelDimensions ) )
+        {
+            continue;
+        }
+
+        glm::u64vec3 index;
+
+        for ( int a = 0; a < 3; ++a )
+        {
+            const int64_t i = static_cast<int64_t>( std::floor( static_cast<double>( p[a] ) + 0.5 ) );
+            index[a] = clampIndex( i, pixelDimensions[a] );
+        }
+
+        double value;
+
+        if ( volume->pixelValue( index, value ) )
+        {
+            values[s] = value;
+        }
+    }
+}
+
+
+/// Sample a bricked volume (passed as the buffer) with trilinear interpolation
+void sampleBrickedLinear( const void* buffer,
+                          const glm::u64vec3& pixelDimensions,
+                          const glm::vec3* pixelPositions,
+                          size_t numPositions,
+                          std::optional<double>* values )
+{
+    const auto* volume = static_cast<const imageio::BrickedVolume*>( buffer );
+
+    for ( size_t s = 0; s < numPositions; ++s )
+    {
+        const glm::vec3& p = pixelPositions[s];
+        values[s] = std::nullopt;
+
+        if ( ! isInside( p, pixelDimensions ) )
+        {
+            continue;
+        }
+
+        // Indices of the two pixels that bracket the position along each axis,
+        // and the weight of the second one
+        glm::u64vec3 lo;
+        glm::u64vec3 hi;
+        double w[3];
+
+        for ( int a = 0; a < 3; ++a )
+        {
+            const double c = static_cast<double>( p[a] );
+            const double f = std::floor( c );
+            const int64_t i = static_cast<int64_t>( f );
+
+            lo[a] = clampIndex( i, pixelDimensions[a] );
+            hi[a] = clampIndex( i + 1, pixelDimensions[a] );
+            w[a] = c - f;
+        }
+
+        // Values of the eight bracketing pixels, with x varying fastest
+        double c[8];
+        bool read = true;
+
+        for ( int k = 0; k < 8 && read; ++k )
+        {
+            const glm::u64vec3 index{ ( k & 1 ) ? hi.x : lo.x,
+                                      ( k & 2 ) ? hi.y : lo.y,
+                                      ( k & 4 ) ? hi.z : lo.z };
+
+            read = volume->pixelValue( index, c[k] );
+        }
+
+        if ( ! read )
+        {
+            continue;
+        }
+
+        const double c00 = c[0] + w[0] * ( c[1] - c[0] );
+        const double c10 = c[2] + w[0] * ( c[3] - c[2] );
+        const double c01 = c[4] + w[0] * ( c[5] - c[4] );
+        const double c11 = c[6] + w[0] * ( c[7] - c[6] );
+
+        const double c0 = c00 + w[1] * ( c10 - c00 );
+        const double c1 = c01 + w[1] * ( c11 - c01 );
+
+        values[s] = c0 + w[2] * ( c1 - c0 );
+    }
+}
+
+
+/// Get the pixels that a sampler of an image component reads: the buffer of the component,
+/// or else the bricked volume of an image stored out of core
+const void* pixelSource( const imageio::ImageCpuRecord& record, uint32_t componentIndex )
+{
+    if ( const auto& volume = record.brickedVolume() )
+    {
+        return ( 0 == componentIndex ) ? volume.get() : nullptr;
+    }
+
+    return ( record.imageBaseData() ) ? record.buffer( componentIndex ) : nullptr;
+}
+
+} // anonymous
+
+
+namespace imageio
+{
+
+std::optional<ImageSampler> ImageSampler::create( const ImageCpuRecord& record, uint32_t componentIndex )
+{
+    const ImageHeader& header = record.header();
+
+    if ( componentIndex >= header.m_numComponents ||
+         ( ! record.imageBaseData() && ! record.brickedVolume() ) )
+    {
+        std::cerr << "Cannot sample invalid image component " << componentIndex << std::endl;
+        return std::nullopt;
+    }
+
+    const void* buffer = pixelSource( record, componentIndex );
+
+    if ( ! buffer )
+    {
+        std::cerr << "Cannot sample image component " << componentIndex
+                  << " that is neither buffered in memory nor bricked" << std::endl;
+        return std::nullopt;
+    }
+
+    if ( record.brickedVolume() )
+    {
+        return ImageSampler( buffer, header.m_bufferComponentType, header.m_pixelDimensions,
+                             record.transformations().pixel_O_subject(),
+                             &sampleBrickedNearest, &sampleBrickedLinear );
+    }
+
+    SampleFunction nearest = nullptr;
+    SampleFunction linear = nullptr;
+
+    auto resolve = [&nearest, &linear] ( auto value )
+    {
+        using T = decltype( value );
+        nearest = &sampleNearest<T>;
+        linear = &sampleLinear<T>;
+    };
+
+    switch ( header.m_bufferComponentType )
+    {
+    case ComponentType::Int8:     resolve( int8_t{} ); break;
+    case ComponentType::UInt8:    resolve( uint8_t{} ); break;
+    case ComponentType::Int16:    resolve( int16_t{} ); break;
+    case ComponentType::UInt16:   resolve( uint16_t{} ); break;
+    case ComponentType::Int32:    resolve( int32_t{} ); break;
+    case ComponentType::UInt32:   resolve( uint32_t{} ); break;
+    case ComponentType::Int64:    resolve( int64_t{} ); break;
+    case ComponentType::UInt64:   resolve( uint64_t{} ); break;
+    case ComponentType::Float32:  resolve( float{} ); break;
+    case ComponentType::Double64: resolve( double{} ); break;
+    }
+
+    if ( ! nearest || ! linear )
+    {
+        std::cerr << "Cannot sample image of unknown component type" << std::endl;
+        return std::nullopt;
+    }
+
+    return ImageSampler( buffer, header.m_bufferComponentType, header.m_pixelDimensions,
+                         record.transformations().pixel_O_subject(), nearest, linear );
+}
+
+
+ImageSampler::ImageSampler(
+        const void* buffer,
+        const ComponentType& componentType,
+        const glm::u64vec3& pixelDimensions,
+        const glm::mat4& pixel_O_subject,
+        SampleFunction nearestFunction,
+        SampleFunction linearFunction )
+    :
+      m_buffer( buffer ),
+      m_componentType( componentType ),
+      m_pixelDimensions( pixelDimensions ),
+      m_pixel_O_subject( pixel_O_subject ),
+      m_nearestFunction( nearestFunction ),
+      m_linearFunction( linearFunction )
+{}
+
+
+std::optional<double> ImageSampler::sample(
+        const glm::vec3& subjectPos, const InterpolationMode& mode ) const
+{
+    const glm::vec4 pixelPos = m_pixel_O_subject * glm::vec4{ subjectPos, 1.0f };
+    const glm::vec3 pixelPos3{ pixelPos / pixelPos.w };
+
+    std::optional<double> value;
+    sampleInPixelSpace( &pixelPos3, 1, mode, &value );
+    return value;
+}
+
+
+std::vector< std::optional<double> > ImageSampler::sample(
+        const std::vector<glm::vec3>& subjectPositions,
+        const InterpolationMode& mode ) const
+{
+    std::vector<glm::vec3> pixelPositions;
+    pixelPositions.reserve( subjectPositions.size() );
+
+    for ( const auto& subjectPos : subjectPositions )
+    {
+        const glm::vec4 pixelPos = m_pixel_O_subject * glm::vec4{ subjectPos, 1.0f };
+        pixelPositions.emplace_back( pixelPos / pixelPos.w );
+    }
+
+    std::vector< std::optional<double> > values( pixelPositions.size() );
+    sampleInPixelSpace( pixelPositions.data(), pixelPositions.size(), mode, values.data() );
+    return values;
+}
+
+
+std::vector< std::optional<double> > ImageSampler::lineProfile(
+        const glm::vec3& subjectStart,
+        const glm::vec3& subjectEnd,
+        size_t numSamples,
+        const InterpolationMode& mode ) const
+{
+    if ( 0 == numSamples )
+    {
+        return {};
+    }
+
+    // The transformation is affine, so the segment is interpolated in Pixel space
+    const glm::vec4 start = m_pixel_O_subject * glm::vec4{ subjectStart, 1.0f };
+    const glm::vec4 end = m_pixel_O_subject * glm::vec4{ subjectEnd, 1.0f };
+
+    const glm::vec3 pixelStart{ start / start.w };
+    const glm::vec3 pixelStep = ( 1 == numSamples )
+            ? glm::vec3{ 0.0f }
+            : ( glm::vec3{ end / end.w } - pixelStart ) / static_cast<float>( numSamples - 1 );
+
+    std::vector<glm::vec3> pixelPositions;
+    pixelPositions.reserve( numSamples );
+
+    for ( size_t i = 0; i < numSamples; ++i )
+    {
+        pixelPositions.emplace_back( pixelStart + static_cast<float>( i ) * pixelStep );
+    }
+
+    std::vector< std::optional<double> > values( numSamples );
+    sampleInPixelSpace( pixelPositions.data(), numSamples, mode, values.data() );
+    return values;
+}
+
+
+std::optional<double> ImageSampler::pixelValue( const glm::u64vec3& pixelIndex ) const
+{
+    if ( glm::any( glm::greaterThanEqual( pixelIndex, m_pixelDimensions ) ) )
+    {
+        return std::nullopt;
+    }
+
+    const glm::vec3 pixelPos{ pixelIndex };
+
+    std::optional<double> value;
+    m_nearestFunction( m_buffer, m_pixelDimensions, &pixelPos, 1, &value );
+    return value;
+}
+
+
+const ComponentType& ImageSampler::componentType() const
+{
+    return m_componentType;
+}
+
+
+bool ImageSampler::samples( const ImageCpuRecord& record, uint32_t componentIndex ) const
+{
+    const ImageHeader& header = record.header();
+
+    return ( componentIndex < header.m_numComponents &&
+             pixelSource( record, componentIndex ) == m_buffer &&
+             header.m_bufferComponentType == m_componentType &&
+             header.m_pixelDimensions == m_pixelDimensions &&
+             record.transformations().pixel_O_subject() == m_pixel_O_subject );
+}
+
+void ImageSampler::sampleInPixelSpace(
+        const glm::vec3* pixelPositions, size_t numPositions,
+        const InterpolationMode& mode, std::optional<double>* values ) const
+{
+    const SampleFunction func = ( InterpolationMode::Linear == mode )
+            ? m_linearFunction : m_nearestFunction;
+
+    func( m_buffer, m_pixelDimensions, pixelPositions, numPositions, values );
+}
+
+} // namespace imageio
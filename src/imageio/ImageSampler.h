@@ -0,0 +1,156 @@
+#ifndef IMAGEIO_IMAGE_SAMPLER_H
+#define IMAGEIO_IMAGE_SAMPLER_H
+
+#include "HZeeTypes.hpp"
+#include "ImageSettings.h"
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec3.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+
+namespace imageio
+{
+
+class ImageCpuRecord;
+
+
+/**
+ * @brief Samples one component of an image at positions in image Subject space.
+ *
+ * The component type of the image buffer is resolved once, when the sampler is created,
+ * into functions that read the buffer as that type. Samples are therefore taken without
+ * virtual calls, ITK region lookups or a switch over component types, which makes the
+ * sampler cheap enough to run on every crosshairs move (e.g. for live line profiles).
+ *
+ * Images stored out of core are sampled through the brick cache of their bricked volume, which
+ * stands in for the buffer.
+ *
+ * Pixel centers lie at integer Pixel coordinates. A position is inside the image if its
+ * nearest pixel is. Trilinear samples near the image boundary repeat the boundary pixels.
+ *
+ * @note The sampler points to the pixel buffer of the image record, so it must not be used
+ * after the record is destroyed. A sampler kept for a record can be checked with \c samples
+ * before it is reused.
+ */
+class ImageSampler
+{
+public:
+
+    using InterpolationMode = ImageSettings::InterpolationMode;
+
+    /**
+     * @brief Create a sampler of an image component
+     *
+     * @param[in] record Image record
+     * @param[in] componentIndex Image component
+     *
+     * @return Sampler; std::nullopt if the component does not exist or is neither buffered in
+     * memory nor bricked
+     */
+    static std::optional<ImageSampler> create( const ImageCpuRecord& record, uint32_t componentIndex );
+
+
+    ImageSampler( const ImageSampler& ) = default;
+    ImageSampler& operator=( const ImageSampler& ) = default;
+
+    ImageSampler( ImageSampler&& ) = default;
+    ImageSampler& operator=( ImageSampler&& ) = default;
+
+    ~ImageSampler() = default;
+
+
+    /**
+     * @brief Sample the image at a position
+     *
+     * @param[in] subjectPos Position in Subject space
+     * @param[in] mode Interpolation of the sample
+     *
+     * @return Sampled value; std::nullopt if the position is outside the image
+     */
+    std::optional<double> sample( const glm::vec3& subjectPos, const InterpolationMode& mode ) const;
+
+    /**
+     * @brief Sample the image at a batch of positions
+     *
+     * @param[in] subjectPositions Positions in Subject space
+     * @param[in] mode Interpolation of the samples
+     *
+     * @return Sampled value at each position; std::nullopt for positions outside the image
+     */
+    std::vector< std::optional<double> > sample(
+            const std::vector<glm::vec3>& subjectPositions,
+            const InterpolationMode& mode ) const;
+
+    /**
+     * @brief Sample the image at equally spaced positions along a line segment
+     *
+     * @param[in] subjectStart Start of the segment in Subject space
+     * @param[in] subjectEnd End of the segment in Subject space
+     * @param[in] numSamples Number of samples, including both ends of the segment
+     * @param[in] mode Interpolation of the samples
+     *
+     * @return Sampled value at each position, from start to end; std::nullopt for positions
+     * outside the image
+     */
+    std::vector< std::optional<double> > lineProfile(
+            const glm::vec3& subjectStart,
+            const glm::vec3& subjectEnd,
+            size_t numSamples,
+            const InterpolationMode& mode ) const;
+
+    /// Get the value of a pixel; std::nullopt if the index is outside the image
+    std::optional<double> pixelValue( const glm::u64vec3& pixelIndex ) const;
+
+    /// Get the component type of the sampled buffer
+    const ComponentType& componentType() const;
+
+    /**
+     * @brief Get whether the sampler samples an image component as it currently is: its buffer
+     * (or bricked volume), component type, dimensions, and Subject space are unchanged since
+     * the sampler was created.
+     * This is much cheaper than creating a new sampler.
+     *
+     * @param[in] record Image record, which must not have been destroyed
+     * @param[in] componentIndex Image component
+     */
+    bool samples( const ImageCpuRecord& record, uint32_t componentIndex ) const;
+
+
+private:
+
+    /// Sample a typed buffer at positions in Pixel space
+    using SampleFunction = void (*)( const void* buffer,
+                                     const glm::u64vec3& pixelDimensions,
+                                     const glm::vec3* pixelPositions,
+                                     size_t numPositions,
+                                     std::optional<double>* values );
+
+    ImageSampler( const void* buffer,
+                  const ComponentType& componentType,
+                  const glm::u64vec3& pixelDimensions,
+                  const glm::mat4& pixel_O_subject,
+                  SampleFunction nearestFunction,
+                  SampleFunction linearFunction );
+
+    /// Sample the image at positions in Pixel space
+    void sampleInPixelSpace( const glm::vec3* pixelPositions, size_t numPositions,
+                             const InterpolationMode& mode, std::optional<double>* values ) const;
+
+    const void* m_buffer; //!< Pixel buffer of the component, or its bricked volume
+    ComponentType m_componentType; //!< Component type of the buffer
+    glm::u64vec3 m_pixelDimensions; //!< Image dimensions in pixels
+    glm::mat4 m_pixel_O_subject; //!< Tx from image Subject to Pixel space
+
+    SampleFunction m_nearestFunction; //!< Nearest neighbor sampling of the buffer type
+    SampleFunction m_linearFunction; //!< Trilinear sampling of the buffer type
+};
+
+} // namespace imageio
+
+#endif // IMAGEIO_IMAGE_SAMPLER_H
@@ -0,0 +1,247 @@
+#include "LabelIndex.h"
+#include "util/HZeeException.hpp"
+#include "util/ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+
+namespace
+{
+
+/// Index of the labels in a block of slices, as accumulated by one worker
+struct BlockIndex
+{
+    BlockIndex( size_t numLabels, bool buildRuns )
+        :
+          m_numPixels( numLabels, 0 ),
+          m_min( numLabels, glm::u64vec3{ std::numeric_limits<uint64_t>::max() } ),
+          m_max( numLabels, glm::u64vec3{ 0 } ),
+          m_sums( numLabels, glm::dvec3{ 0.0 } ),
+          m_runs( buildRuns ? numLabels : 0 )
+    {}
+
+    std::vector<uint64_t> m_numPixels;
+    std::vector<glm::u64vec3> m_min;
+    std::vector<glm::u64vec3> m_max;
+    std::vector<glm::dvec3> m_sums; //!< Sums of pixel positions
+    std::vector< std::vector<imageio::LabelIndex::Run> > m_runs;
+};
+
+
+/// Index the slices [zBegin, zEnd) of a parcellation. Each row is scanned as runs of equal
+/// labels, so that the statistics of a label are updated once per run rather than per pixel.
+template< typename T >
+void indexSlices( const T* buffer, const glm::u64vec3& dims,
+                  uint64_t zBegin, uint64_t zEnd, BlockIndex& index )
+{
+    const size_t numLabels = index.m_numPixels.size();
+    const bool buildRuns = ! index.m_runs.empty();
+
+    for ( uint64_t z = zBegin; z < zEnd; ++z )
+    {
+        for ( uint64_t y = 0; y < dims.y; ++y )
+        {
+            const uint64_t rowOffset = dims.x * ( y + dims.y * z );
+            const T* row = buffer + rowOffset;
+
+            uint64_t x0 = 0;
+
+            while ( x0 < dims.x )
+            {
+                const T label = row[x0];
+
+                uint64_t x1 = x0 + 1;
+                while ( x1 < dims.x && row[x1] == label )
+                {
+                    ++x1;
+                }
+
+                const size_t l = static_cast<size_t>( label );
+
+                if ( l < numLabels )
+                {
+                    const uint64_t length = x1 - x0;
+
+                    index.m_numPixels[l] += length;
+
+                    index.m_min[l] = glm::min( index.m_min[l], glm::u64vec3{ x0, y, z } );
+                    index.m_max[l] = glm::max( index.m_max[l], glm::u64vec3{ x1 - 1, y, z } );
+
+                    // The x coordinates of the run sum to its length times its midpoint
+                    index.m_sums[l] += static_cast<double>( length ) *
+                            glm::dvec3{ 0.5 * static_cast<double>( x0 + x1 - 1 ),
+                                        static_cast<double>( y ),
+                                        static_cast<double>( z ) };
+
+                    if ( buildRuns )
+                    {
+                        index.m_runs[l].push_back(
+                                    { rowOffset + x0, static_cast<uint32_t>( length ) } );
+                    }
+                }
+
+                x0 = x1;
+            }
+        }
+    }
+}
+
+} // anonymous
+
+
+namespace imageio
+{
+
+std::unique_ptr<LabelIndex> LabelIndex::create(
+        const void* buffer,
+        const ComponentType& componentType,
+        const glm::u64vec3& pixelDimensions,
+        size_t numLabels,
+        bool buildRuns,
+        size_t numThreads )
+{
+    if ( ! buffer || 0 == pixelDimensions.x * pixelDimensions.y * pixelDimensions.z )
+    {
+        std::cerr << "Cannot create label index of empty parcellation" << std::endl;
+        return nullptr;
+    }
+
+    if ( pixelDimensions.x > std::numeric_limits<uint32_t>::max() )
+    {
+        std::cerr << "Cannot create label index of parcellation with rows longer than "
+                  << std::numeric_limits<uint32_t>::max() << " pixels" << std::endl;
+        return nullptr;
+    }
+
+    // Each block of contiguous slices is indexed separately, so that the runs of the
+    // blocks are in order of offset when they are concatenated
+    const size_t numBlocks = imageio::parallel::numWorkers(
+                static_cast<size_t>( pixelDimensions.z ), numThreads );
+
+    std::vector<BlockIndex> blocks( numBlocks, BlockIndex( numLabels, buildRuns ) );
+
+    auto indexBlocks = [&] ( auto value )
+    {
+        using T = decltype( value );
+        const T* pixels = static_cast<const T*>( buffer );
+
+        imageio::parallel::forEachIndex( numBlocks, [&] ( size_t, size_t b )
+        {
+            const uint64_t zBegin = pixelDimensions.z * b / numBlocks;
+            const uint64_t zEnd = pixelDimensions.z * ( b + 1 ) / numBlocks;
+            indexSlices( pixels, pixelDimensions, zBegin, zEnd, blocks[b] );
+        }, numThreads );
+    };
+
+    switch ( componentType )
+    {
+    case ComponentType::UInt8:  indexBlocks( uint8_t{} ); break;
+    case ComponentType::UInt16: indexBlocks( uint16_t{} ); break;
+    case ComponentType::UInt32: indexBlocks( uint32_t{} ); break;
+    case ComponentType::UInt64: indexBlocks( uint64_t{} ); break;
+    default:
+    {
+        std::cerr << "Cannot create label index of parcellation with non-unsigned integer "
+                  << "pixel component type" << std::endl;
+        return nullptr;
+    }
+    }
+
+    std::unique_ptr<LabelIndex> index( new LabelIndex( pixelDimensions, numLabels, buildRuns ) );
+
+    for ( size_t l = 0; l < numLabels; ++l )
+    {
+        Label& label = index->m_labels[l];
+        glm::dvec3 sum{ 0.0 };
+
+        for ( const BlockIndex& block : blocks )
+        {
+            if ( 0 == block.m_numPixels[l] )
+            {
+                continue;
+            }
+
+            label.m_boundingBoxMin = ( 0 == label.m_numPixels )
+                    ? block.m_min[l] : glm::min( label.m_boundingBoxMin, block.m_min[l] );
+
+            label.m_boundingBoxMax = ( 0 == label.m_numPixels )
+                    ? block.m_max[l] : glm::max( label.m_boundingBoxMax, block.m_max[l] );
+
+            label.m_numPixels += block.m_numPixels[l];
+            sum += block.m_sums[l];
+
+            if ( buildRuns )
+            {
+                index->m_runs[l].insert( std::end( index->m_runs[l] ),
+                                         std::begin( block.m_runs[l] ),
+                                         std::end( block.m_runs[l] ) );
+            }
+        }
+
+        if ( 0 < label.m_numPixels )
+        {
+            label.m_centroid = sum / static_cast<double>( label.m_numPixels );
+        }
+    }
+
+    return index;
+}
+
+
+LabelIndex::LabelIndex( const glm::u64vec3& pixelDimensions, size_t numLabels, bool buildRuns )
+    :
+      m_pixelDimensions( pixelDimensions ),
+      m_labels( numLabels, Label{ 0, glm::u64vec3{ 0 }, glm::u64vec3{ 0 }, glm::dvec3{ 0.0 } } ),
+      m_runs( buildRuns ? numLabels : 0 )
+{}
+
+const glm::u64vec3& LabelIndex::pixelDimensions() const
+{
+    return m_pixelDimensions;
+}
+
+size_t LabelIndex::numLabels() const
+{
+    return m_labels.size();
+}
+
+const LabelIndex::Label& LabelIndex::label( size_t labelIndex ) const
+{
+    if ( labelIndex < m_labels.size() )
+    {
+        return m_labels[labelIndex];
+    }
+
+    std::ostringstream ss;
+    ss << "Invalid label index " << labelIndex << " requested" << std::ends;
+    throw_io_debug( ss.str() );
+}
+
+bool LabelIndex::hasPixels( size_t labelIndex ) const
+{
+    return ( labelIndex < m_labels.size() && 0 < m_labels[labelIndex].m_numPixels );
+}
+
+bool LabelIndex::hasRuns() const
+{
+    return ! m_runs.empty();
+}
+
+const std::vector<LabelIndex::Run>& LabelIndex::runs( size_t labelIndex ) const
+{
+    static const std::vector<Run> sk_noRuns;
+
+    if ( labelIndex < m_runs.size() )
+    {
+        return m_runs[labelIndex];
+    }
+
+    return sk_noRuns;
+}
+
+} // namespace imageio
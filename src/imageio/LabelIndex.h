@@ -0,0 +1,109 @@
+#ifndef IMAGEIO_LABEL_INDEX_H
+#define IMAGEIO_LABEL_INDEX_H
+
+#include "HZeeTypes.hpp"
+
+#include <glm/vec3.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+namespace imageio
+{
+
+/**
+ * @brief Sparse index of the labels of a parcellation, built in one pass over its pixels.
+ * For each label index, it holds the number of pixels with the label, their bounding box and
+ * centroid and, optionally, the runs of pixels with the label along image rows. Work on a
+ * single label can thus be restricted to the part of the volume that holds it.
+ *
+ * All positions are in image Pixel space.
+ */
+class LabelIndex
+{
+public:
+
+    struct Label
+    {
+        uint64_t m_numPixels; //!< Number of pixels with the label
+        glm::u64vec3 m_boundingBoxMin; //!< Minimum pixel index of the label (if it has pixels)
+        glm::u64vec3 m_boundingBoxMax; //!< Maximum pixel index of the label (if it has pixels)
+        glm::dvec3 m_centroid; //!< Mean pixel position of the label (if it has pixels)
+    };
+
+    /// Run of consecutive pixels with the same label along an image row
+    struct Run
+    {
+        uint64_t m_offset; //!< Offset of the first pixel of the run in the image buffer
+        uint32_t m_length; //!< Number of pixels in the run
+    };
+
+
+    /**
+     * @brief Create the index of a parcellation. The slices of the parcellation are scanned
+     * concurrently on the shared thread pool, in blocks of slices that each accumulate their
+     * own index, and the block indices are then merged.
+     *
+     * @param[in] buffer Parcellation pixels (label indices), with x varying fastest
+     * @param[in] componentType Pixel component type, which must be an unsigned integer type
+     * @param[in] pixelDimensions Parcellation dimensions in pixels
+     * @param[in] numLabels Number of label indices. Pixels with larger indices are not indexed.
+     * @param[in] buildRuns Whether to build the runs of pixels of each label
+     * @param[in] numThreads Maximum number of threads; if zero, the whole shared thread pool is used
+     *
+     * @return Index; null if the parcellation is empty or its component type is invalid
+     */
+    static std::unique_ptr<LabelIndex> create(
+            const void* buffer,
+            const ComponentType& componentType,
+            const glm::u64vec3& pixelDimensions,
+            size_t numLabels,
+            bool buildRuns = false,
+            size_t numThreads = 0 );
+
+
+    LabelIndex( const LabelIndex& ) = delete;
+    LabelIndex& operator=( const LabelIndex& ) = delete;
+
+    LabelIndex( LabelIndex&& ) = default;
+    LabelIndex& operator=( LabelIndex&& ) = default;
+
+    ~LabelIndex() = default;
+
+
+    /// Get the dimensions of the indexed parcellation
+    const glm::u64vec3& pixelDimensions() const;
+
+    /// Get the number of label indices
+    size_t numLabels() const;
+
+    /// Get the index entry of a label
+    const Label& label( size_t labelIndex ) const;
+
+    /// Get whether a label occurs in the parcellation
+    bool hasPixels( size_t labelIndex ) const;
+
+    /// Get whether the runs of pixels of each label were built
+    bool hasRuns() const;
+
+    /// Get the runs of pixels of a label, in increasing order of offset. Empty if the runs
+    /// were not built.
+    const std::vector<Run>& runs( size_t labelIndex ) const;
+
+
+private:
+
+    LabelIndex( const glm::u64vec3& pixelDimensions, size_t numLabels, bool buildRuns );
+
+    glm::u64vec3 m_pixelDimensions;
+    std::vector<Label> m_labels;
+    std::vector< std::vector<Run> > m_runs; //!< Runs of each label; empty if not built
+};
+
+} // namespace imageio
+
+#endif // IMAGEIO_LABEL_INDEX_H
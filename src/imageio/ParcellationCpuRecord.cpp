@@ -1,4 +1,5 @@
 #include "ParcellationCpuRecord.h"
+#include "LabelIndex.h"
 
 #include "util/HZeeException.hpp"
 
@@ -13,7 +14,8 @@ ParcellationCpuRecord::ParcellationCpuRecord(
         std::vector<int64_t> pixelValueMap )
     :
       ImageCpuRecord( std::move( imageCpuRecord ) ),
-      m_labelValues( std::move( pixelValueMap ) )
+      m_labelValues( std::move( pixelValueMap ) ),
+      m_labelIndex( nullptr )
 {
     if ( m_labelValues.empty() )
     {
@@ -57,4 +59,14 @@ std::pair<int64_t, int64_t> ParcellationCpuRecord::minMaxLabelValues() const
     return { sortedLabels.front(), sortedLabels.back() };
 }
 
+void ParcellationCpuRecord::setLabelIndex( std::shared_ptr<const LabelIndex> index )
+{
+    m_labelIndex = std::move( index );
+}
+
+const LabelIndex* ParcellationCpuRecord::labelIndex() const
+{
+    return m_labelIndex.get();
+}
+
 } // namespace imageio
@@ -5,6 +5,7 @@
 
 #include <boost/range/any_range.hpp>
 
+#include <memory>
 #include <optional>
 #include <utility>
 #include <vector>
@@ -13,6 +14,9 @@
 namespace imageio
 {
 
+class LabelIndex;
+
+
 /**
  * @brief Record of a parcellation. It consists of the image record with pixel values
  * corresponding to label indices (unsigned integers). There is also a structure that maps label
@@ -62,6 +66,16 @@ public:
     /// Get the minimum and maximum label values in the parcellation
     std::pair<int64_t, int64_t> minMaxLabelValues() const;
 
+    /**
+     * @brief Set the index of the parcellation's labels (pixel counts, bounding boxes, etc.)
+     *
+     * @param[in] index Index of the labels of this parcellation; null to unset
+     */
+    void setLabelIndex( std::shared_ptr<const LabelIndex> index );
+
+    /// Get the index of the parcellation's labels; null if it is not set
+    const LabelIndex* labelIndex() const;
+
 
 private:
 
@@ -69,6 +83,9 @@ private:
     /// with the excpetion of label value 0, which is always first.
     /// Therefore, this vector is sorted if all label values are non-negative.
     std::vector<int64_t> m_labelValues;
+
+    /// Optional index of the labels, with one entry per label index
+    std::shared_ptr<const LabelIndex> m_labelIndex;
 };
 
 } // namespace imageio
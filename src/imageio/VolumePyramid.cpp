@@ -0,0 +1,377 @@
+#include "VolumePyramid.h"
+#include "BrickedVolume.h"
+#include "itkbridge/ITKBridge.hpp"
+#include "util/HZeeException.hpp"
+#include "util/ThreadPool.h"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/component_wise.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <type_traits>
+
+
+namespace
+{
+
+/**
+ * @brief Overlap of the pixels of a coarse level with those of the finer level along one axis.
+ * Since a coarse pixel spans at most two fine pixels, it overlaps at most three of them: the
+ * pixels starting at m_first[i], with weights m_weights[i], which sum to one.
+ */
+struct AxisTaps
+{
+    AxisTaps( uint64_t srcSize, uint64_t dstSize )
+        :
+          m_first( static_cast<size_t>( dstSize ) ),
+          m_weights( static_cast<size_t>( dstSize ) )
+    {
+        const double scale = static_cast<double>( srcSize ) / static_cast<double>( dstSize );
+
+        for ( uint64_t d = 0; d < dstSize; ++d )
+        {
+            const double begin = static_cast<double>( d ) * scale;
+            const double end = static_cast<double>( d + 1 ) * scale;
+
+            const uint64_t first = static_cast<uint64_t>( std::floor( begin ) );
+
+            m_first[d] = first;
+            m_weights[d].fill( 0.0 );
+
+            for ( uint64_t t = 0; t < 3 && first + t < srcSize; ++t )
+            {
+                const double s = static_cast<double>( first + t );
+                const double overlap = std::min( end, s + 1.0 ) - std::max( begin, s );
+                m_weights[d][t] = std::max( overlap, 0.0 ) / scale;
+            }
+        }
+    }
+
+    std::vector<uint64_t> m_first;
+    std::vector< std::array<double, 3> > m_weights;
+};
+
+
+/**
+ * @brief Reduce a volume to coarser dimensions by area-averaging. Only the slices of the source
+ * volume that a range of destination slices covers need be in memory.
+ *
+ * @param[in] src Source slices, starting with slice \c srcZBegin
+ * @param[in] srcDims Dimensions of the whole source volume
+ * @param[in] srcZBegin Index of the first source slice in memory
+ * @param[out] dst Destination slices, starting with slice \c dstZBegin
+ * @param[in] dstDims Dimensions of the whole destination volume
+ * @param[in] dstZBegin Index of the first destination slice to reduce
+ * @param[in] dstZEnd Index one past the last destination slice to reduce
+ * @param[in] numThreads Maximum number of threads
+ */
+template< typename T >
+void reduce( const T* src, const glm::u64vec3& srcDims, uint64_t srcZBegin,
+             T* dst, const glm::u64vec3& dstDims, uint64_t dstZBegin, uint64_t dstZEnd,
+             size_t numThreads )
+{
+    const AxisTaps xTaps( srcDims.x, dstDims.x );
+    const AxisTaps yTaps( srcDims.y, dstDims.y );
+    const AxisTaps zTaps( srcDims.z, dstDims.z );
+
+    const uint64_t srcRow = srcDims.x;
+    const uint64_t srcSlice = srcDims.x * srcDims.y;
+
+    auto reduceSlice = [&] ( uint64_t z )
+    {
+        T* out = dst + ( z - dstZBegin ) * dstDims.x * dstDims.y;
+
+        for ( uint64_t y = 0; y < dstDims.y; ++y )
+        {
+            for ( uint64_t x = 0; x < dstDims.x; ++x )
+            {
+                double sum = 0.0;
+
+                for ( uint64_t k = 0; k < 3; ++k )
+                {
+                    const double wz = zTaps.m_weights[z][k];
+                    if ( wz <= 0.0 ) continue;
+
+                    const T* srcSlicePtr = src + ( zTaps.m_first[z] + k - srcZBegin ) * srcSlice;
+
+                    for ( uint64_t j = 0; j < 3; ++j )
+                    {
+                        const double wzy = wz * yTaps.m_weights[y][j];
+                        if ( wzy <= 0.0 ) continue;
+
+                        const T* srcRowPtr = srcSlicePtr + ( yTaps.m_first[y] + j ) * srcRow + xTaps.m_first[x];
+
+                        for ( uint64_t i = 0; i < 3; ++i )
+                        {
+                            const double w = wzy * xTaps.m_weights[x][i];
+                            if ( w <= 0.0 ) continue;
+
+                            sum += w * static_cast<double>( srcRowPtr[i] );
+                        }
+                    }
+                }
+
+                if constexpr ( std::is_integral<T>::value )
+                {
+                    sum = std::clamp( std::round( sum ),
+                                      static_cast<double>( std::numeric_limits<T>::lowest() ),
+                                      static_cast<double>( std::numeric_limits<T>::max() ) );
+                }
+
+                *out++ = static_cast<T>( sum );
+            }
+        }
+    };
+
+    imageio::parallel::forEachIndex( static_cast<size_t>( dstZEnd - dstZBegin ),
+                                     [&reduceSlice, dstZBegin] ( size_t, size_t z ) { reduceSlice( dstZBegin + z ); },
+                                     numThreads );
+}
+
+
+/// Reduce slices of a volume of pixels of a given component type
+void reduce( const imageio::ComponentType& componentType,
+             const void* src, const glm::u64vec3& srcDims, uint64_t srcZBegin,
+             void* dst, const glm::u64vec3& dstDims, uint64_t dstZBegin, uint64_t dstZEnd,
+             size_t numThreads )
+{
+    using imageio::ComponentType;
+
+    auto run = [&] ( auto value )
+    {
+        using T = decltype( value );
+        reduce( static_cast<const T*>( src ), srcDims, srcZBegin,
+                static_cast<T*>( dst ), dstDims, dstZBegin, dstZEnd, numThreads );
+    };
+
+    switch ( componentType )
+    {
+    case ComponentType::Int8:     run( int8_t{} ); break;
+    case ComponentType::UInt8:    run( uint8_t{} ); break;
+    case ComponentType::Int16:    run( int16_t{} ); break;
+    case ComponentType::UInt16:   run( uint16_t{} ); break;
+    case ComponentType::Int32:    run( int32_t{} ); break;
+    case ComponentType::UInt32:   run( uint32_t{} ); break;
+    case ComponentType::Int64:    run( int64_t{} ); break;
+    case ComponentType::UInt64:   run( uint64_t{} ); break;
+    case ComponentType::Float32:  run( float{} ); break;
+    case ComponentType::Double64: run( double{} ); break;
+    }
+}
+
+} // anonymous
+
+
+namespace imageio
+{
+
+std::unique_ptr<VolumePyramid> VolumePyramid::create(
+        const void* buffer,
+        const ComponentType& componentType,
+        const glm::u64vec3& pixelDimensions,
+        uint64_t coarsestSize,
+        size_t numThreads )
+{
+    if ( ! buffer || 0 == glm::compMul( pixelDimensions ) )
+    {
+        std::cerr << "Cannot create pyramid of empty volume" << std::endl;
+        return nullptr;
+    }
+
+    coarsestSize = std::max( coarsestSize, uint64_t( 1 ) );
+
+    const auto compSize = itkbridge::k_bytesPerComponentMap.find( componentType );
+
+    if ( std::end( itkbridge::k_bytesPerComponentMap ) == compSize )
+    {
+        std::cerr << "Invalid component type for volume pyramid" << std::endl;
+        return nullptr;
+    }
+
+    std::unique_ptr<VolumePyramid> pyramid( new VolumePyramid( componentType, pixelDimensions ) );
+    pyramid->appendLevels( buffer, pixelDimensions, compSize->second, coarsestSize, numThreads );
+
+    return pyramid;
+}
+
+
+std::unique_ptr<VolumePyramid> VolumePyramid::create(
+        const BrickedVolume& volume,
+        uint64_t coarsestSize,
+        size_t numThreads )
+{
+    const ComponentType& componentType = volume.componentType();
+    const glm::u64vec3& pixelDimensions = volume.pixelDimensions();
+    const uint64_t compSize = volume.componentSizeInBytes();
+
+    if ( 0 == glm::compMul( pixelDimensions ) )
+    {
+        std::cerr << "Cannot create pyramid of empty volume" << std::endl;
+        return nullptr;
+    }
+
+    coarsestSize = std::max( coarsestSize, uint64_t( 1 ) );
+
+    std::unique_ptr<VolumePyramid> pyramid( new VolumePyramid( componentType, pixelDimensions ) );
+
+    if ( glm::compMax( pixelDimensions ) <= coarsestSize )
+    {
+        return pyramid;
+    }
+
+    Level level;
+    level.m_pixelDimensions = glm::max( ( pixelDimensions + glm::u64vec3{ 1 } ) / glm::u64vec3{ 2 }, glm::u64vec3{ 1 } );
+    level.m_downsampleFactors = glm::dvec3{ pixelDimensions } / glm::dvec3{ level.m_pixelDimensions };
+
+    const glm::u64vec3& dstDims = level.m_pixelDimensions;
+    const AxisTaps zTaps( pixelDimensions.z, dstDims.z );
+
+    // The finest level is reduced in slabs, each from the slices of the volume that it covers.
+    // A slab covers about one layer of bricks, so that each brick is read about twice.
+    const uint64_t slabSize = std::max( volume.brickSize() / 2, 1u );
+    std::vector<uint8_t> srcSlab;
+
+    try
+    {
+        level.m_data.resize( compSize * glm::compMul( dstDims ) );
+
+        for ( uint64_t z = 0; z < dstDims.z; z += slabSize )
+        {
+            const uint64_t zEnd = std::min( z + slabSize, dstDims.z );
+            const uint64_t srcZBegin = zTaps.m_first[z];
+            const uint64_t srcZEnd = std::min( zTaps.m_first[zEnd - 1] + 3, pixelDimensions.z );
+
+            srcSlab.resize( compSize * pixelDimensions.x * pixelDimensions.y * ( srcZEnd - srcZBegin ) );
+
+            if ( ! volume.extractSlab( srcZBegin, srcZEnd, srcSlab.data(), numThreads ) )
+            {
+                std::cerr << "Cannot read slices " << srcZBegin << " to " << srcZEnd
+                          << " of bricked volume for its pyramid" << std::endl;
+                return nullptr;
+            }
+
+            reduce( componentType, srcSlab.data(), pixelDimensions, srcZBegin,
+                    level.m_data.data() + compSize * z * dstDims.x * dstDims.y, dstDims, z, zEnd, numThreads );
+        }
+    }
+    catch ( const std::bad_alloc& )
+    {
+        std::cerr << "Cannot allocate level 0 of volume pyramid" << std::endl;
+        return nullptr;
+    }
+
+    pyramid->m_levels.emplace_back( std::move( level ) );
+
+    const Level& finest = pyramid->m_levels.back();
+    pyramid->appendLevels( finest.m_data.data(), finest.m_pixelDimensions, compSize, coarsestSize, numThreads );
+
+    return pyramid;
+}
+
+
+VolumePyramid::VolumePyramid( const ComponentType& componentType, const glm::u64vec3& pixelDimensions )
+    :
+      m_componentType( componentType ),
+      m_pixelDimensions( pixelDimensions ),
+      m_levels()
+{}
+
+void VolumePyramid::appendLevels(
+        const void* src,
+        glm::u64vec3 srcDims,
+        uint64_t componentSize,
+        uint64_t coarsestSize,
+        size_t numThreads )
+{
+    while ( glm::compMax( srcDims ) > coarsestSize )
+    {
+        Level level;
+        level.m_pixelDimensions = glm::max( ( srcDims + glm::u64vec3{ 1 } ) / glm::u64vec3{ 2 }, glm::u64vec3{ 1 } );
+        level.m_downsampleFactors = glm::dvec3{ m_pixelDimensions } / glm::dvec3{ level.m_pixelDimensions };
+
+        try
+        {
+            level.m_data.resize( componentSize * glm::compMul( level.m_pixelDimensions ) );
+        }
+        catch ( const std::bad_alloc& )
+        {
+            std::cerr << "Cannot allocate level " << m_levels.size()
+                      << " of volume pyramid" << std::endl;
+            break;
+        }
+
+        reduce( m_componentType, src, srcDims, 0, level.m_data.data(), level.m_pixelDimensions,
+                0, level.m_pixelDimensions.z, numThreads );
+
+        m_levels.emplace_back( std::move( level ) );
+
+        // Reduce each level from the one before it. Vector data do not move when the vector
+        // of levels grows, so the source pointer remains valid.
+        src = m_levels.back().m_data.data();
+        srcDims = m_levels.back().m_pixelDimensions;
+    }
+}
+
+std::unique_ptr<VolumePyramid> VolumePyramid::withoutPixels() const
+{
+    std::unique_ptr<VolumePyramid> pyramid( new VolumePyramid( m_componentType, m_pixelDimensions ) );
+    pyramid->m_levels.reserve( m_levels.size() );
+
+    for ( const Level& level : m_levels )
+    {
+        pyramid->m_levels.emplace_back( Level{ level.m_pixelDimensions, level.m_downsampleFactors, {} } );
+    }
+
+    return pyramid;
+}
+
+const ComponentType& VolumePyramid::componentType() const
+{
+    return m_componentType;
+}
+
+const glm::u64vec3& VolumePyramid::pixelDimensions() const
+{
+    return m_pixelDimensions;
+}
+
+size_t VolumePyramid::numLevels() const
+{
+    return m_levels.size();
+}
+
+const VolumePyramid::Level& VolumePyramid::level( size_t i ) const
+{
+    if ( i < m_levels.size() )
+    {
+        return m_levels.at( i );
+    }
+
+    std::ostringstream ss;
+    ss << "Invalid volume pyramid level " << i << " requested" << std::ends;
+    throw_io_debug( ss.str() );
+}
+
+size_t VolumePyramid::levelForDownsample( double downsample ) const
+{
+    size_t best = 0;
+
+    for ( size_t i = 0; i < m_levels.size(); ++i )
+    {
+        if ( glm::compMax( m_levels[i].m_downsampleFactors ) > downsample )
+        {
+            break;
+        }
+
+        best = i + 1;
+    }
+
+    return best;
+}
+
+} // namespace imageio
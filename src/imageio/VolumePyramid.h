@@ -0,0 +1,139 @@
+#ifndef IMAGEIO_VOLUME_PYRAMID_H
+#define IMAGEIO_VOLUME_PYRAMID_H
+
+#include "HZeeTypes.hpp"
+
+#include <glm/vec3.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+namespace imageio
+{
+
+class BrickedVolume;
+
+
+/**
+ * @brief Multi-resolution pyramid of a scalar image volume. Each level halves the dimensions
+ * of the level before it, rounding up, until the volume fits in a cube of a given size.
+ *
+ * The full-resolution volume is not held by the pyramid: level i of the pyramid is the image
+ * reduced i + 1 times. All levels span the same physical extent as the image, so the pixel
+ * spacing of a level is that of the image times its downsample factors.
+ */
+class VolumePyramid
+{
+public:
+
+    /// Default number of pixels along the largest axis of the coarsest level
+    static constexpr uint64_t sk_defaultCoarsestSize = 32;
+
+    struct Level
+    {
+        glm::u64vec3 m_pixelDimensions; //!< Level dimensions in pixels
+        glm::dvec3 m_downsampleFactors; //!< Image dimensions divided by level dimensions
+        std::vector<uint8_t> m_data; //!< Level pixels, with x varying fastest
+    };
+
+
+    /**
+     * @brief Create the pyramid of a scalar volume by repeated 2x box reduction: each pixel of
+     * a level is the mean of the pixels of the finer level that it covers, weighted by their
+     * overlap with it. (For odd dimensions, a coarse pixel covers fractions of the fine pixels
+     * on its boundaries.) Integer means are rounded to the nearest integer.
+     *
+     * The slices of each level are reduced concurrently on the shared thread pool.
+     *
+     * @param[in] buffer Volume pixels, with x varying fastest
+     * @param[in] componentType Pixel component type
+     * @param[in] pixelDimensions Volume dimensions in pixels
+     * @param[in] coarsestSize Levels are created until the largest dimension is no more than this
+     * @param[in] numThreads Maximum number of threads; if zero, the whole shared thread pool is used
+     *
+     * @return Pyramid; null if the volume is empty. The pyramid has no levels if the volume
+     * already fits within the coarsest size.
+     */
+    static std::unique_ptr<VolumePyramid> create(
+            const void* buffer,
+            const ComponentType& componentType,
+            const glm::u64vec3& pixelDimensions,
+            uint64_t coarsestSize = sk_defaultCoarsestSize,
+            size_t numThreads = 0 );
+
+    /**
+     * @brief Create the pyramid of a bricked volume, as above, without holding the volume in
+     * memory. The finest level is reduced in slabs from about one layer of bricks at a time.
+     *
+     * @param[in] volume Bricked volume
+     * @param[in] coarsestSize Levels are created until the largest dimension is no more than this
+     * @param[in] numThreads Maximum number of threads; if zero, the whole shared thread pool is used
+     *
+     * @return Pyramid; null if the volume is empty or its finest level cannot be created
+     */
+    static std::unique_ptr<VolumePyramid> create(
+            const BrickedVolume& volume,
+            uint64_t coarsestSize = sk_defaultCoarsestSize,
+            size_t numThreads = 0 );
+
+
+    VolumePyramid( const VolumePyramid& ) = delete;
+    VolumePyramid& operator=( const VolumePyramid& ) = delete;
+
+    VolumePyramid( VolumePyramid&& ) = default;
+    VolumePyramid& operator=( VolumePyramid&& ) = default;
+
+    ~VolumePyramid() = default;
+
+
+    /**
+     * @brief Create a copy of the pyramid that holds the dimensions and downsample factors of
+     * its levels but not their pixels. Once the levels are held in textures, the copy can
+     * still be used to select the level to display.
+     */
+    std::unique_ptr<VolumePyramid> withoutPixels() const;
+
+
+    const ComponentType& componentType() const;
+
+    /// Get the dimensions of the full-resolution volume
+    const glm::u64vec3& pixelDimensions() const;
+
+    /// Get the number of reduced levels
+    size_t numLevels() const;
+
+    /// Get a reduced level, where level 0 has the finest resolution
+    const Level& level( size_t i ) const;
+
+    /**
+     * @brief Get the coarsest level whose pixels are no larger than a given size, as would be
+     * used to display the volume at that size
+     *
+     * @param[in] downsample Number of full-resolution pixels per displayed pixel
+     *
+     * @return Index of the level plus one, so that 0 refers to the full-resolution volume
+     */
+    size_t levelForDownsample( double downsample ) const;
+
+
+private:
+
+    VolumePyramid( const ComponentType& componentType, const glm::u64vec3& pixelDimensions );
+
+    /// Append levels reduced from a source volume (the full-resolution volume or the coarsest
+    /// level) until the largest dimension is no more than the coarsest size
+    void appendLevels( const void* src, glm::u64vec3 srcDims, uint64_t componentSize,
+                       uint64_t coarsestSize, size_t numThreads );
+
+    ComponentType m_componentType;
+    glm::u64vec3 m_pixelDimensions;
+    std::vector<Level> m_levels;
+};
+
+} // namespace imageio
+
+#endif // IMAGEIO_VOLUME_PYRAMID_H
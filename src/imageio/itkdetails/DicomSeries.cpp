@@ -0,0 +1,534 @@
+#include "itkdetails/DicomSeries.hpp"
+#include "util/ThreadPool.h"
+
+#include <itkGDCMImageIO.h>
+
+#include <gdcmReader.h>
+#include <gdcmStringFilter.h>
+#include <gdcmTag.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+
+namespace
+{
+
+static const gdcm::Tag sk_seriesUIDTag( 0x0020, 0x000e );
+static const gdcm::Tag sk_imagePositionTag( 0x0020, 0x0032 );
+static const gdcm::Tag sk_imageOrientationTag( 0x0020, 0x0037 );
+static const gdcm::Tag sk_instanceNumberTag( 0x0020, 0x0013 );
+static const gdcm::Tag sk_rowsTag( 0x0028, 0x0010 );
+static const gdcm::Tag sk_columnsTag( 0x0028, 0x0011 );
+
+/// Tags that refine the Series Instance UID into a series identifier, in the order in which
+/// \c itk::GDCMSeriesFileNames appends them when using series details and the Series Date
+/// restriction of \c seriesSearch
+static const std::vector< gdcm::Tag > sk_seriesDetailTags{
+    gdcm::Tag( 0x0020, 0x0011 ), //!< Series Number
+    gdcm::Tag( 0x0018, 0x0024 ), //!< Sequence Name
+    gdcm::Tag( 0x0018, 0x0050 ), //!< Slice Thickness
+    sk_rowsTag,
+    sk_columnsTag,
+    gdcm::Tag( 0x0008, 0x0021 ) //!< Series Date
+};
+
+
+/// Information used to group and sort the slices of a DICOM series
+struct SliceHeader
+{
+    /// Flag that is true iff the file is a DICOM image
+    bool m_isImage = false;
+
+    std::string m_seriesId;
+    std::optional< std::array< double, 3 > > m_position;
+    std::optional< std::array< double, 6 > > m_orientation;
+    std::optional< long > m_instanceNumber;
+};
+
+
+/// Slice header cached with the modification time and size of its file
+struct CachedSlice
+{
+    std::time_t m_modifiedTime;
+    uintmax_t m_fileSize;
+    SliceHeader m_header;
+};
+
+
+/// Cached index of a directory
+struct CachedDirectory
+{
+    std::unordered_map< std::string, CachedSlice > m_slices;
+    std::shared_ptr< const itkdetails::utility::dicom::SeriesIndex > m_index;
+
+    /// Value of the use counter when the directory was last indexed
+    uint64_t m_lastUse;
+};
+
+
+/// Maximum number of directories whose indices are cached. The least recently indexed
+/// directory is evicted beyond this.
+static constexpr size_t sk_maxNumCachedDirectories = 16;
+
+std::mutex s_cacheMutex;
+std::unordered_map< std::string, CachedDirectory > s_cache;
+uint64_t s_cacheUseCounter = 0;
+
+
+/// Insert the index of a directory into the cache, evicting the least recently indexed
+/// directory if the cache is full. The cache mutex must be held by the caller.
+void cacheDirectory( const std::string& directory, CachedDirectory cachedDirectory )
+{
+    cachedDirectory.m_lastUse = ++s_cacheUseCounter;
+    s_cache[directory] = std::move( cachedDirectory );
+
+    while ( s_cache.size() > sk_maxNumCachedDirectories )
+    {
+        s_cache.erase( std::min_element( std::begin( s_cache ), std::end( s_cache ),
+                                         [] ( const auto& a, const auto& b ) {
+            return a.second.m_lastUse < b.second.m_lastUse; } ) );
+    }
+}
+
+
+/// Parse the backslash-separated numbers of a multi-valued decimal string
+template< size_t N >
+std::optional< std::array< double, N > > parseDecimals( const std::string& value )
+{
+    std::vector< std::string > parts;
+    boost::algorithm::split( parts, value, boost::is_any_of( "\\" ) );
+
+    if ( N != parts.size() )
+    {
+        return std::nullopt;
+    }
+
+    std::array< double, N > numbers;
+
+    for ( size_t i = 0; i < N; ++i )
+    {
+        char* end = nullptr;
+        numbers[i] = std::strtod( parts[i].c_str(), &end );
+
+        if ( end == parts[i].c_str() )
+        {
+            return std::nullopt;
+        }
+    }
+
+    return numbers;
+}
+
+
+/// Create the identifier of the series of a file as \c gdcm::SerieHelper does: the Series
+/// Instance UID is followed by a separator and the values of the detail tags, after which
+/// all characters other than dots and alphanumerics are removed
+std::string createSeriesId( const std::string& seriesUID, const std::vector< std::string >& details )
+{
+    std::string id = seriesUID;
+
+    for ( const auto& s : details )
+    {
+        if ( id == seriesUID && ! s.empty() )
+        {
+            id += ".";
+        }
+
+        id += s;
+    }
+
+    id.erase( std::remove_if( std::begin( id ), std::end( id ), [] ( char c ) {
+        return ( '.' != c && ! std::isalnum( static_cast< unsigned char >( c ) ) ); } ),
+              std::end( id ) );
+
+    return id;
+}
+
+
+/// Read the slice header of a file. Only the tags needed to index series are parsed.
+SliceHeader readSliceHeader( const std::string& fileName )
+{
+    SliceHeader header;
+
+    std::set< gdcm::Tag > tags{ sk_seriesUIDTag, sk_imagePositionTag, sk_imageOrientationTag,
+                                sk_instanceNumberTag };
+
+    tags.insert( std::begin( sk_seriesDetailTags ), std::end( sk_seriesDetailTags ) );
+
+    gdcm::Reader reader;
+    reader.SetFileName( fileName.c_str() );
+
+    if ( ! reader.ReadSelectedTags( tags ) )
+    {
+        return header;
+    }
+
+    gdcm::StringFilter filter;
+    filter.SetFile( reader.GetFile() );
+
+    const gdcm::DataSet& dataSet = reader.GetFile().GetDataSet();
+
+    auto value = [&dataSet, &filter] ( const gdcm::Tag& tag ) -> std::string
+    {
+        if ( ! dataSet.FindDataElement( tag ) )
+        {
+            return std::string{};
+        }
+
+        // Values are padded with spaces or nulls to even lengths
+        return boost::algorithm::trim_copy_if(
+                    filter.ToString( tag ), boost::is_any_of( std::string( " \0", 2 ) ) );
+    };
+
+    const std::string seriesUID = value( sk_seriesUIDTag );
+
+    if ( seriesUID.empty() || value( sk_rowsTag ).empty() || value( sk_columnsTag ).empty() )
+    {
+        return header;
+    }
+
+    std::vector< std::string > details;
+
+    for ( const auto& tag : sk_seriesDetailTags )
+    {
+        details.emplace_back( value( tag ) );
+    }
+
+    header.m_isImage = true;
+    header.m_seriesId = createSeriesId( seriesUID, details );
+    header.m_position = parseDecimals< 3 >( value( sk_imagePositionTag ) );
+    header.m_orientation = parseDecimals< 6 >( value( sk_imageOrientationTag ) );
+
+    const std::string instanceNumber = value( sk_instanceNumberTag );
+
+    if ( ! instanceNumber.empty() )
+    {
+        header.m_instanceNumber = std::strtol( instanceNumber.c_str(), nullptr, 10 );
+    }
+
+    return header;
+}
+
+
+/// Sort the slices of a series as \c gdcm::SerieHelper does: by position along the normal of
+/// the first slice if all slices have distinct positions, otherwise by Instance Number if all
+/// slices have one, otherwise by file name
+std::vector< std::string > sortSlices(
+        std::vector< std::pair< std::string, const SliceHeader* > >& slices )
+{
+    std::sort( std::begin( slices ), std::end( slices ),
+               [] ( const auto& a, const auto& b ) { return a.first < b.first; } );
+
+    const bool havePositions = std::all_of(
+                std::begin( slices ), std::end( slices ), [] ( const auto& s ) {
+        return ( s.second->m_position && s.second->m_orientation ); } );
+
+    bool sorted = false;
+
+    if ( havePositions )
+    {
+        const auto& o = *slices.front().second->m_orientation;
+
+        const std::array< double, 3 > normal{
+            o[1] * o[5] - o[2] * o[4],
+            o[2] * o[3] - o[0] * o[5],
+            o[0] * o[4] - o[1] * o[3] };
+
+        auto distance = [&normal] ( const SliceHeader* h )
+        {
+            const auto& p = *h->m_position;
+            return normal[0] * p[0] + normal[1] * p[1] + normal[2] * p[2];
+        };
+
+        std::vector< std::pair< double, size_t > > order;
+        order.reserve( slices.size() );
+
+        for ( size_t i = 0; i < slices.size(); ++i )
+        {
+            order.emplace_back( distance( slices[i].second ), i );
+        }
+
+        std::sort( std::begin( order ), std::end( order ) );
+
+        const bool distinct = ( std::end( order ) == std::adjacent_find(
+                                    std::begin( order ), std::end( order ),
+                                    [] ( const auto& a, const auto& b ) { return a.first == b.first; } ) );
+
+        if ( distinct )
+        {
+            std::vector< std::pair< std::string, const SliceHeader* > > reordered;
+            reordered.reserve( slices.size() );
+
+            for ( const auto& d : order )
+            {
+                reordered.emplace_back( slices[d.second] );
+            }
+
+            slices = std::move( reordered );
+            sorted = true;
+        }
+    }
+
+    if ( ! sorted && std::all_of( std::begin( slices ), std::end( slices ), [] ( const auto& s ) {
+                                      return s.second->m_instanceNumber.has_value(); } ) )
+    {
+        std::stable_sort( std::begin( slices ), std::end( slices ), [] ( const auto& a, const auto& b ) {
+            return *a.second->m_instanceNumber < *b.second->m_instanceNumber; } );
+    }
+
+    std::vector< std::string > fileNames;
+    fileNames.reserve( slices.size() );
+
+    for ( const auto& s : slices )
+    {
+        fileNames.emplace_back( s.first );
+    }
+
+    return fileNames;
+}
+
+
+/// Create the index of the series of a directory from the slice headers of its files
+std::shared_ptr< const itkdetails::utility::dicom::SeriesIndex >
+createSeriesIndex( const std::unordered_map< std::string, CachedSlice >& slices )
+{
+    std::map< std::string, std::vector< std::pair< std::string, const SliceHeader* > > > series;
+
+    for ( const auto& s : slices )
+    {
+        if ( s.second.m_header.m_isImage )
+        {
+            series[s.second.m_header.m_seriesId].emplace_back( s.first, &s.second.m_header );
+        }
+    }
+
+    auto index = std::make_shared< itkdetails::utility::dicom::SeriesIndex >();
+
+    for ( auto& s : series )
+    {
+        index->m_seriesFileNames.emplace( s.first, sortSlices( s.second ) );
+    }
+
+    return index;
+}
+
+} // anonymous
+
+
+namespace itkdetails
+{
+
+namespace utility
+{
+
+namespace dicom
+{
+
+std::vector< std::string > SeriesIndex::seriesUIDs() const
+{
+    std::vector< std::string > uids;
+    uids.reserve( m_seriesFileNames.size() );
+
+    for ( const auto& s : m_seriesFileNames )
+    {
+        uids.emplace_back( s.first );
+    }
+
+    return uids;
+}
+
+
+std::vector< std::string > SeriesIndex::fileNames( const std::string& seriesUID ) const
+{
+    const auto it = m_seriesFileNames.find( seriesUID );
+    return ( std::end( m_seriesFileNames ) != it ) ? it->second : std::vector< std::string >{};
+}
+
+
+std::shared_ptr< const SeriesIndex > indexDirectory(
+        const std::string& directory, size_t numThreads )
+{
+    namespace fs = boost::filesystem;
+
+    std::unordered_map< std::string, CachedSlice > slices;
+
+    try
+    {
+        for ( const auto& entry : fs::directory_iterator( directory ) )
+        {
+            if ( fs::is_regular_file( entry.status() ) )
+            {
+                const std::string fileName = entry.path().string();
+                slices[fileName] = CachedSlice{ fs::last_write_time( entry.path() ),
+                                                fs::file_size( entry.path() ),
+                                                SliceHeader{} };
+            }
+        }
+    }
+    catch ( const fs::filesystem_error& e )
+    {
+        std::cerr << "Unable to list DICOM directory '" << directory << "': "
+                  << e.what() << std::endl;
+        return nullptr;
+    }
+
+    // Headers of files that are unchanged since the directory was last indexed are reused
+    std::vector< std::string > changedFileNames;
+
+    {
+        std::lock_guard< std::mutex > lock( s_cacheMutex );
+
+        const auto cached = s_cache.find( directory );
+
+        for ( auto& s : slices )
+        {
+            bool found = false;
+
+            if ( std::end( s_cache ) != cached )
+            {
+                const auto& cachedSlices = cached->second.m_slices;
+                const auto c = cachedSlices.find( s.first );
+
+                if ( std::end( cachedSlices ) != c &&
+                     c->second.m_modifiedTime == s.second.m_modifiedTime &&
+                     c->second.m_fileSize == s.second.m_fileSize )
+                {
+                    s.second.m_header = c->second.m_header;
+                    found = true;
+                }
+            }
+
+            if ( ! found )
+            {
+                changedFileNames.push_back( s.first );
+            }
+        }
+
+        if ( changedFileNames.empty() && std::end( s_cache ) != cached &&
+             cached->second.m_slices.size() == slices.size() )
+        {
+            cached->second.m_lastUse = ++s_cacheUseCounter;
+            return cached->second.m_index;
+        }
+    }
+
+    std::vector< SliceHeader > changedHeaders( changedFileNames.size() );
+
+    imageio::parallel::forEachIndex( changedFileNames.size(), [&] ( size_t, size_t i )
+    {
+        changedHeaders[i] = readSliceHeader( changedFileNames[i] );
+    }, numThreads );
+
+    for ( size_t i = 0; i < changedFileNames.size(); ++i )
+    {
+        slices[changedFileNames[i]].m_header = std::move( changedHeaders[i] );
+    }
+
+    auto index = createSeriesIndex( slices );
+
+    {
+        std::lock_guard< std::mutex > lock( s_cacheMutex );
+        cacheDirectory( directory, CachedDirectory{ std::move( slices ), index, 0 } );
+    }
+
+    return index;
+}
+
+
+bool readSeriesSlices(
+        const std::vector< std::string >& fileNames,
+        const ::itk::ImageIOBase* firstImageIO,
+        void* buffer,
+        std::array< double, 3 >& lastSliceOrigin,
+        size_t numThreads )
+{
+    if ( fileNames.empty() || ! firstImageIO || ! buffer ||
+         3 != firstImageIO->GetNumberOfDimensions() )
+    {
+        return false;
+    }
+
+    const size_t sliceSizeInBytes = static_cast< size_t >( firstImageIO->GetImageSizeInBytes() );
+
+    std::atomic< bool > failed( false );
+
+    imageio::parallel::forEachIndex( fileNames.size(), [&] ( size_t, size_t i )
+    {
+        if ( failed )
+        {
+            return;
+        }
+
+        try
+        {
+            const ::itk::GDCMImageIO::Pointer sliceIO = ::itk::GDCMImageIO::New();
+            sliceIO->SetFileName( fileNames[i] );
+            sliceIO->ReadImageInformation();
+
+            bool matches = ( 3 == sliceIO->GetNumberOfDimensions() &&
+                             sliceIO->GetComponentType() == firstImageIO->GetComponentType() &&
+                             sliceIO->GetPixelType() == firstImageIO->GetPixelType() &&
+                             sliceIO->GetNumberOfComponents() == firstImageIO->GetNumberOfComponents() );
+
+            for ( uint32_t d = 0; matches && d < 3; ++d )
+            {
+                matches = ( sliceIO->GetDimensions( d ) == firstImageIO->GetDimensions( d ) );
+            }
+
+            if ( ! matches )
+            {
+                std::cerr << "DICOM file '" << fileNames[i] << "' does not match the first "
+                          << "slice of its series" << std::endl;
+                failed = true;
+                return;
+            }
+
+            ::itk::ImageIORegion region( 3 );
+
+            for ( uint32_t d = 0; d < 3; ++d )
+            {
+                region.SetIndex( d, 0 );
+                region.SetSize( d, sliceIO->GetDimensions( d ) );
+            }
+
+            sliceIO->SetIORegion( region );
+            sliceIO->Read( static_cast< uint8_t* >( buffer ) + i * sliceSizeInBytes );
+
+            if ( fileNames.size() - 1 == i )
+            {
+                for ( uint32_t d = 0; d < 3; ++d )
+                {
+                    lastSliceOrigin[d] = sliceIO->GetOrigin( d );
+                }
+            }
+        }
+        catch ( const ::itk::ExceptionObject& e )
+        {
+            std::cerr << "Exception while reading DICOM file '" << fileNames[i] << "': "
+                      << e.what() << std::endl;
+            failed = true;
+        }
+    }, numThreads );
+
+    return ( ! failed );
+}
+
+} // namespace dicom
+
+} // namespace utility
+
+} // namespace itkdetails
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <itkImageIOBase.h>
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace itkdetails
+{
+
+namespace utility
+{
+
+namespace dicom
+{
+
+/**
+ * @brief Index of the DICOM image series in a directory
+ */
+struct SeriesIndex
+{
+    /// Get the identifiers of the series, in sorted order
+    std::vector< std::string > seriesUIDs() const;
+
+    /// Get the file names of a series, sorted in slice order.
+    /// The vector is empty if the directory has no series with the identifier.
+    std::vector< std::string > fileNames( const std::string& seriesUID ) const;
+
+    /// File names of each series, keyed by series identifier
+    std::map< std::string, std::vector< std::string > > m_seriesFileNames;
+};
+
+
+/**
+ * @brief Index the DICOM image series in a directory (not recursively).
+ *
+ * Series are identified as by \c itk::GDCMSeriesFileNames with series details: the Series
+ * Instance UID is refined by the Series Number, Sequence Name, Slice Thickness, Rows, Columns,
+ * and Series Date of each file. Slices are sorted by position along the slice normal, falling
+ * back to Instance Number and then to file name.
+ *
+ * File headers are parsed using multiple threads. The index is cached per directory: files
+ * whose modification time and size are unchanged since the last call are not parsed again,
+ * so indexing a directory again is nearly instant. The indices of the most recently indexed
+ * directories are cached.
+ *
+ * @param directory Directory path
+ * @param numThreads Maximum number of parsing threads. Zero uses the whole shared thread pool.
+ *
+ * @return Index of the series; null if the directory cannot be read
+ */
+std::shared_ptr< const SeriesIndex > indexDirectory(
+        const std::string& directory, size_t numThreads = 0 );
+
+
+/**
+ * @brief Read the pixels of a series of single-slice DICOM files into a volume buffer using
+ * multiple threads. Slice \c i is decoded by its own GDCM image IO into the buffer at an
+ * offset of \c i slice sizes, exactly as the ITK series reader decodes it.
+ *
+ * @param fileNames Sorted file names of the series
+ * @param firstImageIO GDCM image IO that has read the information of the first file. All
+ * slices must match its dimensions, pixel type, and component type.
+ * @param buffer Volume buffer of at least as many bytes as the slices
+ * @param[out] lastSliceOrigin Origin of the last slice, from which the slice spacing follows
+ * @param numThreads Maximum number of decoding threads. Zero uses the whole shared thread pool.
+ *
+ * @return True iff all slices were read
+ */
+bool readSeriesSlices(
+        const std::vector< std::string >& fileNames,
+        const ::itk::ImageIOBase* firstImageIO,
+        void* buffer,
+        std::array< double, 3 >& lastSliceOrigin,
+        size_t numThreads = 0 );
+
+} // namespace dicom
+
+} // namespace utility
+
+} // namespace itkdetails
@@ -48,9 +48,7 @@ const io::ImageIoInfo& ImageBaseData::imageIOInfo() const
 
 bool ImageBaseData::isVectorImage() const
 {
-    return ( m_imageBasePtr.IsNotNull() )
-            ? ( m_imageBasePtr->GetNumberOfComponentsPerPixel() > 1 )
-            : false;
+    return ( m_imageIOInfo.m_pixelInfo.m_numComponents > 1 );
 }
 
 
@@ -65,6 +65,8 @@ public:
             const std::vector< std::string >& fileNames,
             const imageio::ComponentNormalizationPolicy& normalizationPolicy ) = 0;
 
+    /// Get the buffer of the whole image. Components of multi-component images are
+    /// stored in planar order: all pixels of component 0, then all pixels of component 1, etc.
     virtual const uint8_t* bufferPointer() const = 0;
 
     virtual const uint8_t* bufferPointer( const uint32_t componentIndex ) const = 0;
@@ -86,6 +88,8 @@ public:
     std::optional< utility::PixelStatistics<double> >
     pixelStatistics( uint32_t componentIndex ) const;
 
+    /// Get whether the image has multiple components. (Once loaded, the components of such
+    /// images are held as separate scalar images: see \c bufferPointer.)
     bool isVectorImage() const;
 
     typename image3d::ImageBaseType::Pointer
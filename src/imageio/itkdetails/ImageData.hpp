@@ -6,6 +6,7 @@
 #include <itkImage.h>
 #include <itkVectorImage.h>
 
+#include <memory>
 #include <vector>
 
 
@@ -16,13 +17,18 @@ namespace utility
 {
 template< class ImageType >
 struct PixelStatistics;
+
+template< class PixelType >
+struct PixelMoments;
 }
 
 
 /**
- * @note Data of multi-component (vector) images are cloned after being loaded:
- * one copy pointed to by base class' \c m_imageBasePtr;
- * the other copy pointed to by this class' \c m_splitImagePtrs
+ * @note Data of multi-component (vector) images are held once: after being loaded, the
+ * buffer of the image pointed to by base class' \c m_imageBasePtr is rearranged in place
+ * so that each component is contiguous (planar order). The images pointed to by this class'
+ * \c m_splitImagePtrs are views of the components in that buffer, so they must not outlive
+ * this object. \c m_imageBasePtr then points to the image of the first component.
  */
 template< typename ComponentType >
 class ImageData : public ImageBaseData
@@ -82,11 +88,22 @@ public:
     typename image3d::ImageType< ComponentType >::Pointer
     asITKImage() const;
 
+
+private:
+
+    /// @note Only valid before the image is set up: its components are then rearranged in
+    /// planar order and the vector image is replaced by the split images.
     typename image3d::VectorImageType< ComponentType >::Pointer
     asITKVectorImage() const;
 
+    /// Memory-map the pixel data of an uncompressed, scalar image file instead of reading it.
+    /// @return False if the file cannot be mapped, in which case it must be read normally
+    bool mapImageFile( const ::itk::ImageIOBase::Pointer& imageIO );
 
-private:
+    /// Decompress the pixel data of a BGZF-compressed, scalar NIfTI file using multiple threads,
+    /// accumulating the pixel moments during decompression.
+    /// @return False if the file is not supported, in which case it must be read normally
+    bool inflateImageFile( const ::itk::ImageIOBase::Pointer& imageIO );
 
     bool splitImageIntoComponents();
     bool computePixelStatistics();
@@ -94,6 +111,18 @@ private:
 
     /// Image split into vector of \c itkImage pointers
     std::vector< typename image3d::ImageType< ComponentType >::Pointer > m_splitImagePtrs;
+
+    /// Pixel container of a vector image, which owns the buffer of the split images after
+    /// their components were rearranged in planar order. Null for scalar images.
+    typename image3d::VectorImageType< ComponentType >::PixelContainerPointer m_planarPixels;
+
+    /// Memory mapping of the image file that holds the pixel buffer, if the pixels were mapped
+    /// rather than read. The image does not own its buffer in that case.
+    std::shared_ptr< void > m_mappedPixels;
+
+    /// Moments of the pixels accumulated while the image was decompressed, if it was
+    /// decompressed by this class. They save a pass over the pixels when computing statistics.
+    std::unique_ptr< utility::PixelMoments< ComponentType > > m_streamedMoments;
 };
 
 } // namespace itkdetails
@@ -1,5 +1,7 @@
 #include "itkdetails/ImageData.hpp" // for IDE
+#include "itkdetails/ImageDecompression.hpp"
 #include "itkdetails/ImageIOInfo.hpp"
+#include "itkdetails/ImageMapping.hpp"
 #include "itkdetails/ImageReading.hpp"
 #include "itkdetails/ImageUtility.hpp"
 
@@ -40,11 +42,71 @@ bool normalizeImageIntensities(
 }
 
 
+/// Check whether an image file holds a 3D scalar image with components of a given type
+template< typename ComponentType >
+bool isScalarImageOfType( const ::itk::ImageIOBase::Pointer& imageIO )
+{
+    const auto componentType = io::itkComponentTypeMap.find(
+                std::type_index( typeid( ComponentType ) ) );
+
+    return ( std::end( io::itkComponentTypeMap ) != componentType &&
+             componentType->second == imageIO->GetComponentType() &&
+             1 == imageIO->GetNumberOfComponents() &&
+             image3d::NDIM == imageIO->GetNumberOfDimensions() );
+}
+
+
+/// Create an image with the geometry read from an image file, but without a pixel buffer
+template< typename ComponentType >
+typename image3d::ImageType< ComponentType >::Pointer
+createImageWithoutBuffer( const ::itk::ImageIOBase::Pointer& imageIO )
+{
+    using ImageType = image3d::ImageType< ComponentType >;
+
+    typename ImageType::IndexType start;
+    typename ImageType::SizeType size;
+    typename ImageType::SpacingType spacing;
+    typename ImageType::PointType origin;
+    typename ImageType::DirectionType directions;
+
+    for ( uint i = 0; i < image3d::NDIM; ++i )
+    {
+        start[i] = 0;
+        size[i] = imageIO->GetDimensions( i );
+        spacing[i] = imageIO->GetSpacing( i );
+        origin[i] = imageIO->GetOrigin( i );
+
+        /// @internal Direction vectors are the columns of the direction matrix
+        const std::vector< double > axis = imageIO->GetDirection( i );
+
+        for ( uint j = 0; j < image3d::NDIM; ++j )
+        {
+            directions[j][i] = axis[j];
+        }
+    }
+
+    typename ImageType::RegionType region;
+    region.SetSize( size );
+    region.SetIndex( start );
+
+    typename ImageType::Pointer image = ImageType::New();
+    image->SetRegions( region );
+    image->SetSpacing( spacing );
+    image->SetOrigin( origin );
+    image->SetDirection( directions );
+
+    return image;
+}
+
+
 template< class ComponentType >
 ImageData< ComponentType >::ImageData()
     :
       ImageBaseData(),
-      m_splitImagePtrs()
+      m_splitImagePtrs(),
+      m_planarPixels( nullptr ),
+      m_mappedPixels( nullptr ),
+      m_streamedMoments( nullptr )
 {}
 
 
@@ -54,7 +116,10 @@ ImageData< ComponentType >::ImageData(
         io::ImageIoInfo ioInfo )
     :
       ImageBaseData( std::move( ioInfo ) ),
-      m_splitImagePtrs( std::move( splitImagePtrs ) )
+      m_splitImagePtrs( std::move( splitImagePtrs ) ),
+      m_planarPixels( nullptr ),
+      m_mappedPixels( nullptr ),
+      m_streamedMoments( nullptr )
 {
     // No need to call splitImageIntoComponents() here, since the split image components
     // are passed in to the constructor
@@ -163,7 +228,19 @@ bool ImageData< ComponentType >::loadFromImageFile(
     }
 #endif
 
-    m_imageBasePtr = reader::read< ComponentType >( imageIO );
+    /// @internal Images whose intensities are normalized get modified, so they are read
+    /// into their own buffers rather than mapped
+    if ( imageio::ComponentNormalizationPolicy::None == normalizationPolicy &&
+         mapImageFile( imageIO ) )
+    {
+        return setup();
+    }
+
+    /// @internal BGZF-compressed NIfTI images are decompressed using multiple threads
+    if ( ! inflateImageFile( imageIO ) )
+    {
+        m_imageBasePtr = reader::read< ComponentType >( imageIO );
+    }
 
     if ( m_imageBasePtr.IsNull() )
     {
@@ -187,6 +264,12 @@ bool ImageData< ComponentType >::loadFromImageFile(
         return false;
     }
 
+    if ( imageio::ComponentNormalizationPolicy::None != normalizationPolicy )
+    {
+        /// @internal Moments accumulated during decompression are of the original intensities
+        m_streamedMoments = nullptr;
+    }
+
     return setup();
 }
 
@@ -270,19 +353,113 @@ bool ImageData< ComponentType >::loadFromDicomSeries(
 
 
 template< class ComponentType >
-const uint8_t* ImageData< ComponentType >::bufferPointer() const
+bool ImageData< ComponentType >::mapImageFile( const ::itk::ImageIOBase::Pointer& imageIO )
 {
-    if ( m_imageBasePtr.IsNotNull() )
+    /// @internal Only 3D scalar images with components of the output type are mapped:
+    /// other images are cast by the reader. Vector images are not mapped, since their
+    /// buffers are rearranged by component after loading.
+    if ( ! isScalarImageOfType< ComponentType >( imageIO ) )
     {
-        return reinterpret_cast< const uint8_t* >(
-                    ( isVectorImage() )
-                    ? asITKVectorImage()->GetBufferPointer()
-                    : asITKImage()->GetBufferPointer() );
+        return false;
     }
-    else
+
+    typename image3d::ImageType< ComponentType >::Pointer
+            image = createImageWithoutBuffer< ComponentType >( imageIO );
+
+    const size_t numImagePixels = image->GetBufferedRegion().GetNumberOfPixels();
+
+    auto mapped = mapping::mapPixelData( imageIO->GetFileName(),
+                                         numImagePixels * sizeof( ComponentType ),
+                                         alignof( ComponentType ) );
+
+    if ( ! mapped )
     {
-        return nullptr;
+        return false;
+    }
+
+    /// @internal The image does not manage the memory of its pixels, which are owned
+    /// by the mapping
+    static constexpr bool sk_letImageManageMemory = false;
+
+    image->GetPixelContainer()->SetImportPointer(
+                static_cast< ComponentType* >( mapped->m_pixels ),
+                numImagePixels, sk_letImageManageMemory );
+
+    m_mappedPixels = std::move( mapped->m_mapping );
+    m_imageBasePtr = static_cast< image3d::ImageBaseType::Pointer >( image );
+
+    std::cout << "Memory-mapped pixels of image '" << imageIO->GetFileName() << "'" << std::endl;
+
+    return true;
+}
+
+
+template< class ComponentType >
+bool ImageData< ComponentType >::inflateImageFile( const ::itk::ImageIOBase::Pointer& imageIO )
+{
+    if ( ! isScalarImageOfType< ComponentType >( imageIO ) )
+    {
+        return false;
+    }
+
+    const std::string fileName = imageIO->GetFileName();
+
+    /// @internal A plain gzip stream can only be inflated sequentially, which ITK's reader
+    /// (using zlib's gzread) does at least as fast
+    if ( ! decompression::isBgzfFile( fileName ) )
+    {
+        return false;
+    }
+
+    const auto dataOffset = decompression::niftiGzipPixelDataOffset( fileName );
+
+    if ( ! dataOffset )
+    {
+        return false;
+    }
+
+    typename image3d::ImageType< ComponentType >::Pointer
+            image = createImageWithoutBuffer< ComponentType >( imageIO );
+
+    image->Allocate();
+
+    ComponentType* buffer = image->GetBufferPointer();
+    const size_t numImagePixels = image->GetBufferedRegion().GetNumberOfPixels();
+
+    auto moments = std::make_unique< utility::PixelMoments< ComponentType > >();
+
+    /// @internal Moments of the decompressed pixels are accumulated on this thread,
+    /// while the rest of the image is decompressed on others
+    auto accumulateMoments = [buffer, &moments] ( uint64_t numBytesReady )
+    {
+        const size_t numPixelsReady = numBytesReady / sizeof( ComponentType );
+        const size_t numPixelsDone = moments->m_count;
+
+        moments->add( buffer + numPixelsDone, numPixelsReady - numPixelsDone );
+    };
+
+    if ( ! decompression::inflateGzipFile(
+             fileName, *dataOffset, numImagePixels * sizeof( ComponentType ),
+             reinterpret_cast< uint8_t* >( buffer ), accumulateMoments ) )
+    {
+        return false;
     }
+
+    m_streamedMoments = std::move( moments );
+    m_imageBasePtr = static_cast< image3d::ImageBaseType::Pointer >( image );
+
+    return true;
+}
+
+
+/**
+ * @note The components are contiguous in the buffer, so the buffer of the whole image
+ * starts with that of the first component
+ */
+template< class ComponentType >
+const uint8_t* ImageData< ComponentType >::bufferPointer() const
+{
+    return bufferPointer( 0 );
 }
 
 
@@ -408,14 +585,17 @@ ImageData< ComponentType >::asITKVectorImage() const
 
 
 /**
- * @note Data of multi-component (vector) images gets duplicated by this function:
- * one copy pointed to by base class' \c m_imageBasePtr;
- * the other copy pointed to by this class' \c m_splitImagePtrs
+ * @note Data of multi-component (vector) images are not duplicated by this function:
+ * the buffer of the vector image pointed to by base class' \c m_imageBasePtr is rearranged
+ * in place by component, and the images pointed to by this class' \c m_splitImagePtrs are
+ * views of the components in that buffer. The vector image no longer describes its buffer
+ * afterwards, so it is replaced in \c m_imageBasePtr by the image of the first component,
+ * and only its pixel container is kept, as the owner of the buffer.
  */
 template< class ComponentType >
 bool ImageData< ComponentType >::splitImageIntoComponents()
 {
-    if ( isVectorImage() )
+    if ( m_imageBasePtr.IsNotNull() && m_imageBasePtr->GetNumberOfComponentsPerPixel() > 1 )
     {
         const typename image3d::VectorImageType< ComponentType >::Pointer
                 vectorImage = asITKVectorImage();
@@ -429,6 +609,13 @@ bool ImageData< ComponentType >::splitImageIntoComponents()
         /// @internal Same as m_imageInfo.m_pixelInfo.m_numComponents:
         const uint32_t numComponents = vectorImage->GetVectorLength();
 
+        ComponentType* buffer = vectorImage->GetBufferPointer();
+        const size_t N = numPixels();
+
+        /// @internal Rearrange the pixels of \c vectorImage, whose components are offset from
+        /// each other by a stride of \c numComponents, so that each component is contiguous
+        utility::deinterleaveComponentsInPlace( buffer, N, numComponents );
+
         m_splitImagePtrs.resize( numComponents );
 
         for ( uint32_t i = 0; i < numComponents; ++i )
@@ -437,23 +624,17 @@ bool ImageData< ComponentType >::splitImageIntoComponents()
 
             m_splitImagePtrs[i]->CopyInformation( vectorImage );
             m_splitImagePtrs[i]->SetRegions( vectorImage->GetBufferedRegion() );
-            m_splitImagePtrs[i]->Allocate();
-
-            ComponentType* source = vectorImage->GetBufferPointer() + i;
-            ComponentType* dest = m_splitImagePtrs[i]->GetBufferPointer();
-
-            const ComponentType* end = dest + numPixels();
-
-            /// @internal Copy pixels from component \c i of \c vectorImage (the source),
-            /// which are offset from each other by a stride of \c numComponents,
-            /// into pixels of the i'th split image (the destination)
-            while ( dest < end )
-            {
-                *dest = *source;
-                ++dest;
-                source += numComponents;
-            }
+
+            /// @internal The split image does not manage the memory of its pixels,
+            /// which remains owned by \c vectorImage
+            static constexpr bool sk_letImageManageMemory = false;
+
+            m_splitImagePtrs[i]->GetPixelContainer()->SetImportPointer(
+                        buffer + i * N, N, sk_letImageManageMemory );
         }
+
+        m_planarPixels = vectorImage->GetPixelContainer();
+        m_imageBasePtr = static_cast< image3d::ImageBaseType::Pointer >( m_splitImagePtrs[0] );
     }
     else
     {
@@ -482,10 +663,14 @@ bool ImageData< ComponentType >::computePixelStatistics()
     {
         m_pixelStatistics.clear();
 
+        /// @internal Moments accumulated during decompression are only of scalar images
+        const utility::PixelMoments< ComponentType >* moments =
+                ( 1 == m_splitImagePtrs.size() ) ? m_streamedMoments.get() : nullptr;
+
         for ( const auto& image : m_splitImagePtrs )
         {
             auto stats = utility::computeImagePixelStatistics<
-                    image3d::ImageType< ComponentType > >( image );
+                    image3d::ImageType< ComponentType > >( image, moments );
 
             utility::PixelStatistics< double > cs;
             cs.m_minimum = static_cast< double >( stats.m_minimum );
@@ -0,0 +1,581 @@
+#include "itkdetails/ImageDecompression.hpp"
+#include "itkdetails/ImageMapping.hpp"
+#include "util/ThreadPool.h"
+
+#include <itk_zlib.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <utility>
+
+
+namespace
+{
+
+/// Number of decompressed bytes after which the consumer is notified
+static constexpr uint64_t sk_chunkSize = uint64_t{ 4 } << 20;
+
+/// Maximum number of compressed bytes passed to zlib at once
+static constexpr uint64_t sk_maxInflateInput = uint64_t{ 1 } << 30;
+
+/// Maximum decompressed size of a BGZF block
+static constexpr uint32_t sk_maxBgzfBlockSize = 65536;
+
+/// Window bits for zlib to decode gzip headers and check gzip trailers
+static constexpr int sk_gzipWindowBits = 15 + 16;
+
+/// Minimum size of a gzip member: header and trailer
+static constexpr uint64_t sk_minGzipMemberSize = 18;
+
+/// gzip header flag that indicates an extra field
+static constexpr uint8_t sk_gzipExtraFlag = 4;
+
+
+uint16_t readLittleEndian16( const uint8_t* p )
+{
+    return static_cast< uint16_t >( p[0] | ( p[1] << 8 ) );
+}
+
+
+uint32_t readLittleEndian32( const uint8_t* p )
+{
+    return ( static_cast< uint32_t >( p[0] ) |
+             ( static_cast< uint32_t >( p[1] ) << 8 ) |
+             ( static_cast< uint32_t >( p[2] ) << 16 ) |
+             ( static_cast< uint32_t >( p[3] ) << 24 ) );
+}
+
+
+/// Check whether data start with the header of a deflate-compressed gzip member
+bool isGzipMember( const uint8_t* data, uint64_t numBytes )
+{
+    return ( numBytes >= sk_minGzipMemberSize &&
+             0x1f == data[0] && 0x8b == data[1] && Z_DEFLATED == data[2] );
+}
+
+
+/// zlib stream that decompresses gzip members
+class GzipInflater
+{
+public:
+
+    GzipInflater()
+        : m_stream(),
+          m_valid( false )
+    {
+        m_stream.zalloc = Z_NULL;
+        m_stream.zfree = Z_NULL;
+        m_stream.opaque = Z_NULL;
+        m_stream.next_in = Z_NULL;
+        m_stream.avail_in = 0;
+
+        m_valid = ( Z_OK == inflateInit2( &m_stream, sk_gzipWindowBits ) );
+    }
+
+    ~GzipInflater()
+    {
+        if ( m_valid )
+        {
+            inflateEnd( &m_stream );
+        }
+    }
+
+    GzipInflater( const GzipInflater& ) = delete;
+    GzipInflater& operator=( const GzipInflater& ) = delete;
+
+    bool isValid() const { return m_valid; }
+
+    z_stream& stream() { return m_stream; }
+
+
+private:
+
+    z_stream m_stream;
+    bool m_valid;
+};
+
+
+/// BGZF block: a gzip member whose extra field holds its compressed size
+struct BgzfBlock
+{
+    uint64_t m_inOffset;
+    uint32_t m_inSize;
+    uint64_t m_outOffset;
+    uint32_t m_outSize;
+};
+
+
+/// Get the compressed size of the BGZF block at the start of data
+/// @return Size in bytes; zero if the data do not start with a BGZF block
+uint64_t bgzfBlockSize( const uint8_t* member, uint64_t numBytes )
+{
+    if ( ! isGzipMember( member, numBytes ) || 0 == ( member[3] & sk_gzipExtraFlag ) )
+    {
+        return 0;
+    }
+
+    const uint64_t extraEnd = 12 + uint64_t{ readLittleEndian16( member + 10 ) };
+
+    if ( extraEnd > numBytes )
+    {
+        return 0;
+    }
+
+    // The 'BC' subfield holds the block size minus one
+    uint64_t blockSize = 0;
+
+    for ( uint64_t f = 12; f + 4 <= extraEnd; f += 4 + uint64_t{ readLittleEndian16( member + f + 2 ) } )
+    {
+        if ( 'B' == member[f] && 'C' == member[f + 1] &&
+             2 == readLittleEndian16( member + f + 2 ) && f + 6 <= extraEnd )
+        {
+            blockSize = uint64_t{ readLittleEndian16( member + f + 4 ) } + 1;
+            break;
+        }
+    }
+
+    if ( blockSize < extraEnd + 8 || blockSize > numBytes )
+    {
+        return 0;
+    }
+
+    return blockSize;
+}
+
+
+/// Find the BGZF blocks of a file
+/// @return Blocks in file order; empty if any member of the file is not a BGZF block
+std::vector< BgzfBlock > findBgzfBlocks( const uint8_t* data, uint64_t numBytes )
+{
+    std::vector< BgzfBlock > blocks;
+
+    uint64_t inOffset = 0;
+    uint64_t outOffset = 0;
+
+    while ( inOffset < numBytes )
+    {
+        const uint8_t* member = data + inOffset;
+        const uint64_t blockSize = bgzfBlockSize( member, numBytes - inOffset );
+
+        if ( 0 == blockSize )
+        {
+            return {};
+        }
+
+        // The trailer ends with the decompressed size of the block
+        const uint32_t outSize = readLittleEndian32( member + blockSize - 4 );
+
+        if ( outSize > sk_maxBgzfBlockSize )
+        {
+            return {};
+        }
+
+        blocks.push_back( { inOffset, static_cast< uint32_t >( blockSize ), outOffset, outSize } );
+
+        inOffset += blockSize;
+        outOffset += outSize;
+    }
+
+    return blocks;
+}
+
+
+/// Decompress the part of a BGZF block that overlaps a range of the decompressed file.
+/// Blocks that lie entirely in the range are decompressed directly into the destination.
+bool inflateBgzfBlock(
+        GzipInflater& inflater,
+        const uint8_t* data,
+        const BgzfBlock& block,
+        uint64_t offset,
+        uint64_t numBytes,
+        uint8_t* dest,
+        uint8_t* scratch )
+{
+    const uint64_t lo = std::max( block.m_outOffset, offset );
+    const uint64_t hi = std::min( block.m_outOffset + block.m_outSize, offset + numBytes );
+
+    if ( lo >= hi )
+    {
+        return true;
+    }
+
+    const bool wholeBlock = ( lo == block.m_outOffset && hi == block.m_outOffset + block.m_outSize );
+
+    z_stream& stream = inflater.stream();
+
+    if ( Z_OK != inflateReset( &stream ) )
+    {
+        return false;
+    }
+
+    stream.next_in = const_cast< Bytef* >( data + block.m_inOffset );
+    stream.avail_in = block.m_inSize;
+    stream.next_out = wholeBlock ? ( dest + ( block.m_outOffset - offset ) ) : scratch;
+    stream.avail_out = block.m_outSize;
+
+    if ( Z_STREAM_END != inflate( &stream, Z_FINISH ) || 0 != stream.avail_out )
+    {
+        return false;
+    }
+
+    if ( ! wholeBlock )
+    {
+        std::memcpy( dest + ( lo - offset ), scratch + ( lo - block.m_outOffset ), hi - lo );
+    }
+
+    return true;
+}
+
+
+/// Decompress the BGZF blocks that overlap a range of the decompressed file in parallel.
+/// Batches of consecutive blocks are decompressed on the shared thread pool and by this thread,
+/// which also notifies the consumer of the batches in order.
+bool inflateBgzfBlocks(
+        const uint8_t* data,
+        const std::vector< BgzfBlock >& blocks,
+        uint64_t offset,
+        uint64_t numBytes,
+        uint8_t* dest,
+        const itkdetails::decompression::ProgressConsumer& consumer,
+        size_t numThreads )
+{
+    const uint64_t end = offset + numBytes;
+
+    if ( blocks.back().m_outOffset + blocks.back().m_outSize < end )
+    {
+        return false;
+    }
+
+    // Batches [first, last) of blocks that overlap the range
+    std::vector< std::pair< size_t, size_t > > batches;
+
+    for ( size_t i = 0; i < blocks.size() && blocks[i].m_outOffset < end; )
+    {
+        if ( blocks[i].m_outOffset + blocks[i].m_outSize <= offset )
+        {
+            ++i;
+            continue;
+        }
+
+        const size_t first = i;
+        const uint64_t batchEnd = blocks[i].m_outOffset + sk_chunkSize;
+
+        while ( i < blocks.size() && blocks[i].m_outOffset < std::min( batchEnd, end ) )
+        {
+            ++i;
+        }
+
+        batches.emplace_back( first, i );
+    }
+
+    std::mutex mutex;
+    std::condition_variable batchFinished;
+    std::vector< char > batchDone( batches.size(), 0 );
+    std::atomic< size_t > nextBatch( 0 );
+    std::atomic< bool > failed( false );
+
+    auto inflateBatch = [&] ( size_t b, GzipInflater& inflater, std::vector< uint8_t >& scratch )
+    {
+        bool success = ( inflater.isValid() && ! failed );
+
+        for ( size_t i = batches[b].first; success && i < batches[b].second; ++i )
+        {
+            success = inflateBgzfBlock( inflater, data, blocks[i], offset, numBytes,
+                                        dest, scratch.data() );
+        }
+
+        {
+            std::lock_guard< std::mutex > lock( mutex );
+            batchDone[b] = 1;
+
+            if ( ! success )
+            {
+                failed = true;
+            }
+        }
+
+        batchFinished.notify_all();
+    };
+
+    auto worker = [&] ()
+    {
+        GzipInflater inflater;
+        std::vector< uint8_t > scratch( sk_maxBgzfBlockSize );
+
+        for ( size_t b = nextBatch++; b < batches.size(); b = nextBatch++ )
+        {
+            inflateBatch( b, inflater, scratch );
+        }
+    };
+
+    // This thread is also a worker
+    const size_t numWorkers = imageio::parallel::numWorkers( batches.size(), numThreads );
+
+    imageio::parallel::TaskGroup helpers;
+
+    for ( size_t i = 1; i < numWorkers; ++i )
+    {
+        helpers.run( worker );
+    }
+
+    if ( consumer )
+    {
+        GzipInflater inflater;
+        std::vector< uint8_t > scratch( sk_maxBgzfBlockSize );
+
+        for ( size_t b = 0; b < batches.size(); ++b )
+        {
+            // Batch b has been taken by a running worker, so while it is not done, this thread
+            // decompresses batches that no worker has taken yet, rather than waiting for one
+            for ( ;; )
+            {
+                {
+                    std::unique_lock< std::mutex > lock( mutex );
+
+                    if ( 1 == batchDone[b] || failed )
+                    {
+                        break;
+                    }
+
+                    if ( nextBatch >= batches.size() )
+                    {
+                        batchFinished.wait( lock, [&] () { return ( 1 == batchDone[b] || failed ); } );
+                        break;
+                    }
+                }
+
+                const size_t c = nextBatch++;
+
+                if ( c < batches.size() )
+                {
+                    inflateBatch( c, inflater, scratch );
+                }
+            }
+
+            if ( failed )
+            {
+                break;
+            }
+
+            const BgzfBlock& last = blocks[ batches[b].second - 1 ];
+            consumer( std::min( last.m_outOffset + last.m_outSize, end ) - offset );
+        }
+    }
+    else
+    {
+        worker();
+    }
+
+    helpers.wait();
+
+    return ( ! failed );
+}
+
+
+/// Decompress a range of a gzip file sequentially, continuing across gzip members.
+/// @param publish Optional function called with the number of bytes of the range
+/// decompressed so far, every time the destination advances
+/// @return Number of bytes of the range decompressed, which is less than \c numBytes if the
+/// file ends before the range; std::nullopt on a decompression error
+std::optional< uint64_t > inflateSequential(
+        const uint8_t* data,
+        uint64_t dataSize,
+        uint64_t offset,
+        uint64_t numBytes,
+        uint8_t* dest,
+        const std::function< void ( uint64_t ) >& publish )
+{
+    GzipInflater inflater;
+
+    if ( ! inflater.isValid() || ! isGzipMember( data, dataSize ) )
+    {
+        return std::nullopt;
+    }
+
+    z_stream& stream = inflater.stream();
+
+    // Decompressed bytes before the range are discarded into this buffer
+    std::vector< uint8_t > discard( sk_maxBgzfBlockSize );
+
+    const uint64_t end = offset + numBytes;
+    uint64_t inPos = 0;
+    uint64_t outPos = 0;
+
+    while ( outPos < end )
+    {
+        if ( 0 == stream.avail_in )
+        {
+            if ( inPos >= dataSize )
+            {
+                // The file is truncated
+                return std::nullopt;
+            }
+
+            const uint64_t n = std::min( dataSize - inPos, sk_maxInflateInput );
+            stream.next_in = const_cast< Bytef* >( data + inPos );
+            stream.avail_in = static_cast< uInt >( n );
+            inPos += n;
+        }
+
+        const bool inRange = ( outPos >= offset );
+
+        if ( inRange )
+        {
+            stream.next_out = dest + ( outPos - offset );
+            stream.avail_out = static_cast< uInt >( std::min( end - outPos, sk_chunkSize ) );
+        }
+        else
+        {
+            stream.next_out = discard.data();
+            stream.avail_out = static_cast< uInt >( std::min< uint64_t >( offset - outPos, discard.size() ) );
+        }
+
+        const uInt availOut = stream.avail_out;
+        const int ret = inflate( &stream, Z_NO_FLUSH );
+
+        outPos += ( availOut - stream.avail_out );
+
+        if ( inRange && publish )
+        {
+            publish( outPos - offset );
+        }
+
+        if ( Z_STREAM_END == ret )
+        {
+            // Another gzip member may follow. Anything else after the member is ignored.
+            const uint64_t remaining = stream.avail_in + ( dataSize - inPos );
+
+            if ( outPos >= end || ! isGzipMember( stream.next_in, remaining ) )
+            {
+                break;
+            }
+
+            if ( Z_OK != inflateReset( &stream ) )
+            {
+                return std::nullopt;
+            }
+        }
+        else if ( Z_OK != ret && ! ( Z_BUF_ERROR == ret && 0 == stream.avail_in ) )
+        {
+            return std::nullopt;
+        }
+    }
+
+    return ( outPos > offset ) ? std::min( outPos, end ) - offset : 0;
+}
+
+
+} // anonymous
+
+
+namespace itkdetails
+{
+
+namespace decompression
+{
+
+std::optional< std::vector< char > > inflateGzipPrefix(
+        const std::string& fileName, size_t numBytes )
+{
+    const auto file = mapping::mapFile( fileName );
+
+    if ( ! file )
+    {
+        return std::nullopt;
+    }
+
+    std::vector< char > prefix( numBytes );
+
+    const auto n = inflateSequential( file->m_data, file->m_numBytes, 0, numBytes,
+                                      reinterpret_cast< uint8_t* >( prefix.data() ), nullptr );
+
+    if ( ! n )
+    {
+        return std::nullopt;
+    }
+
+    prefix.resize( static_cast< size_t >( *n ) );
+    return prefix;
+}
+
+
+bool inflateGzipFile(
+        const std::string& fileName,
+        uint64_t offset,
+        uint64_t numBytes,
+        uint8_t* dest,
+        const ProgressConsumer& consumer,
+        size_t numThreads )
+{
+    if ( 0 == numBytes )
+    {
+        return true;
+    }
+
+    if ( ! dest )
+    {
+        return false;
+    }
+
+    const auto file = mapping::mapFile( fileName );
+
+    if ( ! file )
+    {
+        std::cerr << "Unable to open gzip file '" << fileName << "'" << std::endl;
+        return false;
+    }
+
+    if ( 0 == numThreads )
+    {
+        numThreads = imageio::parallel::maxConcurrency();
+    }
+
+    const std::vector< BgzfBlock > blocks = findBgzfBlocks( file->m_data, file->m_numBytes );
+
+    const bool success = ( ! blocks.empty() && numThreads > 1 )
+            ? inflateBgzfBlocks( file->m_data, blocks, offset, numBytes, dest, consumer, numThreads )
+            : ( numBytes == inflateSequential( file->m_data, file->m_numBytes, offset, numBytes, dest, consumer ) );
+
+    if ( ! success )
+    {
+        std::cerr << "Error decompressing gzip file '" << fileName << "'" << std::endl;
+    }
+
+    return success;
+}
+
+
+bool isBgzfFile( const std::string& fileName )
+{
+    const auto file = mapping::mapFile( fileName );
+
+    return ( file && bgzfBlockSize( file->m_data, file->m_numBytes ) > 0 );
+}
+
+
+std::optional< uint64_t > niftiGzipPixelDataOffset( const std::string& fileName )
+{
+    if ( ! boost::algorithm::iends_with( fileName, ".nii.gz" ) )
+    {
+        return std::nullopt;
+    }
+
+    const auto header = inflateGzipPrefix( fileName, mapping::sk_niftiMaxHeaderSize );
+
+    if ( ! header )
+    {
+        return std::nullopt;
+    }
+
+    return mapping::niftiPixelDataOffset( header->data(), header->size() );
+}
+
+} // namespace decompression
+
+} // namespace itkdetails
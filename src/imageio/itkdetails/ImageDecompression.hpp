@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+namespace itkdetails
+{
+
+namespace decompression
+{
+
+/**
+ * @brief Function that is notified of the progress of decompression. It receives the number
+ * of leading bytes of the destination buffer that are decompressed and will not change.
+ * The function is called on the thread that called \c inflateGzipFile, with non-decreasing
+ * numbers of bytes, while decompression continues on other threads (or between steps of
+ * sequential decompression). It is last called with the total number of bytes.
+ */
+using ProgressConsumer = std::function< void ( uint64_t numBytesReady ) >;
+
+
+/**
+ * @brief Decompress the first bytes of a gzip file
+ *
+ * @param fileName Gzip file name
+ * @param numBytes Number of bytes to decompress
+ *
+ * @return Up to \c numBytes decompressed bytes, fewer if the decompressed file is shorter;
+ * std::nullopt if the file cannot be read or is not a valid gzip file
+ */
+std::optional< std::vector< char > > inflateGzipPrefix(
+        const std::string& fileName, size_t numBytes );
+
+
+/**
+ * @brief Decompress a range of the contents of a gzip file into a buffer using multiple threads.
+ *
+ * Files whose gzip members are BGZF blocks (which record their compressed sizes) are
+ * decompressed block-parallel. Other files, including multi-member files, are decompressed
+ * sequentially on the calling thread, since the deflate stream of a plain gzip member cannot
+ * be split: callers should prefer zlib's own reader for them (see \c isBgzfFile).
+ *
+ * @param fileName Gzip file name
+ * @param offset Offset in bytes of the range in the decompressed contents
+ * @param numBytes Number of bytes in the range
+ * @param dest Destination buffer of at least \c numBytes bytes
+ * @param consumer Optional function notified as the destination fills
+ * @param numThreads Maximum number of decompression threads. Zero uses the whole shared thread pool.
+ *
+ * @return True iff the whole range was decompressed. The contents of \c dest are undefined
+ * on failure.
+ */
+bool inflateGzipFile(
+        const std::string& fileName,
+        uint64_t offset,
+        uint64_t numBytes,
+        uint8_t* dest,
+        const ProgressConsumer& consumer = nullptr,
+        size_t numThreads = 0 );
+
+
+/**
+ * @brief Check whether a file is BGZF-compressed, i.e. whether its first gzip member is a
+ * BGZF block. Only the first member is checked, so \c inflateGzipFile may still decompress
+ * the file sequentially if a later member is not a BGZF block.
+ *
+ * @param fileName Gzip file name
+ *
+ * @return True iff the file starts with a BGZF block
+ */
+bool isBgzfFile( const std::string& fileName );
+
+
+/**
+ * @brief Get the offset of the pixel data in the decompressed contents of a gzip-compressed
+ * single-file NIfTI image (.nii.gz)
+ *
+ * @param fileName Image file name
+ *
+ * @return Offset in bytes; std::nullopt if the file is not a supported compressed NIfTI file
+ * (see \c mapping::niftiPixelDataOffset)
+ */
+std::optional< uint64_t > niftiGzipPixelDataOffset( const std::string& fileName );
+
+} // namespace decompression
+
+} // namespace itkdetails
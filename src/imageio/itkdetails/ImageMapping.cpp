@@ -0,0 +1,390 @@
+#include "itkdetails/ImageMapping.hpp"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+
+namespace
+{
+
+/// Maximum number of lines read from the text headers of NRRD and MetaImage files
+static constexpr size_t sk_maxHeaderLines = 1024;
+
+
+bool isLittleEndianHost()
+{
+    const uint16_t one = 1;
+    uint8_t firstByte;
+    std::memcpy( &firstByte, &one, 1 );
+    return ( 1 == firstByte );
+}
+
+
+template< typename T >
+T readValue( const char* header, size_t offset )
+{
+    T value;
+    std::memcpy( &value, header + offset, sizeof( T ) );
+    return value;
+}
+
+
+/// Get the offset in bytes of the pixel data of a single-file NIfTI-1 or NIfTI-2 image
+std::optional< uint64_t > niftiDataOffset( std::ifstream& file )
+{
+    std::array< char, itkdetails::mapping::sk_niftiMaxHeaderSize > header;
+    header.fill( 0 );
+
+    file.read( header.data(), static_cast< std::streamsize >( header.size() ) );
+
+    return itkdetails::mapping::niftiPixelDataOffset(
+                header.data(), static_cast< size_t >( file.gcount() ) );
+}
+
+
+/// Map a range of an open file into memory. The range need not start at a page boundary.
+/// @return Pair of the mapping, which unmaps when destroyed, and the start of the range
+std::optional< std::pair< std::shared_ptr< void >, uint8_t* > > mapFileRange(
+        int fd, uint64_t offset, uint64_t numBytes, bool writable )
+{
+    // Mappings must start at a multiple of the page size
+    const uint64_t pageSize = static_cast< uint64_t >( ::sysconf( _SC_PAGESIZE ) );
+    const uint64_t mapStart = ( offset / pageSize ) * pageSize;
+    const size_t mapLength = static_cast< size_t >( offset + numBytes - mapStart );
+
+    const int protection = writable ? ( PROT_READ | PROT_WRITE ) : PROT_READ;
+
+    void* address = ::mmap( nullptr, mapLength, protection, MAP_PRIVATE,
+                            fd, static_cast< off_t >( mapStart ) );
+
+    if ( MAP_FAILED == address )
+    {
+        return std::nullopt;
+    }
+
+    std::shared_ptr< void > mapping( address, [mapLength] ( void* a ) { ::munmap( a, mapLength ); } );
+    uint8_t* start = static_cast< uint8_t* >( address ) + ( offset - mapStart );
+
+    return std::make_pair( std::move( mapping ), start );
+}
+
+
+/// Get the offset in bytes of the raw pixel data attached to a NRRD header
+std::optional< uint64_t > nrrdDataOffset( std::ifstream& file )
+{
+    std::string line;
+
+    if ( ! std::getline( file, line ) || 0 != line.compare( 0, 4, "NRRD" ) )
+    {
+        return std::nullopt;
+    }
+
+    bool rawEncoding = false;
+
+    for ( size_t i = 0; i < sk_maxHeaderLines && std::getline( file, line ); ++i )
+    {
+        boost::algorithm::trim_right_if( line, boost::is_any_of( "\r" ) );
+
+        if ( line.empty() )
+        {
+            // The header ends with a blank line, after which the data start
+            if ( ! rawEncoding )
+            {
+                return std::nullopt;
+            }
+
+            const std::streamoff offset = file.tellg();
+            return ( offset < 0 ) ? std::nullopt : std::optional< uint64_t >( offset );
+        }
+
+        if ( '#' == line[0] || std::string::npos != line.find( ":=" ) )
+        {
+            // Comment or key/value pair
+            continue;
+        }
+
+        const size_t colon = line.find( ':' );
+
+        if ( std::string::npos == colon )
+        {
+            continue;
+        }
+
+        const std::string field = boost::algorithm::to_lower_copy(
+                    boost::algorithm::trim_copy( line.substr( 0, colon ) ) );
+
+        const std::string value = boost::algorithm::to_lower_copy(
+                    boost::algorithm::trim_copy( line.substr( colon + 1 ) ) );
+
+        if ( "encoding" == field )
+        {
+            rawEncoding = ( "raw" == value );
+        }
+        else if ( "endian" == field )
+        {
+            if ( ( "little" == value ) != isLittleEndianHost() )
+            {
+                return std::nullopt;
+            }
+        }
+        else if ( "data file" == field || "datafile" == field )
+        {
+            return std::nullopt;
+        }
+        else if ( "line skip" == field || "lineskip" == field ||
+                  "byte skip" == field || "byteskip" == field )
+        {
+            if ( "0" != value )
+            {
+                return std::nullopt;
+            }
+        }
+    }
+
+    return std::nullopt;
+}
+
+
+/// Get the offset in bytes of the local raw pixel data of a MetaImage
+std::optional< uint64_t > metaImageDataOffset( std::ifstream& file )
+{
+    std::string line;
+
+    for ( size_t i = 0; i < sk_maxHeaderLines && std::getline( file, line ); ++i )
+    {
+        const size_t equals = line.find( '=' );
+
+        if ( std::string::npos == equals )
+        {
+            return std::nullopt;
+        }
+
+        const std::string key = boost::algorithm::trim_copy( line.substr( 0, equals ) );
+
+        const std::string value = boost::algorithm::to_lower_copy(
+                    boost::algorithm::trim_copy( line.substr( equals + 1 ) ) );
+
+        if ( "CompressedData" == key || "HeaderSize" == key )
+        {
+            if ( "false" != value && "0" != value )
+            {
+                return std::nullopt;
+            }
+        }
+        else if ( "BinaryData" == key )
+        {
+            if ( "true" != value )
+            {
+                return std::nullopt;
+            }
+        }
+        else if ( "BinaryDataByteOrderMSB" == key || "ElementByteOrderMSB" == key )
+        {
+            if ( ( "true" == value ) == isLittleEndianHost() )
+            {
+                return std::nullopt;
+            }
+        }
+        else if ( "ElementDataFile" == key )
+        {
+            // This is the last field of the header. Local data start right after it.
+            if ( "local" != value )
+            {
+                return std::nullopt;
+            }
+
+            const std::streamoff offset = file.tellg();
+            return ( offset < 0 ) ? std::nullopt : std::optional< uint64_t >( offset );
+        }
+    }
+
+    return std::nullopt;
+}
+
+} // anonymous
+
+
+namespace itkdetails
+{
+
+namespace mapping
+{
+
+std::optional< MappedPixelData > mapPixelData(
+        const std::string& fileName, uint64_t numBytes, size_t alignment )
+{
+    if ( 0 == numBytes )
+    {
+        return std::nullopt;
+    }
+
+    const std::string extension = boost::algorithm::to_lower_copy(
+                boost::filesystem::path( fileName ).extension().string() );
+
+    std::optional< uint64_t > dataOffset;
+
+    {
+        std::ifstream file( fileName, std::ios::binary );
+
+        if ( ! file )
+        {
+            return std::nullopt;
+        }
+
+        if ( ".nii" == extension )
+        {
+            dataOffset = niftiDataOffset( file );
+        }
+        else if ( ".nrrd" == extension )
+        {
+            dataOffset = nrrdDataOffset( file );
+        }
+        else if ( ".mha" == extension )
+        {
+            dataOffset = metaImageDataOffset( file );
+        }
+    }
+
+    if ( ! dataOffset || ( alignment > 1 && 0 != *dataOffset % alignment ) )
+    {
+        return std::nullopt;
+    }
+
+    const int fd = ::open( fileName.c_str(), O_RDONLY );
+
+    if ( fd < 0 )
+    {
+        return std::nullopt;
+    }
+
+    struct stat fileStatus;
+
+    if ( 0 != ::fstat( fd, &fileStatus ) ||
+         static_cast< uint64_t >( fileStatus.st_size ) < *dataOffset + numBytes )
+    {
+        ::close( fd );
+        return std::nullopt;
+    }
+
+    auto mapped = mapFileRange( fd, *dataOffset, numBytes, true );
+
+    // The mapping remains valid after the file is closed
+    ::close( fd );
+
+    if ( ! mapped )
+    {
+        std::cerr << "Unable to memory-map image file '" << fileName << "'" << std::endl;
+        return std::nullopt;
+    }
+
+    MappedPixelData data;
+    data.m_mapping = std::move( mapped->first );
+    data.m_pixels = mapped->second;
+    data.m_numBytes = numBytes;
+
+    return data;
+}
+
+
+std::optional< MappedFile > mapFile( const std::string& fileName )
+{
+    const int fd = ::open( fileName.c_str(), O_RDONLY );
+
+    if ( fd < 0 )
+    {
+        return std::nullopt;
+    }
+
+    struct stat fileStatus;
+
+    if ( 0 != ::fstat( fd, &fileStatus ) || fileStatus.st_size <= 0 )
+    {
+        ::close( fd );
+        return std::nullopt;
+    }
+
+    const uint64_t numBytes = static_cast< uint64_t >( fileStatus.st_size );
+    auto mapped = mapFileRange( fd, 0, numBytes, false );
+
+    ::close( fd );
+
+    if ( ! mapped )
+    {
+        std::cerr << "Unable to memory-map file '" << fileName << "'" << std::endl;
+        return std::nullopt;
+    }
+
+    MappedFile file;
+    file.m_mapping = std::move( mapped->first );
+    file.m_data = mapped->second;
+    file.m_numBytes = numBytes;
+
+    return file;
+}
+
+
+std::optional< uint64_t > niftiPixelDataOffset( const char* header, size_t numBytes )
+{
+    // NIfTI-1 headers are shorter than NIfTI-2 headers
+    if ( ! header || numBytes < sk_nifti1HeaderSize )
+    {
+        return std::nullopt;
+    }
+
+    // Header sizes that do not match indicate a byte-swapped file
+    const int32_t headerSize = readValue< int32_t >( header, 0 );
+
+    uint64_t voxOffset = 0;
+    double sclSlope = 0.0;
+    double sclInter = 0.0;
+
+    if ( static_cast< int32_t >( sk_nifti1HeaderSize ) == headerSize &&
+         0 == std::memcmp( header + 344, "n+1", 4 ) )
+    {
+        voxOffset = static_cast< uint64_t >( readValue< float >( header, 108 ) );
+        sclSlope = static_cast< double >( readValue< float >( header, 112 ) );
+        sclInter = static_cast< double >( readValue< float >( header, 116 ) );
+    }
+    else if ( static_cast< int32_t >( sk_niftiMaxHeaderSize ) == headerSize &&
+              sk_niftiMaxHeaderSize <= numBytes &&
+              0 == std::memcmp( header + 4, "n+2", 4 ) )
+    {
+        const int64_t offset = readValue< int64_t >( header, 168 );
+
+        if ( offset < 0 )
+        {
+            return std::nullopt;
+        }
+
+        voxOffset = static_cast< uint64_t >( offset );
+        sclSlope = readValue< double >( header, 176 );
+        sclInter = readValue< double >( header, 184 );
+    }
+    else
+    {
+        return std::nullopt;
+    }
+
+    // ITK rescales the intensities of images with a scaling slope and intercept
+    if ( 0.0 != sclSlope && ( 1.0 != sclSlope || 0.0 != sclInter ) )
+    {
+        return std::nullopt;
+    }
+
+    return voxOffset;
+}
+
+} // namespace mapping
+
+} // namespace itkdetails
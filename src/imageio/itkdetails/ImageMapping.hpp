@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+
+
+namespace itkdetails
+{
+
+namespace mapping
+{
+
+/**
+ * @brief Pixel data of an image file that is memory-mapped rather than read.
+ * The mapping is private (copy-on-write): the pixels may be modified in memory without
+ * modifying the file, and unmodified pages are shared with the page cache.
+ */
+struct MappedPixelData
+{
+    /// Owns the mapping, which is unmapped when the last copy of this pointer is destroyed
+    std::shared_ptr< void > m_mapping;
+
+    /// Start of the pixel data in the mapping
+    void* m_pixels = nullptr;
+
+    /// Number of bytes of pixel data
+    uint64_t m_numBytes = 0;
+};
+
+
+/// Read-only mapping of a whole file
+struct MappedFile
+{
+    /// Owns the mapping, which is unmapped when the last copy of this pointer is destroyed
+    std::shared_ptr< void > m_mapping;
+
+    /// Start of the file contents
+    const uint8_t* m_data = nullptr;
+
+    /// Size of the file in bytes
+    uint64_t m_numBytes = 0;
+};
+
+
+/// Sizes in bytes of the NIfTI-1 and NIfTI-2 headers
+static constexpr size_t sk_nifti1HeaderSize = 348;
+static constexpr size_t sk_niftiMaxHeaderSize = 540;
+
+
+/**
+ * @brief Memory-map the pixel data section of an uncompressed image file. Supported are
+ * NIfTI-1 and NIfTI-2 files (.nii), NRRD files with attached raw data (.nrrd), and MetaImage
+ * files with local raw data (.mha). The pixel data must be stored in the native byte order
+ * of this machine.
+ *
+ * Mapping fails, so that the file must be read normally, if the file has another format,
+ * if its pixel data are compressed, encoded, byte-swapped, intensity-scaled, detached, or
+ * misaligned, or if the pixel data section is smaller than expected.
+ *
+ * @param fileName Image file name
+ * @param numBytes Expected number of bytes of pixel data
+ * @param alignment Required alignment in bytes of the start of the pixel data
+ *
+ * @return Mapped pixel data; std::nullopt if the file cannot be mapped
+ */
+std::optional< MappedPixelData > mapPixelData(
+        const std::string& fileName, uint64_t numBytes, size_t alignment );
+
+
+/**
+ * @brief Memory-map a whole file read-only
+ * @param fileName File name
+ * @return Mapped file; std::nullopt if the file cannot be opened or is empty
+ */
+std::optional< MappedFile > mapFile( const std::string& fileName );
+
+
+/**
+ * @brief Get the offset of the pixel data of a single-file NIfTI-1 or NIfTI-2 image from
+ * its header. The header must be in the native byte order of this machine and must not
+ * scale the intensities.
+ *
+ * @param header Start of the (decompressed) file contents
+ * @param numBytes Number of bytes available at \c header: at least the size of the header
+ *
+ * @return Offset in bytes of the pixel data; std::nullopt if the header is not supported
+ */
+std::optional< uint64_t > niftiPixelDataOffset( const char* header, size_t numBytes );
+
+} // namespace mapping
+
+} // namespace itkdetails
@@ -48,6 +48,23 @@ image3d::ImageBaseType::Pointer
 doReadImageSeries( const itk::ImageIOBase::Pointer imageIO,
                    const std::vector< std::string >& fileNames );
 
+
+/**
+ * @brief Read a DICOM series of single-slice files into a preallocated volume, decoding the
+ * slices in parallel. The volume geometry matches that of \c itk::ImageSeriesReader.
+ *
+ * @tparam ImageType 3D image type of the volume
+ *
+ * @param[in] imageIO GDCM image IO that has read the information of the first file
+ * @param[in] fileNames Sorted file names of the series
+ *
+ * @returns Volume; null if the series does not consist of matching single-slice files
+ */
+template< class ImageType >
+typename ImageType::Pointer
+readSeriesVolume( const itk::ImageIOBase::Pointer imageIO,
+                  const std::vector< std::string >& fileNames );
+
 /**
  * @brief Intermediate loading function that dispatches on image dimensionality
  *
@@ -1,3 +1,4 @@
+#include "itkdetails/DicomSeries.hpp"
 #include "itkdetails/ImageTypes.hpp" // for IDE
 
 #include <itkCastImageFilter.h>
@@ -5,6 +6,8 @@
 #include <itkImageFileReader.h>
 #include <itkImageSeriesReader.h>
 
+#include <array>
+#include <cmath>
 #include <iostream>
 
 
@@ -94,14 +97,30 @@ doReadImageSeries(
     using ImageSeriesReaderType = ::itk::ImageSeriesReader< InputImageType >;
     using CastFilterType = ::itk::CastImageFilter< InputImageType, OutputImageType >;
 
-    //    typename InputImageType::Pointer image = InputImageType::New();
-    typename ImageSeriesReaderType::Pointer seriesReader = ImageSeriesReaderType::New();
     typename CastFilterType::Pointer castFilter = CastFilterType::New();
 
-    seriesReader->SetImageIO( imageIO );
-    seriesReader->SetFileNames( fileNames );
+    /// @internal Series of single-slice files are decoded in parallel. Other series are
+    /// read by the ITK series reader.
+    typename InputImageType::Pointer volume = ITK_NULLPTR;
 
-    castFilter->SetInput( seriesReader->GetOutput() );
+    if constexpr ( image3d::NDIM == InputDim )
+    {
+        volume = readSeriesVolume< InputImageType >( imageIO, fileNames );
+    }
+
+    typename ImageSeriesReaderType::Pointer seriesReader = ImageSeriesReaderType::New();
+
+    if ( volume.IsNotNull() )
+    {
+        castFilter->SetInput( volume );
+    }
+    else
+    {
+        seriesReader->SetImageIO( imageIO );
+        seriesReader->SetFileNames( fileNames );
+
+        castFilter->SetInput( seriesReader->GetOutput() );
+    }
 
     try
     {
@@ -119,6 +138,85 @@ doReadImageSeries(
 }
 
 
+template< class ImageType >
+typename ImageType::Pointer
+readSeriesVolume(
+        const ::itk::ImageIOBase::Pointer imageIO,
+        const std::vector< std::string >& fileNames )
+{
+    static_assert( image3d::NDIM == ImageType::ImageDimension, "Volume must be 3D" );
+
+    if ( fileNames.size() < 2 || image3d::NDIM != imageIO->GetNumberOfDimensions() ||
+         1 != imageIO->GetDimensions( 2 ) )
+    {
+        return ITK_NULLPTR;
+    }
+
+    typename ImageType::SizeType size;
+    typename ImageType::SpacingType spacing;
+    typename ImageType::PointType origin;
+    typename ImageType::DirectionType direction;
+
+    for ( uint32_t i = 0; i < image3d::NDIM; ++i )
+    {
+        size[i] = imageIO->GetDimensions( i );
+        spacing[i] = imageIO->GetSpacing( i );
+        origin[i] = imageIO->GetOrigin( i );
+
+        const std::vector< double > axis = imageIO->GetDirection( i );
+
+        for ( uint32_t j = 0; j < image3d::NDIM; ++j )
+        {
+            direction( j, i ) = axis[j];
+        }
+    }
+
+    size[2] = fileNames.size();
+
+    typename ImageType::Pointer volume = ImageType::New();
+    volume->SetRegions( typename ImageType::RegionType( size ) );
+    volume->SetNumberOfComponentsPerPixel( imageIO->GetNumberOfComponents() );
+    volume->SetOrigin( origin );
+    volume->SetDirection( direction );
+
+    try
+    {
+        volume->Allocate();
+    }
+    catch ( const ::itk::ExceptionObject& e )
+    {
+        std::cerr << "Unable to allocate volume for DICOM series: " << e.what() << std::endl;
+        return ITK_NULLPTR;
+    }
+
+    std::array< double, 3 > lastSliceOrigin;
+
+    if ( ! utility::dicom::readSeriesSlices(
+             fileNames, imageIO.GetPointer(), volume->GetBufferPointer(), lastSliceOrigin ) )
+    {
+        return ITK_NULLPTR;
+    }
+
+    /// @internal As in the ITK series reader, the slice spacing is the distance between the
+    /// first and last slices divided by the number of gaps between slices, or 1.0 if the
+    /// first and last slices coincide
+    double distance = 0.0;
+
+    for ( uint32_t i = 0; i < image3d::NDIM; ++i )
+    {
+        distance += ( lastSliceOrigin[i] - origin[i] ) * ( lastSliceOrigin[i] - origin[i] );
+    }
+
+    spacing[2] = ( distance > 0.0 )
+            ? std::sqrt( distance ) / static_cast< double >( fileNames.size() - 1 )
+            : 1.0;
+
+    volume->SetSpacing( spacing );
+
+    return volume;
+}
+
+
 template< typename OutputComponentType,
           typename InputComponentType,
           bool PixelIsVector >
@@ -0,0 +1,614 @@
+#pragma once
+
+#include "util/ThreadPool.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+
+namespace itkdetails
+{
+
+namespace utility
+{
+
+/// Number of histogram bins and of quantiles (0%, 1%, ..., 100%) of pixel statistics
+static constexpr size_t sk_numHistogramBins = 101;
+
+
+template< class PixelType >
+struct PixelStatistics
+{
+    PixelType m_minimum;
+    PixelType m_maximum;
+
+    double m_mean;
+    double m_stdDeviation;
+    double m_variance;
+    double m_sum;
+
+    std::vector< double > m_histogram;
+    std::array< double, sk_numHistogramBins > m_quantiles;
+};
+
+
+namespace details
+{
+
+/// Number of independent accumulators of the generic moments kernel, which shortens the
+/// chains of dependent floating-point additions
+static constexpr size_t sk_numLanes = 8;
+
+/// Number of pixels processed per task by the thread pool
+static constexpr size_t sk_chunkSize = size_t{ 1 } << 20;
+
+/// Ratio of the histogram bin width to the margin added above the maximum, as used by
+/// itk::Statistics::ImageToHistogramFilter, so that the maximum falls within the last bin
+static constexpr double sk_histogramMarginalScale = 100.0;
+
+
+/// Accumulate the minimum, maximum, sum and sum of squares of pixels
+template< class PixelType >
+void accumulateMoments(
+        const PixelType* pixels, size_t numPixels,
+        PixelType& minimum, PixelType& maximum, double& sum, double& sumOfSquares )
+{
+    std::array< PixelType, sk_numLanes > lo;
+    std::array< PixelType, sk_numLanes > hi;
+    std::array< double, sk_numLanes > s;
+    std::array< double, sk_numLanes > ss;
+
+    lo.fill( minimum );
+    hi.fill( maximum );
+    s.fill( 0.0 );
+    ss.fill( 0.0 );
+
+    size_t i = 0;
+
+    for ( ; i + sk_numLanes <= numPixels; i += sk_numLanes )
+    {
+        for ( size_t k = 0; k < sk_numLanes; ++k )
+        {
+            const PixelType p = pixels[i + k];
+            const double v = static_cast< double >( p );
+
+            lo[k] = ( p < lo[k] ) ? p : lo[k];
+            hi[k] = ( hi[k] < p ) ? p : hi[k];
+            s[k] += v;
+            ss[k] += v * v;
+        }
+    }
+
+    for ( size_t k = 0; i < numPixels; ++i, ++k )
+    {
+        const PixelType p = pixels[i];
+        const double v = static_cast< double >( p );
+
+        lo[k] = ( p < lo[k] ) ? p : lo[k];
+        hi[k] = ( hi[k] < p ) ? p : hi[k];
+        s[k] += v;
+        ss[k] += v * v;
+    }
+
+    for ( size_t k = 0; k < sk_numLanes; ++k )
+    {
+        minimum = std::min( minimum, lo[k] );
+        maximum = std::max( maximum, hi[k] );
+        sum += s[k];
+        sumOfSquares += ss[k];
+    }
+}
+
+
+#if defined(__AVX__)
+
+/// Accumulate the minimum, maximum, sum and sum of squares of float pixels using AVX.
+/// Sums are accumulated in double precision, as by the generic kernel.
+inline void accumulateMoments(
+        const float* pixels, size_t numPixels,
+        float& minimum, float& maximum, double& sum, double& sumOfSquares )
+{
+    static constexpr size_t sk_width = 8;
+
+    __m256 lo = _mm256_set1_ps( minimum );
+    __m256 hi = _mm256_set1_ps( maximum );
+    __m256d s = _mm256_setzero_pd();
+    __m256d ss = _mm256_setzero_pd();
+
+    size_t i = 0;
+
+    for ( ; i + sk_width <= numPixels; i += sk_width )
+    {
+        const __m256 p = _mm256_loadu_ps( pixels + i );
+
+        // The second operand is returned if either is not a number,
+        // so values that are not numbers are skipped as by the generic kernel
+        lo = _mm256_min_ps( p, lo );
+        hi = _mm256_max_ps( p, hi );
+
+        const __m256d a = _mm256_cvtps_pd( _mm256_castps256_ps128( p ) );
+        const __m256d b = _mm256_cvtps_pd( _mm256_extractf128_ps( p, 1 ) );
+
+        s = _mm256_add_pd( s, _mm256_add_pd( a, b ) );
+        ss = _mm256_add_pd( ss, _mm256_add_pd( _mm256_mul_pd( a, a ), _mm256_mul_pd( b, b ) ) );
+    }
+
+    alignas( 32 ) float loLanes[sk_width];
+    alignas( 32 ) float hiLanes[sk_width];
+    alignas( 32 ) double sLanes[4];
+    alignas( 32 ) double ssLanes[4];
+
+    _mm256_store_ps( loLanes, lo );
+    _mm256_store_ps( hiLanes, hi );
+    _mm256_store_pd( sLanes, s );
+    _mm256_store_pd( ssLanes, ss );
+
+    for ( size_t k = 0; k < sk_width; ++k )
+    {
+        minimum = std::min( minimum, loLanes[k] );
+        maximum = std::max( maximum, hiLanes[k] );
+    }
+
+    sum += ( sLanes[0] + sLanes[1] ) + ( sLanes[2] + sLanes[3] );
+    sumOfSquares += ( ssLanes[0] + ssLanes[1] ) + ( ssLanes[2] + ssLanes[3] );
+
+    for ( ; i < numPixels; ++i )
+    {
+        const float p = pixels[i];
+        const double v = static_cast< double >( p );
+
+        minimum = ( p < minimum ) ? p : minimum;
+        maximum = ( maximum < p ) ? p : maximum;
+        sum += v;
+        sumOfSquares += v * v;
+    }
+}
+
+#endif
+
+
+/// Get the number of workers that process a number of pixels in chunks
+inline size_t numChunkThreads( size_t numPixels )
+{
+    return imageio::parallel::numWorkers( imageio::parallel::numChunks( numPixels, sk_chunkSize ) );
+}
+
+
+/// Call a function on consecutive chunks [begin, end) of pixels on the shared thread pool.
+/// The function also receives the index of its worker in [0, numThreads), so that it can
+/// accumulate partial results per worker.
+template< class Function >
+void forEachChunk( size_t numPixels, size_t numThreads, const Function& function )
+{
+    imageio::parallel::forEachChunk( numPixels, sk_chunkSize, function, numThreads );
+}
+
+
+/// Histogram bins: \c sk_numHistogramBins bins of equal width that span the pixel range,
+/// as set up by itk::Statistics::ImageToHistogramFilter with automatic bounds
+struct HistogramBins
+{
+    HistogramBins( double minimum, double maximum )
+        : m_lower( minimum ),
+          m_width( ( maximum - minimum ) / static_cast< double >( sk_numHistogramBins ) ),
+          m_scale( 0.0 )
+    {
+        // Extend the upper bound by a margin, so that the maximum is inside of the last bin
+        const double upper = maximum + m_width / sk_histogramMarginalScale;
+        m_width = ( upper - minimum ) / static_cast< double >( sk_numHistogramBins );
+        m_scale = ( m_width > 0.0 ) ? 1.0 / m_width : 0.0;
+    }
+
+    /// Get the bin of a value, or sk_numHistogramBins if the value is not a number
+    size_t bin( double value ) const
+    {
+        const double t = ( value - m_lower ) * m_scale;
+
+        if ( ! ( t >= 0.0 ) )
+        {
+            return sk_numHistogramBins;
+        }
+
+        return static_cast< size_t >( std::min( t, static_cast< double >( sk_numHistogramBins - 1 ) ) );
+    }
+
+    double m_lower;
+    double m_width;
+    double m_scale;
+};
+
+
+/// Number of histogram tables that consecutive pixels are counted into, so that increments
+/// of the same bin do not wait on each other. Each table has an extra bin for values that
+/// are not numbers.
+static constexpr size_t sk_numHistogramTables = 4;
+static constexpr size_t sk_histogramTableSize = sk_numHistogramBins + 1;
+
+
+/// Count pixels into the bins of histogram tables
+template< class PixelType >
+void accumulateHistogram(
+        const PixelType* pixels, size_t numPixels,
+        const HistogramBins& bins, uint64_t* tables )
+{
+    size_t i = 0;
+
+    for ( ; i + sk_numHistogramTables <= numPixels; i += sk_numHistogramTables )
+    {
+        for ( size_t k = 0; k < sk_numHistogramTables; ++k )
+        {
+            ++tables[ k * sk_histogramTableSize + bins.bin( static_cast< double >( pixels[i + k] ) ) ];
+        }
+    }
+
+    for ( ; i < numPixels; ++i )
+    {
+        ++tables[ bins.bin( static_cast< double >( pixels[i] ) ) ];
+    }
+}
+
+
+#if defined(__AVX__)
+
+/// Count float pixels into the bins of histogram tables, computing the bins using AVX
+inline void accumulateHistogram(
+        const float* pixels, size_t numPixels,
+        const HistogramBins& bins, uint64_t* tables )
+{
+    static constexpr size_t sk_width = 8;
+    static_assert( 0 == sk_width % sk_numHistogramTables, "Pixels must cycle through the tables" );
+
+    const __m256d lower = _mm256_set1_pd( bins.m_lower );
+    const __m256d scale = _mm256_set1_pd( bins.m_scale );
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d lastBin = _mm256_set1_pd( static_cast< double >( sk_numHistogramBins - 1 ) );
+    const __m256d notNumberBin = _mm256_set1_pd( static_cast< double >( sk_numHistogramBins ) );
+
+    alignas( 32 ) int32_t index[sk_width];
+
+    // Bins are computed in double precision, as by HistogramBins::bin
+    auto computeBins = [&] ( __m128 p ) -> __m128i
+    {
+        const __m256d t = _mm256_mul_pd( _mm256_sub_pd( _mm256_cvtps_pd( p ), lower ), scale );
+        const __m256d valid = _mm256_cmp_pd( t, zero, _CMP_GE_OQ );
+        const __m256d b = _mm256_blendv_pd( notNumberBin, _mm256_min_pd( t, lastBin ), valid );
+        return _mm256_cvttpd_epi32( b );
+    };
+
+    size_t i = 0;
+
+    for ( ; i + sk_width <= numPixels; i += sk_width )
+    {
+        const __m256 p = _mm256_loadu_ps( pixels + i );
+
+        _mm_store_si128( reinterpret_cast< __m128i* >( index ), computeBins( _mm256_castps256_ps128( p ) ) );
+        _mm_store_si128( reinterpret_cast< __m128i* >( index + 4 ), computeBins( _mm256_extractf128_ps( p, 1 ) ) );
+
+        for ( size_t k = 0; k < sk_width; ++k )
+        {
+            ++tables[ ( k % sk_numHistogramTables ) * sk_histogramTableSize + static_cast< size_t >( index[k] ) ];
+        }
+    }
+
+    for ( ; i < numPixels; ++i )
+    {
+        ++tables[ bins.bin( static_cast< double >( pixels[i] ) ) ];
+    }
+}
+
+#endif
+
+
+/// Compute the quantiles 0%, 1%, ..., 100% of a histogram by interpolating within its bins,
+/// as does itk::Statistics::Histogram::Quantile. All quantiles are found in one sweep up
+/// and one sweep down the cumulative histogram.
+inline std::array< double, sk_numHistogramBins > histogramQuantiles(
+        const std::vector< double >& histogram, const HistogramBins& bins )
+{
+    std::array< double, sk_numHistogramBins > quantiles;
+    quantiles.fill( bins.m_lower );
+
+    double total = 0.0;
+
+    for ( double f : histogram )
+    {
+        total += f;
+    }
+
+    if ( histogram.empty() || total <= 0.0 )
+    {
+        return quantiles;
+    }
+
+    const size_t numBins = histogram.size();
+    const size_t half = sk_numHistogramBins / 2;
+
+    auto binMin = [&bins] ( size_t n ) { return bins.m_lower + static_cast< double >( n ) * bins.m_width; };
+
+    // Quantiles below the median are interpolated up from the bottom of their bins
+    size_t n = 0;
+    double cumulated = histogram[0];
+
+    for ( size_t i = 0; i < half; ++i )
+    {
+        const double p = static_cast< double >( i ) / 100.0;
+
+        while ( n + 1 < numBins && cumulated / total < p )
+        {
+            cumulated += histogram[++n];
+        }
+
+        const double pPrev = ( cumulated - histogram[n] ) / total;
+        const double proportion = histogram[n] / total;
+
+        quantiles[i] = binMin( n ) + ( ( proportion > 0.0 ) ? ( p - pPrev ) / proportion * bins.m_width : 0.0 );
+    }
+
+    // Quantiles from the median up are interpolated down from the top of their bins
+    n = numBins - 1;
+    cumulated = histogram[n];
+
+    for ( size_t i = sk_numHistogramBins; i-- > half; )
+    {
+        const double p = static_cast< double >( i ) / 100.0;
+
+        while ( n > 0 && 1.0 - cumulated / total > p )
+        {
+            cumulated += histogram[--n];
+        }
+
+        const double pPrev = 1.0 - ( cumulated - histogram[n] ) / total;
+        const double proportion = histogram[n] / total;
+
+        quantiles[i] = binMin( n ) + bins.m_width -
+                ( ( proportion > 0.0 ) ? ( pPrev - p ) / proportion * bins.m_width : 0.0 );
+    }
+
+    return quantiles;
+}
+
+
+/// Fill in the statistics that derive from the moments of the pixels
+template< class PixelType >
+void setMomentStatistics(
+        PixelStatistics< PixelType >& stats,
+        PixelType minimum, PixelType maximum, double sum, double sumOfSquares, uint64_t count )
+{
+    const double n = static_cast< double >( count );
+
+    stats.m_minimum = minimum;
+    stats.m_maximum = maximum;
+    stats.m_sum = sum;
+    stats.m_mean = ( count > 0 ) ? sum / n : 0.0;
+
+    // Unbiased variance, as computed by itk::StatisticsImageFilter
+    stats.m_variance = ( count > 1 ) ? std::max( 0.0, ( sumOfSquares - sum * sum / n ) / ( n - 1.0 ) ) : 0.0;
+    stats.m_stdDeviation = std::sqrt( stats.m_variance );
+}
+
+} // namespace details
+
+
+/**
+ * @brief Minimum, maximum, sum and sum of squares of pixel values, which can be accumulated
+ * chunk by chunk (e.g. while the pixels are being read)
+ */
+template< class PixelType >
+struct PixelMoments
+{
+    PixelType m_minimum = std::numeric_limits< PixelType >::max();
+    PixelType m_maximum = std::numeric_limits< PixelType >::lowest();
+
+    double m_sum = 0.0;
+    double m_sumOfSquares = 0.0;
+    uint64_t m_count = 0;
+
+    /// Accumulate a chunk of pixels
+    void add( const PixelType* pixels, size_t numPixels )
+    {
+        // Sum the chunk separately to limit the loss of precision of the totals
+        double sum = 0.0;
+        double sumOfSquares = 0.0;
+
+        details::accumulateMoments( pixels, numPixels, m_minimum, m_maximum, sum, sumOfSquares );
+
+        m_sum += sum;
+        m_sumOfSquares += sumOfSquares;
+        m_count += numPixels;
+    }
+
+    /// Merge the moments of another set of pixels
+    void merge( const PixelMoments& other )
+    {
+        m_minimum = std::min( m_minimum, other.m_minimum );
+        m_maximum = std::max( m_maximum, other.m_maximum );
+        m_sum += other.m_sum;
+        m_sumOfSquares += other.m_sumOfSquares;
+        m_count += other.m_count;
+    }
+};
+
+
+/**
+ * @brief Compute the statistics of a buffer of 8- or 16-bit integer pixels in a single pass.
+ * Each thread counts the occurrences of every pixel value, from which all statistics follow.
+ */
+template< class PixelType >
+typename std::enable_if< std::is_integral< PixelType >::value && sizeof( PixelType ) <= 2,
+    PixelStatistics< PixelType > >::type
+computePixelStatistics( const PixelType* pixels, size_t numPixels,
+                        const PixelMoments< PixelType >* /*moments*/ = nullptr )
+{
+    static constexpr size_t sk_numValues = size_t{ 1 } << ( 8 * sizeof( PixelType ) );
+    static constexpr int64_t sk_lowest = std::numeric_limits< PixelType >::lowest();
+
+    // Repeated values are counted into alternating tables, so that consecutive
+    // increments do not wait on each other
+    static constexpr size_t sk_numTables = ( 1 == sizeof( PixelType ) ) ? 4 : 2;
+
+    const size_t numThreads = details::numChunkThreads( numPixels );
+
+    std::vector< std::vector< uint64_t > > threadCounts(
+                numThreads, std::vector< uint64_t >( sk_numTables * sk_numValues, 0 ) );
+
+    details::forEachChunk( numPixels, numThreads, [&] ( size_t thread, size_t begin, size_t end )
+    {
+        uint64_t* counts = threadCounts[thread].data();
+        size_t i = begin;
+
+        for ( ; i + sk_numTables <= end; i += sk_numTables )
+        {
+            for ( size_t k = 0; k < sk_numTables; ++k )
+            {
+                ++counts[ k * sk_numValues + static_cast< size_t >( pixels[i + k] - sk_lowest ) ];
+            }
+        }
+
+        for ( ; i < end; ++i )
+        {
+            ++counts[ static_cast< size_t >( pixels[i] - sk_lowest ) ];
+        }
+    } );
+
+    std::vector< uint64_t > counts( sk_numValues, 0 );
+
+    for ( const auto& c : threadCounts )
+    {
+        for ( size_t k = 0; k < sk_numTables; ++k )
+        {
+            for ( size_t v = 0; v < sk_numValues; ++v )
+            {
+                counts[v] += c[k * sk_numValues + v];
+            }
+        }
+    }
+
+    PixelType minimum = std::numeric_limits< PixelType >::max();
+    PixelType maximum = std::numeric_limits< PixelType >::lowest();
+    double sum = 0.0;
+    double sumOfSquares = 0.0;
+
+    for ( size_t v = 0; v < sk_numValues; ++v )
+    {
+        if ( 0 == counts[v] )
+        {
+            continue;
+        }
+
+        const PixelType p = static_cast< PixelType >( static_cast< int64_t >( v ) + sk_lowest );
+        const double value = static_cast< double >( p );
+        const double count = static_cast< double >( counts[v] );
+
+        minimum = std::min( minimum, p );
+        maximum = std::max( maximum, p );
+        sum += count * value;
+        sumOfSquares += count * value * value;
+    }
+
+    PixelStatistics< PixelType > stats;
+    details::setMomentStatistics( stats, minimum, maximum, sum, sumOfSquares, numPixels );
+
+    const details::HistogramBins bins( static_cast< double >( minimum ), static_cast< double >( maximum ) );
+    stats.m_histogram.assign( sk_numHistogramBins, 0.0 );
+
+    for ( size_t v = 0; v < sk_numValues && numPixels > 0; ++v )
+    {
+        if ( counts[v] > 0 )
+        {
+            const double value = static_cast< double >( static_cast< int64_t >( v ) + sk_lowest );
+            stats.m_histogram[ bins.bin( value ) ] += static_cast< double >( counts[v] );
+        }
+    }
+
+    stats.m_quantiles = details::histogramQuantiles( stats.m_histogram, bins );
+
+    return stats;
+}
+
+
+/**
+ * @brief Compute the statistics of a buffer of pixels. The moments pass is skipped if moments
+ * of all pixels are provided (e.g. accumulated while reading them); otherwise it is vectorized.
+ * The histogram, whose bins span the pixel range, is accumulated in a second pass. Both passes
+ * run on a pool of threads that accumulate partial results per thread.
+ *
+ * @param pixels Pixel buffer
+ * @param numPixels Number of pixels in the buffer
+ * @param moments Optional moments of all pixels of the buffer
+ */
+template< class PixelType >
+typename std::enable_if< ! ( std::is_integral< PixelType >::value && sizeof( PixelType ) <= 2 ),
+    PixelStatistics< PixelType > >::type
+computePixelStatistics( const PixelType* pixels, size_t numPixels,
+                        const PixelMoments< PixelType >* moments = nullptr )
+{
+    const size_t numThreads = details::numChunkThreads( numPixels );
+
+    PixelMoments< PixelType > total;
+
+    if ( moments && numPixels == moments->m_count )
+    {
+        total = *moments;
+    }
+    else
+    {
+        std::vector< PixelMoments< PixelType > > threadMoments( numThreads );
+
+        details::forEachChunk( numPixels, numThreads, [&] ( size_t thread, size_t begin, size_t end )
+        {
+            threadMoments[thread].add( pixels + begin, end - begin );
+        } );
+
+        for ( const auto& m : threadMoments )
+        {
+            total.merge( m );
+        }
+    }
+
+    PixelStatistics< PixelType > stats;
+    details::setMomentStatistics( stats, total.m_minimum, total.m_maximum,
+                                  total.m_sum, total.m_sumOfSquares, numPixels );
+
+    const details::HistogramBins bins( static_cast< double >( total.m_minimum ),
+                                       static_cast< double >( total.m_maximum ) );
+
+    std::vector< std::vector< uint64_t > > threadHistograms(
+                numThreads, std::vector< uint64_t >(
+                    details::sk_numHistogramTables * details::sk_histogramTableSize, 0 ) );
+
+    details::forEachChunk( numPixels, numThreads, [&] ( size_t thread, size_t begin, size_t end )
+    {
+        details::accumulateHistogram( pixels + begin, end - begin, bins, threadHistograms[thread].data() );
+    } );
+
+    stats.m_histogram.assign( sk_numHistogramBins, 0.0 );
+
+    for ( const auto& h : threadHistograms )
+    {
+        for ( size_t k = 0; k < details::sk_numHistogramTables; ++k )
+        {
+            for ( size_t b = 0; b < sk_numHistogramBins; ++b )
+            {
+                stats.m_histogram[b] += static_cast< double >( h[k * details::sk_histogramTableSize + b] );
+            }
+        }
+    }
+
+    stats.m_quantiles = details::histogramQuantiles( stats.m_histogram, bins );
+
+    return stats;
+}
+
+} // namespace utility
+
+} // namespace itkdetails
@@ -75,10 +75,9 @@ namespace dicom
  * @return
  */
 /// @internal Identify from a given directory the set of file names that belong together
-/// to the same volumetric image. \c GDCMSeriesFileNames will explore the directory and
-/// will generate a sequence of filenames for DICOM files for one study/series.
-/// The \c GDCMSeriesFileNames object first identifies the list of DICOM series
-/// present in the given directory.
+/// to the same volumetric image. The directory is indexed in the manner of
+/// \c GDCMSeriesFileNames, which generates a sequence of filenames for DICOM files for one
+/// study/series, but file headers are parsed in parallel and the index is cached.
 ///
 /// @internal We use additional DICOM information (tag 0008 0021 : DA 1 Series Date)
 /// to sub-refine each seriesto distinguish unique volumes within the directory.
@@ -86,7 +85,7 @@ namespace dicom
 /// scan and its 3D volume; by using additional DICOM information the scout scan will not be
 /// included as part of the 3D volume.
 ///
-/// By default @code{SetUseSeriesDetails(true)} will use the following DICOM tags to sub-refine
+/// As with @code{SetUseSeriesDetails(true)}, the following DICOM tags also sub-refine
 /// a set of files into multiple series:
 ///
 /// @begin{description}
@@ -96,65 +95,16 @@ namespace dicom
 /// @item[0028 0010] Rows
 /// @item[0028 0011] Columns
 /// @end{description}
-std::pair< std::vector< std::string >, NameGeneratorType::Pointer >
+std::shared_ptr< const SeriesIndex >
 seriesSearch( const char* directory )
 {
     /// @internal Directory in which to search for the series
-//        const std::string seriesDirectory =
-//                ( ::itksys::SystemTools::FileIsDirectory( fileName ) )
-//                ? fileName
-//                : ::itksys::SystemTools::GetParentDirectory( fileName );
-
     const std::string seriesDirectory =
             ( boost::filesystem::is_directory( directory ) )
             ? directory
             : boost::filesystem::path( directory ).parent_path().c_str();
 
-    typename NameGeneratorType::Pointer nameGenerator = NameGeneratorType::New();
-    nameGenerator->SetUseSeriesDetails( true );
-    nameGenerator->AddSeriesRestriction( "0008|0021" ); //!< Series date
-    nameGenerator->SetDirectory( seriesDirectory );
-
-    std::vector< std::string > seriesUIDs;
-
-    try
-    {
-        seriesUIDs = nameGenerator->GetSeriesUIDs();
-
-#if 0
-        if ( seriesUIDs.empty() )
-        {
-            std::cerr << "No DICOM series in directory '"
-                      << seriesDirectory << "'" << std::endl;
-        }
-        else
-        {
-            std::cout << "The directory '" << seriesDirectory
-                      << "' contains the following DICOM series: " << std::endl;
-
-            for ( const auto& i : seriesUIDs )
-            {
-                std::cout << "\t" << i << std::endl;
-            }
-            std::cout << std::endl;
-        }
-#endif
-    }
-    catch ( const itk::ExceptionObject& e )
-    {
-        std::cerr << "Exception when generating DICOM series UIDs: "
-                  << e.what() << std::endl;
-
-        nameGenerator = ITK_NULLPTR;
-    }
-    catch ( ... )
-    {
-        std::cerr << "Exception when generating DICOM series UIDs." << std::endl;
-
-        nameGenerator = ITK_NULLPTR;
-    }
-
-    return std::make_pair( seriesUIDs, nameGenerator );
+    return indexDirectory( seriesDirectory );
 }
 
 
@@ -280,7 +230,9 @@ ImageFileType getImageFileType( const char* path )
     }
     else
     {
-        if ( ! dicom::seriesSearch( path ).first.empty() )
+        const auto seriesIndex = dicom::seriesSearch( path );
+
+        if ( seriesIndex && ! seriesIndex->m_seriesFileNames.empty() )
         {
             /// @internal The path is either a directory containing one or more
             /// DICOM series, or the path is a file whose parent directory
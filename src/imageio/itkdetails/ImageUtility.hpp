@@ -1,19 +1,21 @@
 #pragma once
 
+#include "itkdetails/DicomSeries.hpp"
+#include "itkdetails/ImageStatistics.hpp"
 #include "itkdetails/ImageTypes.hpp"
 
-#include <itkGDCMSeriesFileNames.h>
 #include <itkImage.h>
 #include <itkImageIOFactory.h>
-#include <itkImageToHistogramFilter.h>
 #include <itkImageToVTKImageFilter.h>
 #include <itkRescaleIntensityImageFilter.h>
-#include <itkStatisticsImageFilter.h>
 #include <itkVectorImage.h>
 
 #include <vtkSmartPointer.h>
 
+#include <algorithm>
 #include <array>
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <utility>
@@ -51,22 +53,6 @@ enum class ImageFileType
 };
 
 
-template< class PixelType >
-struct PixelStatistics
-{
-    PixelType m_minimum;
-    PixelType m_maximum;
-
-    double m_mean;
-    double m_stdDeviation;
-    double m_variance;
-    double m_sum;
-
-    std::vector< double > m_histogram;
-    std::array< double, 101 > m_quantiles;
-};
-
-
 /**
  * @brief Get the closest canonical anatomical "SPIRAL" orientation code for a 3x3 direction cosine matrix,
  * in which the world coordinate space is assumed to follow the LPS orientation convention.
@@ -85,71 +71,21 @@ std::pair< std::string, bool >
 getSpiralCodeFromDirectionMatrix( const vnl_matrix_fixed< double, 3, 3 >& matrix );
 
 
+/**
+ * @brief Compute the statistics of the pixels of a scalar image
+ * @param image Image
+ * @param moments Optional moments of all pixels of the image, which save a pass over the pixels
+ */
 template< class ImageType >
 PixelStatistics< typename ImageType::PixelType >
-computeImagePixelStatistics( const typename ImageType::Pointer image )
+computeImagePixelStatistics(
+        const typename ImageType::Pointer image,
+        const PixelMoments< typename ImageType::PixelType >* moments = nullptr )
 {
-    using StatisticsFilterType = ::itk::StatisticsImageFilter< ImageType >;
-    using ImageToHistogramFilterType = itk::Statistics::ImageToHistogramFilter< ImageType >;
-    using HistogramType = typename ImageToHistogramFilterType::HistogramType;
-
-    typename StatisticsFilterType::Pointer statsImageFilter = StatisticsFilterType::New();
-
-    statsImageFilter->SetInput( image );
-    statsImageFilter->Update();
-
-
-    static constexpr size_t sk_numComponents = 1;
-    static constexpr size_t sk_numBins = 101;
-
-    typename HistogramType::SizeType size( sk_numComponents );
-    size.Fill( sk_numBins );
-
-    typename ImageToHistogramFilterType::Pointer histogramFilter = ImageToHistogramFilterType::New();
-
-    // Note: this is another way of setting the min and max histogram bounds:
-    // using MeasType = typename ImageToHistogramFilterType::HistogramType::MeasurementVectorType;
-    // MeasType lowerBound( sk_numBins );
-    // MeasType upperBound( sk_numBins );
-    // lowerBound.Fill( statsImageFilter->GetMinimum() );
-    // lowerBound.Fill( statsImageFilter->GetMaximum() );
-    // histogramFilter->SetHistogramBinMinimum( lowerBound );
-    // histogramFilter->SetHistogramBinMaximum( upperBound );
-
-    histogramFilter->SetInput( image );
-    histogramFilter->SetAutoMinimumMaximum( true );
-    histogramFilter->SetHistogramSize( size );
-    histogramFilter->Update();
-
-
-    PixelStatistics< typename ImageType::PixelType > stats;
-    stats.m_minimum = statsImageFilter->GetMinimum();
-    stats.m_maximum = statsImageFilter->GetMaximum();
-    stats.m_mean = statsImageFilter->GetMean();
-    stats.m_stdDeviation = statsImageFilter->GetSigma();
-    stats.m_variance = statsImageFilter->GetVariance();
-    stats.m_sum = statsImageFilter->GetSum();
-
-
-    HistogramType* histogram = histogramFilter->GetOutput();
-
-    typename HistogramType::ConstIterator itr = histogram->Begin();
-    const typename HistogramType::ConstIterator end = histogram->End();
-
-    stats.m_histogram.reserve( sk_numBins );
-
-    while ( itr != end )
-    {
-        stats.m_histogram.push_back( itr.GetFrequency() );
-        ++itr;
-    }
-
-    for ( size_t i = 0; i < sk_numBins; ++i )
-    {
-        stats.m_quantiles[i] = histogram->Quantile( 0, i / 100.0 );
-    }
-
-    return stats;
+    return computePixelStatistics< typename ImageType::PixelType >(
+                image->GetBufferPointer(),
+                image->GetBufferedRegion().GetNumberOfPixels(),
+                moments );
 }
 
 
@@ -157,9 +93,7 @@ computeImagePixelStatistics( const typename ImageType::Pointer image )
 namespace dicom
 {
 
-using NameGeneratorType = ::itk::GDCMSeriesFileNames;
-
-std::pair< std::vector< std::string >, NameGeneratorType::Pointer >
+std::shared_ptr< const SeriesIndex >
 seriesSearch( const char* directory );
 
 itk::ImageIOBase::Pointer
@@ -257,6 +191,116 @@ convertITKImageToVTKImageData(
 }
 
 
+/**
+ * @brief Rearrange the pixels of a multi-component image buffer in place, from interleaved
+ * order (all components of pixel 0, then all components of pixel 1, ...) to planar order
+ * (all pixels of component 0, then all pixels of component 1, ...).
+ *
+ * Besides the buffer itself, this uses a scratch buffer of at most about 2^20 components.
+ * Pixels are first split by component within chunks that fit in the scratch buffer;
+ * the chunks are then transposed block-wise by following the cycles of the permutation.
+ *
+ * @param buffer Buffer of numPixels * numComponents components
+ * @param numPixels Number of pixels
+ * @param numComponents Number of components per pixel
+ */
+template< typename T >
+void deinterleaveComponentsInPlace( T* buffer, size_t numPixels, uint32_t numComponents )
+{
+    const size_t N = numComponents;
+
+    if ( ! buffer || N < 2 || 0 == numPixels )
+    {
+        return;
+    }
+
+    // Number of pixels per chunk: the scratch buffer holds one chunk of all components
+    static constexpr size_t sk_maxScratchElements = ( 1u << 20 );
+    const size_t C = std::max( sk_maxScratchElements / N, size_t( 1 ) );
+
+    const size_t numChunks = numPixels / C;
+    const size_t numTailPixels = numPixels - numChunks * C;
+
+    std::vector< T > scratch( std::min( numPixels, C ) * N );
+
+    // Split the pixels of interleaved buffer at the given pixel offset into the scratch
+    // buffer, arranged by component
+    auto splitToScratch = [&] ( size_t offset, size_t count )
+    {
+        const T* src = buffer + offset * N;
+
+        for ( size_t p = 0; p < count; ++p )
+        {
+            for ( size_t c = 0; c < N; ++c )
+            {
+                scratch[c * count + p] = src[p * N + c];
+            }
+        }
+    };
+
+    // 1) Within each chunk, arrange pixels by component
+    for ( size_t k = 0; k < numChunks; ++k )
+    {
+        splitToScratch( k * C, C );
+        std::copy( std::begin( scratch ), std::begin( scratch ) + static_cast<std::ptrdiff_t>( C * N ), buffer + k * C * N );
+    }
+
+    // 2) The chunks form a (numChunks x N) matrix of blocks of C elements. Transpose it
+    // in place by following the cycles of the permutation, so that blocks are
+    // arranged by component.
+    const size_t numBlocks = numChunks * N;
+    std::vector< bool > moved( numBlocks, false );
+
+    for ( size_t start = 0; start < numBlocks; ++start )
+    {
+        if ( moved[start] )
+        {
+            continue;
+        }
+
+        // Block (k, c) at index k * N + c moves to index c * numChunks + k. Walk the cycle
+        // backwards, pulling into each position the block that belongs there.
+        std::copy( buffer + start * C, buffer + ( start + 1 ) * C, std::begin( scratch ) );
+
+        size_t dst = start;
+
+        for ( ;; )
+        {
+            moved[dst] = true;
+
+            // Source of destination index c * numChunks + k is k * N + c
+            const size_t src = ( dst % numChunks ) * N + ( dst / numChunks );
+
+            if ( src == start )
+            {
+                std::copy( std::begin( scratch ), std::begin( scratch ) + static_cast<std::ptrdiff_t>( C ), buffer + dst * C );
+                break;
+            }
+
+            std::copy( buffer + src * C, buffer + ( src + 1 ) * C, buffer + dst * C );
+            dst = src;
+        }
+    }
+
+    // 3) Append the tail pixels that do not fill a chunk to each component
+    if ( numTailPixels > 0 )
+    {
+        splitToScratch( numChunks * C, numTailPixels );
+
+        const size_t mainSize = numChunks * C;
+
+        for ( size_t c = N; c-- > 0; )
+        {
+            T* dst = buffer + c * numPixels;
+            std::copy_backward( buffer + c * mainSize, buffer + ( c + 1 ) * mainSize, dst + mainSize );
+            std::copy( std::begin( scratch ) + static_cast<std::ptrdiff_t>( c * numTailPixels ),
+                       std::begin( scratch ) + static_cast<std::ptrdiff_t>( ( c + 1 ) * numTailPixels ),
+                       dst + mainSize );
+        }
+    }
+}
+
+
 template< typename ComponentType >
 bool rescaleIntensities(
         image3d::ImageBaseType::Pointer& imageBase,
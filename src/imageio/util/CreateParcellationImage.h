@@ -7,17 +7,18 @@
 #include "itkdetails/ImageTypes.hpp"
 #include "itkdetails/ImageData.hpp"
 #include "itkbridge/ITKBridge.hpp"
+#include "util/ThreadPool.h"
 
 #include <itkImage.h>
 #include <itkImportImageFilter.h>
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <limits>
 #include <memory>
-#include <set>
 #include <type_traits>
-#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -30,6 +31,221 @@ static constexpr unsigned int Dim = 3;
 
 static constexpr bool importImageFilterWillOwnTheBuffer = false;
 
+// Hard limit on the maximum number of unique labels allowed:
+// (Note: this means that the parcellation should fit into a ushort image.)
+static constexpr size_t sk_maxNumLabels = ( 1 << 16 );
+
+// Number of pixels processed per task by the pool threads that squash a parcellation
+static constexpr size_t sk_pixelsPerChunk = ( 1 << 20 );
+
+// Largest range of label values (max minus min) that is remapped through a dense lookup table
+// of label indices. Wider ranges are remapped by binary search of the sorted labels.
+static constexpr uint64_t sk_maxDenseLabelRange = ( 1 << 22 );
+
+
+/// Offset of a label value from the minimum label value. Differences are computed modulo 2^64,
+/// which gives the correct offset for signed and unsigned label types alike.
+template< typename LabelValueType >
+uint64_t labelOffset( LabelValueType labelValue, LabelValueType minLabelValue )
+{
+    return static_cast<uint64_t>( labelValue ) - static_cast<uint64_t>( minLabelValue );
+}
+
+
+/**
+ * @brief Find the unique values of a buffer of integer labels. The buffer is scanned in
+ * parallel chunks. For 8- and 16-bit labels, each thread marks the labels that it finds in a
+ * dense table spanning all values of the type; for wider labels, each thread collects its
+ * labels in a hash set. The per-thread results are then merged.
+ *
+ * Scanning stops early once more than \c maxNumLabels unique labels are found by a thread.
+ *
+ * @param[in] buffer Label buffer
+ * @param[in] numPixels Number of pixels in the buffer
+ * @param[in] maxNumLabels Maximum number of labels of interest
+ *
+ * @return Unique labels in increasing order. If there are more than \c maxNumLabels,
+ * then more than \c maxNumLabels labels are returned, but not necessarily all of them.
+ */
+template< typename LabelValueType >
+std::vector<LabelValueType> findUniqueLabels(
+        const LabelValueType* buffer, size_t numPixels, size_t maxNumLabels )
+{
+    static_assert( std::is_integral<LabelValueType>::value, "Labels must be integers" );
+
+    const size_t maxNumThreads = imageio::parallel::numWorkers(
+                imageio::parallel::numChunks( numPixels, sk_pixelsPerChunk ) );
+
+    std::vector<LabelValueType> sortedLabels;
+
+    if constexpr ( sizeof( LabelValueType ) <= 2 )
+    {
+        static constexpr LabelValueType sk_lowest = std::numeric_limits<LabelValueType>::lowest();
+        static constexpr size_t sk_tableSize = size_t( 1 ) << ( 8 * sizeof( LabelValueType ) );
+
+        std::vector< std::vector<uint8_t> > tables( maxNumThreads );
+
+        const size_t numThreads = imageio::parallel::forEachChunk( numPixels, sk_pixelsPerChunk,
+            [buffer, &tables] ( size_t t, size_t begin, size_t end )
+        {
+            auto& table = tables[t];
+            if ( table.empty() )
+            {
+                table.resize( sk_tableSize, 0 );
+            }
+
+            for ( size_t i = begin; i < end; ++i )
+            {
+                table[ labelOffset( buffer[i], sk_lowest ) ] = 1;
+            }
+        } );
+
+        // Merge the tables of all threads into the first one
+        std::vector<uint8_t> merged( sk_tableSize, 0 );
+
+        for ( size_t t = 0; t < numThreads; ++t )
+        {
+            if ( tables[t].empty() ) continue;
+
+            for ( size_t v = 0; v < sk_tableSize; ++v )
+            {
+                merged[v] |= tables[t][v];
+            }
+        }
+
+        // Table order is label order, since offsets from the lowest value increase with value
+        for ( size_t v = 0; v < sk_tableSize; ++v )
+        {
+            if ( merged[v] )
+            {
+                sortedLabels.push_back( static_cast<LabelValueType>( sk_lowest + static_cast<int64_t>( v ) ) );
+            }
+        }
+    }
+    else
+    {
+        std::vector< std::unordered_set<LabelValueType> > sets( maxNumThreads );
+        std::atomic<bool> tooManyLabels( false );
+
+        const size_t numThreads = imageio::parallel::forEachChunk( numPixels, sk_pixelsPerChunk,
+            [buffer, maxNumLabels, &sets, &tooManyLabels] ( size_t t, size_t begin, size_t end )
+        {
+            if ( tooManyLabels || begin >= end ) return;
+
+            auto& labels = sets[t];
+
+            // Neighboring pixels usually share a label, so only label changes are inserted
+            LabelValueType lastLabel = buffer[begin];
+            labels.insert( lastLabel );
+
+            for ( size_t i = begin + 1; i < end; ++i )
+            {
+                if ( buffer[i] != lastLabel )
+                {
+                    lastLabel = buffer[i];
+                    labels.insert( lastLabel );
+                }
+            }
+
+            if ( labels.size() > maxNumLabels )
+            {
+                tooManyLabels = true;
+            }
+        } );
+
+        std::unordered_set<LabelValueType> merged;
+
+        for ( size_t t = 0; t < numThreads; ++t )
+        {
+            merged.insert( std::begin( sets[t] ), std::end( sets[t] ) );
+        }
+
+        sortedLabels.assign( std::begin( merged ), std::end( merged ) );
+        std::sort( std::begin( sortedLabels ), std::end( sortedLabels ) );
+    }
+
+    return sortedLabels;
+}
+
+
+/**
+ * @brief Remap a buffer of label values to label indices, in parallel chunks. The indices are
+ * the positions of the labels in a sorted vector of label values.
+ *
+ * If the range of label values is small enough, each label is remapped through a dense lookup
+ * table indexed by its offset from the minimum label. Otherwise, it is found by binary search,
+ * which is skipped for runs of equal labels.
+ *
+ * @param[in] oldBuffer Label values
+ * @param[out] newBuffer Label indices
+ * @param[in] numPixels Number of pixels in the buffers
+ * @param[in] indexedLabels Label value of each index, in increasing order of value
+ * (but for index 0, which may hold any value)
+ */
+template< typename OldPixelType, typename NewPixelType >
+void remapLabelsToIndices(
+        const OldPixelType* oldBuffer,
+        NewPixelType* newBuffer,
+        size_t numPixels,
+        const std::vector<OldPixelType>& indexedLabels )
+{
+    if ( indexedLabels.empty() )
+    {
+        return;
+    }
+
+    // Labels of indices 1 and up are sorted, but the label of index 0 need not precede them
+    const OldPixelType minLabel = *std::min_element( std::begin( indexedLabels ), std::end( indexedLabels ) );
+    const OldPixelType maxLabel = *std::max_element( std::begin( indexedLabels ), std::end( indexedLabels ) );
+
+    if ( labelOffset( maxLabel, minLabel ) <= sk_maxDenseLabelRange )
+    {
+        std::vector<NewPixelType> lookupTable( labelOffset( maxLabel, minLabel ) + 1, 0 );
+
+        for ( size_t index = 0; index < indexedLabels.size(); ++index )
+        {
+            lookupTable[ labelOffset( indexedLabels[index], minLabel ) ] = static_cast<NewPixelType>( index );
+        }
+
+        imageio::parallel::forEachChunk( numPixels, sk_pixelsPerChunk,
+            [oldBuffer, newBuffer, minLabel, &lookupTable] ( size_t, size_t begin, size_t end )
+        {
+            for ( size_t i = begin; i < end; ++i )
+            {
+                newBuffer[i] = lookupTable[ labelOffset( oldBuffer[i], minLabel ) ];
+            }
+        } );
+
+        return;
+    }
+
+    const OldPixelType zeroIndexLabel = indexedLabels.front();
+    const auto sortedBegin = std::next( std::begin( indexedLabels ) );
+    const auto sortedEnd = std::end( indexedLabels );
+
+    imageio::parallel::forEachChunk( numPixels, sk_pixelsPerChunk,
+        [oldBuffer, newBuffer, zeroIndexLabel, sortedBegin, sortedEnd, &indexedLabels]
+        ( size_t, size_t begin, size_t end )
+    {
+        OldPixelType lastLabel = zeroIndexLabel;
+        NewPixelType lastIndex = 0;
+
+        for ( size_t i = begin; i < end; ++i )
+        {
+            if ( oldBuffer[i] != lastLabel )
+            {
+                lastLabel = oldBuffer[i];
+                lastIndex = ( zeroIndexLabel == lastLabel )
+                        ? 0 : static_cast<NewPixelType>(
+                              std::distance( std::begin( indexedLabels ),
+                                             std::lower_bound( sortedBegin, sortedEnd, lastLabel ) ) );
+            }
+
+            newBuffer[i] = lastIndex;
+        }
+    } );
+}
+
 
 /**
  * @brief Helper function to update ImageIOInfo object with a new component type
@@ -66,8 +282,8 @@ itkdetails::io::ImageIoInfo updateImageIOInfo(
 
 /**
  * @brief Template function to create a new ITK image from a buffer of 'old' pixel values.
- * A hash map is provided to convert 'old' pixel values to 'new' pixel values. The spatial
- * information of the new ITK image is provided as input.
+ * The 'new' pixel values are the indices of the 'old' values in a vector of label values.
+ * The spatial information of the new ITK image is provided as input.
  *
  * @param[in] oldBuffer Raw pointer to old pixel buffer
  * @param[in] newIoInfo ImageIoInfo object for new image
@@ -75,7 +291,8 @@ itkdetails::io::ImageIoInfo updateImageIOInfo(
  * @param[in] newOrigin Origin for new image
  * @param[in] newSpacing Pixel spacing for new image
  * @param[in] newDirections Direction vectors for new image
- * @param[in] oldToNewPixelValueMap Hash map from old to new image pixel values
+ * @param[in] indexedLabels Old image pixel value of each new image pixel value, in increasing
+ * order of old value (but for new value 0)
  *
  * @return Unique pointer to new image
  */
@@ -87,7 +304,7 @@ std::unique_ptr< ::itkdetails::ImageBaseData > convertOldBufferToNewImage(
         const itk::ImageBase<3>::PointType& newOrigin,
         const itk::ImageBase<3>::SpacingType& newSpacing,
         const itk::ImageBase<3>::DirectionType& newDirections,
-        const std::unordered_map< OldPixelType, size_t >& oldToNewPixelValueMap )
+        const std::vector<OldPixelType>& indexedLabels )
 {
     if ( ! oldBuffer )
     {
@@ -99,12 +316,7 @@ std::unique_ptr< ::itkdetails::ImageBaseData > convertOldBufferToNewImage(
     // Create new image buffer with size matching old image buffer.
     // Pixels values in old buffer are converted to new values and cast to new type.
     auto newBuffer = std::make_unique< NewPixelType[] >( numTotalPixels );
-    for ( size_t i = 0; i < numTotalPixels; ++i )
-    {
-        newBuffer[i] = static_cast<NewPixelType>( oldToNewPixelValueMap.at( oldBuffer[i] ) );
-
-//        std::cout << int(oldBuffer[i]) << " --> " << int(newBuffer[i]) << std::endl;
-    }
+    remapLabelsToIndices( oldBuffer, newBuffer.get(), numTotalPixels, indexedLabels );
 
     // Create new ITK image holding new buffer and matching old image's spatial information
     using ImportFilterType = itk::ImportImageFilter< NewPixelType, itkdetails::image3d::NDIM >;
@@ -161,22 +373,11 @@ createSquashedImage(
         const itkdetails::image3d::ImageBaseType::SpacingType& spacing,
         const itkdetails::image3d::ImageBaseType::DirectionType& directions )
 {
-    // Hard limit on the maximum number of unique labels allowed:
-    // (Note: this means that the parcellation should fit into a ushort image.)
-    static constexpr size_t sk_maxNumLabels = ( 1 << 16 );
-
     const size_t numTotalPixels = region.GetNumberOfPixels();
 
-    // Set of all unique pixel (parcellation label) values:
-    std::set<LabelValueType> labels;
-    for ( size_t i = 0; i < numTotalPixels; ++i )
-    {
-        labels.insert( buffer[i] );
-    }
-
-    // Create sorted vector of all unique label values:
-    std::vector<LabelValueType> sortedLabels( std::begin( labels ), std::end( labels ) );
-    std::sort( std::begin( sortedLabels ), std::end( sortedLabels ) );
+    // Sorted vector of all unique pixel (parcellation label) values:
+    const std::vector<LabelValueType> sortedLabels =
+            findUniqueLabels( buffer, numTotalPixels, sk_maxNumLabels );
 
     const size_t numUniqueLabels = sortedLabels.size();
     if ( numUniqueLabels >= sk_maxNumLabels )
@@ -187,8 +388,9 @@ createSquashedImage(
         return { nullptr, std::vector<int64_t>{} };
     }
 
-    // Map from label value to label index:
-    std::unordered_map< LabelValueType, size_t > labelToIndex;
+    // Vector from label index to label value in the old type, which maps label values
+    // to label indices when remapping the image
+    std::vector<LabelValueType> indexedLabels;
 
     // Vector from label index to label value.
     // Element i of this map is the i'th sorted label value.
@@ -199,7 +401,7 @@ createSquashedImage(
 
     // Explicitly associate label index 0 with label value 0:
     size_t index = 0;
-    labelToIndex.insert( { 0, index } );
+    indexedLabels.push_back( 0 );
     indexToLabel.push_back( 0 );
     ++index;
 
@@ -233,8 +435,8 @@ createSquashedImage(
             labelValueClipped = static_cast<int64_t>( labelValue );
         }
 
-        // Map label value to index:
-        labelToIndex.insert( { labelValue, index } );
+        // Map label index to value:
+        indexedLabels.push_back( labelValue );
 
         // Copy labels into vector, casting old types to int64_t:
         indexToLabel.push_back( labelValueClipped );
@@ -245,10 +447,13 @@ createSquashedImage(
     }
     std::cout << std::endl;
 
-    // Number of unique label values:
+    // Number of unique label values, including value 0 if it is not in the image:
     const size_t numLabels = indexToLabel.size();
 
-    if ( numLabels != numUniqueLabels )
+    const bool hasZeroLabel = std::binary_search(
+                std::begin( sortedLabels ), std::end( sortedLabels ), LabelValueType( 0 ) );
+
+    if ( numLabels != numUniqueLabels + ( hasZeroLabel ? 0 : 1 ) )
     {
         std::cerr << "Error has occurred while squashing parcellation image." << std::endl;
         return { nullptr, std::vector<int64_t>{} };
@@ -261,7 +466,7 @@ createSquashedImage(
         const auto newIoInfo = updateImageIOInfo( ioInfo, ::itk::ImageIOBase::IOComponentType::UCHAR, 1 );
 
         return { convertOldBufferToNewImage< LabelValueType, uint8_t >(
-                        buffer, newIoInfo, region, origin, spacing, directions, labelToIndex ),
+                        buffer, newIoInfo, region, origin, spacing, directions, indexedLabels ),
                     indexToLabel };
     }
     else if ( numLabels <= std::numeric_limits<uint16_t>::max() + 1 )
@@ -270,7 +475,7 @@ createSquashedImage(
         const auto newIoInfo = updateImageIOInfo( ioInfo, ::itk::ImageIOBase::IOComponentType::USHORT, 2 );
 
         return { convertOldBufferToNewImage< LabelValueType, uint16_t >(
-                        buffer, newIoInfo, region, origin, spacing, directions, labelToIndex ),
+                        buffer, newIoInfo, region, origin, spacing, directions, indexedLabels ),
                     indexToLabel };
     }
     else if ( numLabels <= std::numeric_limits<uint32_t>::max() + 1 )
@@ -280,7 +485,7 @@ createSquashedImage(
         const auto newIoInfo = updateImageIOInfo( ioInfo, ::itk::ImageIOBase::IOComponentType::UINT, 4 );
 
         return { convertOldBufferToNewImage< LabelValueType, uint32_t >(
-                        buffer, newIoInfo, region, origin, spacing, directions, labelToIndex ),
+                        buffer, newIoInfo, region, origin, spacing, directions, indexedLabels ),
                     indexToLabel };
     }
     else if ( numLabels <= std::numeric_limits<uint64_t>::max() + 1 )
@@ -290,7 +495,7 @@ createSquashedImage(
         const auto newIoInfo = updateImageIOInfo( ioInfo, ::itk::ImageIOBase::IOComponentType::ULONG, 8 );
 
         return { convertOldBufferToNewImage< LabelValueType, uint64_t >(
-                        buffer, newIoInfo, region, origin, spacing, directions, labelToIndex ),
+                        buffer, newIoInfo, region, origin, spacing, directions, indexedLabels ),
                     indexToLabel };
     }
     else
@@ -0,0 +1,320 @@
+#include "util/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace imageio
+{
+
+namespace parallel
+{
+
+namespace
+{
+
+/// Pool of threads that run queued jobs in order of submission
+class Pool
+{
+public:
+
+    Pool()
+    {
+        const size_t numThreads = std::max< size_t >( std::thread::hardware_concurrency(), 2 ) - 1;
+
+        m_threads.reserve( numThreads );
+
+        for ( size_t i = 0; i < numThreads; ++i )
+        {
+            m_threads.emplace_back( [this] () { workerLoop(); } );
+        }
+    }
+
+    ~Pool()
+    {
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_stop = true;
+        }
+
+        m_jobAdded.notify_all();
+
+        for ( auto& thread : m_threads )
+        {
+            thread.join();
+        }
+    }
+
+    size_t numThreads() const
+    {
+        return m_threads.size();
+    }
+
+    void submit( std::function< void() > job )
+    {
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            m_jobs.emplace_back( std::move( job ) );
+        }
+
+        m_jobAdded.notify_one();
+    }
+
+
+private:
+
+    void workerLoop()
+    {
+        for ( ;; )
+        {
+            std::function< void() > job;
+
+            {
+                std::unique_lock< std::mutex > lock( m_mutex );
+                m_jobAdded.wait( lock, [this] () { return m_stop || ! m_jobs.empty(); } );
+
+                if ( m_jobs.empty() )
+                {
+                    return;
+                }
+
+                job = std::move( m_jobs.front() );
+                m_jobs.pop_front();
+            }
+
+            // Jobs catch their own exceptions
+            job();
+        }
+    }
+
+    std::vector< std::thread > m_threads;
+    std::deque< std::function< void() > > m_jobs;
+
+    std::mutex m_mutex;
+    std::condition_variable m_jobAdded;
+    bool m_stop = false;
+};
+
+
+Pool& pool()
+{
+    static Pool s_pool;
+    return s_pool;
+}
+
+} // anonymous
+
+
+size_t maxConcurrency()
+{
+    return pool().numThreads() + 1;
+}
+
+
+size_t numWorkers( size_t count, size_t maxWorkers )
+{
+    const size_t maxNum = ( 0 == maxWorkers ) ? maxConcurrency() : std::min( maxWorkers, maxConcurrency() );
+    return std::max< size_t >( std::min( count, maxNum ), 1 );
+}
+
+
+size_t numChunks( size_t count, size_t chunkSize )
+{
+    chunkSize = std::max< size_t >( chunkSize, 1 );
+    return ( count + chunkSize - 1 ) / chunkSize;
+}
+
+
+size_t forEachIndex(
+        size_t count,
+        const std::function< void ( size_t worker, size_t index ) >& func,
+        size_t maxWorkers )
+{
+    const size_t numW = numWorkers( count, maxWorkers );
+
+    if ( 1 == numW )
+    {
+        for ( size_t i = 0; i < count; ++i )
+        {
+            func( 0, i );
+        }
+        return 1;
+    }
+
+    std::atomic<size_t> nextIndex{ 0 };
+    std::atomic<size_t> nextWorker{ 1 };
+
+    std::mutex errorMutex;
+    std::exception_ptr error;
+
+    auto work = [&] ( size_t worker )
+    {
+        try
+        {
+            for ( size_t i = nextIndex++; i < count; i = nextIndex++ )
+            {
+                func( worker, i );
+            }
+        }
+        catch ( ... )
+        {
+            nextIndex = count;
+
+            std::lock_guard< std::mutex > lock( errorMutex );
+            if ( ! error ) error = std::current_exception();
+        }
+    };
+
+    // The helpers take worker indices in the order in which they start, so that the indices
+    // stay in [1, numW) even though a helper that starts after the loop is done does nothing
+    TaskGroup helpers;
+
+    for ( size_t i = 1; i < numW; ++i )
+    {
+        helpers.run( [&] () { work( nextWorker++ ); } );
+    }
+
+    work( 0 );
+    helpers.wait();
+
+    if ( error )
+    {
+        std::rethrow_exception( error );
+    }
+
+    return numW;
+}
+
+
+size_t forEachChunk(
+        size_t count,
+        size_t chunkSize,
+        const std::function< void ( size_t worker, size_t begin, size_t end ) >& func,
+        size_t maxWorkers )
+{
+    chunkSize = std::max< size_t >( chunkSize, 1 );
+
+    return forEachIndex( numChunks( count, chunkSize ), [&] ( size_t worker, size_t chunk )
+    {
+        const size_t begin = chunk * chunkSize;
+        func( worker, begin, std::min( begin + chunkSize, count ) );
+    }, maxWorkers );
+}
+
+
+struct TaskGroup::Impl
+{
+    struct Task
+    {
+        std::function< void() > m_func;
+        std::atomic<bool> m_claimed{ false };
+    };
+
+    /// Run a task, unless another thread has claimed it
+    void runTask( Task& task )
+    {
+        if ( task.m_claimed.exchange( true ) )
+        {
+            return;
+        }
+
+        try
+        {
+            task.m_func();
+        }
+        catch ( ... )
+        {
+            std::lock_guard< std::mutex > lock( m_mutex );
+            if ( ! m_error ) m_error = std::current_exception();
+        }
+
+        task.m_func = nullptr;
+
+        std::lock_guard< std::mutex > lock( m_mutex );
+        if ( 0 == --m_numUnfinished )
+        {
+            m_finished.notify_all();
+        }
+    }
+
+    std::vector< std::shared_ptr<Task> > m_tasks;
+    size_t m_numUnfinished = 0;
+    std::exception_ptr m_error;
+
+    std::mutex m_mutex;
+    std::condition_variable m_finished;
+};
+
+
+TaskGroup::TaskGroup()
+    : m_impl( std::make_shared<Impl>() )
+{}
+
+
+TaskGroup::~TaskGroup()
+{
+    try
+    {
+        wait();
+    }
+    catch ( ... )
+    {
+    }
+}
+
+
+void TaskGroup::run( std::function< void() > func )
+{
+    auto task = std::make_shared<Impl::Task>();
+    task->m_func = std::move( func );
+
+    {
+        std::lock_guard< std::mutex > lock( m_impl->m_mutex );
+        m_impl->m_tasks.push_back( task );
+        ++m_impl->m_numUnfinished;
+    }
+
+    // The job keeps the group state alive, since it may run after the group is destroyed
+    // (in which case the task is already claimed and the job does nothing)
+    pool().submit( [impl = m_impl, task] () { impl->runTask( *task ); } );
+}
+
+
+void TaskGroup::wait()
+{
+    std::vector< std::shared_ptr<Impl::Task> > tasks;
+
+    {
+        std::lock_guard< std::mutex > lock( m_impl->m_mutex );
+        tasks.swap( m_impl->m_tasks );
+    }
+
+    // Run the tasks that no thread of the pool has started yet
+    for ( auto& task : tasks )
+    {
+        m_impl->runTask( *task );
+    }
+
+    std::exception_ptr error;
+
+    {
+        std::unique_lock< std::mutex > lock( m_impl->m_mutex );
+        m_impl->m_finished.wait( lock, [this] () { return 0 == m_impl->m_numUnfinished; } );
+        std::swap( error, m_impl->m_error );
+    }
+
+    if ( error )
+    {
+        std::rethrow_exception( error );
+    }
+}
+
+} // namespace parallel
+
+} // namespace imageio
@@ -0,0 +1,116 @@
+#ifndef IMAGEIO_THREAD_POOL_H
+#define IMAGEIO_THREAD_POOL_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+
+namespace imageio
+{
+
+/**
+ * @brief Parallel loops and task groups that run on one pool of threads shared by the whole
+ * application. The pool is created on first use, with one thread fewer than the number of
+ * hardware threads (but at least one), since the thread that starts parallel work also takes
+ * part in it.
+ *
+ * Parallel work may be nested: a loop body or task may itself start a parallel loop. No threads
+ * are ever created for nested work, so the total number of threads doing parallel work stays
+ * bounded by the pool size plus the threads that start it. A thread that waits for parallel
+ * work never waits for work that has not started: it runs that work itself. Nested work thus
+ * cannot deadlock, even when all threads of the pool are busy.
+ */
+namespace parallel
+{
+
+/// Get the maximum number of threads that run a parallel loop: the threads of the shared pool
+/// and the calling thread
+size_t maxConcurrency();
+
+/**
+ * @brief Get the number of workers that run a parallel loop over a number of items
+ *
+ * @param[in] count Number of items
+ * @param[in] maxWorkers Maximum number of workers; if zero, \c maxConcurrency() is the maximum
+ *
+ * @return Number of workers, which is at least one
+ */
+size_t numWorkers( size_t count, size_t maxWorkers = 0 );
+
+
+/**
+ * @brief Call a function for each index in [0, count) on the shared pool and the calling thread.
+ * Indices are pulled from a shared counter, so workers that finish early take more indices.
+ * The function also receives the index of its worker in [0, numWorkers( count, maxWorkers )),
+ * so that it can accumulate partial results per worker. Worker 0 is the calling thread.
+ *
+ * The call returns once all indices are done. If the function throws, then no further indices
+ * are started and the first exception is rethrown on the calling thread.
+ *
+ * @param[in] count Number of indices
+ * @param[in] func Function called with (worker index, index)
+ * @param[in] maxWorkers Maximum number of workers; if zero, \c maxConcurrency() is the maximum
+ *
+ * @return Number of workers
+ */
+size_t forEachIndex( size_t count,
+                     const std::function< void ( size_t worker, size_t index ) >& func,
+                     size_t maxWorkers = 0 );
+
+/**
+ * @brief Call a function for each chunk [begin, end) of consecutive items in [0, count)
+ * on the shared pool and the calling thread (see \c forEachIndex)
+ *
+ * @param[in] count Number of items
+ * @param[in] chunkSize Number of items per chunk. The last chunk may hold fewer.
+ * @param[in] func Function called with (worker index, first item, one past last item)
+ * @param[in] maxWorkers Maximum number of workers; if zero, \c maxConcurrency() is the maximum
+ *
+ * @return Number of workers, which is \c numWorkers( numChunks( count, chunkSize ), maxWorkers )
+ */
+size_t forEachChunk( size_t count,
+                     size_t chunkSize,
+                     const std::function< void ( size_t worker, size_t begin, size_t end ) >& func,
+                     size_t maxWorkers = 0 );
+
+/// Get the number of chunks of a number of items
+size_t numChunks( size_t count, size_t chunkSize );
+
+
+/**
+ * @brief Group of tasks that run on the shared pool. Tasks start in order of submission as
+ * threads of the pool become free. Waiting on the group runs the tasks that have not yet
+ * started on the waiting thread.
+ */
+class TaskGroup
+{
+public:
+
+    TaskGroup();
+
+    TaskGroup( const TaskGroup& ) = delete;
+    TaskGroup& operator=( const TaskGroup& ) = delete;
+
+    /// Wait for all tasks. Exceptions thrown by the tasks are discarded.
+    ~TaskGroup();
+
+    /// Submit a task
+    void run( std::function< void() > task );
+
+    /// Wait for all tasks submitted so far, running those that have not started on this thread.
+    /// The first exception thrown by a task is rethrown.
+    void wait();
+
+
+private:
+
+    struct Impl;
+    std::shared_ptr<Impl> m_impl;
+};
+
+} // namespace parallel
+
+} // namespace imageio
+
+#endif // IMAGEIO_THREAD_POOL_H
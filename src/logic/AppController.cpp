@@ -21,6 +21,9 @@
 #include "rendering/utility/containers/ShaderProgramContainer.h"
 #include "rendering/utility/gl/GLVersionChecker.h"
 
+#include "slideio/SlideDiskCache.h"
+#include "slideio/SlideTileCache.h"
+
 /////// START INCLUDES FOR TESTING ////////
 #include "rendering/utility/CreateGLObjects.h"
 #include "logic/annotation/Polygon.h"
@@ -336,13 +339,15 @@ void AppController::loadProject( serialize::HZeeProject project )
         throw_debug( "Unable to set project: null manager" )
     }
 
-    // Load images and set their display settings and transformations
+    // Read all files of the project concurrently, then load them in project order
+    const ActionManager::LoadedProjectFiles loaded = m_actionManager->loadProjectFiles( project );
+
+    // Set display settings and transformations of images
     size_t imageCounter = 0;
 
     for ( const auto& image : project.m_refImages )
     {
-        if ( const auto imageUid = m_actionManager->loadImage(
-                 image.m_fileName, std::nullopt ) )
+        if ( const auto& imageUid = loaded.m_refImages[imageCounter] )
         {
             auto imageRec = m_dataManager->imageRecord( *imageUid ).lock();
 
@@ -375,13 +380,12 @@ void AppController::loadProject( serialize::HZeeProject project )
     }
 
 
-    // Load parcellations and set their display settings and transformations
+    // Set display settings and transformations of parcellations
     size_t parcelCounter = 0;
 
     for ( const auto& parcel : project.m_parcellations )
     {
-        if ( const auto parcelUid = m_actionManager->loadParcellation(
-                 parcel.m_fileName, std::nullopt ) )
+        if ( const auto& parcelUid = loaded.m_parcellations[parcelCounter] )
         {
             auto parcelRec = m_dataManager->parcellationRecord( *parcelUid ).lock();
 
@@ -414,11 +418,12 @@ void AppController::loadProject( serialize::HZeeProject project )
     }
 
 
-    // Load images and set their properties and transformations
+    // Set properties of slides
+    size_t slideCounter = 0;
+
     for ( const auto& slide : project.m_slides )
     {
-        if ( const auto slideUid = m_actionManager->loadSlide(
-                 slide.m_fileName, slide.m_slideStack_T_slide.autoTranslateToTopOfStack() ) )
+        if ( const auto& slideUid = loaded.m_slides[slideCounter++] )
         {
             auto slideRec = m_dataManager->slideRecord( *slideUid ).lock();
 
@@ -511,6 +516,65 @@ void AppController::loadBuiltInImageColorMaps(
     }
 }
 
+void AppController::setSlideTileCacheByteBudget( size_t byteBudget )
+{
+    if ( ! m_dataManager )
+    {
+        throw_debug( "Unable to set slide tile cache budget: null DataManager" )
+    }
+
+    if ( auto cache = m_dataManager->slideTileCache() )
+    {
+        cache->setByteBudget( byteBudget );
+    }
+}
+
+void AppController::setSlideDiskCacheDirectory( const std::string& directory, uint64_t byteBudget )
+{
+    if ( ! m_dataManager )
+    {
+        throw_debug( "Unable to set slide disk cache: null DataManager" )
+    }
+
+    auto diskCache = std::make_shared<slideio::SlideDiskCache>( directory, byteBudget );
+
+    if ( diskCache->isValid() )
+    {
+        std::cout << "Caching decoded slide data in " << directory << std::endl;
+        m_dataManager->setSlideDiskCache( std::move( diskCache ) );
+    }
+}
+
+void AppController::setSkipBackgroundSlideTiles( bool skip )
+{
+    if ( ! m_dataManager )
+    {
+        throw_debug( "Unable to set skipping of background slide tiles: null DataManager" )
+    }
+
+    m_dataManager->setSkipBackgroundSlideTiles( skip );
+}
+
+void AppController::setLabelMeshMethod( const LabelMeshMethod& method )
+{
+    if ( ! m_dataManager )
+    {
+        throw_debug( "Unable to set label mesh method: null DataManager" )
+    }
+
+    m_dataManager->setLabelMeshMethod( method );
+}
+
+void AppController::setBrickDirectory( const std::string& directory )
+{
+    if ( ! m_dataManager )
+    {
+        throw_debug( "Unable to set brick directory: null DataManager" )
+    }
+
+    m_dataManager->setBrickDirectory( directory );
+}
+
 void AppController::testTransformFeedback()
 {
     m_actionManager->transformFeedback();
@@ -3,9 +3,11 @@
 
 #include "common/UID.h"
 #include "logic/serialization/ProjectSerialization.h"
+#include "mesh/MeshTypes.h"
 
 #include <QOffscreenSurface>
 
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
@@ -60,6 +62,21 @@ public:
 
     void loadBuiltInImageColorMaps( const std::vector< std::string >& colormapFileNames );
 
+    /// Set the byte budget of the cache of decoded tiles shared by all slides
+    void setSlideTileCacheByteBudget( size_t byteBudget );
+
+    /// Set the directory and byte budget of the cache on disk of decoded slide data
+    void setSlideDiskCacheDirectory( const std::string& directory, uint64_t byteBudget );
+
+    /// Set whether slide tiles that the tissue mask shows to be background are skipped
+    void setSkipBackgroundSlideTiles( bool skip );
+
+    /// Set the method of generating the surface meshes of the labels of parcellations
+    void setLabelMeshMethod( const LabelMeshMethod& method );
+
+    /// Set the directory of the brick files of images that are too large for memory
+    void setBrickDirectory( const std::string& directory );
+
     void testTransformFeedback();
 
     /// @test
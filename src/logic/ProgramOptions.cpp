@@ -11,7 +11,14 @@ ProgramOptions::ProgramOptions( std::string appName )
     :
       m_appName( std::move( appName ) ),
       m_verbose( false ),
-      m_projectFileName()
+      m_projectFileName(),
+      m_slideTileCacheMiB( 1024 ),
+      m_slideCacheDirectory(),
+      m_slideCacheMiB( 4096 ),
+      m_noSlideCache( false ),
+      m_skipBackgroundTiles( false ),
+      m_labelMeshMethod( "marching-cubes" ),
+      m_brickDirectory()
 {}
 
 
@@ -33,6 +40,36 @@ ProgramOptions::ExitCode ProgramOptions::parseCommandLine( int argc, char *argv[
                   po::bool_switch( &m_verbose )->default_value( false ),
                   "Enable verbose output mode" )
 
+                ( "tile-cache",
+                  po::value<size_t>( &m_slideTileCacheMiB )->default_value( m_slideTileCacheMiB )->value_name( "MiB" ),
+                  "Size of the cache of decoded slide tiles, which is shared by all slides" )
+
+                ( "slide-cache-dir",
+                  po::value<std::string>( &m_slideCacheDirectory )->value_name( "path" ),
+                  "Directory of the cache on disk of decoded slide data (default: user cache directory)" )
+
+                ( "slide-cache-size",
+                  po::value<size_t>( &m_slideCacheMiB )->default_value( m_slideCacheMiB )->value_name( "MiB" ),
+                  "Size of the cache on disk of decoded slide data, beyond which least recently used slides are removed" )
+
+                ( "no-slide-cache",
+                  po::bool_switch( &m_noSlideCache )->default_value( false ),
+                  "Disable the cache on disk of decoded slide data" )
+
+                ( "skip-background-tiles",
+                  po::bool_switch( &m_skipBackgroundTiles )->default_value( false ),
+                  "Do not read slide tiles that the tissue mask shows to be background: fill them with the background color" )
+
+                ( "label-mesh-method",
+                  po::value<std::string>( &m_labelMeshMethod )->default_value( m_labelMeshMethod )->value_name( "method" ),
+                  "Method of generating label meshes: 'marching-cubes' runs marching cubes on each label; "
+                  "'discrete-surfaces' extracts the surfaces of all labels in one sweep, which is faster for atlases of many labels" )
+
+                ( "brick-dir",
+                  po::value<std::string>( &m_brickDirectory )->value_name( "path" ),
+                  "Directory of the brick files of images too large for memory, which are stored out of core "
+                  "(default: user cache directory)" )
+
                 ( "project",
                   po::value<std::string>( &m_projectFileName )->required()->value_name( "project_path" ),
                   "Path to project file (required)" )
@@ -70,6 +107,12 @@ ProgramOptions::ExitCode ProgramOptions::parseCommandLine( int argc, char *argv[
                 m_verbose = variablesMap["verbose"].as<bool>();
             }
 
+            if ( "marching-cubes" != m_labelMeshMethod && "discrete-surfaces" != m_labelMeshMethod )
+            {
+                std::cerr << "Error: Invalid label mesh method '" << m_labelMeshMethod << "'" << std::endl;
+                return ExitCode::Failure;
+            }
+
             if ( variablesMap.count( "project" ) )
             {
                 boost::filesystem::path p( variablesMap["project"].as<std::string>() );
@@ -126,3 +169,40 @@ bool ProgramOptions::useVerbose() const
 {
     return m_verbose;
 }
+
+size_t ProgramOptions::slideTileCacheByteBudget() const
+{
+    return m_slideTileCacheMiB * 1024 * 1024;
+}
+
+const std::string& ProgramOptions::slideCacheDirectory() const
+{
+    return m_slideCacheDirectory;
+}
+
+uint64_t ProgramOptions::slideCacheByteBudget() const
+{
+    return static_cast<uint64_t>( m_slideCacheMiB ) * 1024 * 1024;
+}
+
+bool ProgramOptions::useSlideCache() const
+{
+    return ( ! m_noSlideCache );
+}
+
+bool ProgramOptions::skipBackgroundSlideTiles() const
+{
+    return m_skipBackgroundTiles;
+}
+
+LabelMeshMethod ProgramOptions::labelMeshMethod() const
+{
+    return ( "discrete-surfaces" == m_labelMeshMethod )
+            ? LabelMeshMethod::DiscreteSurfaces
+            : LabelMeshMethod::MarchingCubes;
+}
+
+const std::string& ProgramOptions::brickDirectory() const
+{
+    return m_brickDirectory;
+}
@@ -1,6 +1,10 @@
 #ifndef PROGRAM_OPTIONS_H
 #define PROGRAM_OPTIONS_H
 
+#include "mesh/MeshTypes.h"
+
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 
@@ -27,6 +31,29 @@ public:
 
     bool useVerbose() const;
 
+    /// Byte budget of the cache of decoded slide tiles
+    size_t slideTileCacheByteBudget() const;
+
+    /// Directory of the cache on disk of decoded slide data.
+    /// If empty, the default cache location is used.
+    const std::string& slideCacheDirectory() const;
+
+    /// Byte budget of the cache on disk of decoded slide data
+    uint64_t slideCacheByteBudget() const;
+
+    /// Whether to cache decoded slide data on disk
+    bool useSlideCache() const;
+
+    /// Whether to skip reading slide tiles that the tissue mask shows to be background
+    bool skipBackgroundSlideTiles() const;
+
+    /// Method of generating the surface meshes of the labels of parcellations
+    LabelMeshMethod labelMeshMethod() const;
+
+    /// Directory of the brick files of images that are too large for memory.
+    /// If empty, the default cache location is used.
+    const std::string& brickDirectory() const;
+
 
 private:
 
@@ -38,6 +65,27 @@ private:
 
     /// Path to project file
     std::string m_projectFileName;
+
+    /// Size of the slide tile cache in mebibytes
+    size_t m_slideTileCacheMiB;
+
+    /// Directory of the cache on disk of decoded slide data
+    std::string m_slideCacheDirectory;
+
+    /// Size of the cache on disk of decoded slide data in mebibytes
+    size_t m_slideCacheMiB;
+
+    /// Flag to not cache decoded slide data on disk
+    bool m_noSlideCache;
+
+    /// Flag to fill slide tiles of background with the background color instead of reading them
+    bool m_skipBackgroundTiles;
+
+    /// Name of the method of generating label meshes
+    std::string m_labelMeshMethod;
+
+    /// Directory of the brick files of images that are too large for memory
+    std::string m_brickDirectory;
 };
 
 #endif // PROGRAM_OPTIONS_H
@@ -169,6 +169,52 @@ bool isSlideActive( DataManager& dataManager, const UID& slideUid )
 }
 
 
+slideio::SlideDecodePriority slideDecodePriority(
+        DataManager& dataManager,
+        const slideio::SlideDecodeService::JobRegion& region,
+        const glm::vec3& worldViewCenter,
+        const glm::mat4& world_O_slideStack )
+{
+    // Jobs of slides that are not in the stack are least urgent
+    slideio::SlideDecodePriority priority;
+    priority.m_stackDistance = std::numeric_limits<size_t>::max();
+    priority.m_viewDistance = std::numeric_limits<double>::max();
+
+    const auto slideIndex = dataManager.slideIndex( region.m_slideUid );
+
+    if ( ! slideIndex )
+    {
+        return priority;
+    }
+
+    const size_t activeIndex = dataManager.activeSlideIndex().value_or( *slideIndex );
+
+    priority.m_stackDistance = ( *slideIndex > activeIndex )
+            ? *slideIndex - activeIndex
+            : activeIndex - *slideIndex;
+
+    auto slideRecord = dataManager.slideRecord( region.m_slideUid ).lock();
+
+    if ( ! slideRecord || ! slideRecord->cpuData() || 0 == slideRecord->cpuData()->numFileLevels() )
+    {
+        return priority;
+    }
+
+    const slideio::SlideCpuRecord& cpuRecord = *slideRecord->cpuData();
+
+    // View center in level 0 pixel coordinates of the slide
+    const glm::vec4 slideViewCenter = slideio::slide_O_world( cpuRecord, world_O_slideStack ) *
+            glm::vec4{ worldViewCenter, 1.0f };
+
+    const glm::dvec2 pixelViewCenter = glm::dvec2( slideViewCenter.x, slideViewCenter.y ) *
+            glm::dvec2( cpuRecord.fileLevel( 0 ).m_dims );
+
+    priority.m_viewDistance = glm::distance( region.m_center, pixelViewCenter );
+
+    return priority;
+}
+
+
 gui::ViewSliderParams defaultViewSliderParams()
 {
     return sk_defaultViewSliderParams;
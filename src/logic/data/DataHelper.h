@@ -5,6 +5,7 @@
 #include "common/UID.h"
 #include "gui/view/ViewSliderParams.h"
 #include "common/CoordinateFrame.h"
+#include "slideio/SlideDecodeService.h"
 
 #include <glm/mat4x4.hpp>
 #include <glm/vec3.hpp>
@@ -85,6 +86,22 @@ float slideStackPositiveExtent( DataManager& );
 bool isSlideActive( DataManager&, const UID& slideUid );
 
 
+/**
+ * @brief Compute the priority of decoding a region of a slide. Regions of slides nearer to the
+ * active slide in the stack are more urgent; among regions of a slide, those nearer to the view
+ * center are more urgent.
+ *
+ * @param region Slide region decoded by a job
+ * @param worldViewCenter World-space center of the view
+ * @param world_O_slideStack Transformation from slide stack to World space
+ */
+slideio::SlideDecodePriority slideDecodePriority(
+        DataManager&,
+        const slideio::SlideDecodeService::JobRegion& region,
+        const glm::vec3& worldViewCenter,
+        const glm::mat4& world_O_slideStack );
+
+
 /// Get the parameters of the horizontal and vertical scroll bars for a given view camera
 std::pair< gui::ViewSliderParams, gui::ViewSliderParams >
 viewScrollBarParams(
@@ -4,15 +4,43 @@
 #include "logic/managers/DataManager.h"
 #include "logic/records/ImageColorMapRecord.h"
 #include "logic/records/LabelTableRecord.h"
+#include "logic/serialization/ProjectSerialization.h"
 
+#include "imageio/ImageProbe.h"
+#include "imageio/LabelIndex.h"
+#include "imageio/VolumePyramid.h"
 #include "imageio/util/CreateParcellationImage.h"
+#include "imageio/util/ThreadPool.h"
+#include "mesh/MeshCpuRecord.h"
+#include "mesh/MeshLoading.h"
 #include "mesh/vtkdetails/MeshGeneration.hpp"
 #include "rendering/utility/CreateGLObjects.h"
+#include "slideio/SlideDecodeService.h"
 #include "slideio/SlideHelper.h"
+#include "slideio/SlideReading.h"
+#include "slideio/SlideTileReader.h"
 
+#include <glm/glm.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <vtkMultiThreader.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iomanip>
 #include <iostream>
 #include <limits>
+#include <mutex>
 #include <numeric>
+#include <sstream>
+#include <thread>
 
 
 namespace
@@ -27,20 +55,363 @@ static constexpr double sk_image3dOpacity = 1.0;
 // Default 3D parcellation opacity
 static constexpr double sk_parcel3dOpacity = 0.5;
 
+// Width and height (in tiles) of the region around the view center whose tiles are prefetched
+static constexpr double sk_prefetchRegionTiles = 4.0;
+
+
+// Longest time that label mesh generation waits for a mesh before reporting progress again
+static constexpr std::chrono::milliseconds sk_meshProgressInterval{ 100 };
+
+// Number of slabs of slices per worker into which the parcellation is divided for extracting
+// the surfaces of its labels. More slabs balance the load and report progress more finely.
+static constexpr size_t sk_numSlabsPerWorker = 4;
+
+
+// Minimum size (in bytes) of the loaded component of an image for which a resolution pyramid
+// is built. Smaller images are uploaded at once faster than their pyramid is built.
+static constexpr size_t sk_minPyramidBytes = size_t{ 64 } << 20;
+
+// Minimum size (in bytes) of the loaded component of an image for which the image is stored
+// out of core as a bricked volume, rather than read into memory. The full-resolution texture of
+// such an image would not fit in the memory of most GPUs, so it is displayed from its pyramid.
+static constexpr size_t sk_minBrickedBytes = size_t{ 4 } << 30;
+
+
+/// Get the size in bytes of the loaded component of an image
+size_t componentSizeInBytes( const imageio::ImageHeader& header )
+{
+    return static_cast<size_t>( header.m_pixelDimensions.x *
+                                header.m_pixelDimensions.y *
+                                header.m_pixelDimensions.z ) *
+            header.m_bufferComponentSizeInBytes;
+}
+
+
+/// Get the name of the brick file of an image in the brick directory. The name holds a hash
+/// of the absolute path of the image file, so that images of equal file names do not collide.
+std::string brickFileName( const std::string& brickDirectory, const std::string& filename )
+{
+    const boost::filesystem::path path = boost::filesystem::absolute( filename );
+
+    std::ostringstream ss;
+    ss << path.filename().string() << "-"
+       << std::hex << std::setw( 16 ) << std::setfill( '0' )
+       << std::hash< std::string >{}( path.string() ) << ".bricks";
+
+    return ( boost::filesystem::path( brickDirectory ) / ss.str() ).string();
+}
+
+
+/// Read an image from disk into a CPU record. The resolution pyramid of the loaded component
+/// of a large image is built as well (on the shared thread pool), so that the image can be
+/// displayed at coarse resolution before its full-resolution texture has been uploaded.
+///
+/// If a brick directory is given, an image too large for memory is stored out of core as a
+/// bricked volume in that directory instead of being read. Images that cannot be bricked
+/// (e.g. compressed or multi-component images) are read into memory.
+std::unique_ptr<imageio::ImageCpuRecord> readImageFile(
+        const std::string& filename,
+        const std::optional< std::string >& dicomSeriesUid,
+        const std::string& brickDirectory )
+{
+    if ( ! brickDirectory.empty() )
+    {
+        const auto probe = data::details::probeImageFile( filename, dicomSeriesUid );
+
+        if ( probe && componentSizeInBytes( probe->m_header ) >= sk_minBrickedBytes )
+        {
+            boost::system::error_code ec;
+            boost::filesystem::create_directories( brickDirectory, ec );
+
+            if ( ec )
+            {
+                std::cerr << "Unable to create brick directory '" << brickDirectory
+                          << "': " << ec.message() << std::endl;
+            }
+            else if ( auto cpuRecord = data::details::generateBrickedImageCpuRecord(
+                          *probe, brickFileName( brickDirectory, filename ) ) )
+            {
+                return cpuRecord;
+            }
+
+            std::cerr << "Reading image from file '" << filename << "' into memory" << std::endl;
+        }
+    }
+
+    auto cpuRecord = data::details::generateImageCpuRecord(
+                filename, dicomSeriesUid, imageio::ComponentNormalizationPolicy::None );
+
+    if ( cpuRecord && cpuRecord->imageBaseData() )
+    {
+        const auto& header = cpuRecord->header();
+
+        if ( componentSizeInBytes( header ) < sk_minPyramidBytes )
+        {
+            return cpuRecord;
+        }
+
+        cpuRecord->setPyramid( sk_compToLoad, imageio::VolumePyramid::create(
+                                   cpuRecord->imageBaseData()->bufferPointer( sk_compToLoad ),
+                                   header.m_bufferComponentType, header.m_pixelDimensions ) );
+    }
+
+    return cpuRecord;
+}
+
+
+/// Read a parcellation image from disk and convert it to a parcellation CPU record,
+/// along with the index of its labels
+std::unique_ptr<imageio::ParcellationCpuRecord> readParcellationFile(
+        const std::string& filename,
+        const std::optional< std::string >& dicomSeriesUid )
+{
+    // Step 1) Load parcellation image
+    auto imageCpuRecord = data::details::generateImageCpuRecord(
+                filename, dicomSeriesUid, imageio::ComponentNormalizationPolicy::None );
+
+    if ( ! imageCpuRecord || ! imageCpuRecord->imageBaseData() )
+    {
+        std::cerr << "Error loading parcellation image from file '" << filename << "'" << std::endl;
+        return nullptr;
+    }
+
+    std::ostringstream ss;
+    ss << "Loaded image from '" << filename << "'" << std::endl << std::endl
+       << "Header:\n" << imageCpuRecord->header() << std::endl << std::endl
+       << "Transformation:\n" << imageCpuRecord->transformations() << std::ends;
+    std::cout << ss.str() << std::endl;
+
+    if ( imageio::isFloatingType( imageCpuRecord->header().m_bufferComponentType ) )
+    {
+        std::cerr << "Cannot load parcellation image: only integer "
+                  << "pixel component types are valid." << std::endl;
+        return nullptr;
+    }
+
+    // Step 2) Convert image record to parcellation record. This function "squashes"
+    // empty space between label values
+    auto parcelCpuRecord = imageio::createParcellationCpuRecord( *imageCpuRecord );
+    if ( ! parcelCpuRecord || ! parcelCpuRecord->imageBaseData() )
+    {
+        std::cerr << "Error creating parcellation CPU record for '" << filename << "'" << std::endl;
+        return nullptr;
+    }
+
+    // Step 3) Index the labels, so that per-label work need not scan the whole parcellation
+    data::details::indexParcellationLabels( *parcelCpuRecord );
+
+    ss.str( std::string() );
+    ss << "Generated parcellation from '" << filename << "'" << std::endl << std::endl
+       << "Header:\n" << parcelCpuRecord->header() << std::endl << std::endl
+       << "Transformation:\n" << parcelCpuRecord->transformations() << std::ends;
+    std::cout << ss.str() << std::endl;
+
+    return parcelCpuRecord;
+}
+
+
+/// Limits the number of threads used by each VTK threaded filter while in scope, so that
+/// filters run concurrently by several workers do not each start a thread per core
+class VtkThreadLimit
+{
+public:
+
+    explicit VtkThreadLimit( size_t maxThreads )
+        : m_previousMaxThreads( vtkMultiThreader::GetGlobalMaximumNumberOfThreads() )
+    {
+        vtkMultiThreader::SetGlobalMaximumNumberOfThreads( static_cast<int>( maxThreads ) );
+    }
+
+    ~VtkThreadLimit()
+    {
+        vtkMultiThreader::SetGlobalMaximumNumberOfThreads( m_previousMaxThreads );
+    }
+
+    VtkThreadLimit( const VtkThreadLimit& ) = delete;
+    VtkThreadLimit& operator=( const VtkThreadLimit& ) = delete;
+
+private:
+
+    int m_previousMaxThreads;
+};
+
+
+/// Run tasks on the shared thread pool and wait for all of them to finish
+void runConcurrently( const std::vector< std::function< void() > >& tasks, size_t numThreads )
+{
+    imageio::parallel::forEachIndex( tasks.size(), [&tasks] ( size_t, size_t i )
+    {
+        try
+        {
+            tasks[i]();
+        }
+        catch ( const std::exception& e )
+        {
+            std::cerr << "Exception while reading project file: " << e.what() << std::endl;
+        }
+    }, numThreads );
+}
+
 } // anonymous
 
 
 namespace data
 {
 
+ProjectCpuRecords readProjectFiles(
+        const serialize::HZeeProject& project,
+        std::shared_ptr<slideio::SlideTileCache> tileCache,
+        std::shared_ptr<slideio::SlideDiskCache> diskCache,
+        const std::string& brickDirectory,
+        bool decodeSlides,
+        size_t numThreads )
+{
+    using clock = std::chrono::steady_clock;
+
+    ProjectCpuRecords records;
+    records.m_refImages.resize( project.m_refImages.size() );
+    records.m_parcellations.resize( project.m_parcellations.size() );
+    records.m_slides.resize( project.m_slides.size() );
+
+    records.m_timings.resize( project.m_refImages.size() +
+                              project.m_parcellations.size() +
+                              project.m_slides.size() );
+
+    // Validate the images from their file headers before reading any pixels, so that invalid
+    // images are reported at once rather than after the others are read, and are not read
+    std::vector<char> refImageValid( project.m_refImages.size(), 0 );
+    std::vector<char> parcellationValid( project.m_parcellations.size(), 0 );
+
+    std::vector< std::function< void() > > probeTasks;
+
+    for ( size_t i = 0; i < project.m_refImages.size(); ++i )
+    {
+        probeTasks.emplace_back( [&filename = project.m_refImages[i].m_fileName, &valid = refImageValid[i]] ()
+        {
+            valid = ( nullptr != details::probeImageFile( filename, std::nullopt ) );
+        } );
+    }
+
+    for ( size_t i = 0; i < project.m_parcellations.size(); ++i )
+    {
+        probeTasks.emplace_back( [&filename = project.m_parcellations[i].m_fileName, &valid = parcellationValid[i]] ()
+        {
+            const auto probe = details::probeImageFile( filename, std::nullopt );
+
+            if ( probe && imageio::isFloatingType( probe->m_header.m_bufferComponentType ) )
+            {
+                std::cerr << "Cannot load parcellation image from file '" << filename << "': only integer "
+                          << "pixel component types are valid." << std::endl;
+                return;
+            }
+
+            valid = ( nullptr != probe );
+        } );
+    }
+
+    runConcurrently( probeTasks, numThreads );
+
+    // Each task writes only to its own record and timing
+    std::vector< std::function< void() > > tasks;
+    tasks.reserve( records.m_timings.size() );
+
+    size_t t = 0;
+
+    for ( size_t i = 0; i < project.m_refImages.size(); ++i, ++t )
+    {
+        const std::string& filename = project.m_refImages[i].m_fileName;
+        records.m_timings[t].m_fileName = filename;
+
+        if ( ! refImageValid[i] )
+        {
+            continue;
+        }
+
+        tasks.emplace_back( [&filename, &brickDirectory, &record = records.m_refImages[i], &timing = records.m_timings[t]] ()
+        {
+            const auto start = clock::now();
+            record = readImageFile( filename, std::nullopt, brickDirectory );
+            timing.m_readSeconds = std::chrono::duration<double>( clock::now() - start ).count();
+        } );
+    }
+
+    for ( size_t i = 0; i < project.m_parcellations.size(); ++i, ++t )
+    {
+        const std::string& filename = project.m_parcellations[i].m_fileName;
+        records.m_timings[t].m_fileName = filename;
+
+        if ( ! parcellationValid[i] )
+        {
+            continue;
+        }
+
+        tasks.emplace_back( [&filename, &record = records.m_parcellations[i], &timing = records.m_timings[t]] ()
+        {
+            const auto start = clock::now();
+            record = readParcellationFile( filename, std::nullopt );
+            timing.m_readSeconds = std::chrono::duration<double>( clock::now() - start ).count();
+        } );
+    }
+
+    for ( size_t i = 0; i < project.m_slides.size(); ++i, ++t )
+    {
+        const std::string& filename = project.m_slides[i].m_fileName;
+        records.m_timings[t].m_fileName = filename;
+
+        tasks.emplace_back( [&filename, &tileCache, &diskCache, decodeSlides,
+                            &record = records.m_slides[i], &timing = records.m_timings[t]] ()
+        {
+            const auto start = clock::now();
+            record = details::generateSlideCpuRecord( filename, tileCache, diskCache.get(), decodeSlides );
+            timing.m_readSeconds = std::chrono::duration<double>( clock::now() - start ).count();
+        } );
+    }
+
+    runConcurrently( tasks, numThreads );
+
+    return records;
+}
+
+
+void printLoadTimings( const std::vector< FileLoadTiming >& timings, double totalSeconds )
+{
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision( 3 )
+       << "Project load times (seconds):" << std::endl
+       << std::setw( 10 ) << "read" << std::setw( 10 ) << "gpu" << "  file" << std::endl;
+
+    double sumSeconds = 0.0;
+
+    for ( const auto& timing : timings )
+    {
+        ss << std::setw( 10 ) << timing.m_readSeconds
+           << std::setw( 10 ) << timing.m_gpuSeconds << "  " << timing.m_fileName
+           << ( timing.m_loaded ? "" : " (failed)" ) << std::endl;
+
+        sumSeconds += timing.m_readSeconds + timing.m_gpuSeconds;
+    }
+
+    ss << "Loaded " << timings.size() << " files in " << totalSeconds
+       << " s (" << sumSeconds << " s if loaded sequentially)" << std::ends;
+
+    std::cout << ss.str() << std::endl;
+}
+
+
 std::optional<UID> loadImage(
         DataManager& dataManager,
         const std::string& filename,
         const std::optional< std::string >& dicomSeriesUid )
 {
-    auto cpuRecord = details::generateImageCpuRecord(
-                filename, dicomSeriesUid, imageio::ComponentNormalizationPolicy::None );
+    return loadImage( dataManager, readImageFile( filename, dicomSeriesUid, dataManager.brickDirectory() ), filename );
+}
+
 
+std::optional<UID> loadImage(
+        DataManager& dataManager,
+        std::unique_ptr<imageio::ImageCpuRecord> cpuRecord,
+        const std::string& filename )
+{
     if ( ! cpuRecord )
     {
         std::cerr << "Error loading image from file '" << filename << "'" << std::endl;
@@ -136,44 +507,21 @@ std::optional<UID> loadParcellation(
         const std::string& filename,
         const std::optional< std::string >& dicomSeriesUid )
 {
-    // Step 1) Load parcellation image
-    auto imageCpuRecord = details::generateImageCpuRecord(
-                filename, dicomSeriesUid, imageio::ComponentNormalizationPolicy::None );
-
-    if ( ! imageCpuRecord || ! imageCpuRecord->imageBaseData() )
-    {
-        std::cerr << "Error loading parcellation image from file '" << filename << "'" << std::endl;
-        return std::nullopt;
-    }
-
-    std::ostringstream ss;
-    ss << "Loaded image from '" << filename << "'" << std::endl << std::endl
-       << "Header:\n" << imageCpuRecord->header() << std::endl << std::endl
-       << "Transformation:\n" << imageCpuRecord->transformations() << std::ends;
-    std::cout << ss.str() << std::endl;
+    return loadParcellation( dataManager, readParcellationFile( filename, dicomSeriesUid ), filename );
+}
 
-    if ( imageio::isFloatingType( imageCpuRecord->header().m_bufferComponentType ) )
-    {
-        std::cerr << "Cannot load parcellation image: only integer "
-                  << "pixel component types are valid." << std::endl;
-        return std::nullopt;
-    }
 
-    // Step 2) Convert image record to parcellation record. This function "squashes"
-    // empty space between label values
-    auto parcelCpuRecord = imageio::createParcellationCpuRecord( *imageCpuRecord );
+std::optional<UID> loadParcellation(
+        DataManager& dataManager,
+        std::unique_ptr<imageio::ParcellationCpuRecord> parcelCpuRecord,
+        const std::string& filename )
+{
     if ( ! parcelCpuRecord || ! parcelCpuRecord->imageBaseData() )
     {
-        std::cerr << "Error creating parcellation CPU record for '" << filename << "'" << std::endl;
+        std::cerr << "Error loading parcellation from file '" << filename << "'" << std::endl;
         return std::nullopt;
     }
 
-    ss.str( std::string() );
-    ss << "Generated parcellation from '" << filename << "'" << std::endl << std::endl
-       << "Header:\n" << parcelCpuRecord->header() << std::endl << std::endl
-       << "Transformation:\n" << parcelCpuRecord->transformations() << std::ends;
-    std::cout << ss.str() << std::endl;
-
     parcelCpuRecord->setOpacity( 0, sk_parcel3dOpacity );
 
 
@@ -261,9 +609,15 @@ std::optional<UID> loadParcellation(
 std::optional<UID> loadSlide(
         DataManager& dataManager,
         const std::string& filename,
-        bool translateToTopOfStack )
+        bool translateToTopOfStack,
+        SlideDecodedHandler onDecoded )
 {
-    auto cpuRecord = details::generateSlideCpuRecord( filename );
+    // Decode the slide now, unless a handler of data decoded in the background is provided
+    const bool decodeNow = ( ! onDecoded || ! dataManager.slideDecodeService() );
+
+    auto cpuRecord = details::generateSlideCpuRecord(
+                filename, dataManager.slideTileCache(), dataManager.slideDiskCache().get(), decodeNow );
+
     if ( ! cpuRecord )
     {
         std::ostringstream ss;
@@ -272,6 +626,26 @@ std::optional<UID> loadSlide(
         return std::nullopt;
     }
 
+    return loadSlide( dataManager, std::move( cpuRecord ), translateToTopOfStack, onDecoded );
+}
+
+
+std::optional<UID> loadSlide(
+        DataManager& dataManager,
+        std::unique_ptr<slideio::SlideCpuRecord> cpuRecord,
+        bool translateToTopOfStack,
+        SlideDecodedHandler onDecoded )
+{
+    if ( ! cpuRecord )
+    {
+        return std::nullopt;
+    }
+
+    const std::string filename = cpuRecord->header().fileName();
+
+    // The record holds placeholder data, unless no handler of data decoded in the background is provided
+    const bool decodeNow = ( ! onDecoded || ! dataManager.slideDecodeService() );
+
     float stackTranslation = 0.0f;
 
     if ( translateToTopOfStack )
@@ -283,6 +657,11 @@ std::optional<UID> loadSlide(
 
     cpuRecord->transformation().setStackTranslationZ( stackTranslation );
 
+    if ( auto reader = cpuRecord->tileReader() )
+    {
+        reader->setSkipBackgroundTiles( dataManager.skipBackgroundSlideTiles() );
+    }
+
     auto gpuRecord = gpuhelper::createSlideGpuRecord( cpuRecord.get() );
     if ( ! gpuRecord )
     {
@@ -309,10 +688,144 @@ std::optional<UID> loadSlide(
         dataManager.setActiveSlideUid( *slideUid );
     }
 
+    if ( decodeNow )
+    {
+        return *slideUid;
+    }
+
+    // Decode the slide data in the background, starting from the center of the slide
+    const slideio::SlideCpuRecord* loadedCpuRecord = record->cpuData();
+    const bool createThumbnail = loadedCpuRecord->header().associatedImages().isThumbImageGenerated();
+    const glm::vec3 backgroundColor = loadedCpuRecord->header().backgroundColor();
+
+    const slideio::SlideDecodeService::JobRegion region{
+        *slideUid, 0.5 * glm::dvec2( loadedCpuRecord->fileLevel( 0 ).m_dims ) };
+
+    // The service outlives its jobs, which it joins upon destruction
+    slideio::SlideDecodeService* service = dataManager.slideDecodeService().get();
+
+    service->submit(
+                region, loadedCpuRecord->tileReader(),
+                [uid = *slideUid, createThumbnail, backgroundColor, onDecoded, diskCache = dataManager.slideDiskCache(),
+                 service, region, tileReader = loadedCpuRecord->tileReader()]
+                ( slideio::SlideTileReader& reader, openslide_t* handle )
+    {
+        // Downsampling is split among idle workers of the service
+        auto runner = [service, &region, &tileReader, handle] (
+                size_t count, const slideio::SlideDecodeService::IndexWork& work )
+        {
+            service->forEachIndex( region, tileReader, count, work, handle );
+        };
+
+        std::shared_ptr<slideio::DecodedSlideData> decoded =
+                slideio::decodeSlide( reader, createThumbnail, backgroundColor, handle, diskCache.get(), runner );
+
+        if ( ! decoded )
+        {
+            std::cerr << "Unable to decode slide from file '" << reader.fileName() << "'" << std::endl;
+            return;
+        }
+
+        onDecoded( uid, std::move( decoded ) );
+    } );
+
     return *slideUid;
 }
 
 
+bool applyDecodedSlide(
+        DataManager& dataManager,
+        const UID& slideUid,
+        slideio::DecodedSlideData decoded )
+{
+    auto record = dataManager.slideRecord( slideUid ).lock();
+
+    if ( ! record || ! record->cpuData() || ! record->gpuData() )
+    {
+        // The slide may have been unloaded while it was being decoded
+        return false;
+    }
+
+    slideio::applyDecodedSlide( *record->cpuData(), std::move( decoded ) );
+
+    if ( ! gpuhelper::updateSlideGpuRecord( record->cpuData(), *record->gpuData() ) )
+    {
+        std::cerr << "Unable to update texture of slide " << slideUid << std::endl;
+        return false;
+    }
+
+    dataManager.notifySlideDataChanged( slideUid );
+    return true;
+}
+
+
+void prefetchSlideTiles(
+        DataManager& dataManager,
+        const glm::vec3& worldViewCenter,
+        const glm::mat4& world_O_slideStack,
+        size_t numNeighbours )
+{
+    auto service = dataManager.slideDecodeService();
+    const auto activeIndex = dataManager.activeSlideIndex();
+
+    if ( ! service || ! activeIndex )
+    {
+        return;
+    }
+
+    const long first = static_cast<long>( *activeIndex ) - static_cast<long>( numNeighbours );
+    const long last = static_cast<long>( *activeIndex ) + static_cast<long>( numNeighbours );
+
+    for ( long index = std::max( first, 0L ); index <= last; ++index )
+    {
+        const auto slideUid = dataManager.orderedSlideUid( index );
+        if ( ! slideUid )
+        {
+            continue;
+        }
+
+        auto record = dataManager.slideRecord( *slideUid ).lock();
+        if ( ! record || ! record->cpuData() )
+        {
+            continue;
+        }
+
+        const slideio::SlideCpuRecord& cpuRecord = *record->cpuData();
+        const auto reader = cpuRecord.tileReader();
+
+        if ( ! reader || 0 == cpuRecord.numCreatedLevels() )
+        {
+            continue;
+        }
+
+        // Prefetch at twice the resolution of the slide texture
+        const glm::dvec2 textureDownsample =
+                cpuRecord.createdLevel( cpuRecord.numCreatedLevels() - 1 ).m_downsampleFactors;
+
+        const double downsample = 0.5 * std::min( textureDownsample.x, textureDownsample.y );
+        const int level = reader->bestLevelForDownsample( downsample );
+
+        // Size of the prefetched region in normalized slide coordinates
+        const glm::vec2 halfRegionSize = glm::vec2(
+                    0.5 * sk_prefetchRegionTiles * reader->tileSize() * reader->levelDownsample( level ) /
+                    glm::dvec2( cpuRecord.fileLevel( 0 ).m_dims ) );
+
+        const glm::vec4 slideViewCenter = slideio::slide_O_world( cpuRecord, world_O_slideStack ) *
+                glm::vec4{ worldViewCenter, 1.0f };
+
+        const glm::vec2 center( slideViewCenter.x, slideViewCenter.y );
+
+        const auto tiles = slideio::tilesInSlideRegion(
+                    cpuRecord, center - halfRegionSize, center + halfRegionSize, downsample );
+
+        if ( tiles )
+        {
+            service->prefetchTiles( *slideUid, reader, tiles->first, tiles->second );
+        }
+    }
+}
+
+
 std::optional<UID> getActiveParcellation( DataManager& dataManager, const UID& imageUid )
 {
     // Return the active parcellation, if one exists
@@ -404,6 +917,9 @@ std::vector<UID> generateLabelMeshes(
     const std::map< uint32_t, UID > labelMeshUids =
             dataManager.labelMeshUids_of_parcellation( parcelUid );
 
+    // Index of the labels that occur in the parcellation
+    const imageio::LabelIndex* index = parcelRecord->cpuData()->labelIndex();
+
     for ( const uint32_t labelIndex : labelIndices )
     {
         auto it = labelMeshUids.find( labelIndex );
@@ -427,6 +943,13 @@ std::vector<UID> generateLabelMeshes(
             continue;
         }
 
+        if ( index && ! index->hasPixels( labelIndex ) )
+        {
+            // Ignore label that does not occur in the parcellation, rather than
+            // running the mesh pipeline over the whole volume to find no surface
+            continue;
+        }
+
         if ( auto meshUid = details::generateLabelMeshRecord( dataManager, parcelUid, labelIndex ) )
         {
             generatedMeshUids.push_back( *meshUid );
@@ -437,7 +960,12 @@ std::vector<UID> generateLabelMeshes(
 }
 
 
-std::vector<UID> generateAllLabelMeshes( DataManager& dataManager, const UID& parcelUid )
+std::vector<UID> generateAllLabelMeshes(
+        DataManager& dataManager,
+        const UID& parcelUid,
+        const MeshGenerationProgressHandler& progressHandler,
+        size_t numThreads,
+        const LabelMeshMethod& method )
 {
     std::vector<UID> generatedMeshUids;
 
@@ -454,56 +982,37 @@ std::vector<UID> generateAllLabelMeshes( DataManager& dataManager, const UID& pa
 
     auto baseData = parcelRecord->cpuData()->imageBaseData();
 
-    // Parcellation pixels are indices into labels values
-    const vtkSmartPointer<vtkImageData> labelsIndexVtkData =
-            baseData->asVTKImageData( sk_compToLoad );
-
-    if ( ! labelsIndexVtkData )
+    // Find the labels that occur in the parcellation from its label index, rather than
+    // scanning the whole volume. Parcellations are indexed when created, but an index is
+    // built here if one is missing.
+    if ( ! parcelRecord->cpuData()->labelIndex() )
     {
-        std::ostringstream ss;
-        ss << "Parcellation " << parcelUid << " has null VTK data" << std::ends;
-        std::cerr << ss.str() << std::endl;
-        return generatedMeshUids;
+        details::indexParcellationLabels( *parcelRecord->cpuData() );
     }
 
-    // Create a set of all label indices in the image. The function
-    // vtkdetails::generateIntegerImageHistogram (and its underlying VTK function)
-    // require values of type int32_t for building a histogram. Therefore,
-    // indices are cast to int32_t and it is assumed that there are less than 2^31 - 1
-    // label values. (Hopefully a safe assumption!)
+    const imageio::LabelIndex* index = parcelRecord->cpuData()->labelIndex();
 
-    if ( parcelRecord->cpuData()->maxLabelIndex() >= std::numeric_limits<int32_t>::max() )
+    if ( ! index )
     {
         std::ostringstream ss;
-        ss << "Warning: the parcellation contains " << parcelRecord->cpuData()->maxLabelIndex()
-           << " labels, which is more than the maximum number allowed." << std::ends;
+        ss << "Unable to index the labels of parcellation " << parcelUid << std::ends;
         std::cerr << ss.str() << std::endl;
+        return generatedMeshUids;
     }
 
-    const int32_t maxLabelIndex = static_cast<int32_t>(
-                std::min( parcelRecord->cpuData()->maxLabelIndex(),
-                          static_cast<size_t>( std::numeric_limits<int32_t>::max() ) ) );
-
-    // Set of all label indices
-    std::set<int32_t> labelIndices;
-
-    auto it = std::end( labelIndices );
-    for ( int32_t index = 0; index <= maxLabelIndex; ++index )
-    {
-        it = labelIndices.insert( it, index );
-    }
-
-    // Generate histogram of label indices in parcellation
-    /// @todo Move this function from vtkdetails to meshgen
-    const std::map< int32_t, double > histogram =
-            vtkdetails::generateIntegerImageHistogram( labelsIndexVtkData, labelIndices );
+    // Indices of the labels to mesh
+    std::vector<uint32_t> labelIndicesToMesh;
 
-    for ( const auto& bin : histogram )
+    for ( size_t i = 0; i < index->numLabels(); ++i )
     {
-        const uint32_t labelIndex = static_cast<uint32_t>( bin.first );
-        const double labelFrequency = bin.second;
+        if ( ! index->hasPixels( i ) )
+        {
+            // Do not attempt to generate mesh for label that does not occur in the parcellation
+            continue;
+        }
 
         // Convert label index to label value:
+        const uint32_t labelIndex = static_cast<uint32_t>( i );
         const auto labelValue = parcelRecord->cpuData()->labelValue( labelIndex );
 
         if ( ! labelValue )
@@ -518,17 +1027,222 @@ std::vector<UID> generateAllLabelMeshes( DataManager& dataManager, const UID& pa
             continue;
         }
 
-        if ( 0.0 < labelFrequency )
+        labelIndicesToMesh.push_back( labelIndex );
+    }
+
+    if ( labelIndicesToMesh.empty() )
+    {
+        return generatedMeshUids;
+    }
+
+    const imageio::ImageHeader& header = parcelRecord->cpuData()->header();
+
+    // With the discrete surfaces method, the workers first sweep slabs of slices of the
+    // parcellation, extracting the raw surface pieces of all labels in each slab. Once all slabs
+    // are swept, they merge and smooth the pieces of each label. Progress is counted in slabs
+    // swept and meshes loaded.
+    const size_t numSlices = ( LabelMeshMethod::DiscreteSurfaces == method )
+            ? static_cast<size_t>( header.m_pixelDimensions.z ) : 0;
+
+    // The workers run on the shared thread pool, while this thread loads their meshes
+    numThreads = imageio::parallel::numWorkers(
+                std::max( labelIndicesToMesh.size(), numSlices ), numThreads );
+
+    const size_t numSlabs = std::min( numSlices, sk_numSlabsPerWorker * numThreads );
+    const size_t numSteps = numSlabs + labelIndicesToMesh.size();
+
+    // VTK pipelines update the information of their input data objects, so each worker
+    // meshes its own VTK image. The images share the parcellation's pixel buffer.
+    std::vector< vtkSmartPointer<vtkImageData> > workerVtkData( numThreads );
+
+    for ( auto& vtkData : workerVtkData )
+    {
+        vtkData = baseData->asVTKImageData( sk_compToLoad );
+
+        if ( ! vtkData )
+        {
+            std::ostringstream ss;
+            ss << "Parcellation " << parcelUid << " has null VTK data" << std::ends;
+            std::cerr << ss.str() << std::endl;
+            return generatedMeshUids;
+        }
+    }
+
+    // Raw surface pieces of the labels in each slab. Labels that turn out to have no surface
+    // get no mesh.
+    std::vector< std::map< uint32_t, vtkSmartPointer<vtkPolyData> > > slabSurfaces( numSlabs );
+
+    // Meshes generated by the workers and not yet loaded, with their label indices
+    std::deque< std::pair< uint32_t, std::unique_ptr<MeshCpuRecord> > > generatedMeshes;
+
+    std::mutex mutex;
+    std::condition_variable meshGenerated; // Signals this thread that a slab or mesh is done
+    std::condition_variable slabsSwept; // Signals the workers that all slabs are swept
+    size_t numActiveWorkers = numThreads;
+    size_t numSlabsSwept = 0;
+
+    std::atomic<size_t> nextWorker( 0 );
+    std::atomic<size_t> nextSlab( 0 );
+    std::atomic<size_t> nextLabel( 0 );
+    std::atomic<bool> canceled( false );
+
+    auto worker = [&] ()
+    {
+        const size_t t = nextWorker++;
+
+        for ( size_t s = nextSlab++; s < numSlabs && ! canceled; s = nextSlab++ )
+        {
+            const std::array<int, 2> slices{ {
+                    static_cast<int>( s * numSlices / numSlabs ),
+                    static_cast<int>( ( s + 1 ) * numSlices / numSlabs ) } };
+
+            auto surfaces = meshgen::extractLabelSurfaces(
+                        workerVtkData[t].Get(), header, labelIndicesToMesh, slices );
+
+            std::lock_guard<std::mutex> lock( mutex );
+            slabSurfaces[s] = std::move( surfaces );
+            ++numSlabsSwept;
+            meshGenerated.notify_one();
+            slabsSwept.notify_all();
+        }
+
+        if ( 0 < numSlabs )
+        {
+            // The pieces of a label may lie in any slab. The slabs are all claimed by running
+            // workers, so waiting here for the other workers to sweep theirs cannot deadlock.
+            std::unique_lock<std::mutex> lock( mutex );
+            slabsSwept.wait( lock, [&] () { return numSlabs == numSlabsSwept || canceled; } );
+        }
+
+        for ( size_t i = nextLabel++; i < labelIndicesToMesh.size() && ! canceled; i = nextLabel++ )
         {
-            // This label value occurs in the parcellation.
-            // Do not attempt to generate mesh for label that has 0 frequency.
-            if ( auto meshUid = details::generateLabelMeshRecord( dataManager, parcelUid, labelIndex ) )
+            std::unique_ptr<MeshCpuRecord> mesh;
+
+            if ( LabelMeshMethod::DiscreteSurfaces == method )
             {
-                generatedMeshUids.push_back( *meshUid );
+                // Only this worker touches the pieces of the label, so they are released
+                // from the slabs once smoothed
+                std::vector< vtkSmartPointer<vtkPolyData> > surfacePieces;
+
+                for ( auto& surfaces : slabSurfaces )
+                {
+                    const auto piece = surfaces.find( labelIndicesToMesh[i] );
+
+                    if ( std::end( surfaces ) != piece )
+                    {
+                        surfacePieces.emplace_back( std::move( piece->second ) );
+                    }
+                }
+
+                if ( ! surfacePieces.empty() )
+                {
+                    mesh = meshgen::generateLabelMeshFromSurfaces(
+                                surfacePieces, workerVtkData[t].Get(),
+                                header, labelIndicesToMesh[i] );
+                }
             }
+            else
+            {
+                mesh = meshgen::generateLabelMesh(
+                            workerVtkData[t].Get(), header, labelIndicesToMesh[i],
+                            details::labelBoundingBox( *parcelRecord->cpuData(), labelIndicesToMesh[i] ) );
+            }
+
+            std::lock_guard<std::mutex> lock( mutex );
+            generatedMeshes.emplace_back( labelIndicesToMesh[i], std::move( mesh ) );
+            meshGenerated.notify_one();
         }
+
+        std::lock_guard<std::mutex> lock( mutex );
+        --numActiveWorkers;
+        meshGenerated.notify_one();
+    };
+
+    // The VTK filters of a worker share the cores left to it by the other workers
+    const VtkThreadLimit vtkThreadLimit(
+                std::max( imageio::parallel::maxConcurrency() / numThreads, size_t{ 1 } ) );
+
+    imageio::parallel::TaskGroup workers;
+
+    for ( size_t t = 0; t < numThreads; ++t )
+    {
+        workers.run( worker );
     }
 
+    // Load the meshes on this thread as they are handed back, since their GPU records
+    // are created in its OpenGL context
+    size_t numGenerated = 0;
+    size_t numSlabsReported = 0;
+
+    auto reportProgress = [&] ()
+    {
+        if ( canceled || ! progressHandler )
+        {
+            return;
+        }
+
+        if ( ! progressHandler( numSlabsReported + numGenerated, numSteps ) )
+        {
+            std::cout << "Canceled generation of label meshes for parcellation " << parcelUid
+                      << " after " << numGenerated << " of " << labelIndicesToMesh.size()
+                      << " labels" << std::endl;
+
+            // Set under the lock, so that no worker misses it while waiting for the slabs
+            std::lock_guard<std::mutex> lock( mutex );
+            canceled = true;
+            slabsSwept.notify_all();
+        }
+    };
+
+    while ( true )
+    {
+        std::unique_lock<std::mutex> lock( mutex );
+
+        if ( ! meshGenerated.wait_for( lock, sk_meshProgressInterval, [&] () {
+                 return ! generatedMeshes.empty() || numSlabsReported != numSlabsSwept ||
+                        0 == numActiveWorkers; } ) )
+        {
+            // Nothing was done in time: report progress anyway, so that the handler can keep
+            // its user interface responsive and cancel while slabs are swept or labels meshed
+            lock.unlock();
+            reportProgress();
+            continue;
+        }
+
+        if ( numSlabsReported != numSlabsSwept )
+        {
+            numSlabsReported = numSlabsSwept;
+            lock.unlock();
+            reportProgress();
+            continue;
+        }
+
+        if ( generatedMeshes.empty() )
+        {
+            break;
+        }
+
+        auto generated = std::move( generatedMeshes.front() );
+        generatedMeshes.pop_front();
+        lock.unlock();
+
+        if ( canceled )
+        {
+            continue;
+        }
+
+        if ( auto meshUid = details::insertLabelMeshRecord(
+                 dataManager, parcelUid, generated.first, std::move( generated.second ) ) )
+        {
+            generatedMeshUids.push_back( *meshUid );
+        }
+
+        ++numGenerated;
+        reportProgress();
+    }
+
+    workers.wait();
+
     return generatedMeshUids;
 }
 
@@ -2,7 +2,11 @@
 #define DATA_LOADING_H
 
 #include "common/UID.h"
+#include "mesh/MeshTypes.h"
 
+#include <glm/fwd.hpp>
+
+#include <functional>
 #include <memory>
 #include <optional>
 #include <set>
@@ -12,10 +16,91 @@
 
 class DataManager;
 
+namespace imageio
+{
+class ImageCpuRecord;
+class ParcellationCpuRecord;
+}
+
+namespace serialize
+{
+struct HZeeProject;
+}
+
+namespace slideio
+{
+struct DecodedSlideData;
+class SlideCpuRecord;
+class SlideDiskCache;
+class SlideTileCache;
+}
+
 
 namespace data
 {
 
+/// Time spent loading one file of a project
+struct FileLoadTiming
+{
+    std::string m_fileName;
+    double m_readSeconds = 0.0; //!< Time reading the file into a CPU record on a worker thread
+    double m_gpuSeconds = 0.0; //!< Time creating the GPU record and inserting it into DataManager
+    bool m_loaded = false; //!< Whether the file was successfully loaded
+};
+
+
+/**
+ * @brief CPU records of the files of a project, read concurrently before being loaded into
+ * DataManager. The records are in the order of the files in the project; records of files that
+ * could not be read are null. Timings are in order of reference images, parcellations, and slides.
+ */
+struct ProjectCpuRecords
+{
+    std::vector< std::unique_ptr<imageio::ImageCpuRecord> > m_refImages;
+    std::vector< std::unique_ptr<imageio::ParcellationCpuRecord> > m_parcellations;
+    std::vector< std::unique_ptr<slideio::SlideCpuRecord> > m_slides;
+
+    std::vector< FileLoadTiming > m_timings;
+};
+
+
+/**
+ * @brief Read the reference images, parcellations, and slides of a project into CPU records
+ * on a pool of worker threads. This function does not use OpenGL or DataManager, so records
+ * must then be loaded into DataManager on the GUI thread with the overloads of loadImage,
+ * loadParcellation, and loadSlide that take a CPU record.
+ *
+ * The reference images and parcellations are first validated from their file headers, so that
+ * invalid ones are reported before any pixels are read. Their records are left null.
+ *
+ * @param[in] project Project whose files are read
+ * @param[in] tileCache Cache of tiles shared among all slides
+ * @param[in] diskCache Cache on disk of decoded slide data; may be nullptr
+ * @param[in] brickDirectory Directory of the brick files of reference images that are too large
+ * for memory, which are stored out of core; if empty, all reference images are read into memory
+ * @param[in] decodeSlides If true, the slides' pixel data are decoded. Otherwise, slides hold
+ * placeholder data and must be loaded with a decoded data handler.
+ * @param[in] numThreads Maximum number of worker threads; if zero, the whole shared thread pool is used
+ *
+ * @return CPU records and read times of all project files
+ */
+ProjectCpuRecords readProjectFiles(
+        const serialize::HZeeProject& project,
+        std::shared_ptr<slideio::SlideTileCache> tileCache,
+        std::shared_ptr<slideio::SlideDiskCache> diskCache,
+        const std::string& brickDirectory,
+        bool decodeSlides,
+        size_t numThreads = 0 );
+
+
+/**
+ * @brief Print a report of the time spent loading each file of a project
+ * @param[in] timings Load timings of the files
+ * @param[in] totalSeconds Wall-clock time spent loading all files
+ */
+void printLoadTimings( const std::vector< FileLoadTiming >& timings, double totalSeconds );
+
+
 /**
  * @brief Attempt to load an image from disk into the DataManager instance. Return its assigned
  * UID if successful. Make this the active image and assign it to be the the last image in the
@@ -33,6 +118,22 @@ std::optional<UID> loadImage(
         const std::optional< std::string >& dicomSeriesUid );
 
 
+/**
+ * @brief Load an image that has already been read from disk into the DataManager instance.
+ * This is the part of loadImage that must run on the GUI thread.
+ *
+ * @param[in] dataManager DataManager instance
+ * @param[in] cpuRecord Image CPU record
+ * @param[in] filename Image file name, used for logging
+ *
+ * @return If loading successful, return the image UID. Otherwise, return std::nullopt.
+ */
+std::optional<UID> loadImage(
+        DataManager& dataManager,
+        std::unique_ptr<imageio::ImageCpuRecord> cpuRecord,
+        const std::string& filename );
+
+
 /**
  * @brief Attempt to load a parcellation from disk into the DataManager instance.
  * Return its assigned UID if successful. Make this the active parcellation.
@@ -52,13 +153,42 @@ std::optional<UID> loadParcellation(
         const std::optional< std::string >& dicomSeriesUid );
 
 
+/**
+ * @brief Load a parcellation that has already been read from disk into the DataManager instance.
+ * This is the part of loadParcellation that must run on the GUI thread.
+ *
+ * @param[in] dataManager DataManager instance
+ * @param[in] parcelCpuRecord Parcellation CPU record
+ * @param[in] filename Parcellation image file name, used for logging
+ *
+ * @return If loading successful, return the parcellation UID. Otherwise, return std::nullopt.
+ */
+std::optional<UID> loadParcellation(
+        DataManager& dataManager,
+        std::unique_ptr<imageio::ParcellationCpuRecord> parcelCpuRecord,
+        const std::string& filename );
+
+
+/// Handler of slide data that has been decoded in the background.
+/// @note The handler is called on a decoding thread.
+using SlideDecodedHandler = std::function<
+    void ( const UID& slideUid, std::shared_ptr<slideio::DecodedSlideData> ) >;
+
+
 /**
  * @brief Load a slide image from disk and return its assigned UID if successful.
  *
+ * If a decoded data handler is provided, then this function returns as soon as the slide file is
+ * opened: the slide is inserted into DataManager with placeholder pixel data, and its data are
+ * decoded by the DataManager's slide decoding service. The handler is called with the decoded data,
+ * which are to be applied to the slide on the GUI thread using applyDecodedSlide.
+ * If no handler is provided, the slide data are decoded before this function returns.
+ *
  * @param dataManager DataManager reference
  * @param filename Slide file name
  * @param translateToTopOfStack If true, the slide will be translated along the stack's Z axis
  * such that it is on top of the stack
+ * @param onDecoded Optional handler of slide data decoded in the background
  *
  * @return If generation successful, return the slide UID.
  * Otherwise, return std::nullopt.
@@ -66,7 +196,65 @@ std::optional<UID> loadParcellation(
 std::optional<UID> loadSlide(
         DataManager& dataManager,
         const std::string& filename,
-        bool translateToTopOfStack );
+        bool translateToTopOfStack,
+        SlideDecodedHandler onDecoded = nullptr );
+
+
+/**
+ * @brief Load a slide that has already been read from disk into the DataManager instance.
+ * This is the part of loadSlide that must run on the GUI thread.
+ *
+ * If a decoded data handler is provided and the DataManager has a slide decoding service,
+ * then the record must hold placeholder data (i.e. it was read without decoding) and its data
+ * are decoded in the background. Otherwise, the record must hold decoded data.
+ *
+ * @param dataManager DataManager reference
+ * @param cpuRecord Slide CPU record
+ * @param translateToTopOfStack If true, the slide will be translated along the stack's Z axis
+ * such that it is on top of the stack
+ * @param onDecoded Optional handler of slide data decoded in the background
+ *
+ * @return If loading successful, return the slide UID. Otherwise, return std::nullopt.
+ */
+std::optional<UID> loadSlide(
+        DataManager& dataManager,
+        std::unique_ptr<slideio::SlideCpuRecord> cpuRecord,
+        bool translateToTopOfStack,
+        SlideDecodedHandler onDecoded = nullptr );
+
+
+/**
+ * @brief Apply decoded data to a slide that was loaded with placeholder data,
+ * updating both its CPU record and its texture.
+ * @note Must be called on the GUI thread with the OpenGL context current.
+ *
+ * @param dataManager DataManager reference
+ * @param slideUid Slide UID
+ * @param decoded Decoded slide data
+ *
+ * @return True iff the slide exists and was updated
+ */
+bool applyDecodedSlide(
+        DataManager& dataManager,
+        const UID& slideUid,
+        slideio::DecodedSlideData decoded );
+
+
+/**
+ * @brief Prefetch tiles of the active slide and of its neighbouring slides in the stack,
+ * so that they are cached before being viewed. The tiles around the view center are read
+ * at twice the resolution of the slide textures.
+ *
+ * @param dataManager DataManager reference
+ * @param worldViewCenter World-space center of the view
+ * @param world_O_slideStack Transformation from slide stack to World space
+ * @param numNeighbours Number of slides above and below the active slide to prefetch
+ */
+void prefetchSlideTiles(
+        DataManager& dataManager,
+        const glm::vec3& worldViewCenter,
+        const glm::mat4& world_O_slideStack,
+        size_t numNeighbours );
 
 
 /**
@@ -113,16 +301,48 @@ std::vector<UID> generateLabelMeshes(
         const std::set<uint32_t>& labelsIndices );
 
 
+/**
+ * @brief Handler of the progress of label mesh generation. It is called with the number of
+ * steps done so far and the total number of steps. The steps are the labels whose meshes are
+ * generated, preceded with the discrete surfaces method by the slabs of the parcellation swept.
+ * It is also called periodically while no step is done, with unchanged numbers.
+ * It returns false to cancel the generation of the remaining meshes.
+ */
+using MeshGenerationProgressHandler = std::function< bool ( size_t numDone, size_t numSteps ) >;
+
+
 /**
  * @brief Generate surface meshes from all label indices in a parcellation.
  * Load the meshes into DataManager instance.
  *
+ * The meshes of the labels are generated concurrently on the shared thread pool, with the
+ * threads of each worker's VTK filters capped so that the cores are not oversubscribed. As each
+ * mesh is done, it is handed back to the calling thread, which creates its GPU record
+ * and loads it. Hence, the calling thread must have an OpenGL context current.
+ *
+ * With the discrete surfaces method, the workers first extract the boundaries of all labels
+ * in one sweep over the parcellation, divided into slabs of slices, and then merge and smooth
+ * the boundary pieces of each label. With the marching cubes method, each worker runs
+ * marching cubes over the bounding box of each of its labels.
+ *
  * @param[in] dataManager DataManager instance
  * @param[in] parcelUid UID of the input parcellation
+ * @param[in] progressHandler Optional handler of progress, called on the calling thread
+ * after each slab is swept and each mesh is loaded, and at least every 100 ms in between.
+ * Meshes already being generated when it cancels are discarded.
+ * @param[in] numThreads Maximum number of worker threads; if zero, the whole shared thread pool is used
+ * @param[in] method Method of generating the meshes. The application uses the method chosen
+ * with its --label-mesh-method option (see \c DataManager::labelMeshMethod). Benchmark the
+ * methods on a given machine and atlas size with LabelMeshBenchmark.
  *
  * @return Vector of UIDs of meshes successfully generated and loaded into dataManager
  */
-std::vector<UID> generateAllLabelMeshes( DataManager& dataManager, const UID& parcelUid );
+std::vector<UID> generateAllLabelMeshes(
+        DataManager& dataManager,
+        const UID& parcelUid,
+        const MeshGenerationProgressHandler& progressHandler = nullptr,
+        size_t numThreads = 0,
+        const LabelMeshMethod& method = LabelMeshMethod::MarchingCubes );
 
 
 /**
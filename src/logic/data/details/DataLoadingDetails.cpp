@@ -2,10 +2,14 @@
 
 #include "logic/managers/DataManager.h"
 #include "imageio/ImageLoader.h"
+#include "imageio/ImageProbe.h"
+#include "imageio/LabelIndex.h"
 #include "mesh/MeshLoading.h"
 #include "rendering/utility/CreateGLObjects.h"
 #include "slideio/SlideReading.h"
 
+#include <glm/glm.hpp>
+
 #include <boost/filesystem.hpp>
 #include <boost/tokenizer.hpp>
 
@@ -15,6 +19,7 @@
 
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <sstream>
 
 
@@ -74,6 +79,59 @@ std::unique_ptr< imageio::ImageCpuRecord > generateImageCpuRecord(
 }
 
 
+std::unique_ptr< imageio::ImageProbe > probeImageFile(
+        const std::string& filename,
+        const std::optional< std::string >& dicomSeriesUid )
+{
+    // Use the same cast policy as when loading the image
+    imageio::ImageLoader imageLoader( imageio::ComponentTypeCastPolicy::ToOpenGLCompatible );
+
+    auto probe = imageLoader.probe( filename, dicomSeriesUid );
+
+    if ( ! probe )
+    {
+        std::ostringstream ss;
+        ss << "Unable to read image header from file '" << filename << "'" << std::ends;
+        std::cerr << ss.str() << std::endl;
+        return nullptr;
+    }
+
+    const auto dim = probe->m_header.m_numDimensions;
+
+    if ( dim > 3 )
+    {
+        std::ostringstream ss;
+        ss << "Unable to load image of dimension " << dim << " (greater than 3)." << std::ends;
+        std::cerr << ss.str() << std::endl;
+        return nullptr;
+    }
+
+    return probe;
+}
+
+
+std::unique_ptr< imageio::ImageCpuRecord > generateBrickedImageCpuRecord(
+        const imageio::ImageProbe& probe,
+        const std::string& brickFileName )
+{
+    // Same cast policy as the probe. Images whose components would be cast are not bricked.
+    imageio::ImageLoader imageLoader( imageio::ComponentTypeCastPolicy::ToOpenGLCompatible );
+
+    auto cpuRecord = imageLoader.loadBricked( probe, brickFileName );
+
+    if ( ! cpuRecord )
+    {
+        std::ostringstream ss;
+        ss << "Unable to load image from file '" << probe.m_header.m_fileName
+           << "' as a bricked volume" << std::ends;
+        std::cerr << ss.str() << std::endl;
+        return nullptr;
+    }
+
+    return cpuRecord;
+}
+
+
 std::unique_ptr<ImageColorMap> loadImageColorMapWithQt( const std::string& path )
 {
     using char_separator = boost::char_separator<char>;
@@ -364,6 +422,50 @@ std::unique_ptr<MeshCpuRecord> generateIsoSurfaceMeshCpuRecord(
 }
 
 
+void indexParcellationLabels( imageio::ParcellationCpuRecord& parcelCpuRecord )
+{
+    if ( ! parcelCpuRecord.imageBaseData() )
+    {
+        return;
+    }
+
+    const auto& header = parcelCpuRecord.header();
+
+    parcelCpuRecord.setLabelIndex( imageio::LabelIndex::create(
+                                       parcelCpuRecord.imageBaseData()->bufferPointer( sk_compIndex ),
+                                       header.m_bufferComponentType,
+                                       header.m_pixelDimensions,
+                                       parcelCpuRecord.numLabels() ) );
+}
+
+
+std::optional< std::array<int, 6> > labelBoundingBox(
+        const imageio::ParcellationCpuRecord& parcelCpuRecord,
+        const uint32_t labelIndex )
+{
+    const imageio::LabelIndex* index = parcelCpuRecord.labelIndex();
+
+    if ( ! index || ! index->hasPixels( labelIndex ) )
+    {
+        return std::nullopt;
+    }
+
+    const auto& label = index->label( labelIndex );
+
+    // VTK extents are of type int
+    if ( glm::any( glm::greaterThan( label.m_boundingBoxMax,
+                                     glm::u64vec3{ std::numeric_limits<int>::max() } ) ) )
+    {
+        return std::nullopt;
+    }
+
+    return std::array<int, 6>{ {
+            static_cast<int>( label.m_boundingBoxMin.x ), static_cast<int>( label.m_boundingBoxMax.x ),
+            static_cast<int>( label.m_boundingBoxMin.y ), static_cast<int>( label.m_boundingBoxMax.y ),
+            static_cast<int>( label.m_boundingBoxMin.z ), static_cast<int>( label.m_boundingBoxMax.z ) } };
+}
+
+
 std::unique_ptr<MeshCpuRecord> generateLabelMeshCpuRecord(
         DataManager& dataManager,
         const UID& parcelUid,
@@ -390,7 +492,8 @@ std::unique_ptr<MeshCpuRecord> generateLabelMeshCpuRecord(
         return nullptr;
     }
 
-    return meshgen::generateLabelMesh( parcelVtkData.Get(), parcelRecord->cpuData()->header(), labelIndex );
+    return meshgen::generateLabelMesh( parcelVtkData.Get(), parcelRecord->cpuData()->header(), labelIndex,
+                                       labelBoundingBox( *parcelRecord->cpuData(), labelIndex ) );
 }
 
 
@@ -399,8 +502,17 @@ std::optional<UID> generateLabelMeshRecord(
         const UID& parcelUid,
         const uint32_t labelIndex )
 {
-    auto meshCpuRecord = generateLabelMeshCpuRecord( dataManager, parcelUid, labelIndex );
+    return insertLabelMeshRecord( dataManager, parcelUid, labelIndex,
+                                  generateLabelMeshCpuRecord( dataManager, parcelUid, labelIndex ) );
+}
 
+
+std::optional<UID> insertLabelMeshRecord(
+        DataManager& dataManager,
+        const UID& parcelUid,
+        const uint32_t labelIndex,
+        std::unique_ptr<MeshCpuRecord> meshCpuRecord )
+{
     if ( ! meshCpuRecord || ! meshCpuRecord->polyData() )
     {
         std::ostringstream ss;
@@ -464,6 +576,8 @@ std::optional<UID> createBlankParcellation( DataManager& dataManager, const UID&
         return std::nullopt;
     }
 
+    indexParcellationLabels( *parcelCpuRecord );
+
     static constexpr bool sk_useNormalizedIntegers = false;
 
     auto parcelGpuRecord = gpuhelper::createImageGpuRecord(
@@ -472,7 +586,8 @@ std::optional<UID> createBlankParcellation( DataManager& dataManager, const UID&
                 tex::MagnificationFilter::Nearest,
                 sk_useNormalizedIntegers );
 
-    if ( ! parcelGpuRecord )
+    // The blank parcellation is created when first needed for editing, so it is uploaded at once
+    if ( ! parcelGpuRecord || ! parcelGpuRecord->uploadNextLevel() )
     {
         std::ostringstream ss;
         ss << "Unable to generate GPU record for blank parcellation of image " << imageUid << std::ends;
@@ -531,12 +646,21 @@ std::optional<UID> createBlankParcellation( DataManager& dataManager, const UID&
 
 
 std::unique_ptr<slideio::SlideCpuRecord>
-generateSlideCpuRecord( const std::string& filename )
+generateSlideCpuRecord(
+        const std::string& filename,
+        std::shared_ptr<slideio::SlideTileCache> tileCache,
+        const slideio::SlideDiskCache* diskCache,
+        bool decode )
 {
     static const glm::vec2 sk_pixelSize( 11.38f / 2011.0f, 11.38f / 2011.0f );
     static const float sk_thickness = 12.0f / 68.0f;
 
-    return slideio::readSlide( filename, sk_pixelSize, sk_thickness );
+    if ( decode )
+    {
+        return slideio::readSlide( filename, sk_pixelSize, sk_thickness, std::move( tileCache ), diskCache );
+    }
+
+    return slideio::openSlide( filename, sk_pixelSize, sk_thickness, std::move( tileCache ) );
 }
 
 } // namespace details
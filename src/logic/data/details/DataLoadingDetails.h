@@ -10,6 +10,7 @@
 #include "logic/records/ImageColorMapRecord.h"
 #include "logic/records/LabelTableRecord.h"
 
+#include <array>
 #include <memory>
 #include <optional>
 #include <string>
@@ -18,9 +19,16 @@
 class DataManager;
 class MeshCpuRecord;
 
+namespace imageio
+{
+struct ImageProbe;
+}
+
 namespace slideio
 {
 class SlideCpuRecord;
+class SlideDiskCache;
+class SlideTileCache;
 }
 
 
@@ -36,6 +44,28 @@ std::unique_ptr< imageio::ImageCpuRecord > generateImageCpuRecord(
         const imageio::ComponentNormalizationPolicy& normPolicy );
 
 
+/**
+ * @brief Read the information of an image from its file header(s) without reading its pixels.
+ * Components are described as cast by \c generateImageCpuRecord.
+ * @return Image information; nullptr if the image cannot be read or loaded
+ */
+std::unique_ptr< imageio::ImageProbe > probeImageFile(
+        const std::string& filename,
+        const std::optional< std::string >& dicomSeriesUid );
+
+
+/**
+ * @brief Load an image that is too large for memory as a bricked volume stored out of core
+ * (see \c imageio::ImageLoader::loadBricked)
+ * @param[in] probe Image information, as read by \c probeImageFile
+ * @param[in] brickFileName Name of the brick file of the image, which is created if needed
+ * @return Record of the bricked image; nullptr if the image cannot be bricked
+ */
+std::unique_ptr< imageio::ImageCpuRecord > generateBrickedImageCpuRecord(
+        const imageio::ImageProbe& probe,
+        const std::string& brickFileName );
+
+
 std::unique_ptr<ImageColorMap> loadImageColorMapWithQt( const std::string& path );
 
 
@@ -64,6 +94,29 @@ std::unique_ptr<MeshCpuRecord> generateIsoSurfaceMeshCpuRecord(
         const double isoValue );
 
 
+/**
+ * @brief Index the labels of a parcellation on the shared thread pool and keep the index
+ * on the record, so that per-label work need not scan the whole parcellation
+ *
+ * @param[in,out] parcelCpuRecord Parcellation
+ */
+void indexParcellationLabels( imageio::ParcellationCpuRecord& parcelCpuRecord );
+
+
+/**
+ * @brief Get the bounding box of a label's pixels from the label index of a parcellation
+ *
+ * @param[in] parcelCpuRecord Parcellation
+ * @param[in] labelIndex Label index
+ *
+ * @return Bounding box in image Pixel space, as a VTK extent { xMin, xMax, yMin, yMax, zMin, zMax };
+ * std::nullopt if the parcellation has no label index or the label has no pixels
+ */
+std::optional< std::array<int, 6> > labelBoundingBox(
+        const imageio::ParcellationCpuRecord& parcelCpuRecord,
+        const uint32_t labelIndex );
+
+
 std::unique_ptr<MeshCpuRecord> generateLabelMeshCpuRecord(
         DataManager& dataManager,
         const UID& parcelUid,
@@ -76,6 +129,24 @@ std::optional<UID> generateLabelMeshRecord(
         const uint32_t labelIndex );
 
 
+/**
+ * @brief Create the GPU record of a label mesh and load the mesh into a DataManager instance.
+ * This must be called with an OpenGL context current.
+ *
+ * @param[in] dataManager DataManager instance
+ * @param[in] parcelUid UID of the parcellation of the label
+ * @param[in] labelIndex Label index of the mesh
+ * @param[in] meshCpuRecord CPU record of the mesh
+ *
+ * @return UID of the loaded mesh; std::nullopt if it could not be loaded
+ */
+std::optional<UID> insertLabelMeshRecord(
+        DataManager& dataManager,
+        const UID& parcelUid,
+        const uint32_t labelIndex,
+        std::unique_ptr<MeshCpuRecord> meshCpuRecord );
+
+
 std::unique_ptr< imageio::ParcellationCpuRecord >
 generateDefaultParcellationCpuRecord( DataManager& dataManager, const UID& imageUid );
 
@@ -92,7 +163,22 @@ generateDefaultParcellationCpuRecord( DataManager& dataManager, const UID& image
 std::optional<UID> createBlankParcellation( DataManager& dataManager, const UID& imageUid );
 
 
-std::unique_ptr<slideio::SlideCpuRecord> generateSlideCpuRecord( const std::string& filename );
+/**
+ * @brief Generate a slide record from file
+ *
+ * @param[in] filename Slide file name
+ * @param[in] tileCache Cache of tiles shared among all slides
+ * @param[in] diskCache Cache on disk of decoded slide data; may be nullptr
+ * @param[in] decode If true, the slide's pixel data is decoded before returning. Otherwise,
+ * the record holds placeholder data until decoded data is applied to it.
+ *
+ * @return Slide record; nullptr on failure
+ */
+std::unique_ptr<slideio::SlideCpuRecord> generateSlideCpuRecord(
+        const std::string& filename,
+        std::shared_ptr<slideio::SlideTileCache> tileCache,
+        const slideio::SlideDiskCache* diskCache,
+        bool decode );
 
 } // namespace details
 
@@ -9,6 +9,7 @@
 #include "logic/camera/Camera.h"
 #include "logic/records/ImageRecord.h"
 #include "logic/records/LabelTableRecord.h"
+#include "logic/records/ParcellationRecord.h"
 #include "logic/records/SlideRecord.h"
 #include "logic/serialization/ProjectSerialization.h"
 
@@ -28,7 +29,11 @@
 
 #include "imageio/util/MathFuncs.hpp"
 #include "imageio/HZeeTypes.hpp"
+#include "imageio/ImageSampler.h"
+#include "imageio/VolumePyramid.h"
+#include "slideio/SlideDecodeService.h"
 #include "slideio/SlideHelper.h"
+#include "slideio/SlideReading.h"
 
 #include "rendering/computers/Polygonizer.h"
 #include "rendering/utility/math/MathUtility.h"
@@ -42,9 +47,13 @@
 
 #include <boost/format.hpp>
 
+#include <QCoreApplication>
 #include <QOpenGLContext>
 #include <QOpenGLWidget>
+#include <QProgressDialog>
 
+#include <chrono>
+#include <mutex>
 #include <optional>
 #include <sstream>
 
@@ -55,9 +64,42 @@ namespace
 static const std::string sk_glContextErrorMsg(
         "The global shared OpenGL context could not be made current." );
 
+// Number of slides above and below the active slide whose tiles are prefetched
+static constexpr size_t sk_numPrefetchedNeighbourSlides = 1;
+
+
+/// Get the CPU and GPU data of an image or parcellation record. The data keep the record alive.
+std::pair< std::shared_ptr<imageio::ImageCpuRecord>, std::shared_ptr<ImageGpuRecord> >
+imageRecordData( DataManager& dataManager, const UID& uid )
+{
+    if ( auto record = dataManager.imageRecord( uid ).lock() )
+    {
+        return { std::shared_ptr<imageio::ImageCpuRecord>( record, record->cpuData() ),
+                 std::shared_ptr<ImageGpuRecord>( record, record->gpuData() ) };
+    }
+
+    if ( auto record = dataManager.parcellationRecord( uid ).lock() )
+    {
+        return { std::shared_ptr<imageio::ImageCpuRecord>( record, record->cpuData() ),
+                 std::shared_ptr<ImageGpuRecord>( record, record->gpuData() ) };
+    }
+
+    return { nullptr, nullptr };
+}
+
 } // anonymous
 
 
+/// Callbacks that run on worker threads lock the mutex of the guard while they refer to the
+/// manager, and do nothing once the guard is revoked. Since the manager revokes the guard
+/// under the mutex before it is destroyed, no callback refers to a destroyed manager.
+struct ActionManager::CallbackGuard
+{
+    std::mutex m_mutex;
+    bool m_revoked = false;
+};
+
+
 ActionManager::ActionManager(
         GetterType<view_type_range_t> viewUidAndTypeProvider,
         ShaderProgramActivatorType shaderProgramActivator,
@@ -68,6 +110,9 @@ ActionManager::ActionManager(
         InteractionManager& interactionManager )
     :
       m_globalContext( QOpenGLContext::globalShareContext() ),
+      m_slideTileUpdatePending( false ),
+      m_imageSamplers(),
+      m_callbackGuard( std::make_shared<CallbackGuard>() ),
 
       m_viewUidAndTypeProvider( viewUidAndTypeProvider ),
       m_shaderProgramActivator( shaderProgramActivator ),
@@ -94,9 +139,48 @@ ActionManager::ActionManager(
     // We could also use the default format QSurfaceFormat::defaultFormat()
     m_surface.setFormat( m_globalContext->format() );
     m_surface.create();
+
+    // Prioritize decoding of slides nearest to the active one and of regions nearest to the crosshairs
+    if ( auto service = m_dataManager.slideDecodeService() )
+    {
+        service->setPriorityFunction( [this, guard = m_callbackGuard]
+                                      ( const slideio::SlideDecodeService::JobRegion& region )
+        {
+            std::lock_guard<std::mutex> lock( guard->m_mutex );
+
+            if ( guard->m_revoked )
+            {
+                return slideio::SlideDecodePriority();
+            }
+
+            const glm::vec3 worldCenter = ( m_crosshairsFrameProvider )
+                    ? m_crosshairsFrameProvider().worldOrigin() : glm::vec3{ 0.0f };
+
+            const glm::mat4 world_O_stack = ( m_slideStackFrameProvider )
+                    ? m_slideStackFrameProvider().world_O_frame() : glm::mat4{ 1.0f };
+
+            return data::slideDecodePriority( m_dataManager, region, worldCenter, world_O_stack );
+        } );
+    }
 }
 
-ActionManager::~ActionManager() = default;
+ActionManager::~ActionManager()
+{
+    // Wait for the callbacks that are running on worker threads,
+    // and keep those that run from here on from referring to this manager
+    {
+        std::lock_guard<std::mutex> lock( m_callbackGuard->m_mutex );
+        m_callbackGuard->m_revoked = true;
+    }
+
+    // Jobs submitted from here on can no longer be prioritized,
+    // and decoded data can no longer be applied
+    if ( auto service = m_dataManager.slideDecodeService() )
+    {
+        service->setPriorityFunction( nullptr );
+        service->cancelAll();
+    }
+}
 
 
 void ActionManager::setSlideStackFrameProvider( GetterType<CoordinateFrame> provider )
@@ -125,9 +209,6 @@ void ActionManager::setCrosshairsFrameChangeDoneBroadcaster(
 /// @todo This should be done by pull when ever update occurs
 void ActionManager::updateWorldPositionStatus()
 {
-    static constexpr uint32_t sk_compIndex = 0;
-    static const glm::u64vec3 sk_minIndex( 0 );
-
     if ( ! m_crosshairsFrameProvider )
     {
         return;
@@ -147,28 +228,40 @@ void ActionManager::updateWorldPositionStatus()
     // double precision floating point. If the world position is not inside the image domain,
     // then std::nullopt is returned.
 
-    auto getImagePixelValue = [ &worldPos ] ( const imageio::ImageCpuRecord& record )
-            -> std::optional<double>
+    auto getImagePixelValue = [this, &getImageSubjectPosition]
+            ( const UID& uid, const imageio::ImageCpuRecord& record ) -> std::optional<double>
     {
-        const glm::vec4 pixelPos4 = record.transformations().pixel_O_world() * worldPos;
-        const glm::vec3 pixelPos{ pixelPos4 / pixelPos4.w };
-
-        const glm::u64vec3 pixelIndex = glm::round( pixelPos );
-
-        if ( glm::all( glm::greaterThanEqual( pixelIndex, sk_minIndex ) ) &&
-             glm::all( glm::lessThan( pixelIndex, record.header().m_pixelDimensions ) ) )
+        const imageio::ImageSampler* sampler = imageSampler( uid, record );
+        if ( ! sampler )
         {
-            // Position is inside the image
-            double value;
-            if ( bool retrieved = record.pixelValue( sk_compIndex, pixelIndex, value ) )
-            {
-                return value;
-            }
+            return std::nullopt;
         }
 
-        return std::nullopt;
+        return sampler->sample( getImageSubjectPosition( record ),
+                                imageio::ImageSampler::InterpolationMode::NearestNeighbor );
+    };
+
+    auto formatImageValue = [] ( const imageio::ImageCpuRecord& record, double value )
+    {
+        auto format = ( imageio::isIntegerType( record.header().m_componentType ) )
+                ? boost::format( "%d" ) : boost::format( "%.6f" );
+        return ( format % value ).str();
     };
 
+    // Drop the samplers of records that have been unloaded
+    for ( auto it = std::begin( m_imageSamplers ); it != std::end( m_imageSamplers ); )
+    {
+        if ( m_dataManager.imageRecord( it->first ).expired() &&
+             m_dataManager.parcellationRecord( it->first ).expired() )
+        {
+            it = m_imageSamplers.erase( it );
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
 
     std::ostringstream ssPosition;
     std::ostringstream ssImageValue;
@@ -184,6 +277,9 @@ void ActionManager::updateWorldPositionStatus()
 
     do
     {
+        auto imageUid = m_dataManager.activeImageUid();
+        if ( ! imageUid ) break;
+
         auto imageRecord = m_dataManager.activeImageRecord().lock();
         if ( ! imageRecord ) break;
 
@@ -199,15 +295,34 @@ void ActionManager::updateWorldPositionStatus()
         ssPosition << boost::format( "(%.3f, %.3f, %.3f) mm, " )
                       % subjectPos.x % subjectPos.y % subjectPos.z;
 
-        auto imageValue = getImagePixelValue( *imageCpuRecord );
+        auto imageValue = getImagePixelValue( *imageUid, *imageCpuRecord );
         if ( ! imageValue ) break;
 
-        auto format = ( imageio::isIntegerType( imageCpuRecord->header().m_componentType ) )
-                ? boost::format( "Image: %d, " )
-                : boost::format( "Image: %.6f, " );
-
         ssImageValue.str( std::string() );
-        ssImageValue << format % (*imageValue);
+        ssImageValue << "Image: " << formatImageValue( *imageCpuRecord, *imageValue );
+
+        // Also show the values of the other images, identified by their order
+        std::ostringstream ssOtherValues;
+
+        for ( long i = 0; auto uid = m_dataManager.orderedImageUid( i ); ++i )
+        {
+            if ( *uid == *imageUid ) continue;
+
+            auto otherRecord = m_dataManager.imageRecord( *uid ).lock();
+            if ( ! otherRecord || ! otherRecord->cpuData() ) continue;
+
+            const auto otherValue = getImagePixelValue( *uid, *otherRecord->cpuData() );
+
+            ssOtherValues << ( ssOtherValues.tellp() > 0 ? ", " : "" ) << "image " << ( i + 1 ) << ": "
+                          << ( otherValue ? formatImageValue( *otherRecord->cpuData(), *otherValue ) : "<N/A>" );
+        }
+
+        if ( ssOtherValues.tellp() > 0 )
+        {
+            ssImageValue << " (" << ssOtherValues.str() << ")";
+        }
+
+        ssImageValue << ", ";
 
         break;
     } while( 1 );
@@ -234,7 +349,7 @@ void ActionManager::updateWorldPositionStatus()
         if ( ! labelTableCpuRecord ) break;
 
         // Parcellation stores the index into a map of label values
-        auto labelIndexAsDouble = getImagePixelValue( *parcelCpuRecord );
+        auto labelIndexAsDouble = getImagePixelValue( *parcelUid, *parcelCpuRecord );
         if ( ! labelIndexAsDouble ) break;
 
         // Since image pixel values are generically returned as double,
@@ -261,6 +376,35 @@ void ActionManager::updateWorldPositionStatus()
 }
 
 
+const imageio::ImageSampler* ActionManager::imageSampler(
+        const UID& uid, const imageio::ImageCpuRecord& record )
+{
+    static constexpr uint32_t sk_compIndex = 0;
+
+    auto it = m_imageSamplers.find( uid );
+
+    if ( std::end( m_imageSamplers ) != it && it->second.samples( record, sk_compIndex ) )
+    {
+        return &it->second;
+    }
+
+    // The record is new or has changed
+    if ( std::end( m_imageSamplers ) != it )
+    {
+        m_imageSamplers.erase( it );
+    }
+
+    auto sampler = imageio::ImageSampler::create( record, sk_compIndex );
+
+    if ( ! sampler )
+    {
+        return nullptr;
+    }
+
+    return &m_imageSamplers.emplace( uid, std::move( *sampler ) ).first->second;
+}
+
+
 /// @todo Enable objectID rendering in renderers when in pointer mode
 /// @todo Disable objectID rendering in renderers when not in pointer mode
 
@@ -494,6 +638,8 @@ std::optional<UID> ActionManager::loadImage(
             // Update the assemblies
             updateImageSliceAssembly();
             m_guiManager.updateAllViewWidgets();
+
+            uploadImageLevels( *imageUid );
         }
         else
         {
@@ -526,6 +672,8 @@ std::optional<UID> ActionManager::loadParcellation(
             // Update the assemblies
             updateImageSliceAssembly();
             m_guiManager.updateAllViewWidgets();
+
+            uploadImageLevels( *parcelUid );
         }
         else
         {
@@ -551,10 +699,11 @@ std::optional<UID> ActionManager::loadSlide(
 
     if ( m_globalContext->makeCurrent( &m_surface ) )
     {
-        slideUid = data::loadSlide( m_dataManager, filename, translateToTopOfStack );
+        slideUid = data::loadSlide( m_dataManager, filename, translateToTopOfStack, slideDecodedHandler() );
 
         if ( slideUid )
         {
+            loadSlideAssociatedImagesInBackground( *slideUid );
             std::cout << "Loaded slide " << *slideUid << std::endl;
 
             updateSlideStackAssembly();
@@ -576,6 +725,301 @@ std::optional<UID> ActionManager::loadSlide(
 }
 
 
+ActionManager::LoadedProjectFiles
+ActionManager::loadProjectFiles( const serialize::HZeeProject& project )
+{
+    using clock = std::chrono::steady_clock;
+
+    const auto start = clock::now();
+
+    // Slides are decoded in the background if there is a decoding service
+    const bool decodeSlides = ( nullptr == m_dataManager.slideDecodeService() );
+
+    // Read files into CPU records concurrently. This does not require the OpenGL context.
+    data::ProjectCpuRecords records = data::readProjectFiles(
+                project, m_dataManager.slideTileCache(), m_dataManager.slideDiskCache(),
+                m_dataManager.brickDirectory(), decodeSlides );
+
+    LoadedProjectFiles loaded;
+    loaded.m_refImages.resize( project.m_refImages.size() );
+    loaded.m_parcellations.resize( project.m_parcellations.size() );
+    loaded.m_slides.resize( project.m_slides.size() );
+
+    if ( ! m_globalContext->makeCurrent( &m_surface ) )
+    {
+        throw_debug( sk_glContextErrorMsg )
+    }
+
+    // Create GPU records and insert records into DataManager serially, in project order
+    auto timeLoad = [&records] ( size_t t, const std::function< std::optional<UID> () >& load )
+    {
+        const auto loadStart = clock::now();
+        const std::optional<UID> uid = load();
+
+        records.m_timings[t].m_gpuSeconds = std::chrono::duration<double>( clock::now() - loadStart ).count();
+        records.m_timings[t].m_loaded = uid.has_value();
+        return uid;
+    };
+
+    size_t t = 0;
+
+    for ( size_t i = 0; i < project.m_refImages.size(); ++i, ++t )
+    {
+        loaded.m_refImages[i] = timeLoad( t, [&] () {
+            return data::loadImage( m_dataManager, std::move( records.m_refImages[i] ),
+                                    project.m_refImages[i].m_fileName ); } );
+    }
+
+    for ( size_t i = 0; i < project.m_parcellations.size(); ++i, ++t )
+    {
+        loaded.m_parcellations[i] = timeLoad( t, [&] () {
+            return data::loadParcellation( m_dataManager, std::move( records.m_parcellations[i] ),
+                                           project.m_parcellations[i].m_fileName ); } );
+    }
+
+    for ( size_t i = 0; i < project.m_slides.size(); ++i, ++t )
+    {
+        loaded.m_slides[i] = timeLoad( t, [&] () {
+            return data::loadSlide( m_dataManager, std::move( records.m_slides[i] ),
+                                    project.m_slides[i].m_slideStack_T_slide.autoTranslateToTopOfStack(),
+                                    slideDecodedHandler() ); } );
+    }
+
+    for ( const auto& slideUid : loaded.m_slides )
+    {
+        if ( slideUid )
+        {
+            loadSlideAssociatedImagesInBackground( *slideUid );
+        }
+    }
+
+    updateImageSliceAssembly();
+    updateSlideStackAssembly();
+    m_guiManager.updateAllViewWidgets();
+
+    m_globalContext->doneCurrent();
+
+    for ( const auto& imageUid : loaded.m_refImages )
+    {
+        if ( imageUid )
+        {
+            uploadImageLevels( *imageUid );
+        }
+    }
+
+    for ( const auto& parcelUid : loaded.m_parcellations )
+    {
+        if ( parcelUid )
+        {
+            uploadImageLevels( *parcelUid );
+        }
+    }
+
+    data::printLoadTimings( records.m_timings,
+                            std::chrono::duration<double>( clock::now() - start ).count() );
+
+    return loaded;
+}
+
+
+void ActionManager::updateSlideDecoding()
+{
+    auto service = m_dataManager.slideDecodeService();
+
+    if ( ! service || ! m_crosshairsFrameProvider || ! m_slideStackFrameProvider )
+    {
+        return;
+    }
+
+    service->reprioritize();
+
+    data::prefetchSlideTiles( m_dataManager,
+                              m_crosshairsFrameProvider().worldOrigin(),
+                              m_slideStackFrameProvider().world_O_frame(),
+                              sk_numPrefetchedNeighbourSlides );
+}
+
+
+void ActionManager::requestSlideTiles(
+        const UID& slideUid, int level, const std::vector< glm::i64vec2 >& tileIndices )
+{
+    auto service = m_dataManager.slideDecodeService();
+    auto slideRecord = m_dataManager.slideRecord( slideUid ).lock();
+
+    if ( ! service || ! slideRecord || ! slideRecord->cpuData() )
+    {
+        return;
+    }
+
+    // Update the views once tiles have been read, so that they are made resident in the
+    // tile atlas. Updates for tiles that are read in quick succession are coalesced.
+    auto onTileRead = [this, guard = m_callbackGuard] ( int /*level*/, const glm::i64vec2& /*tileIndex*/ )
+    {
+        std::lock_guard<std::mutex> lock( guard->m_mutex );
+
+        if ( ! guard->m_revoked && ! m_slideTileUpdatePending.exchange( true ) )
+        {
+            QMetaObject::invokeMethod( &m_slideDecodeContext, [this] ()
+            {
+                m_slideTileUpdatePending = false;
+                m_guiManager.updateAllViewWidgets();
+            },
+            Qt::QueuedConnection );
+        }
+    };
+
+    service->prefetchTiles( slideUid, slideRecord->cpuData()->tileReader(), level, tileIndices, onTileRead );
+}
+
+
+void ActionManager::uploadImageLevels( const UID& imageUid )
+{
+    QMetaObject::invokeMethod( &m_slideDecodeContext, [this, imageUid] ()
+    {
+        auto [cpuData, gpuData] = imageRecordData( m_dataManager, imageUid );
+
+        if ( ! cpuData || ! gpuData || ! gpuData->hasPendingLevels() )
+        {
+            return;
+        }
+
+        if ( ! m_globalContext->makeCurrent( &m_surface ) )
+        {
+            throw_debug( sk_glContextErrorMsg )
+        }
+
+        const bool uploaded = gpuData->uploadNextChunk();
+
+        m_globalContext->doneCurrent();
+
+        if ( uploaded && ! gpuData->uploadingLevel() )
+        {
+            // A level has been completed, so the views can show it
+            m_guiManager.updateAllViewWidgets();
+        }
+
+        if ( ! gpuData->hasPendingLevels() )
+        {
+            // All levels are held in textures, so the pixels of the pyramid levels are freed.
+            // Their dimensions are kept for selecting the level to display.
+            for ( uint32_t c = 0; c < cpuData->header().m_numComponents; ++c )
+            {
+                if ( auto pyramid = cpuData->pyramid( c ) )
+                {
+                    cpuData->setPyramid( c, pyramid->withoutPixels() );
+                }
+            }
+        }
+
+        // Post the next chunk, so that GUI events are processed before it is uploaded
+        uploadImageLevels( imageUid );
+    },
+    Qt::QueuedConnection );
+}
+
+
+void ActionManager::applyDecodedSlide(
+        const UID& slideUid, std::shared_ptr<slideio::DecodedSlideData> decoded )
+{
+    if ( ! decoded )
+    {
+        return;
+    }
+
+    if ( m_globalContext->makeCurrent( &m_surface ) )
+    {
+        if ( data::applyDecodedSlide( m_dataManager, slideUid, std::move( *decoded ) ) )
+        {
+            std::cout << "Decoded slide " << slideUid << std::endl;
+            m_guiManager.updateAllViewWidgets();
+        }
+
+        m_globalContext->doneCurrent();
+    }
+    else
+    {
+        throw_debug( sk_glContextErrorMsg )
+    }
+}
+
+
+std::function< void ( const UID&, std::shared_ptr<slideio::DecodedSlideData> ) >
+ActionManager::slideDecodedHandler()
+{
+    // Post slide data decoded on a worker thread to the GUI thread
+    return [this, guard = m_callbackGuard] ( const UID& uid, std::shared_ptr<slideio::DecodedSlideData> decoded )
+    {
+        std::lock_guard<std::mutex> lock( guard->m_mutex );
+
+        if ( guard->m_revoked )
+        {
+            return;
+        }
+
+        // Calls posted to the context object are discarded if it is destroyed before they run
+        QMetaObject::invokeMethod( &m_slideDecodeContext,
+                                   [this, uid, decoded] () { applyDecodedSlide( uid, decoded ); },
+                                   Qt::QueuedConnection );
+    };
+}
+
+
+void ActionManager::loadSlideAssociatedImagesInBackground( const UID& slideUid )
+{
+    auto service = m_dataManager.slideDecodeService();
+    auto record = m_dataManager.slideRecord( slideUid ).lock();
+
+    if ( ! service || ! record || ! record->cpuData() )
+    {
+        // Without a decoding service, images are read when first requested
+        return;
+    }
+
+    slideio::SlideCpuRecord* cpuRecord = record->cpuData();
+
+    const slideio::SlideDecodeService::JobRegion region{
+        slideUid, 0.5 * glm::dvec2( cpuRecord->fileLevel( 0 ).m_dims ) };
+
+    // The handler is held by the slide record, so it must not keep the service or reader alive
+    std::weak_ptr<slideio::SlideDecodeService> weakService = service;
+    std::weak_ptr<slideio::SlideTileReader> weakReader = cpuRecord->tileReader();
+
+    cpuRecord->header().associatedImages().setLoadRequestHandler(
+                [this, guard = m_callbackGuard, weakService, weakReader, region]
+                ( std::function< bool () > loadTask )
+    {
+        auto service = weakService.lock();
+        auto reader = weakReader.lock();
+
+        if ( ! service || ! reader )
+        {
+            return;
+        }
+
+        service->submit( region, reader, [this, guard, uid = region.m_slideUid, loadTask]
+                         ( slideio::SlideTileReader& /*reader*/, openslide_t* /*handle*/ )
+        {
+            if ( ! loadTask() )
+            {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock( guard->m_mutex );
+
+            if ( guard->m_revoked )
+            {
+                return;
+            }
+
+            // Show the loaded images
+            QMetaObject::invokeMethod( &m_slideDecodeContext,
+                                       [this, uid] () { m_dataManager.notifySlideDataChanged( uid ); },
+                                       Qt::QueuedConnection );
+        } );
+    } );
+}
+
+
 void ActionManager::saveProject( const std::optional< std::string >& newFileName )
 {
     // Update image and slide data in project:
@@ -637,7 +1081,35 @@ void ActionManager::generateLabelMeshes()
             return;
         }
 
-        const auto generatedUids = data::generateAllLabelMeshes( m_dataManager, *parcelUid );
+        QProgressDialog progressDialog( "Generating label meshes...", "Cancel", 0, 0 );
+        progressDialog.setWindowModality( Qt::ApplicationModal );
+
+        auto progressHandler = [this, &progressDialog] ( size_t numDone, size_t numSteps )
+        {
+            progressDialog.setMaximum( static_cast<int>( numSteps ) );
+
+            if ( progressDialog.value() != static_cast<int>( numDone ) )
+            {
+                progressDialog.setValue( static_cast<int>( numDone ) );
+            }
+            else
+            {
+                // The dialog does not process events when its value is unchanged, so process
+                // them here for the Cancel button to respond while the labels are meshed
+                QCoreApplication::processEvents();
+            }
+
+            // Processing events may make the context of another widget current
+            // before the next mesh is loaded
+            m_globalContext->makeCurrent( &m_surface );
+
+            return ! progressDialog.wasCanceled();
+        };
+
+        const auto generatedUids = data::generateAllLabelMeshes(
+                    m_dataManager, *parcelUid, progressHandler, 0, m_dataManager.labelMeshMethod() );
+
+        progressDialog.reset();
 
         if ( ! generatedUids.empty() )
         {
@@ -6,13 +6,20 @@
 #include "common/PublicTypes.h"
 #include "rendering/common/ShaderProviderType.h"
 
+#include "imageio/ImageSampler.h"
+
 #include <glm/fwd.hpp>
 
+#include <QObject>
 #include <QOffscreenSurface>
 
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 
 class AssemblyManager;
@@ -22,6 +29,16 @@ class GuiManager;
 class InteractionManager;
 class QOpenGLContext;
 
+namespace serialize
+{
+struct HZeeProject;
+}
+
+namespace slideio
+{
+struct DecodedSlideData;
+}
+
 
 /**
  * @brief Handles high-level application actions.
@@ -47,6 +64,16 @@ public:
     ~ActionManager();
 
 
+    /// UIDs of the files of a project that were loaded, in the order of the files in the
+    /// project. Files that could not be loaded have no UID.
+    struct LoadedProjectFiles
+    {
+        std::vector< std::optional<UID> > m_refImages;
+        std::vector< std::optional<UID> > m_parcellations;
+        std::vector< std::optional<UID> > m_slides;
+    };
+
+
     void setSlideStackFrameProvider( GetterType<CoordinateFrame> );
     void setCrosshairsFrameProvider( GetterType<CoordinateFrame> );
 
@@ -90,11 +117,30 @@ public:
             const std::string& filename,
             const std::optional< std::string >& dicomSeriesUid );
 
-    /// Load a slide image from disk and set it as the active slide
+    /// Load a slide image from disk and set it as the active slide. The slide is shown with
+    /// placeholder data until its data are decoded in the background.
     std::optional<UID> loadSlide(
             const std::string& filename,
             bool translateToTopOfStack );
 
+    /// Load the reference images, parcellations, and slides of a project. The files are read
+    /// concurrently on worker threads, so that loading takes about as long as the slowest file.
+    /// GPU records are then created serially on this thread, in the order of the project files.
+    /// A report of the time spent loading each file is printed.
+    LoadedProjectFiles loadProjectFiles( const serialize::HZeeProject& project );
+
+    /// Recompute priorities of background slide decoding and prefetch tiles around the
+    /// crosshairs for the active slide and its neighbours. Call this when the active slide
+    /// or crosshairs change.
+    void updateSlideDecoding();
+
+    /// Read tiles of a slide level in the background, so that they can be rendered from the
+    /// tile atlas. The views are updated as the tiles arrive.
+    /// @param slideUid UID of the slide record
+    /// @param level File level
+    /// @param tileIndices Tile (column, row) indices within the level
+    void requestSlideTiles( const UID& slideUid, int level, const std::vector< glm::i64vec2 >& tileIndices );
+
     /// Save project back to disk
     /// @param[in] newFileName Optional new file name. If not provided, then the project is saved
     /// to the same file that it was loaded from.
@@ -103,7 +149,8 @@ public:
     /// Generate an iso-surface mesh for the active image
     void generateIsoSurfaceMesh( double isoValue );
 
-    /// Generate label surface meshes for the active parcellation
+    /// Generate label surface meshes for the active parcellation. Progress is shown in a
+    /// dialog, from which generation can be canceled.
     void generateLabelMeshes();
 
     /// These are convenience functions that update Assemblies based on the latest data in DataManager
@@ -124,12 +171,50 @@ public:
 
 private:
 
+    /// Upload the remaining resolution levels of an image or parcellation texture, from coarse to
+    /// fine. One slab of a level is uploaded per pass through the GUI event loop, so that the GUI
+    /// stays responsive while large levels are uploaded. The views are updated after each level
+    /// is completed, so that the image is shown at its coarsest level first and then sharpens.
+    void uploadImageLevels( const UID& imageUid );
+
+    /// Apply slide data decoded in the background. Must be called on the GUI thread.
+    void applyDecodedSlide( const UID& slideUid, std::shared_ptr<slideio::DecodedSlideData> decoded );
+
+    /// Get a handler that posts slide data decoded on a worker thread to the GUI thread
+    std::function< void ( const UID&, std::shared_ptr<slideio::DecodedSlideData> ) > slideDecodedHandler();
+
+    /// Read the associated images of a slide on the decoding workers when they are first requested,
+    /// rather than on the GUI thread. The slide's data is marked changed once they are read.
+    void loadSlideAssociatedImagesInBackground( const UID& slideUid );
+
+    /// Get the sampler of the first component of an image or parcellation record. Samplers are
+    /// kept per record and recreated only when the record's buffer or pixel space changes.
+    /// @return Sampler; nullptr if the component cannot be sampled
+    const imageio::ImageSampler* imageSampler( const UID& uid, const imageio::ImageCpuRecord& record );
+
+    /// Guard of the callbacks that worker threads call back into this manager
+    struct CallbackGuard;
+
     /// @todo If we pass textures to Mesh(), then addMesh() in updateMeshAssembly() shouldn't
     /// need an OpenGL context any more. These blank meshes should live in AssemblyManager.
 
     QOpenGLContext* m_globalContext;
     QOffscreenSurface m_surface;
 
+    /// Context object of slide data decoded in the background and of image levels to upload
+    /// that are posted to the GUI thread
+    QObject m_slideDecodeContext;
+
+    /// Flag that a view update for newly read slide tiles has been posted to the GUI thread
+    std::atomic<bool> m_slideTileUpdatePending;
+
+    /// Samplers of the images and parcellations whose values are shown at the crosshairs
+    std::unordered_map< UID, imageio::ImageSampler > m_imageSamplers;
+
+    /// Guard shared with the callbacks of the slide decoding workers. It is revoked when this
+    /// manager is destroyed, after which the callbacks no longer refer to the manager.
+    std::shared_ptr<CallbackGuard> m_callbackGuard;
+
     GetterType<view_type_range_t> m_viewUidAndTypeProvider;
     ShaderProgramActivatorType m_shaderProgramActivator;
     UniformsProviderType m_uniformsProvider;
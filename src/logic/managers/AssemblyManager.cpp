@@ -215,6 +215,11 @@ void AssemblyManager::setActiveSlideQuerier( QuerierType<bool, UID> querier )
     m_impl->m_slideStackAssembly.setActiveSlideQuerier( querier );
 }
 
+void AssemblyManager::setSlideTileRequester( SlideTileRequesterType requester )
+{
+    m_impl->m_slideStackAssembly.setSlideTileRequester( requester );
+}
+
 void AssemblyManager::setActiveSubjectToWorldProvider(
         GetterType< std::optional<glm::mat4> > provider )
 {
@@ -16,6 +16,7 @@
 #include "rendering/common/DrawableScaling.h"
 #include "rendering/common/SceneType.h"
 #include "rendering/common/ShaderProviderType.h"
+#include "rendering/common/SlideTileRequesterType.h"
 
 #include <glm/fwd.hpp>
 
@@ -90,6 +91,10 @@ public:
     /// (Used because the active slide is rendered differently.)
     void setActiveSlideQuerier( QuerierType<bool, UID> );
 
+    /// Set the function that requests tiles of a slide to be read, so that the 2D slides
+    /// can render them from the tile atlas.
+    void setSlideTileRequester( SlideTileRequesterType );
+
     /// Set the function that provides the transformation from the active image's Subject to World space.
     void setActiveSubjectToWorldProvider( GetterType< std::optional<glm::mat4> > );
 
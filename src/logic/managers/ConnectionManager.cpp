@@ -254,6 +254,17 @@ void ConnectionManager::Impl::createActionConnections()
 
     m_actionManager.setCrosshairsFrameChangeDoneBroadcaster(
                 [this] ( const CoordinateFrame& frame) { this->handleCrosshairsChangeDone( frame ); } );
+
+    // Slides nearest to the active one are decoded first
+    m_dataManager.connectToActiveSlideChangedSignal(
+                [this] ( const UID& /*activeSlideUid*/ ) { m_actionManager.updateSlideDecoding(); } );
+
+    // Tiles of slides that are rendered from the tile atlas are read in the background
+    m_assemblyManager.setSlideTileRequester(
+                [this] ( const UID& slideUid, int level, const std::vector< glm::i64vec2 >& tileIndices )
+    {
+        m_actionManager.requestSlideTiles( slideUid, level, tileIndices );
+    } );
 }
 
 
@@ -1372,6 +1383,9 @@ void ConnectionManager::Impl::handleCrosshairsChangeDone( const CoordinateFrame&
 
     m_interactionManager.applyExtraToCameras( LinkedFrameType::Crosshairs, extra );
 
+    // Slide regions nearest to the crosshairs are decoded first
+    m_actionManager.updateSlideDecoding();
+
     // Need to update views, since change is not handled by an InteractionHandler
     m_guiManager.updateAllViewWidgets();
 }
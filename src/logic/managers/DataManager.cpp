@@ -1,6 +1,8 @@
 #include "logic/managers/DataManager.h"
 
 #include "common/HZeeException.hpp"
+#include "slideio/SlideDecodeService.h"
+#include "slideio/SlideTileCache.h"
 
 #include <glm/glm.hpp>
 
@@ -83,6 +85,13 @@ struct DataManager::Impl
         :
           m_project(),
 
+          m_slideTileCache( std::make_shared<slideio::SlideTileCache>() ),
+          m_slideDecodeService( std::make_shared<slideio::SlideDecodeService>() ),
+          m_slideDiskCache( nullptr ),
+          m_skipBackgroundSlideTiles( false ),
+          m_labelMeshMethod( LabelMeshMethod::MarchingCubes ),
+          m_brickDirectory(),
+
           m_imageRecords(),
           m_parcelRecords(),
           m_isoMeshRecords(),
@@ -130,6 +139,24 @@ struct DataManager::Impl
 
     serialize::HZeeProject m_project;
 
+    /// Cache of decoded slide tiles, which is shared by the tile readers of all slides
+    std::shared_ptr<slideio::SlideTileCache> m_slideTileCache;
+
+    /// Service that decodes slide data on background threads
+    std::shared_ptr<slideio::SlideDecodeService> m_slideDecodeService;
+
+    /// Cache on disk of decoded slide data, which persists across application runs
+    std::shared_ptr<slideio::SlideDiskCache> m_slideDiskCache;
+
+    /// Flag that slide tiles of background are filled with the background color instead of read
+    bool m_skipBackgroundSlideTiles;
+
+    /// Method of generating the surface meshes of the labels of parcellations
+    LabelMeshMethod m_labelMeshMethod;
+
+    /// Directory of the brick files of images that are stored out of core
+    std::string m_brickDirectory;
+
     std::unordered_map< UID, std::shared_ptr<ImageRecord> > m_imageRecords;
     std::unordered_map< UID, std::shared_ptr<ParcellationRecord> > m_parcelRecords;
 
@@ -304,6 +331,66 @@ serialize::HZeeProject& DataManager::project()
     return m_impl->m_project;
 }
 
+std::shared_ptr<slideio::SlideTileCache> DataManager::slideTileCache()
+{
+    if ( ! m_impl ) { throw_debug( "Null impl" ) }
+    return m_impl->m_slideTileCache;
+}
+
+std::shared_ptr<slideio::SlideDecodeService> DataManager::slideDecodeService()
+{
+    if ( ! m_impl ) { throw_debug( "Null impl" ) }
+    return m_impl->m_slideDecodeService;
+}
+
+std::shared_ptr<slideio::SlideDiskCache> DataManager::slideDiskCache()
+{
+    if ( ! m_impl ) { throw_debug( "Null impl" ) }
+    return m_impl->m_slideDiskCache;
+}
+
+void DataManager::setSlideDiskCache( std::shared_ptr<slideio::SlideDiskCache> diskCache )
+{
+    if ( ! m_impl ) { throw_debug( "Null impl" ) }
+    m_impl->m_slideDiskCache = std::move( diskCache );
+}
+
+bool DataManager::skipBackgroundSlideTiles() const
+{
+    if ( ! m_impl ) { throw_debug( "Null impl" ) }
+    return m_impl->m_skipBackgroundSlideTiles;
+}
+
+void DataManager::setSkipBackgroundSlideTiles( bool skip )
+{
+    if ( ! m_impl ) { throw_debug( "Null impl" ) }
+    m_impl->m_skipBackgroundSlideTiles = skip;
+}
+
+LabelMeshMethod DataManager::labelMeshMethod() const
+{
+    if ( ! m_impl ) { throw_debug( "Null impl" ) }
+    return m_impl->m_labelMeshMethod;
+}
+
+void DataManager::setLabelMeshMethod( const LabelMeshMethod& method )
+{
+    if ( ! m_impl ) { throw_debug( "Null impl" ) }
+    m_impl->m_labelMeshMethod = method;
+}
+
+const std::string& DataManager::brickDirectory() const
+{
+    if ( ! m_impl ) { throw_debug( "Null impl" ) }
+    return m_impl->m_brickDirectory;
+}
+
+void DataManager::setBrickDirectory( std::string directory )
+{
+    if ( ! m_impl ) { throw_debug( "Null impl" ) }
+    m_impl->m_brickDirectory = std::move( directory );
+}
+
 void DataManager::updateProject( const std::optional<std::string>& newFileName )
 {
     if ( ! m_impl ) { throw_debug( "Null impl" ) }
@@ -884,6 +971,12 @@ bool DataManager::unloadSlide( const UID& slideUid )
         setActiveSlideIndex( newActiveIndex );
     }
 
+    // Drop pending decoding jobs of the slide
+    if ( m_impl->m_slideDecodeService )
+    {
+        m_impl->m_slideDecodeService->cancel( slideUid );
+    }
+
     if ( m_impl->m_slideRecords.erase( slideUid ) > 0 )
     {
         m_impl->m_orderedSlideUids.remove( slideUid );
@@ -1234,6 +1327,19 @@ bool DataManager::setActiveSlideUid( const UID& uid )
     {
         if ( m_impl->m_activeSlideUid != uid )
         {
+            // Only the active slide shows its macro and label images, so release the
+            // pixels of the previous active slide's images. They are read again on demand.
+            if ( m_impl->m_activeSlideUid )
+            {
+                auto prevIt = m_impl->m_slideRecords.find( *m_impl->m_activeSlideUid );
+
+                if ( std::end( m_impl->m_slideRecords ) != prevIt && prevIt->second &&
+                     prevIt->second->cpuData() )
+                {
+                    prevIt->second->cpuData()->header().associatedImages().releaseImages();
+                }
+            }
+
             m_impl->m_activeSlideUid = uid;
             m_impl->m_signalActiveSlideChanged( uid );
             m_impl->m_signalSlideDataChanged( uid );
@@ -1303,6 +1409,16 @@ bool DataManager::setSlideOrder( const std::list<UID>& orderedSlideUids )
     return false;
 }
 
+void DataManager::notifySlideDataChanged( const UID& slideUid )
+{
+    if ( ! m_impl ) { throw_debug( "Null impl" ) }
+
+    if ( std::end( m_impl->m_slideRecords ) != m_impl->m_slideRecords.find( slideUid ) )
+    {
+        m_impl->m_signalSlideDataChanged( slideUid );
+    }
+}
+
 std::optional<UID> DataManager::defaultParcellationUid_of_image( const UID& imageUid ) const
 {
     if ( ! m_impl ) { throw_debug( "Null impl" ) }
@@ -13,6 +13,8 @@
 #include "logic/records/SlideAnnotationRecord.h"
 #include "logic/records/SlideRecord.h"
 
+#include "mesh/MeshTypes.h"
+
 #include <boost/range/any_range.hpp>
 
 #include <map>
@@ -24,6 +26,14 @@
 #include <vector>
 
 
+namespace slideio
+{
+class SlideDecodeService;
+class SlideDiskCache;
+class SlideTileCache;
+}
+
+
 /**
  * @brief This class owns the data for images, parcellations, label meshes,
  * iso-surface meshes, slides, image color maps, and parcellation label tables.
@@ -63,6 +73,39 @@ public:
     void updateProject( const std::optional< std::string >& newFileName );
 
 
+    /// Get the cache of decoded tiles that is shared by all slides
+    std::shared_ptr<slideio::SlideTileCache> slideTileCache();
+
+    /// Get the service that decodes slide data on background threads
+    std::shared_ptr<slideio::SlideDecodeService> slideDecodeService();
+
+    /// Get the cache on disk of decoded slide data; nullptr if there is no cache
+    std::shared_ptr<slideio::SlideDiskCache> slideDiskCache();
+
+    /// Set the cache on disk of decoded slide data
+    void setSlideDiskCache( std::shared_ptr<slideio::SlideDiskCache> );
+
+    /// Get whether the tile readers of slides skip tiles that are background
+    /// (see \c slideio::SlideTileReader::setSkipBackgroundTiles)
+    bool skipBackgroundSlideTiles() const;
+
+    /// Set whether the tile readers of slides loaded hereafter skip tiles that are background
+    void setSkipBackgroundSlideTiles( bool skip );
+
+    /// Get the method of generating the surface meshes of the labels of parcellations
+    LabelMeshMethod labelMeshMethod() const;
+
+    /// Set the method of generating the surface meshes of the labels of parcellations
+    void setLabelMeshMethod( const LabelMeshMethod& method );
+
+    /// Get the directory of the brick files of images that are too large for memory;
+    /// empty if such images are read into memory
+    const std::string& brickDirectory() const;
+
+    /// Set the directory of the brick files of images loaded hereafter that are too large for memory
+    void setBrickDirectory( std::string directory );
+
+
     /// Insert an image record and return its assigned UID.
     std::optional<UID> insertImageRecord( std::shared_ptr<ImageRecord> );
 
@@ -135,6 +178,10 @@ public:
     /// Set the ordering of slides. Return true iff successful.
     bool setSlideOrder( const std::list<UID>& orderedSlideUids );
 
+    /// Signal that the data of a slide has changed outside of DataManager,
+    /// e.g. after its pixel data was decoded in the background
+    void notifySlideDataChanged( const UID& slideUid );
+
 
     /// Get the "active" image, which is currently being manipulated (i.e. transformed, window-leveled,
     /// highlighted) by user. This image also defines the coordinate system of the views.
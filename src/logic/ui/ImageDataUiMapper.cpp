@@ -596,15 +596,8 @@ void ImageDataUiMapper::Impl::updateAppFromUi( const gui::ImagePropertiesPartial
 
         if ( auto gpuRecord = activeImageRecord->gpuData() )
         {
-            if ( auto texture = gpuRecord->texture().lock() )
-            {
-                texture->setMinificationFilter( minFilter );
-                texture->setMagnificationFilter( magFilter );
-            }
-            else
-            {
-                std::cerr << "Null GPU image texture" << std::endl;
-            }
+            // Filters apply to all resolution levels of the image
+            gpuRecord->setFilters( minFilter, magFilter );
         }
         else
         {
@@ -787,8 +780,7 @@ ImageDataUiMapper::Impl::getActiveImageProperties() const
     }
 
     auto imageRecord = m_dataManager.imageRecord( *activeImageUid ).lock();
-    if ( ! imageRecord || ! imageRecord->cpuData() ||
-         ! imageRecord->cpuData()->imageBaseData() )
+    if ( ! imageRecord || ! imageRecord->cpuData() )
     {
         return std::nullopt;
     }
@@ -800,7 +792,7 @@ ImageDataUiMapper::Impl::getActiveImageProperties() const
     gui::ImagePropertiesComplete_msgToUi msg;
     msg.m_imageUid = *activeImageUid;
 
-    msg.m_properties.m_path = cpuRecord->imageBaseData()->imageIOInfo().m_fileInfo.m_fileName;
+    msg.m_properties.m_path = cpuRecord->header().m_fileName;
     msg.m_properties.m_displayName = settings.displayName();
 
     /// @note The \c m_fileType property is not correctly set by ITK.
@@ -816,8 +808,7 @@ ImageDataUiMapper::Impl::getActiveImageProperties() const
     }
 #endif
 
-    msg.m_properties.m_loadedFromFile = boost::filesystem::exists(
-                cpuRecord->imageBaseData()->imageIOInfo().m_fileInfo.m_fileName );
+    msg.m_properties.m_loadedFromFile = boost::filesystem::exists( cpuRecord->header().m_fileName );
 
 
     std::optional<UID> colorMapUid = m_dataManager.imageColorMapUid_of_image( *activeImageUid );
@@ -908,8 +899,7 @@ ImageDataUiMapper::Impl::getActiveImageWindowLevel() const
     }
 
     auto activeImageRecord = m_dataManager.imageRecord( *activeImageUid ).lock();
-    if ( ! activeImageRecord || ! activeImageRecord->cpuData() ||
-         ! activeImageRecord->cpuData()->imageBaseData() )
+    if ( ! activeImageRecord || ! activeImageRecord->cpuData() )
     {
         return std::nullopt;
     }
@@ -938,8 +928,7 @@ ImageDataUiMapper::Impl::getActiveImageHeader() const
     }
 
     auto activeImageRecord = m_dataManager.imageRecord( *activeImageUid ).lock();
-    if ( ! activeImageRecord || ! activeImageRecord->cpuData() ||
-         ! activeImageRecord->cpuData()->imageBaseData() )
+    if ( ! activeImageRecord || ! activeImageRecord->cpuData() )
     {
         return std::nullopt;
     }
@@ -967,8 +956,7 @@ ImageDataUiMapper::Impl::getActiveImageTransformation() const
     }
 
     auto activeImageRecord = m_dataManager.imageRecord( *activeImageUid ).lock();
-    if ( ! activeImageRecord || ! activeImageRecord->cpuData() ||
-         ! activeImageRecord->cpuData()->imageBaseData() )
+    if ( ! activeImageRecord || ! activeImageRecord->cpuData() )
     {
         return std::nullopt;
     }
@@ -9,6 +9,7 @@
 #include <QDebug>
 #include <QDirIterator>
 #include <QIcon>
+#include <QStandardPaths>
 #include <QSurfaceFormat>
 
 #include <memory>
@@ -150,6 +151,33 @@ int main( int argc, char *argv[] )
     // Load the built-in color maps
     appController->loadBuiltInImageColorMaps( colorMapFileNames );
 
+    appController->setSlideTileCacheByteBudget( options.slideTileCacheByteBudget() );
+    appController->setSkipBackgroundSlideTiles( options.skipBackgroundSlideTiles() );
+    appController->setLabelMeshMethod( options.labelMeshMethod() );
+
+    if ( options.useSlideCache() )
+    {
+        std::string slideCacheDirectory = options.slideCacheDirectory();
+
+        if ( slideCacheDirectory.empty() )
+        {
+            slideCacheDirectory = QStandardPaths::writableLocation(
+                        QStandardPaths::CacheLocation ).toStdString() + "/slides";
+        }
+
+        appController->setSlideDiskCacheDirectory( slideCacheDirectory, options.slideCacheByteBudget() );
+    }
+
+    std::string brickDirectory = options.brickDirectory();
+
+    if ( brickDirectory.empty() )
+    {
+        brickDirectory = QStandardPaths::writableLocation(
+                    QStandardPaths::CacheLocation ).toStdString() + "/bricks";
+    }
+
+    appController->setBrickDirectory( brickDirectory );
+
 
     // Open the project file and load images, parcellations, and slides
     serialize::HZeeProject project;
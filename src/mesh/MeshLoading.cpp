@@ -74,7 +74,8 @@ std::unique_ptr<MeshCpuRecord> generateIsoSurface(
 std::unique_ptr<MeshCpuRecord> generateLabelMesh(
         vtkImageData* imageData,
         const imageio::ImageHeader& imageHeader,
-        const uint32_t labelIndex )
+        const uint32_t labelIndex,
+        const std::optional< std::array<int, 6> >& labelBoundingBox )
 {
     // Note: triangle strips offer no speed advantage over indexed triangles on modern hardware
     static const MeshPrimitiveType sk_primitiveType = MeshPrimitiveType::Triangles;
@@ -108,7 +109,99 @@ std::unique_ptr<MeshCpuRecord> generateLabelMesh(
     try
     {
         auto polyData = ::vtkdetails::generateLabelMesh(
-                    imageData, imageDirections, labelIndex, sk_primitiveType );
+                    imageData, imageDirections, labelIndex, sk_primitiveType, labelBoundingBox );
+
+        if ( ! polyData )
+        {
+            std::cerr << "Error generating label mesh at index " << labelIndex << std::endl;
+            return nullptr;
+        }
+
+        return std::make_unique<MeshCpuRecord>(
+                    polyData, MeshInfo( MeshSource::Label, sk_primitiveType, labelIndex ) );
+    }
+    catch ( const std::exception& e )
+    {
+        std::cerr << "Error generating label mesh: " << e.what() << std::endl;
+        return nullptr;
+    }
+    catch ( ... )
+    {
+        std::cerr << "Error generating label mesh." << std::endl;
+        return nullptr;
+    }
+}
+
+
+std::map< uint32_t, vtkSmartPointer<vtkPolyData> > extractLabelSurfaces(
+        vtkImageData* imageData,
+        const imageio::ImageHeader& imageHeader,
+        const std::vector<uint32_t>& labelIndices,
+        const std::array<int, 2>& slices )
+{
+    // Parcellation image must have exactly one scalar component
+    if ( 1 != imageHeader.m_numComponents ||
+         imageio::PixelType::Scalar != imageHeader.m_pixelType )
+    {
+        std::cerr << "Error extracting label surfaces: "
+                  << "Pixel type must be single-component scalar." << std::endl;
+        return {};
+    }
+
+    // Parcellation pixels are indices that must be of unsigned integer type
+    if ( ! imageio::isUnsignedIntegerType( imageHeader.m_componentType ) )
+    {
+        std::cerr << "Error extracting label surfaces: "
+                  << "parcellation component type must be unsigned integral." << std::endl;
+        return {};
+    }
+
+    if ( ! imageData )
+    {
+        std::cerr << "Error: Parcellation image data is null!" << std::endl;
+        return {};
+    }
+
+    try
+    {
+        return ::vtkdetails::extractLabelSurfaces( imageData, labelIndices, slices );
+    }
+    catch ( const std::exception& e )
+    {
+        std::cerr << "Error extracting label surfaces: " << e.what() << std::endl;
+        return {};
+    }
+    catch ( ... )
+    {
+        std::cerr << "Error extracting label surfaces." << std::endl;
+        return {};
+    }
+}
+
+
+std::unique_ptr<MeshCpuRecord> generateLabelMeshFromSurfaces(
+        const std::vector< vtkSmartPointer<vtkPolyData> >& surfacePieces,
+        vtkImageData* imageData,
+        const imageio::ImageHeader& imageHeader,
+        const uint32_t labelIndex )
+{
+    // Note: triangle strips offer no speed advantage over indexed triangles on modern hardware
+    static const MeshPrimitiveType sk_primitiveType = MeshPrimitiveType::Triangles;
+
+    if ( surfacePieces.empty() || ! imageData )
+    {
+        std::cerr << "Error generating label mesh at index " << labelIndex
+                  << ": no surface pieces or null parcellation image data" << std::endl;
+        return nullptr;
+    }
+
+    const vnl_matrix_fixed< double, 3, 3 > imageDirections =
+            imageio::convert::toVnlMatrixFixed( imageHeader.m_directions );
+
+    try
+    {
+        auto polyData = ::vtkdetails::smoothLabelSurface(
+                    surfacePieces, imageData, imageDirections, sk_primitiveType );
 
         if ( ! polyData )
         {
@@ -1,8 +1,15 @@
 #ifndef MESH_LOADER_H
 #define MESH_LOADER_H
 
+#include <vtkSmartPointer.h>
+
+#include <array>
+#include <cstdint>
+#include <map>
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 
 namespace imageio
@@ -12,6 +19,7 @@ class ImageHeader;
 
 class MeshCpuRecord;
 class vtkImageData;
+class vtkPolyData;
 
 
 namespace meshgen
@@ -22,7 +30,51 @@ std::unique_ptr<MeshCpuRecord> generateIsoSurface(
         const imageio::ImageHeader& imageHeader,
         const double isoValue );
 
+/**
+ * @brief Generate the surface mesh of a label in a parcellation
+ *
+ * @param imageData Parcellation image of label indices
+ * @param imageHeader Parcellation header
+ * @param labelIndex Index of the label
+ * @param labelBoundingBox Optional bounding box of the label in image Pixel space, as a VTK
+ * extent { xMin, xMax, yMin, yMax, zMin, zMax }, to which mesh generation is restricted
+ */
 std::unique_ptr<MeshCpuRecord> generateLabelMesh(
+        vtkImageData* imageData,
+        const imageio::ImageHeader& imageHeader,
+        const uint32_t labelIndex,
+        const std::optional< std::array<int, 6> >& labelBoundingBox = std::nullopt );
+
+/**
+ * @brief Extract the raw surface pieces of many labels in one sweep over a slab of slices of
+ * a parcellation. Slabs that cover the parcellation may be swept concurrently. The pieces of
+ * each label from all slabs are then turned into a mesh by \c generateLabelMeshFromSurfaces.
+ *
+ * @param imageData Parcellation image of label indices
+ * @param imageHeader Parcellation header
+ * @param labelIndices Indices of the labels
+ * @param slices Range [first, last) of the slices (pixel z indices) of the slab
+ *
+ * @return Raw surface piece of each label that has pixel faces in the slab; empty on error
+ */
+std::map< uint32_t, vtkSmartPointer<vtkPolyData> > extractLabelSurfaces(
+        vtkImageData* imageData,
+        const imageio::ImageHeader& imageHeader,
+        const std::vector<uint32_t>& labelIndices,
+        const std::array<int, 2>& slices );
+
+/**
+ * @brief Generate the surface mesh of a label from the pieces of its raw surface. This may be
+ * called concurrently for different labels.
+ *
+ * @param surfacePieces Raw surface pieces of the label from all slabs of the parcellation,
+ * as extracted by \c extractLabelSurfaces
+ * @param imageData Parcellation image from which the surface was extracted
+ * @param imageHeader Parcellation header
+ * @param labelIndex Index of the label
+ */
+std::unique_ptr<MeshCpuRecord> generateLabelMeshFromSurfaces(
+        const std::vector< vtkSmartPointer<vtkPolyData> >& surfacePieces,
         vtkImageData* imageData,
         const imageio::ImageHeader& imageHeader,
         const uint32_t labelIndex );
@@ -16,4 +16,11 @@ enum class MeshPrimitiveType
     Triangles //!< Indexed triangles
 };
 
+/// Method of generating the surface meshes of the labels of a parcellation
+enum class LabelMeshMethod
+{
+    MarchingCubes, //!< Marching cubes run separately on each label
+    DiscreteSurfaces //!< Boundaries of all labels extracted in one sweep, then smoothed per label
+};
+
 #endif // MESH_TYPES_H
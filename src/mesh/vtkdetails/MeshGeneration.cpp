@@ -4,11 +4,14 @@
 #include "imageio/itkdetails/ImageIOInfo.hpp"
 #include "imageio/itkdetails/ImageUtility.hpp"
 
+#include <vtkAlgorithmOutput.h>
+#include <vtkAppendPolyData.h>
 #include <vtkCallbackCommand.h>
+#include <vtkCellArray.h>
 #include <vtkCleanPolyData.h>
 #include <vtkDecimatePro.h>
+#include <vtkExtractVOI.h>
 #include <vtkGeometryFilter.h>
-#include <vtkImageAccumulate.h>
 #include <vtkImageCast.h>
 #include <vtkImageGaussianSmooth.h>
 #include <vtkImageThreshold.h>
@@ -16,6 +19,7 @@
 #include <vtkMaskFields.h>
 #include <vtkNew.h>
 #include <vtkPointData.h>
+#include <vtkPoints.h>
 #include <vtkPolyDataNormals.h>
 #include <vtkPolyDataWriter.h>
 #include <vtkReverseSense.h>
@@ -33,6 +37,10 @@
 #include <vnl/vnl_vector_fixed.h>
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
 
 namespace
 {
@@ -91,6 +99,321 @@ vnl_matrix_fixed< double, 4, 4 > constructVTKImageToSubjectMatrix(
     return subject_O_voxels * voxels_O_VTK;
 }
 
+
+// Smoothing of label meshes, shared by the marching cubes and discrete surface methods:
+constexpr bool sk_smoothMesh = true;
+constexpr uint32_t sk_smoothingIterations = 25;
+constexpr double sk_passBand = 0.1;
+constexpr double sk_featureAngle = 120.0;
+
+
+/// Grid of pixel corners of a label image. Corner (i, j, k) is the corner shared by
+/// pixels (i - 1, j - 1, k - 1) and (i, j, k), so there is one more corner than pixels
+/// along each axis.
+struct CornerGrid
+{
+    int64_t m_numCorners[3];
+    double m_origin[3]; //!< VTK coordinates of corner (0, 0, 0)
+    double m_spacing[3];
+};
+
+
+/// Raw surface of one label, built from pixel faces during the sweep over a label image.
+/// Faces that share corners share vertices.
+class LabelSurfaceBuilder
+{
+public:
+
+    explicit LabelSurfaceBuilder( const CornerGrid& grid )
+        : m_grid( grid ) {}
+
+    /**
+     * @brief Add the pixel face normal to an axis whose lowest corner is given. The face is
+     * oriented so that its normal points along the positive or negative axis direction.
+     */
+    void addFace( int axis, bool positive, const std::array<int64_t, 3>& corner )
+    {
+        // Axes spanned by the face, ordered so that their cross product is the axis
+        static constexpr int sk_faceAxes[3][2] = { { 1, 2 }, { 2, 0 }, { 0, 1 } };
+
+        const int u = sk_faceAxes[axis][0];
+        const int v = sk_faceAxes[axis][1];
+
+        std::array<int64_t, 3> c = corner;
+        const vtkIdType id0 = cornerId( c );
+        ++c[u];
+        const vtkIdType id1 = cornerId( c );
+        ++c[v];
+        const vtkIdType id2 = cornerId( c );
+        --c[u];
+        const vtkIdType id3 = cornerId( c );
+
+        if ( positive )
+        {
+            m_triangles.insert( std::end( m_triangles ), { id0, id1, id2, id0, id2, id3 } );
+        }
+        else
+        {
+            m_triangles.insert( std::end( m_triangles ), { id0, id2, id1, id0, id3, id2 } );
+        }
+    }
+
+    bool empty() const
+    {
+        return m_triangles.empty();
+    }
+
+    vtkSmartPointer<vtkPolyData> polyData() const
+    {
+        vtkNew<vtkPoints> points;
+        points->SetDataTypeToDouble();
+        points->SetNumberOfPoints( static_cast<vtkIdType>( m_points.size() / 3 ) );
+
+        for ( size_t i = 0; i < m_points.size() / 3; ++i )
+        {
+            points->SetPoint( static_cast<vtkIdType>( i ), &m_points[3*i] );
+        }
+
+        vtkNew<vtkCellArray> triangles;
+        triangles->Allocate( triangles->EstimateSize( static_cast<vtkIdType>( m_triangles.size() / 3 ), 3 ) );
+
+        for ( size_t i = 0; i < m_triangles.size(); i += 3 )
+        {
+            triangles->InsertNextCell( 3, &m_triangles[i] );
+        }
+
+        vtkSmartPointer<vtkPolyData> polyData = vtkSmartPointer<vtkPolyData>::New();
+        polyData->SetPoints( points.GetPointer() );
+        polyData->SetPolys( triangles.GetPointer() );
+        return polyData;
+    }
+
+
+private:
+
+    vtkIdType cornerId( const std::array<int64_t, 3>& c )
+    {
+        const uint64_t key = static_cast<uint64_t>(
+                    c[0] + m_grid.m_numCorners[0] * ( c[1] + m_grid.m_numCorners[1] * c[2] ) );
+
+        const auto it = m_cornerIds.emplace( key, static_cast<vtkIdType>( m_points.size() / 3 ) );
+
+        if ( it.second )
+        {
+            for ( int a = 0; a < 3; ++a )
+            {
+                m_points.push_back( m_grid.m_origin[a] + m_grid.m_spacing[a] * static_cast<double>( c[a] ) );
+            }
+        }
+
+        return it.first->second;
+    }
+
+    const CornerGrid& m_grid;
+
+    std::unordered_map<uint64_t, vtkIdType> m_cornerIds; //!< Vertex of each corner on the surface
+    std::vector<double> m_points; //!< Vertex coordinates
+    std::vector<vtkIdType> m_triangles; //!< Vertex indices of triangles
+};
+
+
+/**
+ * @brief Sweep once over a slab of slices of a label image and add every pixel face on a label
+ * boundary to the surfaces of the requested labels on either side of it. Interior faces are
+ * visited once, as the high face of the pixel below them along each axis.
+ *
+ * @param labels Pixels of the label image, with x varying fastest
+ * @param dims Image dimensions
+ * @param slices Range [first, last) of the slices of the slab
+ * @param labelSlots Index into builders of each label; -1 for labels whose surfaces are not built.
+ * Labels beyond the end of this vector are not built either.
+ * @param builders Surface builders of the requested labels
+ */
+template< typename T >
+void extractLabelFaces( const T* labels,
+                        const int dims[3],
+                        const std::array<int, 2>& slices,
+                        const std::vector<int32_t>& labelSlots,
+                        std::vector<LabelSurfaceBuilder>& builders )
+{
+    const int64_t strides[3] = { 1, dims[0], static_cast<int64_t>( dims[0] ) * dims[1] };
+
+    auto slotOf = [&labelSlots] ( T label ) -> int32_t
+    {
+        const uint64_t l = static_cast<uint64_t>( label );
+        return ( l < labelSlots.size() ) ? labelSlots[l] : -1;
+    };
+
+    int64_t offset = slices[0] * strides[2];
+
+    for ( int64_t z = slices[0]; z < slices[1]; ++z )
+    {
+        for ( int64_t y = 0; y < dims[1]; ++y )
+        {
+            for ( int64_t x = 0; x < dims[0]; ++x, ++offset )
+            {
+                const T label = labels[offset];
+                const int32_t slot = slotOf( label );
+                const std::array<int64_t, 3> pixel{ { x, y, z } };
+
+                for ( int a = 0; a < 3; ++a )
+                {
+                    // The low faces of pixels on the image boundary face the outside
+                    if ( 0 == pixel[a] && 0 <= slot )
+                    {
+                        builders[slot].addFace( a, false, pixel );
+                    }
+
+                    std::array<int64_t, 3> corner = pixel;
+                    ++corner[a];
+
+                    if ( dims[a] == corner[a] )
+                    {
+                        if ( 0 <= slot )
+                        {
+                            builders[slot].addFace( a, true, corner );
+                        }
+                        continue;
+                    }
+
+                    const T neighbor = labels[offset + strides[a]];
+
+                    if ( neighbor == label )
+                    {
+                        continue;
+                    }
+
+                    if ( 0 <= slot )
+                    {
+                        builders[slot].addFace( a, true, corner );
+                    }
+
+                    const int32_t neighborSlot = slotOf( neighbor );
+
+                    if ( 0 <= neighborSlot )
+                    {
+                        builders[neighborSlot].addFace( a, false, corner );
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Finish a raw label surface into a mesh, as the last stage of both the marching cubes
+ * and the discrete surface methods: optionally convert the surface to triangle strips,
+ * clean and smooth it, transform it from VTK image coordinates to subject space,
+ * and generate its normals.
+ *
+ * @param surface Output of the pipeline that generates the raw triangulated label surface
+ * @param labelData Label image from which the surface is generated
+ */
+vtkSmartPointer< vtkPolyData > finishLabelMesh(
+        vtkAlgorithmOutput* surface,
+        vtkImageData* labelData,
+        const vnl_matrix_fixed< double, 3, 3 >& imageDirections,
+        const MeshPrimitiveType& primitiveType )
+{
+    static constexpr bool sk_stripScalars = false;
+
+    if ( ! surface || ! labelData )
+    {
+        return nullptr;
+    }
+
+    vtkNew< vtkStripper > triangleStripper;
+    vtkNew< vtkCleanPolyData > cleanFilter;
+    vtkNew< vtkWindowedSincPolyDataFilter > windowedSincSmoother;
+    vtkNew< vtkMaskFields > scalarsMask;
+    vtkNew< vtkGeometryFilter > geometryFilter;
+    vtkNew< vtkTransformPolyDataFilter > transformToSubjectFilter;
+    vtkNew< vtkPolyDataNormals > normalsGenerator;
+
+    // Transformation from VTK coordinates to subject (ITK/LPS) space
+    vtkNew< vtkTransform > tx_subject_O_VTK;
+
+    const vnl_matrix_fixed< double, 4, 4 > subject_O_VTK =
+            constructVTKImageToSubjectMatrix(
+                imageDirections,
+                vnl_vector<double>{ labelData->GetOrigin(), 3 },
+                vnl_vector<double>{ labelData->GetSpacing(), 3 } );
+
+    tx_subject_O_VTK->SetMatrix( subject_O_VTK.data_block() );
+
+    vtkWeakPointer< vtkPolyDataAlgorithm > meshPipelineTail = nullptr;
+    vtkAlgorithmOutput* algOutput = surface;
+
+    if ( MeshPrimitiveType::TriangleStrip == primitiveType )
+    {
+        // Generate triangle strips
+        triangleStripper->SetInputConnection( algOutput );
+        algOutput = triangleStripper->GetOutputPort();
+    }
+
+    // Clean the mesh
+    cleanFilter->SetInputConnection( algOutput );
+    meshPipelineTail = cleanFilter.GetPointer();
+
+    // Smooth the surface
+    if ( sk_smoothMesh )
+    {
+        if ( ! meshPipelineTail ) { return nullptr; }
+        windowedSincSmoother->SetInputConnection( meshPipelineTail->GetOutputPort() );
+        windowedSincSmoother->SetNumberOfIterations( sk_smoothingIterations );
+        windowedSincSmoother->SetFeatureEdgeSmoothing( 1 );
+        windowedSincSmoother->SetFeatureAngle( sk_featureAngle );
+        windowedSincSmoother->SetPassBand( sk_passBand );
+        windowedSincSmoother->BoundarySmoothingOff();
+        windowedSincSmoother->NonManifoldSmoothingOn();
+        windowedSincSmoother->NormalizeCoordinatesOn();
+        meshPipelineTail = windowedSincSmoother.GetPointer();
+    }
+
+    if ( ! meshPipelineTail ) { return nullptr; }
+
+    if ( sk_stripScalars )
+    {
+        // Strip scalars from the points and cells
+        scalarsMask->SetInputConnection( meshPipelineTail->GetOutputPort() );
+        scalarsMask->CopyAttributeOff( vtkMaskFields::POINT_DATA, vtkDataSetAttributes::SCALARS );
+        scalarsMask->CopyAttributeOff( vtkMaskFields::CELL_DATA, vtkDataSetAttributes::SCALARS) ;
+        algOutput = scalarsMask->GetOutputPort();
+    }
+    else
+    {
+        algOutput = meshPipelineTail->GetOutputPort();
+    }
+
+    // Convert to polyData
+    geometryFilter->SetInputConnection( algOutput );
+    meshPipelineTail = geometryFilter.GetPointer();
+
+    // Transform to subject space
+    if ( ! meshPipelineTail ) { return nullptr; }
+    transformToSubjectFilter->SetInputConnection( meshPipelineTail->GetOutputPort() );
+    transformToSubjectFilter->SetTransform( tx_subject_O_VTK.GetPointer() );
+    meshPipelineTail = transformToSubjectFilter.GetPointer();
+
+    // Generate vertex normal vectors
+    if ( ! meshPipelineTail ) { return nullptr; }
+    normalsGenerator->SetInputConnection( meshPipelineTail->GetOutputPort() );
+    normalsGenerator->ComputePointNormalsOn();
+    normalsGenerator->ComputeCellNormalsOff();
+    normalsGenerator->SetFeatureAngle( sk_featureAngle );
+    normalsGenerator->FlipNormalsOff();
+    normalsGenerator->SplittingOn();
+    normalsGenerator->ConsistencyOff();
+    normalsGenerator->AutoOrientNormalsOn();
+    //    normalsGenerator->SetNonManifoldTraversal(1);
+    meshPipelineTail = normalsGenerator.GetPointer();
+
+    // Run pipeline
+    meshPipelineTail->Update();
+
+    return meshPipelineTail->GetOutput();
+}
+
 } // anonymous
 
 
@@ -234,51 +557,18 @@ vtkSmartPointer< vtkPolyData > generateIsoSurfaceMesh(
 }
 
 
-std::map< int32_t, double > generateIntegerImageHistogram(
-        vtkImageData* imageData,
-        const std::set<int32_t>& imageValues )
-{
-    vtkNew< vtkImageAccumulate > imageHistogram;
-
-    const auto minMax = std::minmax_element(
-                std::begin( imageValues ), std::end( imageValues ) );
-
-    imageHistogram->SetInputData( imageData );
-    imageHistogram->SetComponentOrigin( 0, 0, 0 );
-    imageHistogram->SetComponentSpacing( 1, 1, 1 );
-    imageHistogram->SetComponentExtent( *(minMax.first), *(minMax.second), 0, 0, 0, 0 );
-    imageHistogram->Update();
-
-    std::map< int32_t, double > frequencies;
-
-    for ( const int32_t i : imageValues )
-    {
-        frequencies[i] = imageHistogram->GetOutput()->
-                GetPointData()->GetScalars()->GetTuple1( i );
-    }
-
-    return frequencies;
-}
-
-
 vtkSmartPointer< vtkPolyData > generateLabelMesh(
         vtkImageData* labelData,
         const vnl_matrix_fixed< double, 3, 3 >& imageDirections,
         const uint32_t labelIndex,
-        const MeshPrimitiveType& primitiveType )
+        const MeshPrimitiveType& primitiveType,
+        const std::optional< std::array<int, 6> >& labelBoundingBox )
 {
     // This flag controls whether the label is smoothed prior to meshing:
     static constexpr bool sk_smoothImage = false;
     static constexpr double sk_imageGaussianStdev = 1.0;
     static constexpr double sk_imageGaussianRadius = 3.0;
 
-    static constexpr bool sk_stripScalars = false;
-
-    static constexpr bool sk_smoothMesh = true;
-    static constexpr uint32_t sk_smoothingIterations = 25;
-    static constexpr double sk_passBand = 0.1;
-    static constexpr double sk_featureAngle = 120.0;
-
     if ( ! labelData )
     {
         return nullptr;
@@ -290,6 +580,7 @@ vtkSmartPointer< vtkPolyData > generateLabelMesh(
         return nullptr;
     }
 
+    vtkNew< vtkExtractVOI > voiExtractor;
     vtkNew< vtkImageThreshold > imageThresholder;
     vtkNew< vtkImageCast > imageCaster;
     vtkNew< vtkImageGaussianSmooth > imageSmoother;
@@ -298,34 +589,50 @@ vtkSmartPointer< vtkPolyData > generateLabelMesh(
     //    vtkNew< vtkDecimatePro > decimator;
     //    vtkNew< vtkSmoothPolyDataFilter > meshSmoother;
     vtkNew< vtkTriangleFilter > triangleFilter;
-    vtkNew< vtkCleanPolyData > cleanFilter;
-    vtkNew< vtkStripper > triangleStripper;
-    vtkNew< vtkWindowedSincPolyDataFilter > windowedSincSmoother;
-    vtkNew< vtkMaskFields > scalarsMask;
-    vtkNew< vtkGeometryFilter > geometryFilter;
-    vtkNew< vtkTransformPolyDataFilter > transformToSubjectFilter;
-    vtkNew< vtkPolyDataNormals > normalsGenerator;
 
     /// @todo ITK-SNAP has a nice way of combining progress of multiple functions
     vtkNew< vtkCallbackCommand > mcCallback;
     mcCallback->SetCallback( progressFunction< vtkMarchingCubes > );
 
-    // Transformation from VTK coordinates to subject (ITK/LPS) space
-    vtkNew< vtkTransform > tx_subject_O_VTK;
+    // Set up label image processing pipeline
+    vtkWeakPointer< vtkImageAlgorithm > imagePipelineTail = nullptr;
 
-    const vnl_matrix_fixed< double, 4, 4 > subject_O_VTK =
-            constructVTKImageToSubjectMatrix(
-                imageDirections,
-                vnl_vector<double>{ labelData->GetOrigin(), 3 },
-                vnl_vector<double>{ labelData->GetSpacing(), 3 } );
+    // Crop the image to the label's bounding box, so that the cost of the pipeline scales
+    // with the size of the label rather than that of the image. The box is padded by one pixel,
+    // so that the surface closes around the label, and by the Gaussian kernel radius,
+    // so that smoothing sees the same neighborhood as it would in the whole image.
+    // The cropped image keeps the extent indices, origin, and spacing of the whole image,
+    // so the mesh is generated in the same VTK coordinates and the transformation to
+    // subject space holds.
+    if ( labelBoundingBox )
+    {
+        const int padding = 1 + ( sk_smoothImage
+                                  ? static_cast<int>( std::ceil( sk_imageGaussianStdev * sk_imageGaussianRadius ) )
+                                  : 0 );
 
-    tx_subject_O_VTK->SetMatrix( subject_O_VTK.data_block() );
+        int wholeExtent[6];
+        labelData->GetExtent( wholeExtent );
 
-    // Set up label image processing pipeline
-    vtkWeakPointer< vtkImageAlgorithm > imagePipelineTail = nullptr;
+        int voi[6];
+
+        for ( int i = 0; i < 3; ++i )
+        {
+            voi[2*i] = std::max( wholeExtent[2*i], wholeExtent[2*i] + (*labelBoundingBox)[2*i] - padding );
+            voi[2*i + 1] = std::min( wholeExtent[2*i + 1], wholeExtent[2*i] + (*labelBoundingBox)[2*i + 1] + padding );
+        }
+
+        voiExtractor->SetInputData( labelData );
+        voiExtractor->SetVOI( voi );
+        voiExtractor->SetSampleRate( 1, 1, 1 );
+
+        imageThresholder->SetInputConnection( voiExtractor->GetOutputPort() );
+    }
+    else
+    {
+        imageThresholder->SetInputData( labelData );
+    }
 
     // Threshold the image at a given label value
-    imageThresholder->SetInputData( labelData );
     imageThresholder->SetInValue( 1.0 );
     imageThresholder->SetOutValue( 0.0 );
     imagePipelineTail = imageThresholder.GetPointer();
@@ -362,115 +669,163 @@ vtkSmartPointer< vtkPolyData > generateLabelMesh(
     triangleFilter->SetInputConnection( meshPipelineTail->GetOutputPort() );
     meshPipelineTail = triangleFilter.GetPointer();
 
-    if ( MeshPrimitiveType::TriangleStrip == primitiveType )
-    {
-        // Generate triangle strips
-        if ( ! meshPipelineTail ) { return nullptr; }
-        triangleStripper->SetInputConnection( meshPipelineTail->GetOutputPort() );
-        meshPipelineTail = triangleStripper.GetPointer();
-    }
-
-    // Clean the mesh
-    cleanFilter->SetInputConnection( meshPipelineTail->GetOutputPort() );
-    meshPipelineTail = cleanFilter.GetPointer();
-
     // MC observer
     //    meshPipelineTail->AddObserver( vtkCommand::ProgressEvent, mcCallback );
     //    meshPipelineTail->Update();
 
-    // Smooth the surface
-    if ( sk_smoothMesh )
+    vtkSmartPointer<ErrorObserver> errorObserver =
+            vtkSmartPointer<ErrorObserver>::New();
+
+    // Select data for a label
+    imageThresholder->ThresholdBetween(
+                static_cast<double>( labelIndex ),
+                static_cast<double>( labelIndex ) );
+
+    // Strip, clean, smooth, and transform the mesh, and run the pipeline
+    return finishLabelMesh( meshPipelineTail->GetOutputPort(), labelData, imageDirections, primitiveType );
+}
+
+
+std::map< uint32_t, vtkSmartPointer<vtkPolyData> > extractLabelSurfaces(
+        vtkImageData* labelData,
+        const std::vector<uint32_t>& labelIndices,
+        const std::array<int, 2>& slices )
+{
+    std::map< uint32_t, vtkSmartPointer<vtkPolyData> > surfaces;
+
+    if ( ! labelData || labelIndices.empty() )
     {
-        if ( ! meshPipelineTail ) { return nullptr; }
-        windowedSincSmoother->SetInputConnection( meshPipelineTail->GetOutputPort() );
-        windowedSincSmoother->SetNumberOfIterations( sk_smoothingIterations );
-        windowedSincSmoother->SetFeatureEdgeSmoothing( 1 );
-        windowedSincSmoother->SetFeatureAngle( sk_featureAngle );
-        windowedSincSmoother->SetPassBand( sk_passBand );
-        windowedSincSmoother->BoundarySmoothingOff();
-        windowedSincSmoother->NonManifoldSmoothingOn();
-        windowedSincSmoother->NormalizeCoordinatesOn();
-        meshPipelineTail = windowedSincSmoother.GetPointer();
+        return surfaces;
     }
 
-    if ( ! meshPipelineTail ) { return nullptr; }
+    if ( 1 != labelData->GetNumberOfScalarComponents() )
+    {
+        std::cerr << "Cannot extract label surfaces from image with "
+                  << labelData->GetNumberOfScalarComponents() << " components" << std::endl;
+        return surfaces;
+    }
 
-    vtkAlgorithmOutput* algOutput = nullptr;
+    int dims[3];
+    labelData->GetDimensions( dims );
 
-    if ( sk_stripScalars )
+    if ( 0 >= dims[0] || 0 >= dims[1] || 0 >= dims[2] )
     {
-        // Strip scalars from the points and cells
-        scalarsMask->SetInputConnection( meshPipelineTail->GetOutputPort() );
-        scalarsMask->CopyAttributeOff( vtkMaskFields::POINT_DATA, vtkDataSetAttributes::SCALARS );
-        scalarsMask->CopyAttributeOff( vtkMaskFields::CELL_DATA, vtkDataSetAttributes::SCALARS) ;
-        algOutput = scalarsMask->GetOutputPort();
+        return surfaces;
     }
-    else
+
+    if ( slices[0] < 0 || dims[2] < slices[1] || slices[1] <= slices[0] )
     {
-        algOutput = meshPipelineTail->GetOutputPort();
+        std::cerr << "Invalid slab [" << slices[0] << ", " << slices[1] << ") of label image with "
+                  << dims[2] << " slices" << std::endl;
+        return surfaces;
     }
 
+    int extent[6];
+    labelData->GetExtent( extent );
 
-    // Convert to polyData
-    geometryFilter->SetInputConnection( algOutput );
-    meshPipelineTail = geometryFilter.GetPointer();
+    const double* origin = labelData->GetOrigin();
+    const double* spacing = labelData->GetSpacing();
 
-    // Transform to subject space
-    if ( ! meshPipelineTail ) { return nullptr; }
-    transformToSubjectFilter->SetInputConnection( meshPipelineTail->GetOutputPort() );
-    transformToSubjectFilter->SetTransform( tx_subject_O_VTK.GetPointer() );
-    meshPipelineTail = transformToSubjectFilter.GetPointer();
+    // Pixel centers lie at VTK coordinates origin + spacing * (extent index),
+    // so their corners lie half a pixel below and above them
+    CornerGrid grid;
 
-    // Generate vertex normal vectors
-    if ( ! meshPipelineTail ) { return nullptr; }
-    normalsGenerator->SetInputConnection( meshPipelineTail->GetOutputPort() );
-    normalsGenerator->ComputePointNormalsOn();
-    normalsGenerator->ComputeCellNormalsOff();
-    normalsGenerator->SetFeatureAngle( sk_featureAngle );
-    normalsGenerator->FlipNormalsOff();
-    normalsGenerator->SplittingOn();
-    normalsGenerator->ConsistencyOff();
-    normalsGenerator->AutoOrientNormalsOn();
-    //    normalsGenerator->SetNonManifoldTraversal(1);
-    meshPipelineTail = normalsGenerator.GetPointer();
+    for ( int a = 0; a < 3; ++a )
+    {
+        grid.m_numCorners[a] = static_cast<int64_t>( dims[a] ) + 1;
+        grid.m_origin[a] = origin[a] + spacing[a] * ( static_cast<double>( extent[2*a] ) - 0.5 );
+        grid.m_spacing[a] = spacing[a];
+    }
 
+    // Map requested labels to their surface builders
+    const uint32_t maxLabelIndex = *std::max_element( std::begin( labelIndices ), std::end( labelIndices ) );
 
-    vtkSmartPointer<ErrorObserver> errorObserver =
-            vtkSmartPointer<ErrorObserver>::New();
+    std::vector<int32_t> labelSlots( static_cast<size_t>( maxLabelIndex ) + 1, -1 );
+    std::vector<uint32_t> slotLabels;
+    std::vector<LabelSurfaceBuilder> builders;
 
-    // Select data for a label
-    imageThresholder->ThresholdBetween(
-                static_cast<double>( labelIndex ),
-                static_cast<double>( labelIndex ) );
+    builders.reserve( labelIndices.size() );
+    slotLabels.reserve( labelIndices.size() );
 
-    if ( ! meshPipelineTail )
+    for ( const uint32_t labelIndex : labelIndices )
     {
-        return nullptr;
+        if ( -1 == labelSlots[labelIndex] )
+        {
+            labelSlots[labelIndex] = static_cast<int32_t>( builders.size() );
+            slotLabels.push_back( labelIndex );
+            builders.emplace_back( grid );
+        }
     }
 
-    // Run pipeline
-    meshPipelineTail->Update();
+    const void* pixels = labelData->GetScalarPointer();
 
-//        if ( errorObserver->GetError() )
-//        {
-//            std::cout << "Caught error! " << errorObserver->GetErrorMessage();
-//        }
+    switch ( labelData->GetScalarType() )
+    {
+    case VTK_UNSIGNED_CHAR:
+        extractLabelFaces( static_cast<const unsigned char*>( pixels ), dims, slices, labelSlots, builders ); break;
+    case VTK_UNSIGNED_SHORT:
+        extractLabelFaces( static_cast<const unsigned short*>( pixels ), dims, slices, labelSlots, builders ); break;
+    case VTK_UNSIGNED_INT:
+        extractLabelFaces( static_cast<const unsigned int*>( pixels ), dims, slices, labelSlots, builders ); break;
+    case VTK_UNSIGNED_LONG:
+        extractLabelFaces( static_cast<const unsigned long*>( pixels ), dims, slices, labelSlots, builders ); break;
+    case VTK_UNSIGNED_LONG_LONG:
+        extractLabelFaces( static_cast<const unsigned long long*>( pixels ), dims, slices, labelSlots, builders ); break;
+    default:
+    {
+        std::cerr << "Cannot extract label surfaces from image with non-unsigned integer "
+                  << "scalar type " << labelData->GetScalarTypeAsString() << std::endl;
+        return surfaces;
+    }
+    }
 
-//        if ( errorObserver->GetWarning() )
-//        {
-//            std::cout << "Caught warning! " << errorObserver->GetWarningMessage();
-//        }
+    for ( size_t i = 0; i < builders.size(); ++i )
+    {
+        if ( ! builders[i].empty() )
+        {
+            surfaces.emplace( slotLabels[i], builders[i].polyData() );
+        }
+    }
 
-    //        static const std::string filePrefix = "label_";
-    //        std::stringstream ss;
-    //        ss << filePrefix << label << ".vtk" << std::ends;
-    //        writePolyData( meshPipelineTail->GetOutput(), ss.str().c_str() );
+    return surfaces;
+}
 
-//    vtkSmartPointer<vtkPolyData> polyDataCopy = vtkSmartPointer<vtkPolyData>::New();
-//    polyDataCopy->DeepCopy( meshPipelineTail->GetOutput() );
-//    return polyDataCopy;
 
-    return meshPipelineTail->GetOutput();
+vtkSmartPointer< vtkPolyData > smoothLabelSurface(
+        const std::vector< vtkSmartPointer<vtkPolyData> >& surfacePieces,
+        vtkImageData* labelData,
+        const vnl_matrix_fixed< double, 3, 3 >& imageDirections,
+        const MeshPrimitiveType& primitiveType )
+{
+    if ( surfacePieces.empty() || ! labelData )
+    {
+        return nullptr;
+    }
+
+    if ( MeshPrimitiveType::TriangleFan == primitiveType )
+    {
+        // Not supported
+        return nullptr;
+    }
+
+    // Append the pieces of the surface. Cleaning the surface at the start of the finishing
+    // pipeline merges the coincident vertices of neighboring pieces on the slab boundaries.
+    vtkNew< vtkAppendPolyData > surfaceAppender;
+
+    for ( const auto& piece : surfacePieces )
+    {
+        if ( ! piece )
+        {
+            return nullptr;
+        }
+
+        surfaceAppender->AddInputData( piece.Get() );
+    }
+
+    // The raw surface is already made of triangles, so it is only finished like the surfaces
+    // from marching cubes. Features are not preserved in smoothing: the 90 degree edges
+    // between pixel faces are below the feature angle and are smoothed away.
+    return finishLabelMesh( surfaceAppender->GetOutputPort(), labelData, imageDirections, primitiveType );
 }
 
 } // namespace vtkdetails
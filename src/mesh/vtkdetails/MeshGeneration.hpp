@@ -7,8 +7,9 @@
 #include <vtkPolyData.h>
 #include <vtkSmartPointer.h>
 
+#include <array>
 #include <map>
-#include <set>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -46,17 +47,60 @@ vtkSmartPointer< vtkPolyData > generateIsoSurfaceMesh(
         const double isoValue,
         const MeshPrimitiveType& primitiveType );
 
-// Label images are stored as indices
+/**
+ * @brief Generate the surface mesh of a label. Label images are stored as indices.
+ *
+ * @param labelBoundingBox Optional bounding box of the label's pixels, in image Pixel
+ * space, ordered as a VTK extent: { xMin, xMax, yMin, yMax, zMin, zMax }. If provided,
+ * the mesh is generated only from the padded bounding box, rather than from the whole image.
+ */
 vtkSmartPointer< vtkPolyData > generateLabelMesh(
         vtkImageData* imageData,
         const vnl_matrix_fixed< double, 3, 3 >& imageDirections,
         const uint32_t labelIndex,
+        const MeshPrimitiveType& primitiveType,
+        const std::optional< std::array<int, 6> >& labelBoundingBox = std::nullopt );
+
+/**
+ * @brief Extract the boundary surfaces of many labels in a single sweep over a slab of slices
+ * of a label image, in the manner of discrete marching cubes and surface nets. Each pixel face
+ * between two different labels, or between a label and the outside of the image, is added to
+ * the surface of each requested label on either side of it, oriented away from that label.
+ * The cost of the sweep does not depend on the number of labels.
+ *
+ * A face belongs to the slab of the pixel below it along its normal axis, or to the slab of
+ * slice 0 on the low image boundary. Hence, sweeping disjoint slabs that cover the image
+ * (possibly concurrently) yields each face once, and the pieces of a label from all slabs
+ * form its closed surface. The pieces share vertices on the slab boundaries.
+ *
+ * The surfaces are blocky and in VTK image coordinates. They are meant to be passed to
+ * \c smoothLabelSurface, which may be called on different labels concurrently.
+ *
+ * @param labelData Label image of unsigned integer label indices, with one component
+ * @param labelIndices Indices of the labels whose surfaces to extract
+ * @param slices Range [first, last) of the slices (pixel z indices) of the slab to sweep
+ * @return Raw surface piece of each requested label that has faces in the slab
+ */
+std::map< uint32_t, vtkSmartPointer<vtkPolyData> > extractLabelSurfaces(
+        vtkImageData* labelData,
+        const std::vector<uint32_t>& labelIndices,
+        const std::array<int, 2>& slices );
+
+/**
+ * @brief Merge the raw surface pieces of a label from \c extractLabelSurfaces, smooth the
+ * surface in the same way as \c generateLabelMesh does, transform it to subject space,
+ * and generate its normals.
+ *
+ * @param surfacePieces Raw surface pieces of the label from the slabs of the image,
+ * which are not modified
+ * @param labelData Label image from which the surface was extracted
+ */
+vtkSmartPointer< vtkPolyData > smoothLabelSurface(
+        const std::vector< vtkSmartPointer<vtkPolyData> >& surfacePieces,
+        vtkImageData* labelData,
+        const vnl_matrix_fixed< double, 3, 3 >& imageDirections,
         const MeshPrimitiveType& primitiveType );
 
-std::map< int32_t, double >
-generateIntegerImageHistogram(
-        vtkImageData* imageData,
-        const std::set<int32_t>& imageValues );
 
 } // namespace vtkdetails
 
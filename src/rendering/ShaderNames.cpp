@@ -107,6 +107,10 @@ const char* const frag::layerOpacities = "layerOpacities";
 const char* const frag::layerPermutation = "layerPermutation";
 
 const char* const frag::tex2D = "tex2D";
+const char* const frag::tex2DAtlas = "tex2DAtlas";
+const char* const frag::tex2DPageTable = "tex2DPageTable";
+const char* const frag::tex2DPageScale = "tex2DPageScale";
+const char* const frag::tex2DVirtual = "tex2DVirtual";
 const char* const frag::imageTex3D = "imageTex3D";
 const char* const frag::labelTex3D = "labelTex3D";
 const char* const frag::labelColormapTexture = "labelColormapTexture";
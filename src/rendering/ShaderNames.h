@@ -159,6 +159,10 @@ struct frag :
     static const char* const layerPermutation;
 
     static const char* const tex2D;
+    static const char* const tex2DAtlas;
+    static const char* const tex2DPageTable;
+    static const char* const tex2DPageScale;
+    static const char* const tex2DVirtual;
     static const char* const imageTex3D;
     static const char* const labelTex3D;
     static const char* const labelColormapTexture;
@@ -5,12 +5,14 @@
 #include "rendering/drawables/slides/SlideSlice.h"
 #include "rendering/drawables/slides/SlideStackArrow.h"
 #include "rendering/records/MeshGpuRecord.h"
+#include "rendering/records/SlideTileAtlas.h"
 #include "rendering/utility/CreateGLObjects.h"
 #include "rendering/utility/UnderlyingEnumType.h"
 #include "rendering/utility/math/MathUtility.h"
 #include "rendering/utility/vtk/PolyDataGenerator.h"
 
 #include "common/HZeeException.hpp"
+#include "slideio/SlideTileReader.h"
 
 #include <glm/glm.hpp>
 
@@ -62,6 +64,7 @@ SlideStackAssembly::SlideStackAssembly(
       m_slideStackHeightProvider( stackHeightProvider ),
       m_slideStackToWorldTxProvider( slideStackToWorldTxProvider ),
       m_activeSlideQuerier( activeSlideQuerier ),
+      m_slideTileRequester( nullptr ),
 
       m_root2dStackToWorldTx( nullptr ),
       m_root3dStackToWorldTx( nullptr ),
@@ -74,6 +77,7 @@ SlideStackAssembly::SlideStackAssembly(
       m_sphereMeshRecord( nullptr ),
 
       m_boxMeshRecord( nullptr ),
+      m_tileAtlas( nullptr ),
 
       m_slides(),
       m_properties()
@@ -116,6 +120,8 @@ void SlideStackAssembly::initialize()
         throw_debug( "Null MeshGPURecord" );
     }
 
+    m_tileAtlas = std::make_shared<SlideTileAtlas>( slideio::SlideTileReader::sk_defaultTileSize );
+
     std::ostringstream baseName;
     baseName << "SlideStackAssembly_#" << numCreated() << std::ends;
 
@@ -140,7 +146,7 @@ void SlideStackAssembly::initialize()
 
 
     m_root2dStackToWorldTx = std::make_shared<DynamicTransformation>(
-                baseName.str() + "_root2d", m_slideStackToWorldTxProvider );
+                baseName.str() + "_root2d", root2dStackToWorldTxProvider() );
 
     m_root3dStackToWorldTx = std::make_shared<DynamicTransformation>(
                 baseName.str() + "_root3d", m_slideStackToWorldTxProvider );
@@ -205,12 +211,22 @@ void SlideStackAssembly::addSlide( const UID& uid, std::weak_ptr<SlideRecord> sl
         return getRenderingProperties().m_image3dLayerOpacity;
     };
 
+    auto requestSlideTiles = [this] ( const UID& slideUid, int level, const std::vector< glm::i64vec2 >& tileIndices )
+    {
+        if ( m_slideTileRequester )
+        {
+            m_slideTileRequester( slideUid, level, tileIndices );
+        }
+    };
+
     auto slideSlice = std::make_shared<SlideSlice>(
                 sliceName.str(),
                 m_shaderActivator, m_uniformsProvider, m_blankTextures,
                 sliceMeshGpuRecord, slideRecord,
                 m_activeSlideQuerier,
-                getImage3dLayerOpacity );
+                getImage3dLayerOpacity,
+                m_tileAtlas,
+                requestSlideTiles );
 
     auto slideBox = std::make_shared<SlideBox>(
                 boxName.str(),
@@ -454,7 +470,7 @@ void SlideStackAssembly::setSlideStackToWorldTxProvider( GetterType<glm::mat4> p
 
     if ( m_root2dStackToWorldTx )
     {
-        m_root2dStackToWorldTx->setMatrixProvider( m_slideStackToWorldTxProvider );
+        m_root2dStackToWorldTx->setMatrixProvider( root2dStackToWorldTxProvider() );
     }
 
     if ( m_root3dStackToWorldTx )
@@ -464,12 +480,37 @@ void SlideStackAssembly::setSlideStackToWorldTxProvider( GetterType<glm::mat4> p
 }
 
 
+GetterType< std::optional<glm::mat4> > SlideStackAssembly::root2dStackToWorldTxProvider()
+{
+    return [this] () -> std::optional<glm::mat4>
+    {
+        if ( m_tileAtlas )
+        {
+            m_tileAtlas->beginRequests();
+        }
+
+        if ( ! m_slideStackToWorldTxProvider )
+        {
+            return std::nullopt;
+        }
+
+        return m_slideStackToWorldTxProvider();
+    };
+}
+
+
 void SlideStackAssembly::setActiveSlideQuerier( QuerierType<bool, UID> querier )
 {
     m_activeSlideQuerier = querier;
 }
 
 
+void SlideStackAssembly::setSlideTileRequester( SlideTileRequesterType requester )
+{
+    m_slideTileRequester = requester;
+}
+
+
 const SlideStackAssemblyRenderingProperties&
 SlideStackAssembly::getRenderingProperties() const
 {
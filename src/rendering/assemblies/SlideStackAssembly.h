@@ -6,6 +6,7 @@
 #include "rendering/assemblies/RenderingProperties.h"
 #include "rendering/common/MeshColorLayer.h"
 #include "rendering/common/ShaderProviderType.h"
+#include "rendering/common/SlideTileRequesterType.h"
 
 #include "common/ObjectCounter.hpp"
 #include "common/PublicTypes.h"
@@ -13,6 +14,7 @@
 
 #include "logic/records/SlideRecord.h"
 
+#include <optional>
 #include <unordered_map>
 
 
@@ -22,6 +24,7 @@ class MeshGpuRecord;
 class SlideBox;
 class SlideSlice;
 class SlideStackArrow;
+class SlideTileAtlas;
 
 
 class SlideStackAssembly final :
@@ -70,6 +73,7 @@ public:
     void setSlideStackHeightProvider( GetterType<float> );
     void setSlideStackToWorldTxProvider( GetterType<glm::mat4> );
     void setActiveSlideQuerier( QuerierType<bool, UID> );
+    void setSlideTileRequester( SlideTileRequesterType );
 
     const SlideStackAssemblyRenderingProperties& getRenderingProperties() const;
 
@@ -93,6 +97,12 @@ private:
 
     void updateStackRenderingProperties();
 
+    /// Get the Slide Stack to World transformation provider of the 2D root. The 2D root is
+    /// updated once per frame of each 2D view, before the slides below it, so the provider
+    /// also begins the tile atlas requests of the frame. Tiles requested by one slide of
+    /// a frame are thus never evicted by another slide of the same frame.
+    GetterType< std::optional<glm::mat4> > root2dStackToWorldTxProvider();
+
 
     ShaderProgramActivatorType m_shaderActivator;
     UniformsProviderType m_uniformsProvider;
@@ -113,6 +123,9 @@ private:
     /// Function that returns true iff the provided UID is for the active slide
     QuerierType<bool, UID> m_activeSlideQuerier;
 
+    /// Function that requests slide tiles to be read for the tile atlas
+    SlideTileRequesterType m_slideTileRequester;
+
 
     /// Root drawables for the 2D version of the slide stack
     std::shared_ptr<DynamicTransformation> m_root2dStackToWorldTx;
@@ -134,6 +147,9 @@ private:
     /// Mesh record of the box used for 3D slides
     std::shared_ptr<MeshGpuRecord> m_boxMeshRecord;
 
+    /// Atlas of full-resolution slide tiles that is shared by the 2D slides
+    std::shared_ptr<SlideTileAtlas> m_tileAtlas;
+
     std::unordered_map< UID, SlideSliceAndBox > m_slides;
 
     SlideStackAssemblyRenderingProperties m_properties;
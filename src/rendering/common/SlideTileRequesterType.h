@@ -0,0 +1,18 @@
+#ifndef SLIDE_TILE_REQUESTER_TYPE_H
+#define SLIDE_TILE_REQUESTER_TYPE_H
+
+#include "common/UID.h"
+
+#include <glm/vec2.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <functional>
+#include <vector>
+
+/// Functional requesting that tiles of a slide level be read into the slide tile cache,
+/// so that they can be made resident in the tile atlas. The arguments are the UID of the
+/// slide record, the file level, and the tile (column, row) indices within the level.
+using SlideTileRequesterType =
+    std::function< void ( const UID& slideUid, int level, const std::vector< glm::i64vec2 >& tileIndices ) >;
+
+#endif // SLIDE_TILE_REQUESTER_TYPE_H
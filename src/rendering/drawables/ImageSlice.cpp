@@ -11,6 +11,8 @@
 
 #include "logic/camera/CameraHelpers.h"
 
+#include "imageio/VolumePyramid.h"
+
 #include "common/HZeeException.hpp"
 
 #include <glm/gtc/matrix_inverse.hpp>
@@ -24,8 +26,10 @@
 #include <glm/gtx/string_cast.hpp>
 #include <glm/gtx/transform.hpp>
 
+#include <algorithm>
 #include <array>
 #include <cmath>
+#include <optional>
 #include <sstream>
 #include <unordered_map>
 #include <utility>
@@ -52,6 +56,53 @@ static constexpr float sk_shininess = 15.0f;
 
 static constexpr int sk_numVerts = 7;
 
+// Image component that is rendered
+static constexpr uint32_t sk_comp = 0;
+
+
+/**
+ * @brief Compute the number of full-resolution image pixels per device pixel of the view,
+ * measured at a point on the slice
+ * @param world_O_pixel Transformation from image Pixel to World space
+ * @param pixelPos Point at which to measure, in image Pixel space
+ * @return The downsample factor; std::nullopt if the image is not visible at the point
+ */
+std::optional<double> imageDownsampleInView(
+        const Viewport& viewport,
+        const camera::Camera& camera,
+        const glm::mat4& world_O_pixel,
+        const glm::vec3& pixelPos )
+{
+    auto viewDevice_O_pixel = [&viewport, &camera, &world_O_pixel] ( const glm::vec3& p )
+    {
+        const glm::vec4 worldPos = world_O_pixel * glm::vec4{ p, 1.0f };
+        const glm::vec3 ndcPos = camera::ndc_O_world( camera, glm::vec3{ worldPos } / worldPos.w );
+        return camera::viewDevice_O_ndc( viewport, glm::vec2{ ndcPos } );
+    };
+
+    const glm::vec2 p = viewDevice_O_pixel( pixelPos );
+
+    // Use the image axis that is most magnified in the view. (An axis along the view
+    // direction is not magnified at all.)
+    double devicePixels = 0.0;
+
+    for ( int i = 0; i < 3; ++i )
+    {
+        glm::vec3 step{ 0.0f };
+        step[i] = 1.0f;
+
+        devicePixels = std::max( devicePixels, static_cast<double>(
+                                     glm::length( viewDevice_O_pixel( pixelPos + step ) - p ) ) );
+    }
+
+    if ( ! std::isfinite( devicePixels ) || devicePixels <= 0.0 )
+    {
+        return std::nullopt;
+    }
+
+    return 1.0 / devicePixels;
+}
+
 } // anonymous
 
 
@@ -241,7 +292,7 @@ void ImageSlice::setUseIntensityThresolding( bool set )
 
 void ImageSlice::doUpdate(
         double /*time*/,
-        const Viewport&,
+        const Viewport& viewport,
         const camera::Camera& camera,
         const CoordinateFrame& crosshairs )
 {
@@ -335,6 +386,8 @@ void ImageSlice::doUpdate(
         worldIntersectionPositions[i] = glm::vec3{ world_O_subject * subjectPos };
     }
 
+    updateImageLevel( *image3dRecord, viewport, camera, worldIntersectionPositions );
+
     const glm::vec4 subjectNormal{ subjectPlaneNormal, 0.0f };
     const glm::vec4 worldPlaneNormal = glm::inverseTranspose( world_O_subject ) * subjectNormal;
 
@@ -373,3 +426,38 @@ void ImageSlice::doUpdate(
         m_sliceOutline->setVisible( false );
     }
 }
+
+
+void ImageSlice::updateImageLevel(
+        ImageRecord& imageRecord,
+        const Viewport& viewport,
+        const camera::Camera& camera,
+        const SliceIntersector::IntersectionVertices& worldPositions )
+{
+    size_t level = 0;
+
+    const auto pyramid = imageRecord.cpuData()->pyramid( sk_comp );
+
+    if ( pyramid && pyramid->numLevels() > 0 )
+    {
+        glm::vec3 worldCenter{ 0.0f };
+
+        for ( const glm::vec3& p : worldPositions )
+        {
+            worldCenter += p / static_cast<float>( sk_numVerts );
+        }
+
+        const auto& tx = imageRecord.cpuData()->transformations();
+        const glm::vec4 pixelCenter = tx.pixel_O_world() * glm::vec4{ worldCenter, 1.0f };
+
+        const auto downsample = imageDownsampleInView(
+                    viewport, camera, tx.world_O_pixel(), glm::vec3{ pixelCenter } / pixelCenter.w );
+
+        if ( downsample )
+        {
+            level = pyramid->levelForDownsample( *downsample );
+        }
+    }
+
+    m_sliceMesh->setImage3dLevel( level );
+}
@@ -79,6 +79,13 @@ private:
 
     void doUpdate( double time, const Viewport&, const camera::Camera&, const CoordinateFrame& ) override;
 
+    /// Select the resolution level of the image to render, such that image pixels are about
+    /// the size of device pixels at the center of the slice
+    void updateImageLevel( ImageRecord& imageRecord,
+                           const Viewport& viewport,
+                           const camera::Camera& camera,
+                           const SliceIntersector::IntersectionVertices& worldPositions );
+
     /// 3D image record being rendered in this slice
     std::weak_ptr<ImageRecord> m_image3dRecord;
 
@@ -61,7 +61,11 @@ TexturedMesh::TexturedMesh(
       m_meshGpuRecordProvider( meshGpuRecordProvider ),
 
       m_texture2d(),
+      m_texture2dAtlas(),
+      m_texture2dPageTable(),
+      m_texture2dPageScale( 0.0f, 0.0f ),
       m_image3dRecord(),
+      m_image3dLevel( 0 ),
       m_parcelRecord(),
       m_imageColorMapRecord(),
       m_labelsRecord(),
@@ -202,6 +206,17 @@ void TexturedMesh::setTexture2dThresholds( glm::vec2 thresholds )
 }
 
 
+void TexturedMesh::setVirtualTexture2d(
+        std::weak_ptr<GLTexture> atlas,
+        std::weak_ptr<GLTexture> pageTable,
+        const glm::vec2& pageScale )
+{
+    m_texture2dAtlas = atlas;
+    m_texture2dPageTable = pageTable;
+    m_texture2dPageScale = pageScale;
+}
+
+
 void TexturedMesh::setImage3dRecord( std::weak_ptr<ImageRecord> imageRecord )
 {
     m_image3dRecord = imageRecord;
@@ -257,6 +272,12 @@ std::weak_ptr<ParcellationRecord> TexturedMesh::parcelRecord()
 }
 
 
+void TexturedMesh::setImage3dLevel( size_t level )
+{
+    m_image3dLevel = level;
+}
+
+
 void TexturedMesh::setLayerPermutation(
         const std::array< TexturedMeshColorLayer, static_cast<size_t>( TexturedMeshColorLayer::NumLayers ) >& perm )
 {
@@ -541,6 +562,8 @@ void TexturedMesh::doRender( const RenderStage& stage )
     static const Uniforms::SamplerIndexType sk_label3DUnit{ 4 };
     static const Uniforms::SamplerIndexType sk_labelColorMapTexUnit{ 5 };
     static const Uniforms::SamplerIndexType sk_imageColorMapTexUnit{ 6 };
+    static const Uniforms::SamplerIndexType sk_tex2DAtlasUnit{ 7 };
+    static const Uniforms::SamplerIndexType sk_tex2DPageTableUnit{ 8 };
 
     static const glm::vec3 sk_materialSpecular{ 1.0f, 1.0f, 1.0f };
 
@@ -706,6 +729,28 @@ void TexturedMesh::doRender( const RenderStage& stage )
             }
         }
 
+        uniforms->setValue( frag::tex2DAtlas, sk_tex2DAtlasUnit );
+        uniforms->setValue( frag::tex2DPageTable, sk_tex2DPageTableUnit );
+
+        auto atlas = m_texture2dAtlas.lock();
+        auto pageTable = m_texture2dPageTable.lock();
+
+        if ( atlas && pageTable && m_texture2d.lock() )
+        {
+            atlas->bind( sk_tex2DAtlasUnit.index );
+            atlas->bindSampler( sk_tex2DAtlasUnit.index );
+
+            pageTable->bind( sk_tex2DPageTableUnit.index );
+            pageTable->bindSampler( sk_tex2DPageTableUnit.index );
+
+            uniforms->setValue( frag::tex2DPageScale, m_texture2dPageScale );
+            uniforms->setValue( frag::tex2DVirtual, true );
+        }
+        else
+        {
+            uniforms->setValue( frag::tex2DVirtual, false );
+        }
+
 
         std::optional<glm::mat4> imageSubject_O_world;
 
@@ -716,7 +761,7 @@ void TexturedMesh::doRender( const RenderStage& stage )
 
             if ( cpuRecord && gpuRecord )
             {
-                if ( auto texture = gpuRecord->texture().lock() )
+                if ( auto texture = gpuRecord->texture( m_image3dLevel ).lock() )
                 {
                     /// @todo: include sampler object in GL texture
                     texture->bind( sk_image3DUnit.index );
@@ -838,12 +883,22 @@ void TexturedMesh::doRender( const RenderStage& stage )
         texture->unbindSampler( sk_tex2DUnit.index );
     }
 
+    if ( auto atlas = m_texture2dAtlas.lock() )
+    {
+        atlas->unbindSampler( sk_tex2DAtlasUnit.index );
+    }
+
+    if ( auto pageTable = m_texture2dPageTable.lock() )
+    {
+        pageTable->unbindSampler( sk_tex2DPageTableUnit.index );
+    }
+
 
     if ( auto imageRecord = m_image3dRecord.lock() )
     {
         if ( auto gpuRecord = imageRecord->gpuData() )
         {
-            if ( auto texture = gpuRecord->texture().lock() )
+            if ( auto texture = gpuRecord->texture( m_image3dLevel ).lock() )
             {
                 // Note: unbind here wrecks render when mesh has transparency.
                 // texture->unbind();
@@ -54,9 +54,20 @@ public:
     std::weak_ptr<ImageRecord> image3dRecord();
     std::weak_ptr<ParcellationRecord> parcelRecord();
 
+    /// Set the resolution level of the 3D image to sample, where level 0 has full resolution.
+    /// If the level has not been uploaded yet, the nearest available level is sampled.
+    void setImage3dLevel( size_t level );
+
     void setTexture2d( std::weak_ptr<GLTexture> );
     void setTexture2dThresholds( glm::vec2 thresholds );
 
+    /// Set a virtual texture for the 2D image: wherever the page table maps the 2D texture
+    /// coordinates to a tile of the atlas, the tile is sampled instead of the 2D texture.
+    /// Pass null textures to sample only the 2D texture.
+    void setVirtualTexture2d( std::weak_ptr<GLTexture> atlas,
+                              std::weak_ptr<GLTexture> pageTable,
+                              const glm::vec2& pageScale );
+
 //    void addClippingPlane();
     void setUseOctantClipPlanes( bool set );
 
@@ -165,7 +176,11 @@ private:
     GetterType<MeshGpuRecord*> m_meshGpuRecordProvider;
 
     std::weak_ptr<GLTexture> m_texture2d;
+    std::weak_ptr<GLTexture> m_texture2dAtlas;
+    std::weak_ptr<GLTexture> m_texture2dPageTable;
+    glm::vec2 m_texture2dPageScale;
     std::weak_ptr<ImageRecord> m_image3dRecord;
+    size_t m_image3dLevel;
     std::weak_ptr<ParcellationRecord> m_parcelRecord;
     std::weak_ptr<ImageColorMapRecord> m_imageColorMapRecord;
     std::weak_ptr<LabelTableRecord> m_labelsRecord;
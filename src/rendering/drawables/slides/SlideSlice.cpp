@@ -6,13 +6,17 @@
 #include "rendering/drawables/TexturedMesh.h"
 #include "rendering/drawables/Transformation.h"
 #include "rendering/records/MeshGpuRecord.h"
+#include "rendering/records/SlidePageTable.h"
+#include "rendering/records/SlideTileAtlas.h"
 #include "rendering/utility/UnderlyingEnumType.h"
 #include "rendering/utility/gl/GLDrawTypes.h"
 #include "rendering/utility/math/MathUtility.h"
 
 #include "common/HZeeException.hpp"
+#include "common/Viewport.h"
 #include "logic/camera/CameraHelpers.h"
 #include "slideio/SlideHelper.h"
+#include "slideio/SlideTileReader.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_inverse.hpp>
@@ -27,6 +31,9 @@
 
 #include <algorithm>
 #include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
 
 
 namespace
@@ -44,6 +51,125 @@ static const float sk_activeSlideHighlightOpacity = 0.15f;
 /// (which is a hexagon; the additional vertex set as the center hub)
 static constexpr int sk_numVerts = 7;
 
+
+/**
+ * @brief Compute the number of level 0 slide pixels per device pixel of the view,
+ * measured at a point on the slide
+ * @param tileSize Distance along the slide over which to measure, in level 0 pixels
+ * @return The downsample factor; std::nullopt if the slide is seen edge-on
+ */
+std::optional<double> slideDownsampleInView(
+        const Viewport& viewport,
+        const camera::Camera& camera,
+        const glm::mat4& world_O_slide,
+        const glm::vec3& slidePos,
+        const glm::dvec2& level0Dims,
+        double tileSize )
+{
+    auto viewDevice_O_slide = [&viewport, &camera, &world_O_slide] ( const glm::vec3& p )
+    {
+        const glm::vec4 worldPos = world_O_slide * glm::vec4{ p, 1.0f };
+        const glm::vec3 ndcPos = camera::ndc_O_world( camera, glm::vec3{ worldPos } / worldPos.w );
+        return camera::viewDevice_O_ndc( viewport, glm::vec2{ ndcPos } );
+    };
+
+    const glm::vec3 dx{ static_cast<float>( tileSize / level0Dims.x ), 0.0f, 0.0f };
+    const glm::vec3 dy{ 0.0f, static_cast<float>( tileSize / level0Dims.y ), 0.0f };
+
+    const glm::vec2 p = viewDevice_O_slide( slidePos );
+
+    // Use the direction of the slide that is most magnified in the view
+    const double devicePixels = static_cast<double>( std::max(
+                glm::length( viewDevice_O_slide( slidePos + dx ) - p ),
+                glm::length( viewDevice_O_slide( slidePos + dy ) - p ) ) );
+
+    if ( ! std::isfinite( devicePixels ) || devicePixels <= 0.0 )
+    {
+        return std::nullopt;
+    }
+
+    return tileSize / devicePixels;
+}
+
+
+/**
+ * @brief Compute the bounding box of the region of a slide slice that is visible in the view,
+ * in normalized slide coordinates
+ * @param camera View camera
+ * @param slide_O_world Transformation from World to normalized slide coordinates
+ * @param slidePositions Vertices of the slice polygon in normalized slide coordinates
+ * @param slidePlane Equation of the slice plane in normalized slide coordinates
+ * @return Minimum and maximum corners of the region; std::nullopt if no region is visible
+ */
+std::optional< std::pair< glm::dvec2, glm::dvec2 > > visibleSlideRegion(
+        const camera::Camera& camera,
+        const glm::mat4& slide_O_world,
+        const SliceIntersector::IntersectionVertices& slidePositions,
+        const glm::vec3& slidePlaneNormal )
+{
+    static const std::array< glm::vec2, 4 > sk_ndcCorners =
+    { { { -1.0f, -1.0f }, { 1.0f, -1.0f }, { 1.0f, 1.0f }, { -1.0f, 1.0f } } };
+
+    auto slide_O_ndc = [&camera, &slide_O_world] ( const glm::vec3& ndcPos )
+    {
+        const glm::vec4 slidePos = slide_O_world * glm::vec4{ camera::world_O_ndc( camera, ndcPos ), 1.0f };
+        return glm::dvec3{ slidePos } / static_cast<double>( slidePos.w );
+    };
+
+    // Bounding box of the slice polygon
+    glm::dvec2 regionMin{ std::numeric_limits<double>::max() };
+    glm::dvec2 regionMax{ std::numeric_limits<double>::lowest() };
+
+    for ( const glm::vec3& p : slidePositions )
+    {
+        regionMin = glm::min( regionMin, glm::dvec2{ p } );
+        regionMax = glm::max( regionMax, glm::dvec2{ p } );
+    }
+
+    // Clip the bounding box to the view by intersecting the rays through the view corners
+    // with the slice plane. Skip clipping if any ray is parallel to the plane.
+    const glm::dvec3 n{ slidePlaneNormal };
+    const glm::dvec3 p0{ slidePositions[0] };
+
+    glm::dvec2 viewMin{ std::numeric_limits<double>::max() };
+    glm::dvec2 viewMax{ std::numeric_limits<double>::lowest() };
+    bool clipToView = true;
+
+    for ( const glm::vec2& corner : sk_ndcCorners )
+    {
+        const glm::dvec3 rayNear = slide_O_ndc( glm::vec3{ corner, -1.0f } );
+        const glm::dvec3 rayDir = slide_O_ndc( glm::vec3{ corner, 1.0f } ) - rayNear;
+        const double denom = glm::dot( n, rayDir );
+
+        if ( std::abs( denom ) < 1.0e-12 )
+        {
+            clipToView = false;
+            break;
+        }
+
+        const glm::dvec3 q = rayNear + ( glm::dot( n, p0 - rayNear ) / denom ) * rayDir;
+
+        viewMin = glm::min( viewMin, glm::dvec2{ q } );
+        viewMax = glm::max( viewMax, glm::dvec2{ q } );
+    }
+
+    if ( clipToView )
+    {
+        regionMin = glm::max( regionMin, viewMin );
+        regionMax = glm::min( regionMax, viewMax );
+    }
+
+    regionMin = glm::clamp( regionMin, glm::dvec2{ 0.0 }, glm::dvec2{ 1.0 } );
+    regionMax = glm::clamp( regionMax, glm::dvec2{ 0.0 }, glm::dvec2{ 1.0 } );
+
+    if ( regionMax.x <= regionMin.x || regionMax.y <= regionMin.y )
+    {
+        return std::nullopt;
+    }
+
+    return std::make_pair( regionMin, regionMax );
+}
+
 } // anonymous
 
 
@@ -55,12 +181,16 @@ SlideSlice::SlideSlice(
         std::weak_ptr<MeshGpuRecord> sliceMeshGpuRecord,
         std::weak_ptr<SlideRecord> slideRecord,
         QuerierType<bool, UID> activeSlideQuerier,
-        GetterType<float> image3dLayerOpacityProvider )
+        GetterType<float> image3dLayerOpacityProvider,
+        std::weak_ptr<SlideTileAtlas> tileAtlas,
+        SlideTileRequesterType tileRequester )
     :
       DrawableBase( std::move( name ), DrawableType::SlideSlice ),
 
       m_activeSlideQuerier( activeSlideQuerier ),
       m_image3dLayerOpacityProvider( image3dLayerOpacityProvider ),
+      m_tileAtlas( tileAtlas ),
+      m_tileRequester( tileRequester ),
 
       m_sliceMeshGpuRecord( sliceMeshGpuRecord ),
       m_slideRecord( slideRecord ),
@@ -254,9 +384,138 @@ void SlideSlice::setupChildren()
 }
 
 
+void SlideSlice::updateVirtualTexture(
+        SlideRecord& slideRecord,
+        const Viewport& viewport,
+        const camera::Camera& camera,
+        const glm::mat4& world_O_slide,
+        const SliceIntersector::IntersectionVertices& slidePositions )
+{
+    // By default, only the ordinary slide texture is sampled
+    m_sliceMesh->setVirtualTexture2d( {}, {}, glm::vec2{ 0.0f } );
+
+    auto atlas = m_tileAtlas.lock();
+    auto texture = slideRecord.gpuData()->texture().lock();
+    auto pageTable = slideRecord.gpuData()->pageTable().lock();
+    auto reader = slideRecord.cpuData()->tileReader();
+
+    if ( ! atlas || ! texture || ! pageTable || ! reader ||
+         ! reader->isValid() || reader->tileSize() != atlas->tileSize() )
+    {
+        return;
+    }
+
+    const glm::dvec2 level0Dims{ reader->levelDims( 0 ) };
+    const double tileSize = static_cast<double>( reader->tileSize() );
+
+    glm::vec3 slideCenter{ 0.0f };
+
+    for ( const glm::vec3& p : slidePositions )
+    {
+        slideCenter += p / static_cast<float>( sk_numVerts );
+    }
+
+    const auto downsample = slideDownsampleInView(
+                viewport, camera, world_O_slide, slideCenter, level0Dims, tileSize );
+
+    if ( ! downsample )
+    {
+        return;
+    }
+
+    const int level = reader->bestLevelForDownsample( *downsample );
+
+    // Tiles are not needed if the ordinary texture already has enough resolution for the view
+    const double textureDownsample = level0Dims.x / static_cast<double>( std::max( texture->size().x, 1u ) );
+
+    if ( reader->levelDownsample( level ) >= textureDownsample )
+    {
+        return;
+    }
+
+    const auto region = visibleSlideRegion(
+                camera, glm::inverse( world_O_slide ), slidePositions, m_modelPlaneNormal );
+
+    if ( ! region )
+    {
+        return;
+    }
+
+    // Tiles of the visible region, sorted from the center of the view outwards, so that
+    // the central tiles are kept if there are more tiles than atlas slots
+    const glm::dvec2 levelDims{ reader->levelDims( level ) };
+    const glm::i64vec2 regionOrigin{ glm::floor( region->first * levelDims ) };
+    const glm::i64vec2 regionEnd{ glm::ceil( region->second * levelDims ) };
+
+    std::vector< glm::i64vec2 > tiles = reader->tilesInRegion( level, regionOrigin, regionEnd - regionOrigin );
+
+    auto isBackground = [&reader, level] ( const glm::i64vec2& tileIndex )
+    {
+        return reader->isBackgroundTile( level, tileIndex );
+    };
+
+    // Skipped tiles of background are neither read nor uploaded: the ordinary texture shows them
+    if ( reader->skipBackgroundTiles() )
+    {
+        tiles.erase( std::remove_if( std::begin( tiles ), std::end( tiles ), isBackground ), std::end( tiles ) );
+    }
+
+    const glm::dvec2 centerTile = 0.5 * ( region->first + region->second ) * levelDims / tileSize - 0.5;
+
+    std::sort( std::begin( tiles ), std::end( tiles ),
+               [&centerTile] ( const glm::i64vec2& a, const glm::i64vec2& b )
+    {
+        return ( glm::length( glm::dvec2{ a } - centerTile ) < glm::length( glm::dvec2{ b } - centerTile ) );
+    } );
+
+    // Tiles of background that are not skipped follow all tiles of tissue, so that they are
+    // dropped first if there are more tiles than atlas slots
+    std::stable_partition( std::begin( tiles ), std::end( tiles ),
+                           [&isBackground] ( const glm::i64vec2& tileIndex ) { return ( ! isBackground( tileIndex ) ); } );
+
+    if ( tiles.size() > atlas->numSlots() )
+    {
+        tiles.resize( atlas->numSlots() );
+    }
+
+    // Make cached tiles resident and request the others. The atlas requests of the frame were
+    // begun by the slide stack, so tiles requested by other slides of the frame stay resident.
+    std::vector< glm::i64vec2 > missingTiles;
+
+    for ( const glm::i64vec2& tileIndex : tiles )
+    {
+        const slideio::SlideTileKey key{ reader->slideUid(), level, tileIndex };
+
+        if ( atlas->requestTile( key ) )
+        {
+            continue;
+        }
+
+        if ( auto tile = reader->findCachedTile( level, tileIndex ) )
+        {
+            atlas->insertTile( key, *tile );
+        }
+        else
+        {
+            missingTiles.push_back( tileIndex );
+        }
+    }
+
+    if ( ! missingTiles.empty() && m_tileRequester )
+    {
+        m_tileRequester( slideRecord.uid(), level, missingTiles );
+    }
+
+    if ( pageTable->update( *reader, *atlas, level ) )
+    {
+        m_sliceMesh->setVirtualTexture2d( atlas->texture(), pageTable->texture(), pageTable->pageScale() );
+    }
+}
+
+
 void SlideSlice::doUpdate(
         double /*time*/,
-        const Viewport&,
+        const Viewport& viewport,
         const camera::Camera& camera,
         const CoordinateFrame& crosshairs )
 {
@@ -345,6 +604,9 @@ void SlideSlice::doUpdate(
 
     math::applyLayeringOffsetsToModelPositions( camera, slide_O_world, 2, positions );
 
+    updateVirtualTexture( *slideRecord, viewport, camera, world_O_stack * stack_O_slide,
+                          *slideIntersectionPositions );
+
 
     auto& positionsObject = sliceMeshGpuRecord->positionsObject();
     auto& normalsObject = sliceMeshGpuRecord->normalsObject();
@@ -3,6 +3,7 @@
 
 #include "rendering/common/MeshColorLayer.h"
 #include "rendering/common/ShaderProviderType.h"
+#include "rendering/common/SlideTileRequesterType.h"
 #include "rendering/drawables/DrawableBase.h"
 #include "rendering/interfaces/ITexturable3D.h"
 #include "rendering/utility/containers/Uniforms.h"
@@ -21,6 +22,7 @@
 class BlankTextures;
 class Line;
 class MeshGpuRecord;
+class SlideTileAtlas;
 class TexturedMesh;
 class Transformation;
 
@@ -39,7 +41,9 @@ public:
                 std::weak_ptr<MeshGpuRecord> sliceMeshGpuRecord,
                 std::weak_ptr<SlideRecord> slideRecord,
                 QuerierType<bool, UID> activeSlideQuerier,
-                GetterType<float> image3dLayerOpacityProvider );
+                GetterType<float> image3dLayerOpacityProvider,
+                std::weak_ptr<SlideTileAtlas> tileAtlas,
+                SlideTileRequesterType tileRequester );
 
     SlideSlice( const SlideSlice& ) = delete;
     SlideSlice& operator=( const SlideSlice& ) = delete;
@@ -79,12 +83,27 @@ private:
 
     void setupChildren();
 
+    /// Make the tiles of the slide that are visible in the view resident in the tile atlas,
+    /// at the file level that matches the view resolution. Tiles that are not cached are
+    /// requested, and are made resident in later updates.
+    void updateVirtualTexture( SlideRecord& slideRecord,
+                               const Viewport& viewport,
+                               const camera::Camera& camera,
+                               const glm::mat4& world_O_slide,
+                               const SliceIntersector::IntersectionVertices& slidePositions );
+
     /// Function that returns true iff the provided UID is for the active slide
     QuerierType<bool, UID> m_activeSlideQuerier;
 
     /// Function that returns the opacity of the 3D image layer
     GetterType<float> m_image3dLayerOpacityProvider;
 
+    /// Atlas of slide tiles resident on the GPU, which is shared by all slides
+    std::weak_ptr<SlideTileAtlas> m_tileAtlas;
+
+    /// Function that requests slide tiles that are not cached
+    SlideTileRequesterType m_tileRequester;
+
     std::weak_ptr<MeshGpuRecord> m_sliceMeshGpuRecord;
     std::weak_ptr<SlideRecord> m_slideRecord;
 
@@ -1,11 +1,199 @@
 #include "rendering/records/ImageGpuRecord.h"
 #include "rendering/utility/gl/GLTexture.h"
+#include "rendering/utility/gl/GLTextureUploader.h"
+
+#include <algorithm>
+#include <iostream>
+#include <utility>
+
 
 ImageGpuRecord::ImageGpuRecord( std::shared_ptr<GLTexture> texture )
-    : m_texture( texture )
+    : m_levelTextures{ texture },
+      m_levelUploaders( 1 ),
+      m_activeUpload( nullptr ),
+      m_activeLevel( 0 ),
+      m_minFilter( std::nullopt ),
+      m_magFilter( std::nullopt ),
+      m_autoGenerateMipmaps( false )
+{}
+
+ImageGpuRecord::ImageGpuRecord( std::vector<LevelUploader> levelUploaders )
+    : m_levelTextures( levelUploaders.size() ),
+      m_levelUploaders( std::move( levelUploaders ) ),
+      m_activeUpload( nullptr ),
+      m_activeLevel( 0 ),
+      m_minFilter( std::nullopt ),
+      m_magFilter( std::nullopt ),
+      m_autoGenerateMipmaps( false )
 {}
 
 std::weak_ptr<GLTexture> ImageGpuRecord::texture()
 {
-    return m_texture;
+    return texture( 0 );
+}
+
+std::weak_ptr<GLTexture> ImageGpuRecord::texture( size_t level )
+{
+    for ( size_t i = level; i < m_levelTextures.size(); ++i )
+    {
+        if ( m_levelTextures[i] )
+        {
+            return m_levelTextures[i];
+        }
+    }
+
+    for ( size_t i = std::min( level, m_levelTextures.size() ); i > 0; --i )
+    {
+        if ( m_levelTextures[i - 1] )
+        {
+            return m_levelTextures[i - 1];
+        }
+    }
+
+    return {};
+}
+
+size_t ImageGpuRecord::numLevels() const
+{
+    return m_levelTextures.size();
+}
+
+bool ImageGpuRecord::hasPendingLevels() const
+{
+    if ( m_activeUpload )
+    {
+        return true;
+    }
+
+    for ( const auto& uploader : m_levelUploaders )
+    {
+        if ( uploader )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool ImageGpuRecord::uploadNextChunk()
+{
+    if ( ! m_activeUpload )
+    {
+        // Start the upload of the coarsest pending level
+        for ( size_t i = m_levelUploaders.size(); i > 0; --i )
+        {
+            LevelUploader& uploader = m_levelUploaders[i - 1];
+
+            if ( ! uploader )
+            {
+                continue;
+            }
+
+            // The uploader is released whether or not it succeeds, so that a failed level
+            // is not attempted again
+            m_activeUpload = uploader();
+            m_activeLevel = i - 1;
+            uploader = nullptr;
+            break;
+        }
+
+        if ( ! m_activeUpload )
+        {
+            return false;
+        }
+    }
+
+    const bool uploaded = m_activeUpload->uploadNextSlab();
+
+    if ( m_activeUpload->isComplete() )
+    {
+        auto texture = m_activeUpload->texture();
+
+        if ( m_minFilter )
+        {
+            texture->setMinificationFilter( *m_minFilter );
+        }
+
+        if ( m_magFilter )
+        {
+            texture->setMagnificationFilter( *m_magFilter );
+        }
+
+        if ( m_autoGenerateMipmaps )
+        {
+            texture->setAutoGenerateMipmaps( true );
+        }
+
+        m_levelTextures[m_activeLevel] = std::move( texture );
+        m_activeUpload = nullptr;
+        return true;
+    }
+
+    if ( ! uploaded )
+    {
+        std::cerr << "Error uploading level " << m_activeLevel << " of image texture" << std::endl;
+        m_activeUpload = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+bool ImageGpuRecord::uploadNextLevel()
+{
+    while ( uploadNextChunk() )
+    {
+        if ( ! m_activeUpload )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+std::optional<size_t> ImageGpuRecord::uploadingLevel() const
+{
+    if ( m_activeUpload )
+    {
+        return m_activeLevel;
+    }
+
+    return std::nullopt;
+}
+
+double ImageGpuRecord::uploadingLevelProgress() const
+{
+    return ( m_activeUpload ) ? m_activeUpload->progress() : 0.0;
+}
+
+void ImageGpuRecord::setFilters(
+        const tex::MinificationFilter& minFilter,
+        const tex::MagnificationFilter& magFilter )
+{
+    m_minFilter = minFilter;
+    m_magFilter = magFilter;
+
+    for ( auto& texture : m_levelTextures )
+    {
+        if ( texture )
+        {
+            texture->setMinificationFilter( minFilter );
+            texture->setMagnificationFilter( magFilter );
+        }
+    }
+}
+
+void ImageGpuRecord::setAutoGenerateMipmaps( bool set )
+{
+    m_autoGenerateMipmaps = set;
+
+    for ( auto& texture : m_levelTextures )
+    {
+        if ( texture )
+        {
+            texture->setAutoGenerateMipmaps( set );
+        }
+    }
 }
@@ -1,15 +1,40 @@
 #ifndef IMAGE_GPU_RECORD_H
 #define IMAGE_GPU_RECORD_H
 
+#include "rendering/utility/gl/GLTextureTypes.h"
+
+#include <functional>
 #include <memory>
+#include <optional>
+#include <vector>
 
 class GLTexture;
+class GLTextureUploader;
+
 
+/**
+ * @brief GPU record of a 3D image. The image may have multiple levels of resolution, each in its
+ * own texture: level 0 has full resolution and each further level is coarser. Levels are
+ * uploaded one at a time, from coarsest to finest, so that the image can be shown at coarse
+ * resolution before the finer levels have been uploaded. Each level is uploaded in chunks,
+ * and a level is not sampled until all of its chunks have been uploaded.
+ */
 class ImageGpuRecord
 {
 public:
 
+    /// Function that creates the texture of a level, allocates its storage, and returns an
+    /// uploader of its pixels. It is called with the OpenGL context current and returns null
+    /// if the texture cannot be created.
+    using LevelUploader = std::function< std::shared_ptr<GLTextureUploader> (void) >;
+
+    /// Construct a record of a single-level image, whose texture is already uploaded
     explicit ImageGpuRecord( std::shared_ptr<GLTexture> texture );
+
+    /// Construct a record of a multi-level image from the uploaders of its levels, ordered from
+    /// finest to coarsest. No level is uploaded until \c uploadNextChunk is called.
+    explicit ImageGpuRecord( std::vector<LevelUploader> levelUploaders );
+
     ImageGpuRecord() = delete;
 
     ImageGpuRecord( const ImageGpuRecord& ) = default;
@@ -22,12 +47,67 @@ public:
 
     // Return as non-const, since users need access to
     // non-const member functions of GLTexture
+
+    /// Get the texture of the finest level that has been uploaded
     std::weak_ptr<GLTexture> texture();
 
+    /// Get the texture of a level. If the level has not been uploaded yet, the texture of the
+    /// nearest coarser uploaded level is returned, or else of the nearest finer one.
+    std::weak_ptr<GLTexture> texture( size_t level );
+
+    /// Get the number of levels
+    size_t numLevels() const;
+
+    /// Get whether levels remain to be uploaded
+    bool hasPendingLevels() const;
+
+    /**
+     * @brief Upload the next chunk of the level being uploaded. If no level is being uploaded,
+     * the upload of the coarsest level that has not been uploaded yet is started.
+     * Must be called with the OpenGL context current.
+     *
+     * @return True iff a chunk was uploaded
+     */
+    bool uploadNextChunk();
+
+    /**
+     * @brief Upload chunks until the level being uploaded (or else the next level) is complete.
+     * Must be called with the OpenGL context current.
+     *
+     * @return True iff a level was completed
+     */
+    bool uploadNextLevel();
+
+    /// Get the level being uploaded; std::nullopt if no level is being uploaded
+    std::optional<size_t> uploadingLevel() const;
+
+    /// Get the fraction of the level being uploaded that is done, from 0 to 1
+    double uploadingLevelProgress() const;
+
+    /// Set the filters of the textures of all levels, including levels uploaded later
+    void setFilters( const tex::MinificationFilter& minFilter,
+                     const tex::MagnificationFilter& magFilter );
+
+    /// Set whether mipmaps are generated for the textures of all levels, including levels
+    /// uploaded later (once they are complete)
+    void setAutoGenerateMipmaps( bool set );
+
 
 private:
 
-    std::shared_ptr<GLTexture> m_texture;
+    /// Textures of the levels; null for levels that have not been uploaded
+    std::vector< std::shared_ptr<GLTexture> > m_levelTextures;
+
+    /// Uploaders of the levels; null for levels whose upload has started
+    std::vector< LevelUploader > m_levelUploaders;
+
+    /// Upload in progress and its level
+    std::shared_ptr<GLTextureUploader> m_activeUpload;
+    size_t m_activeLevel;
+
+    std::optional<tex::MinificationFilter> m_minFilter;
+    std::optional<tex::MagnificationFilter> m_magFilter;
+    bool m_autoGenerateMipmaps;
 };
 
 #endif // IMAGE_GPU_RECORD_H
@@ -0,0 +1,245 @@
+#include "rendering/records/SlideAtlasLayout.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+
+SlideAtlasLayout::SlideAtlasLayout( int64_t tileSize, int numSlotsPerSide )
+    :
+      m_tileSize( std::max( tileSize, int64_t( 1 ) ) ),
+      m_numSlotsPerSide( std::max( numSlotsPerSide, 1 ) ),
+      m_slots( static_cast<size_t>( m_numSlotsPerSide * m_numSlotsPerSide ) ),
+      m_slotOfTile(),
+      m_currentRequest( 0 ),
+      m_residencyVersionCounter( 0 ),
+      m_slideResidencies()
+{}
+
+
+int64_t SlideAtlasLayout::tileSize() const
+{
+    return m_tileSize;
+}
+
+glm::i64vec2 SlideAtlasLayout::dims() const
+{
+    return glm::i64vec2{ m_numSlotsPerSide * ( m_tileSize + 2 * sk_slotBorder ) };
+}
+
+size_t SlideAtlasLayout::numSlots() const
+{
+    return m_slots.size();
+}
+
+
+void SlideAtlasLayout::beginRequests()
+{
+    ++m_currentRequest;
+}
+
+
+std::optional<glm::i64vec2> SlideAtlasLayout::requestTile( const slideio::SlideTileKey& key )
+{
+    auto it = m_slotOfTile.find( key );
+
+    if ( std::end( m_slotOfTile ) == it )
+    {
+        return std::nullopt;
+    }
+
+    m_slots[it->second].m_lastRequest = m_currentRequest;
+    return tileOrigin( it->second );
+}
+
+
+std::optional<glm::i64vec2> SlideAtlasLayout::insertTile( const slideio::SlideTileKey& key )
+{
+    if ( auto origin = requestTile( key ) )
+    {
+        return origin;
+    }
+
+    // Use the least recently requested slot. Free slots are never requested, so they come first.
+    auto slotIt = std::min_element( std::begin( m_slots ), std::end( m_slots ),
+                                    [] ( const Slot& a, const Slot& b ) { return ( a.m_lastRequest < b.m_lastRequest ); } );
+
+    if ( slotIt->m_key && slotIt->m_lastRequest == m_currentRequest )
+    {
+        // All slots hold tiles of the current requests
+        return std::nullopt;
+    }
+
+    const size_t slotIndex = static_cast<size_t>( std::distance( std::begin( m_slots ), slotIt ) );
+
+    if ( slotIt->m_key )
+    {
+        updateResidency( slotIt->m_key->m_slideUid, false );
+        m_slotOfTile.erase( *( slotIt->m_key ) );
+    }
+
+    slotIt->m_key = key;
+    slotIt->m_lastRequest = m_currentRequest;
+
+    m_slotOfTile[key] = slotIndex;
+    updateResidency( key.m_slideUid, true );
+
+    return tileOrigin( slotIndex );
+}
+
+
+void SlideAtlasLayout::padTile( const slideio::SlideTile& tile, std::vector<uint32_t>& slotBuffer ) const
+{
+    const int64_t B = sk_slotBorder;
+    const int64_t slotSize = m_tileSize + 2 * B;
+
+    slotBuffer.resize( static_cast<size_t>( slotSize * slotSize ) );
+
+    for ( int64_t y = 0; y < slotSize; ++y )
+    {
+        const int64_t ty = std::clamp( y - B, int64_t( 0 ), tile.m_dims.y - 1 );
+        const uint32_t* srcRow = tile.m_data.get() + ty * tile.m_dims.x;
+        uint32_t* dstRow = slotBuffer.data() + y * slotSize;
+
+        std::fill( dstRow, dstRow + B, srcRow[0] );
+
+        const int64_t width = std::min( tile.m_dims.x, slotSize - B );
+        std::copy( srcRow, srcRow + width, dstRow + B );
+
+        std::fill( dstRow + B + width, dstRow + slotSize, srcRow[tile.m_dims.x - 1] );
+    }
+}
+
+
+std::vector< std::pair< slideio::SlideTileKey, glm::i64vec2 > >
+SlideAtlasLayout::residentTiles( const UID& slideUid ) const
+{
+    std::vector< std::pair< slideio::SlideTileKey, glm::i64vec2 > > tiles;
+
+    for ( const auto& t : m_slotOfTile )
+    {
+        if ( t.first.m_slideUid == slideUid )
+        {
+            tiles.emplace_back( t.first, tileOrigin( t.second ) );
+        }
+    }
+
+    return tiles;
+}
+
+
+uint64_t SlideAtlasLayout::residencyVersion( const UID& slideUid ) const
+{
+    auto it = m_slideResidencies.find( slideUid );
+    return ( std::end( m_slideResidencies ) != it ) ? it->second.m_version : 0;
+}
+
+
+std::vector<glm::vec4> SlideAtlasLayout::pageTable(
+        const UID& slideUid,
+        const std::vector<glm::i64vec2>& levelDims,
+        int64_t tileSize,
+        int level ) const
+{
+    if ( level < 0 || static_cast<size_t>( level ) >= levelDims.size() || tileSize <= 0 )
+    {
+        return {};
+    }
+
+    const int64_t T = tileSize;
+    const glm::i64vec2 dims = ( levelDims[ static_cast<size_t>( level ) ] + T - int64_t( 1 ) ) / T;
+
+    std::vector<glm::vec4> pages( static_cast<size_t>( dims.x * dims.y ), glm::vec4{ 0.0f } );
+
+    const double Td = static_cast<double>( T );
+    const glm::dvec2 atlasDims{ this->dims() };
+    const glm::dvec2 pageLevelDims{ levelDims[ static_cast<size_t>( level ) ] };
+
+    // Write coarser tiles first, so that finer tiles overwrite them
+    auto tiles = residentTiles( slideUid );
+
+    std::sort( std::begin( tiles ), std::end( tiles ),
+               [] ( const auto& a, const auto& b ) { return ( a.first.m_level > b.first.m_level ); } );
+
+    for ( const auto& t : tiles )
+    {
+        const int tileLevel = t.first.m_level;
+
+        if ( tileLevel < level || static_cast<size_t>( tileLevel ) >= levelDims.size() )
+        {
+            // Tiles finer than the level are not used, since the atlas has no mipmaps
+            continue;
+        }
+
+        const glm::dvec2 tileLevelDims{ levelDims[ static_cast<size_t>( tileLevel ) ] };
+        const glm::dvec2 tileIndex{ t.first.m_index };
+
+        const glm::vec4 page{
+            tileLevelDims.x / atlasDims.x,
+            tileLevelDims.y / atlasDims.y,
+            ( static_cast<double>( t.second.x ) - tileIndex.x * Td ) / atlasDims.x,
+            ( static_cast<double>( t.second.y ) - tileIndex.y * Td ) / atlasDims.y };
+
+        if ( tileLevel == level )
+        {
+            const glm::i64vec2 i = t.first.m_index;
+
+            if ( i.x < dims.x && i.y < dims.y )
+            {
+                pages[ static_cast<size_t>( i.y * dims.x + i.x ) ] = page;
+            }
+            continue;
+        }
+
+        // Normalized slide coordinates covered by the coarser tile
+        const glm::dvec2 slideMin = ( tileIndex * Td ) / tileLevelDims;
+        const glm::dvec2 slideMax = glm::min( ( tileIndex + 1.0 ) * Td / tileLevelDims, glm::dvec2{ 1.0 } );
+
+        // Pages entirely inside the coarser tile. The last page of the level may be
+        // narrower than a tile, so it is covered if the tile reaches the slide edge.
+        const glm::dvec2 pageMin = glm::ceil( slideMin * pageLevelDims / Td );
+        glm::dvec2 pageEnd = glm::floor( slideMax * pageLevelDims / Td );
+
+        if ( slideMax.x >= 1.0 ) pageEnd.x = static_cast<double>( dims.x );
+        if ( slideMax.y >= 1.0 ) pageEnd.y = static_cast<double>( dims.y );
+
+        for ( int64_t y = static_cast<int64_t>( pageMin.y ); y < static_cast<int64_t>( pageEnd.y ); ++y )
+        {
+            for ( int64_t x = static_cast<int64_t>( pageMin.x ); x < static_cast<int64_t>( pageEnd.x ); ++x )
+            {
+                pages[ static_cast<size_t>( y * dims.x + x ) ] = page;
+            }
+        }
+    }
+
+    return pages;
+}
+
+
+glm::i64vec2 SlideAtlasLayout::tileOrigin( size_t slotIndex ) const
+{
+    const int64_t slotSize = m_tileSize + 2 * sk_slotBorder;
+    const int64_t i = static_cast<int64_t>( slotIndex );
+
+    return glm::i64vec2{ ( i % m_numSlotsPerSide ) * slotSize + sk_slotBorder,
+                         ( i / m_numSlotsPerSide ) * slotSize + sk_slotBorder };
+}
+
+
+void SlideAtlasLayout::updateResidency( const UID& slideUid, bool inserted )
+{
+    SlideResidency& residency = m_slideResidencies[slideUid];
+
+    if ( inserted )
+    {
+        ++residency.m_numTiles;
+    }
+    else if ( 0 == --residency.m_numTiles )
+    {
+        m_slideResidencies.erase( slideUid );
+        return;
+    }
+
+    residency.m_version = ++m_residencyVersionCounter;
+}
@@ -0,0 +1,145 @@
+#ifndef SLIDE_ATLAS_LAYOUT_H
+#define SLIDE_ATLAS_LAYOUT_H
+
+#include "slideio/SlideTile.h"
+#include "slideio/SlideTileCache.h"
+
+#include "common/UID.h"
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+/**
+ * @brief Layout of the tile atlas that is shared by all slides: which slide tiles are resident
+ * in which slots of the atlas, and the page tables that map the tiles of slide levels to them.
+ *
+ * The atlas is divided into a grid of equally-sized slots, each of which holds one tile.
+ * Every slot has a border of one texel around its tile. When no slot is free, the tile that
+ * was least recently requested is evicted, but tiles requested since the last call to
+ * beginRequests() are never evicted.
+ *
+ * The layout holds no OpenGL objects, so it can be used without an OpenGL context:
+ * \c SlideTileAtlas and \c SlidePageTable upload the tiles and pages that it lays out.
+ */
+class SlideAtlasLayout
+{
+public:
+
+    /// Width of the border around each tile in its slot, in texels
+    static constexpr int64_t sk_slotBorder = 1;
+
+    /**
+     * @brief Create the layout of an empty atlas
+     * @param tileSize Width and height of tiles in pixels
+     * @param numSlotsPerSide Number of slot columns and rows
+     */
+    SlideAtlasLayout( int64_t tileSize, int numSlotsPerSide );
+
+    SlideAtlasLayout( const SlideAtlasLayout& ) = default;
+    SlideAtlasLayout& operator=( const SlideAtlasLayout& ) = default;
+
+    ~SlideAtlasLayout() = default;
+
+    int64_t tileSize() const;
+
+    /// Get the atlas dimensions in texels
+    glm::i64vec2 dims() const;
+
+    size_t numSlots() const;
+
+    /// Start a new set of tile requests. Tiles requested after this call are not evicted
+    /// to make room for other tiles until the next call.
+    void beginRequests();
+
+    /**
+     * @brief Request a tile that is resident in the atlas
+     * @return Texel coordinates of the first tile pixel in the atlas;
+     * std::nullopt if the tile is not resident
+     */
+    std::optional<glm::i64vec2> requestTile( const slideio::SlideTileKey& key );
+
+    /**
+     * @brief Assign a slot to a tile and request it. If the tile is not resident, it takes
+     * the least recently requested slot, whose tile is evicted.
+     * @return Texel coordinates of the first tile pixel in the atlas;
+     * std::nullopt if all slots hold tiles requested since the last call to beginRequests()
+     */
+    std::optional<glm::i64vec2> insertTile( const slideio::SlideTileKey& key );
+
+    /**
+     * @brief Copy a tile into the middle of a slot-sized buffer, then replicate its edge pixels
+     * out to the slot border. Tiles at the right and bottom edges of a level are smaller than
+     * the slot, so their edges are replicated to fill the rest of the slot.
+     * @param tile Tile no larger than the tile size, with data
+     * @param[out] slotBuffer Pixels of the slot in row-major order; resized to the slot
+     */
+    void padTile( const slideio::SlideTile& tile, std::vector<uint32_t>& slotBuffer ) const;
+
+    /// Get all resident tiles of a slide, paired with the atlas texel coordinates of their first pixel
+    std::vector< std::pair< slideio::SlideTileKey, glm::i64vec2 > > residentTiles( const UID& slideUid ) const;
+
+    /// Get a counter that changes whenever tiles of a slide are inserted into or evicted from the atlas.
+    /// It is zero iff no tile of the slide is resident.
+    uint64_t residencyVersion( const UID& slideUid ) const;
+
+    /**
+     * @brief Lay out the page table of a slide level over the resident tiles of the slide
+     * (see \c SlidePageTable for the meaning of the pages)
+     * @param slideUid UID of the slide
+     * @param levelDims Dimensions of all file levels of the slide in pixels
+     * @param tileSize Width and height of the slide's tiles in pixels
+     * @param level File level whose tiles are the pages
+     * @return Pages of the level in row-major order, one per tile of the level;
+     * empty if the level does not exist
+     */
+    std::vector<glm::vec4> pageTable( const UID& slideUid,
+                                      const std::vector<glm::i64vec2>& levelDims,
+                                      int64_t tileSize,
+                                      int level ) const;
+
+
+private:
+
+    struct Slot
+    {
+        std::optional<slideio::SlideTileKey> m_key; //!< Tile held in the slot
+        uint64_t m_lastRequest = 0; //!< Request set in which the slot was last used
+    };
+
+    /// Texel coordinates of the first tile pixel in a slot
+    glm::i64vec2 tileOrigin( size_t slotIndex ) const;
+
+    /// Residency of the tiles of a slide
+    struct SlideResidency
+    {
+        uint64_t m_version = 0; //!< Value of the version counter when the tiles last changed
+        size_t m_numTiles = 0; //!< Number of resident tiles
+    };
+
+    /// Record that a tile of a slide was inserted or evicted. Slides without resident tiles
+    /// are forgotten, so that only slides with resident tiles are tracked.
+    void updateResidency( const UID& slideUid, bool inserted );
+
+    int64_t m_tileSize;
+    int m_numSlotsPerSide;
+
+    std::vector<Slot> m_slots;
+    std::unordered_map< slideio::SlideTileKey, size_t, slideio::SlideTileKeyHash > m_slotOfTile;
+
+    uint64_t m_currentRequest;
+
+    /// Counter of changes to the residency of all slides, which makes the residency versions
+    /// of slides unique, even across slides that are forgotten and then tracked again
+    uint64_t m_residencyVersionCounter;
+    std::unordered_map< UID, SlideResidency > m_slideResidencies;
+};
+
+#endif // SLIDE_ATLAS_LAYOUT_H
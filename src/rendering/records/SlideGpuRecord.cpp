@@ -1,8 +1,12 @@
 #include "rendering/records/SlideGpuRecord.h"
+#include "rendering/records/SlidePageTable.h"
 #include "rendering/utility/gl/GLTexture.h"
 
-SlideGpuRecord::SlideGpuRecord( std::shared_ptr<GLTexture> texture )
+SlideGpuRecord::SlideGpuRecord(
+        std::shared_ptr<GLTexture> texture,
+        std::shared_ptr<SlidePageTable> pageTable )
     : m_texture( texture ),
+      m_pageTable( pageTable ),
       m_activeLevel( 0 )
 {
 }
@@ -11,3 +15,8 @@ std::weak_ptr<GLTexture> SlideGpuRecord::texture()
 {
     return m_texture;
 }
+
+std::weak_ptr<SlidePageTable> SlideGpuRecord::pageTable()
+{
+    return m_pageTable;
+}
@@ -4,12 +4,14 @@
 #include <memory>
 
 class GLTexture;
+class SlidePageTable;
 
 class SlideGpuRecord
 {
 public:
 
-    explicit SlideGpuRecord( std::shared_ptr<GLTexture> texture );
+    explicit SlideGpuRecord( std::shared_ptr<GLTexture> texture,
+                             std::shared_ptr<SlidePageTable> pageTable = nullptr );
     SlideGpuRecord() = delete;
 
     SlideGpuRecord( const SlideGpuRecord& ) = default;
@@ -24,10 +26,15 @@ public:
     // non-const member functions of GLTexture
     std::weak_ptr<GLTexture> texture();
 
+    /// Page table that maps the slide's tiles into the shared tile atlas.
+    /// Null if the slide is not rendered with virtual texturing.
+    std::weak_ptr<SlidePageTable> pageTable();
+
 
 private:
 
     std::shared_ptr<GLTexture> m_texture;
+    std::shared_ptr<SlidePageTable> m_pageTable;
 
     /// Level being rendered
     int m_activeLevel;
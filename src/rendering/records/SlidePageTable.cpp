@@ -0,0 +1,105 @@
+#include "rendering/records/SlidePageTable.h"
+#include "rendering/records/SlideTileAtlas.h"
+#include "rendering/utility/gl/GLTexture.h"
+
+#include "slideio/SlideTileReader.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+
+SlidePageTable::SlidePageTable()
+    :
+      m_texture( std::make_shared<GLTexture>( tex::Target::Texture2D ) ),
+      m_level( std::nullopt ),
+      m_residencyVersion( 0 ),
+      m_dims( 1, 1 ),
+      m_pageScale( 0.0f, 0.0f ),
+      m_pages( 1, glm::vec4{ 0.0f } )
+{
+    m_texture->generate();
+    m_texture->setSize( glm::uvec3{ m_dims.x, m_dims.y, 1 } );
+
+    m_texture->setData( 0,
+                        tex::SizedInternalFormat::RGBA32F,
+                        tex::BufferPixelFormat::RGBA,
+                        tex::BufferPixelDataType::Float32,
+                        m_pages.data() );
+
+    // Pages are fetched without filtering
+    m_texture->setAutoGenerateMipmaps( false );
+    m_texture->setWrapMode( tex::WrapMode::ClampToEdge );
+    m_texture->setMinificationFilter( tex::MinificationFilter::Nearest );
+    m_texture->setMagnificationFilter( tex::MagnificationFilter::Nearest );
+}
+
+SlidePageTable::~SlidePageTable() = default;
+
+
+std::weak_ptr<GLTexture> SlidePageTable::texture()
+{
+    return m_texture;
+}
+
+glm::vec2 SlidePageTable::pageScale() const
+{
+    return m_pageScale;
+}
+
+
+bool SlidePageTable::update(
+        const slideio::SlideTileReader& reader,
+        const SlideTileAtlas& atlas,
+        int level )
+{
+    const glm::i64vec2 dims = reader.levelTileCounts( level );
+
+    if ( dims.x <= 0 || dims.y <= 0 || dims.x > sk_maxDims || dims.y > sk_maxDims )
+    {
+        return false;
+    }
+
+    const uint64_t residencyVersion = atlas.residencyVersion( reader.slideUid() );
+
+    if ( m_level && *m_level == level && m_residencyVersion == residencyVersion )
+    {
+        return true;
+    }
+
+    std::vector<glm::i64vec2> levelDims;
+
+    for ( int i = 0; i < reader.numLevels(); ++i )
+    {
+        levelDims.push_back( reader.levelDims( i ) );
+    }
+
+    m_pages = atlas.layout().pageTable( reader.slideUid(), levelDims, reader.tileSize(), level );
+
+    if ( m_dims != dims )
+    {
+        m_dims = dims;
+        m_texture->setSize( glm::uvec3{ m_dims.x, m_dims.y, 1 } );
+
+        m_texture->setData( 0,
+                            tex::SizedInternalFormat::RGBA32F,
+                            tex::BufferPixelFormat::RGBA,
+                            tex::BufferPixelDataType::Float32,
+                            m_pages.data() );
+    }
+    else
+    {
+        m_texture->setSubData( 0,
+                               glm::uvec3{ 0, 0, 0 },
+                               glm::uvec3{ m_dims.x, m_dims.y, 1 },
+                               tex::BufferPixelFormat::RGBA,
+                               tex::BufferPixelDataType::Float32,
+                               m_pages.data() );
+    }
+
+    m_level = level;
+    m_residencyVersion = residencyVersion;
+    m_pageScale = glm::vec2{ glm::dvec2{ reader.levelDims( level ) } / static_cast<double>( reader.tileSize() ) };
+
+    return true;
+}
@@ -0,0 +1,80 @@
+#ifndef SLIDE_PAGE_TABLE_H
+#define SLIDE_PAGE_TABLE_H
+
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+
+class GLTexture;
+class SlideTileAtlas;
+
+namespace slideio
+{
+class SlideTileReader;
+}
+
+
+/**
+ * @brief Indirection texture that maps the tiles of one slide level to their slots
+ * in the shared tile atlas. There is one texel (page) per tile of the level.
+ *
+ * Each page holds the affine map from normalized slide coordinates to normalized atlas
+ * coordinates of the tile that covers it: atlasCoords = slideCoords * page.xy + page.zw.
+ * Pages whose tile is not resident map to the finest resident tile of a coarser level
+ * that covers the whole page. Pages with no resident tile at all are zero; for these,
+ * the slide's ordinary texture is sampled instead.
+ *
+ * @note Construction and updates require a current OpenGL context.
+ */
+class SlidePageTable
+{
+public:
+
+    /// Maximum number of page columns and rows
+    static constexpr int64_t sk_maxDims = 4096;
+
+    SlidePageTable();
+
+    SlidePageTable( const SlidePageTable& ) = delete;
+    SlidePageTable& operator=( const SlidePageTable& ) = delete;
+
+    ~SlidePageTable();
+
+    std::weak_ptr<GLTexture> texture();
+
+    /// Get the number of pages per unit of normalized slide coordinates
+    /// (i.e. the level dimensions divided by the tile size)
+    glm::vec2 pageScale() const;
+
+    /**
+     * @brief Map the pages of a level to the tiles of the slide that are resident in the atlas.
+     * The table is rebuilt only if the level or the slide's residency in the atlas has changed.
+     * @param reader Tile reader of the slide
+     * @param atlas Tile atlas
+     * @param level File level whose tiles are the pages
+     * @return False iff the level has too many tiles for a page table
+     */
+    bool update( const slideio::SlideTileReader& reader, const SlideTileAtlas& atlas, int level );
+
+
+private:
+
+    std::shared_ptr<GLTexture> m_texture;
+
+    /// Level and residency version of the atlas for which the table was last built
+    std::optional<int> m_level;
+    uint64_t m_residencyVersion;
+
+    glm::i64vec2 m_dims;
+    glm::vec2 m_pageScale;
+
+    std::vector<glm::vec4> m_pages;
+};
+
+#endif // SLIDE_PAGE_TABLE_H
@@ -0,0 +1,126 @@
+#include "rendering/records/SlideTileAtlas.h"
+#include "rendering/utility/gl/GLTexture.h"
+
+#include "slideio/SlideTile.h"
+
+#include <glm/glm.hpp>
+
+
+SlideTileAtlas::SlideTileAtlas( int64_t tileSize, int numSlotsPerSide )
+    :
+      m_texture( std::make_shared<GLTexture>( tex::Target::Texture2D ) ),
+      m_layout( tileSize, numSlotsPerSide ),
+      m_slotBuffer()
+{
+    const glm::i64vec2 atlasDims = dims();
+
+    m_texture->generate();
+    m_texture->setSize( glm::uvec3{ atlasDims.x, atlasDims.y, 1 } );
+
+    // Allocate storage without data: slots are written as tiles are inserted
+    m_texture->setData( 0,
+                        tex::SizedInternalFormat::RGBA8_UNorm,
+                        tex::BufferPixelFormat::BGRA,
+                        tex::BufferPixelDataType::UInt8,
+                        nullptr );
+
+    // The atlas has no mipmaps: the level of detail is chosen per tile
+    m_texture->setAutoGenerateMipmaps( false );
+    m_texture->setWrapMode( tex::WrapMode::ClampToEdge );
+    m_texture->setMinificationFilter( tex::MinificationFilter::Linear );
+    m_texture->setMagnificationFilter( tex::MagnificationFilter::Linear );
+}
+
+SlideTileAtlas::~SlideTileAtlas() = default;
+
+
+std::weak_ptr<GLTexture> SlideTileAtlas::texture()
+{
+    return m_texture;
+}
+
+int64_t SlideTileAtlas::tileSize() const
+{
+    return m_layout.tileSize();
+}
+
+glm::i64vec2 SlideTileAtlas::dims() const
+{
+    return m_layout.dims();
+}
+
+size_t SlideTileAtlas::numSlots() const
+{
+    return m_layout.numSlots();
+}
+
+const SlideAtlasLayout& SlideTileAtlas::layout() const
+{
+    return m_layout;
+}
+
+
+void SlideTileAtlas::beginRequests()
+{
+    m_layout.beginRequests();
+}
+
+
+std::optional<glm::i64vec2> SlideTileAtlas::requestTile( const slideio::SlideTileKey& key )
+{
+    return m_layout.requestTile( key );
+}
+
+
+std::optional<glm::i64vec2> SlideTileAtlas::insertTile(
+        const slideio::SlideTileKey& key, const slideio::SlideTile& tile )
+{
+    const int64_t tileSize = m_layout.tileSize();
+
+    if ( ! tile.m_data || tile.m_dims.x <= 0 || tile.m_dims.y <= 0 ||
+         tile.m_dims.x > tileSize || tile.m_dims.y > tileSize )
+    {
+        return std::nullopt;
+    }
+
+    if ( auto origin = m_layout.requestTile( key ) )
+    {
+        return origin;
+    }
+
+    const std::optional<glm::i64vec2> tileOrigin = m_layout.insertTile( key );
+
+    if ( ! tileOrigin )
+    {
+        // All slots hold tiles of the current requests
+        return std::nullopt;
+    }
+
+    m_layout.padTile( tile, m_slotBuffer );
+
+    const int64_t B = sk_slotBorder;
+    const int64_t slotSize = tileSize + 2 * B;
+    const glm::i64vec2 origin = *tileOrigin - B;
+
+    m_texture->setSubData( 0,
+                           glm::uvec3{ origin.x, origin.y, 0 },
+                           glm::uvec3{ slotSize, slotSize, 1 },
+                           tex::BufferPixelFormat::BGRA,
+                           tex::BufferPixelDataType::UInt8,
+                           m_slotBuffer.data() );
+
+    return tileOrigin;
+}
+
+
+std::vector< std::pair< slideio::SlideTileKey, glm::i64vec2 > >
+SlideTileAtlas::residentTiles( const UID& slideUid ) const
+{
+    return m_layout.residentTiles( slideUid );
+}
+
+
+uint64_t SlideTileAtlas::residencyVersion( const UID& slideUid ) const
+{
+    return m_layout.residencyVersion( slideUid );
+}
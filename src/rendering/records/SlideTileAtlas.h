@@ -0,0 +1,109 @@
+#ifndef SLIDE_TILE_ATLAS_H
+#define SLIDE_TILE_ATLAS_H
+
+#include "rendering/records/SlideAtlasLayout.h"
+
+#include "slideio/SlideTileCache.h"
+
+#include "common/UID.h"
+
+#include <glm/vec2.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+
+class GLTexture;
+
+namespace slideio
+{
+struct SlideTile;
+}
+
+
+/**
+ * @brief Fixed-size physical texture that holds the slide tiles resident on the GPU.
+ * It is shared by all slides, so that GPU memory used for full-resolution slide tiles
+ * is bounded regardless of the number and size of slides.
+ *
+ * The slots of the atlas are assigned to tiles by its \c SlideAtlasLayout. The border of
+ * every slot replicates the edges of its tile, so that linear filtering never reads from
+ * neighboring slots.
+ *
+ * @note Construction and insertion of tiles require a current OpenGL context.
+ */
+class SlideTileAtlas
+{
+public:
+
+    /// Default number of slot columns and rows
+    static constexpr int sk_defaultNumSlotsPerSide = 8;
+
+    /// Width of the border around each tile in its slot, in texels
+    static constexpr int64_t sk_slotBorder = SlideAtlasLayout::sk_slotBorder;
+
+    /**
+     * @brief Create the atlas texture
+     * @param tileSize Width and height of tiles in pixels
+     * @param numSlotsPerSide Number of slot columns and rows
+     */
+    SlideTileAtlas( int64_t tileSize, int numSlotsPerSide = sk_defaultNumSlotsPerSide );
+
+    SlideTileAtlas( const SlideTileAtlas& ) = delete;
+    SlideTileAtlas& operator=( const SlideTileAtlas& ) = delete;
+
+    ~SlideTileAtlas();
+
+    std::weak_ptr<GLTexture> texture();
+
+    int64_t tileSize() const;
+
+    /// Get the atlas texture dimensions in texels
+    glm::i64vec2 dims() const;
+
+    size_t numSlots() const;
+
+    /// Get the layout of the tiles in the atlas
+    const SlideAtlasLayout& layout() const;
+
+    /// Start a new set of tile requests. Tiles requested after this call are not evicted
+    /// to make room for other tiles until the next call.
+    void beginRequests();
+
+    /**
+     * @brief Request a tile that is resident in the atlas
+     * @return Texel coordinates of the first tile pixel in the atlas;
+     * std::nullopt if the tile is not resident
+     */
+    std::optional<glm::i64vec2> requestTile( const slideio::SlideTileKey& key );
+
+    /**
+     * @brief Upload a tile to a slot of the atlas, evicting another tile if needed
+     * @return Texel coordinates of the first tile pixel in the atlas;
+     * std::nullopt if all slots hold tiles requested since the last call to beginRequests()
+     */
+    std::optional<glm::i64vec2> insertTile( const slideio::SlideTileKey& key, const slideio::SlideTile& tile );
+
+    /// Get all resident tiles of a slide, paired with the atlas texel coordinates of their first pixel
+    std::vector< std::pair< slideio::SlideTileKey, glm::i64vec2 > > residentTiles( const UID& slideUid ) const;
+
+    /// Get a counter that changes whenever tiles of a slide are inserted into or evicted from the atlas.
+    /// It is zero iff no tile of the slide is resident.
+    uint64_t residencyVersion( const UID& slideUid ) const;
+
+
+private:
+
+    std::shared_ptr<GLTexture> m_texture;
+
+    SlideAtlasLayout m_layout;
+
+    /// Buffer of a single slot, used to pad tiles with their border
+    std::vector<uint32_t> m_slotBuffer;
+};
+
+#endif // SLIDE_TILE_ATLAS_H
@@ -112,6 +112,18 @@ uniform samplerBuffer labelColormapTexture;
 uniform sampler1D imageColorMapTexture;
 //uniform sampler1D imageColorMapTexture[NUM_IMAGES];
 
+// Texture unit 7: Atlas of 2D image tiles with pre-multiplied RGBA colors
+uniform sampler2D tex2DAtlas;
+
+// Texture unit 8: Page table that maps 2D image texture coordinates to atlas coordinates
+uniform sampler2D tex2DPageTable;
+
+// Number of pages per unit of 2D image texture coordinates
+uniform vec2 tex2DPageScale;
+
+// Flag to sample the 2D image from the tile atlas where the page table has a resident tile
+uniform bool tex2DVirtual;
+
 // Slope and intercept for remapping the 3D image
 uniform float slope;
 uniform float intercept;
@@ -187,9 +199,29 @@ float computeOpacity( vec3 viewDir, float image3DAlpha )
 
 
 
+vec4 sampleImage2d()
+{
+    if ( tex2DVirtual )
+    {
+        ivec2 page = clamp( ivec2( floor( fs_in.TexCoords2D * tex2DPageScale ) ),
+                            ivec2( 0 ), textureSize( tex2DPageTable, 0 ) - 1 );
+
+        // Affine map from texture coordinates to atlas coordinates; zero if no tile is resident
+        vec4 map = texelFetch( tex2DPageTable, page, 0 );
+
+        if ( map.x > 0.0 )
+        {
+            return texture( tex2DAtlas, fs_in.TexCoords2D * map.xy + map.zw );
+        }
+    }
+
+    return texture( tex2D, fs_in.TexCoords2D );
+}
+
+
 vec4 computeImage2dColor()
 {
-    vec4 color = texture( tex2D, fs_in.TexCoords2D );
+    vec4 color = sampleImage2d();
     float mag = dot( color.rgb, vec3( 0.299, 0.587, 0.114 ) );
 
     float threshAlpha = smoothedThreshold( mag, image2dThresholds[0], image2dThresholds[1] );
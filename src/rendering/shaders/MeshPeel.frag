@@ -80,6 +80,16 @@ uniform samplerBuffer labelColormapTexture;
 // (premultiplied colors)
 uniform sampler1D imageColorMapTexture;
 
+// texture unit 7:
+// (premultiplied colors)
+uniform sampler2D tex2DAtlas; // atlas of 2D image tiles
+
+// texture unit 8:
+uniform sampler2D tex2DPageTable; // maps 2D image texture coordinates to atlas coordinates
+
+uniform vec2 tex2DPageScale;
+uniform bool tex2DVirtual;
+
 uniform float slope;
 uniform float intercept;
 
@@ -232,9 +242,28 @@ vec4 composeLayers( vec4 layers[NUM_LAYERS] )
 }
 
 
+vec4 sampleImage2d()
+{
+    if ( tex2DVirtual )
+    {
+        ivec2 page = clamp( ivec2( floor( fs_in.TexCoords2D * tex2DPageScale ) ),
+                            ivec2( 0 ), textureSize( tex2DPageTable, 0 ) - 1 );
+
+        vec4 map = texelFetch( tex2DPageTable, page, 0 );
+
+        if ( map.x > 0.0 )
+        {
+            return texture( tex2DAtlas, fs_in.TexCoords2D * map.xy + map.zw );
+        }
+    }
+
+    return texture( tex2D, fs_in.TexCoords2D );
+}
+
+
 vec4 computeImage2dColor()
 {
-    vec4 color = texture( tex2D, fs_in.TexCoords2D );
+    vec4 color = sampleImage2d();
     float mag = dot( color.rgb, vec3( 0.299, 0.587, 0.114 ) );
 
     float threshAlpha = smoothstep( image2dThresholds[0] - 0.01, image2dThresholds[0], mag ) -
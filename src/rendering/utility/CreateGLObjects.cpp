@@ -1,10 +1,14 @@
 #include "rendering/utility/CreateGLObjects.h"
+#include "rendering/records/SlidePageTable.h"
+#include "rendering/utility/gl/GLTextureUploader.h"
 #include "rendering/utility/vtk/PolyDataConversion.h"
 #include "rendering/utility/vtk/PolyDataGenerator.h"
 
 #include "common/HZeeException.hpp"
 #include "logic/annotation/Polygon.h"
 
+#include "imageio/VolumePyramid.h"
+
 #include <glm/glm.hpp>
 #include <glm/gtc/packing.hpp>
 
@@ -14,6 +18,7 @@
 
 #include <array>
 #include <iostream>
+#include <limits>
 #include <sstream>
 
 
@@ -108,15 +113,75 @@ std::unique_ptr<MeshGpuRecord> convertPolyDataToMeshGpuRecord(
 }
 
 
-} // anonymous
+/**
+ * @brief Get the slide level from which the slide texture is created. This is the smallest
+ * among all levels that hold pixel data. File levels without data are only accessed
+ * tile-by-tile.
+ *
+ * @return Non-owning pointer to the level; nullptr if no level holds valid data
+ */
+const slideio::SlideLevel* slideTextureLevel( const slideio::SlideCpuRecord* cpuRecord )
+{
+    if ( ! cpuRecord )
+    {
+        std::ostringstream ss;
+        ss << "Null SlideCpuRecord" << std::ends;
+        std::cerr << ss.str() << std::endl;
+        return nullptr;
+    }
 
+    const slideio::SlideLevel* smallestLevel = nullptr;
 
-namespace gpuhelper
-{
+    const size_t numCreatedLevels = cpuRecord->numCreatedLevels();
+    const size_t numFileLevels = cpuRecord->numFileLevels();
 
-std::unique_ptr<ImageGpuRecord> createImageGpuRecord(
-        const imageio::ImageCpuRecord* imageCpuRecord,
-        const uint32_t componentIndex,
+    // Check created levels first
+    if ( numCreatedLevels > 0 )
+    {
+        smallestLevel = &( cpuRecord->createdLevel( numCreatedLevels - 1 ) );
+    }
+    else if ( numFileLevels > 0 )
+    {
+        for ( size_t i = numFileLevels; i > 0; --i )
+        {
+            if ( cpuRecord->fileLevel( i - 1 ).m_data )
+            {
+                smallestLevel = &( cpuRecord->fileLevel( i - 1 ) );
+                break;
+            }
+        }
+    }
+    else
+    {
+        std::ostringstream ss;
+        ss << "No level data" << std::ends;
+        std::cerr << ss.str() << std::endl;
+        return nullptr;
+    }
+
+    if ( ! smallestLevel || ! smallestLevel->m_data ||
+         smallestLevel->m_dims.x <= 0 || smallestLevel->m_dims.y <= 0 )
+    {
+        std::ostringstream ss;
+        ss << "Null level data" << std::ends;
+        std::cerr << ss.str() << std::endl;
+        return nullptr;
+    }
+
+    return smallestLevel;
+}
+
+
+/**
+ * @brief Create a 3D texture of a scalar volume and allocate its storage, without
+ * uploading its pixels
+ * @return Uploader of the pixels into the texture; null if the texture cannot be created
+ */
+std::shared_ptr<GLTextureUploader> createTextureUploader3d(
+        const glm::u32vec3& pixelDimensions,
+        const imageio::ComponentType& componentType,
+        uint32_t componentSizeInBytes,
+        const void* data,
         const tex::MinificationFilter& minFilter,
         const tex::MagnificationFilter& magFilter,
         bool useNormalizedIntegers )
@@ -125,17 +190,14 @@ std::unique_ptr<ImageGpuRecord> createImageGpuRecord(
     static const tex::WrapMode sk_wrapMode = tex::WrapMode::ClampToEdge;
 //    static const glm::vec4 sk_borderColor( 0.0f, 0.0f, 0.0f, 0.0f );
 
-    if ( ! imageCpuRecord || ! imageCpuRecord->imageBaseData() )
+    if ( ! data )
     {
-        std::stringstream ss;
-        ss << "Null imageCpuRecord" << std::ends;
+        std::ostringstream ss;
+        ss << "Null 3D texture data" << std::ends;
         std::cerr << ss.str() << std::endl;
         return nullptr;
     }
 
-    const imageio::ImageHeader& header = imageCpuRecord->header();
-    const imageio::ComponentType componentType = header.m_bufferComponentType;
-
     GLTexture::PixelStoreSettings pixelPackSettings;
     pixelPackSettings.m_alignment = sk_alignment;
 
@@ -154,6 +216,53 @@ std::unique_ptr<ImageGpuRecord> createImageGpuRecord(
 
     texture->setWrapMode( sk_wrapMode );
 
+    texture->setSize( pixelDimensions );
+
+    // Allocate storage for the first mipmap level of the texture. Its pixels are uploaded
+    // in slabs, so that the whole volume is never staged by the driver at once.
+    static constexpr GLint sk_mipmapLevel = 0;
+
+    const tex::BufferPixelFormat format = ( useNormalizedIntegers )
+            ? GLTexture::getBufferPixelNormalizedRedFormat( componentType )
+            : GLTexture::getBufferPixelRedFormat( componentType );
+
+    const tex::BufferPixelDataType type = GLTexture::getBufferPixelDataType( componentType );
+
+    texture->setData( sk_mipmapLevel,
+                      ( useNormalizedIntegers )
+                      ? GLTexture::getSizedInternalNormalizedRedFormat( componentType )
+                      : GLTexture::getSizedInternalRedFormat( componentType ),
+                      format, type, nullptr );
+
+    return std::make_shared<GLTextureUploader>(
+                texture, sk_mipmapLevel, format, type, componentSizeInBytes, data );
+}
+
+} // anonymous
+
+
+namespace gpuhelper
+{
+
+std::unique_ptr<ImageGpuRecord> createImageGpuRecord(
+        const imageio::ImageCpuRecord* imageCpuRecord,
+        const uint32_t componentIndex,
+        const tex::MinificationFilter& minFilter,
+        const tex::MagnificationFilter& magFilter,
+        bool useNormalizedIntegers )
+{
+    if ( ! imageCpuRecord || ( ! imageCpuRecord->imageBaseData() && ! imageCpuRecord->brickedVolume() ) )
+    {
+        std::stringstream ss;
+        ss << "Null imageCpuRecord" << std::ends;
+        std::cerr << ss.str() << std::endl;
+        return nullptr;
+    }
+
+    const imageio::ImageHeader& header = imageCpuRecord->header();
+    const imageio::ComponentType componentType = header.m_bufferComponentType;
+    const uint32_t componentSize = header.m_bufferComponentSizeInBytes;
+
     static const glm::u64vec3 sk_maxDims( std::numeric_limits<uint32_t>::max() );
 
     if ( glm::any( glm::greaterThan( header.m_pixelDimensions, sk_maxDims ) ) )
@@ -165,31 +274,73 @@ std::unique_ptr<ImageGpuRecord> createImageGpuRecord(
         return nullptr;
     }
 
-    texture->setSize( glm::u32vec3{ header.m_pixelDimensions } );
-    texture->setAutoGenerateMipmaps( true );
+    const glm::u32vec3 pixelDimensions{ header.m_pixelDimensions };
+    const void* buffer = imageCpuRecord->buffer( componentIndex );
+    auto pyramid = imageCpuRecord->pyramid( componentIndex );
 
-    // Load data in for the first mipmap level of the texture
-    static constexpr GLint sk_mipmapLevel = 0;
+    if ( ! buffer && ( ! pyramid || 0 == pyramid->numLevels() ) )
+    {
+        std::stringstream ss;
+        ss << "Error: Cannot create 3D texture: Image " << header.m_fileName
+           << " is stored out of core and has no pyramid." << std::ends;
+        std::cerr << ss.str() << std::endl;
+        return nullptr;
+    }
+
+    if ( ! pyramid || 0 == pyramid->numLevels() )
+    {
+        // Without a pyramid, the texture is a single level whose coarser levels are generated
+        // as mipmaps once it is complete. No chunk is uploaded yet: the caller uploads the
+        // chunks, either at once or spread over passes through the event loop.
+        std::vector<ImageGpuRecord::LevelUploader> uploaders;
+
+        uploaders.emplace_back( [=] () {
+            return createTextureUploader3d( pixelDimensions, componentType, componentSize, buffer,
+                                            minFilter, magFilter, useNormalizedIntegers ); } );
+
+        auto gpuRecord = std::make_unique<ImageGpuRecord>( std::move( uploaders ) );
+        gpuRecord->setAutoGenerateMipmaps( true );
 
-    if ( useNormalizedIntegers )
+        return gpuRecord;
+    }
+
+    // The levels of the pyramid replace mipmaps. The record holds the pyramid, so that
+    // its levels remain valid until they are uploaded.
+    std::vector<ImageGpuRecord::LevelUploader> uploaders;
+    uploaders.reserve( 1 + pyramid->numLevels() );
+
+    if ( buffer )
     {
-        texture->setData( sk_mipmapLevel,
-                          GLTexture::getSizedInternalNormalizedRedFormat( componentType ),
-                          GLTexture::getBufferPixelNormalizedRedFormat( componentType ),
-                          GLTexture::getBufferPixelDataType( componentType ),
-                          imageCpuRecord->imageBaseData()->bufferPointer( componentIndex ) );
+        uploaders.emplace_back( [=] () {
+            return createTextureUploader3d( pixelDimensions, componentType, componentSize, buffer,
+                                            minFilter, magFilter, useNormalizedIntegers ); } );
     }
     else
     {
-        texture->setData( sk_mipmapLevel,
-                          GLTexture::getSizedInternalRedFormat( componentType ),
-                          GLTexture::getBufferPixelRedFormat( componentType ),
-                          GLTexture::getBufferPixelDataType( componentType ),
-                          imageCpuRecord->imageBaseData()->bufferPointer( componentIndex ) );
+        // An image stored out of core has no buffer, so its full-resolution level is never
+        // uploaded: it is displayed from the finest level of its pyramid
+        uploaders.emplace_back( nullptr );
     }
 
+    for ( size_t i = 0; i < pyramid->numLevels(); ++i )
+    {
+        uploaders.emplace_back( [=] () {
+            const auto& level = pyramid->level( i );
+            return createTextureUploader3d( glm::u32vec3{ level.m_pixelDimensions }, componentType,
+                                            componentSize, level.m_data.data(),
+                                            minFilter, magFilter, useNormalizedIntegers ); } );
+    }
 
-    return std::make_unique<ImageGpuRecord>( texture );
+    auto gpuRecord = std::make_unique<ImageGpuRecord>( std::move( uploaders ) );
+
+    // Upload the coarsest level now, so that the image can be shown immediately.
+    // The finer levels are uploaded later, one chunk at a time.
+    if ( ! gpuRecord->uploadNextLevel() )
+    {
+        return nullptr;
+    }
+
+    return gpuRecord;
 }
 
 
@@ -678,52 +829,56 @@ void createTestColorBuffer( MeshRecord& meshRecord )
 
 std::unique_ptr<SlideGpuRecord> createSlideGpuRecord( const slideio::SlideCpuRecord* cpuRecord )
 {
-    if ( ! cpuRecord )
+    const slideio::SlideLevel* level = slideTextureLevel( cpuRecord );
+
+    if ( ! level )
     {
-        std::ostringstream ss;
-        ss << "Null SlideCpuRecord" << std::ends;
-        std::cerr << ss.str() << std::endl;
         return nullptr;
     }
 
-    // Create the GPU texture from the smallest among all levels
-
-    const slideio::SlideLevel* smallestLevel = nullptr;
+    auto texture = createTexture2d(
+                level->m_dims,
+                const_cast< const uint32_t* >( level->m_data.get() ) );
 
-    const size_t numCreatedLevels = cpuRecord->numCreatedLevels();
-    const size_t numFileLevels = cpuRecord->numFileLevels();
+    // Slides that are read in tiles are also rendered from tiles in the shared atlas
+    std::shared_ptr<SlidePageTable> pageTable;
 
-    // Check created levels first
-    if ( numCreatedLevels > 0 )
+    if ( cpuRecord->tileReader() )
     {
-        smallestLevel = &( cpuRecord->createdLevel( numCreatedLevels - 1 ) );
+        pageTable = std::make_shared<SlidePageTable>();
     }
-    else if ( numFileLevels > 0 )
-    {
-        smallestLevel = &( cpuRecord->fileLevel( numFileLevels - 1 ) );
-    }
-    else
+
+    return std::make_unique<SlideGpuRecord>( texture, pageTable );
+}
+
+
+bool updateSlideGpuRecord( const slideio::SlideCpuRecord* cpuRecord, SlideGpuRecord& gpuRecord )
+{
+    const slideio::SlideLevel* level = slideTextureLevel( cpuRecord );
+
+    if ( ! level )
     {
-        std::ostringstream ss;
-        ss << "No level data" << std::ends;
-        std::cerr << ss.str() << std::endl;
-        return nullptr;
+        return false;
     }
 
-    if ( ! smallestLevel || ! smallestLevel->m_data ||
-         smallestLevel->m_dims.x <= 0 || smallestLevel->m_dims.y <= 0 )
+    auto texture = gpuRecord.texture().lock();
+
+    if ( ! texture )
     {
-        std::ostringstream ss;
-        ss << "Null level data" << std::ends;
-        std::cerr << ss.str() << std::endl;
-        return nullptr;
+        std::cerr << "Null slide texture" << std::endl;
+        return false;
     }
 
-    auto texture = createTexture2d(
-                smallestLevel->m_dims,
-                const_cast< const uint32_t* >( smallestLevel->m_data.get() ) );
+    // Re-allocate the texture in place, so that objects holding the texture see the new data
+    texture->setSize( glm::uvec3{ level->m_dims.x, level->m_dims.y, 1 } );
+
+    texture->setData( 0,
+                      tex::SizedInternalFormat::RGBA8_UNorm,
+                      tex::BufferPixelFormat::BGRA,
+                      tex::BufferPixelDataType::UInt8,
+                      level->m_data.get() );
 
-    return std::make_unique<SlideGpuRecord>( texture );
+    return true;
 }
 
 
@@ -57,6 +57,14 @@ std::unique_ptr<MeshGpuRecord> createMeshGpuRecordFromVtkPolyData(
 
 std::unique_ptr<SlideGpuRecord> createSlideGpuRecord( const slideio::SlideCpuRecord* );
 
+/**
+ * @brief Upload the current texture level of a slide to its existing GPU record,
+ * e.g. after a placeholder level has been replaced with decoded data
+ *
+ * @return True iff the texture was updated
+ */
+bool updateSlideGpuRecord( const slideio::SlideCpuRecord*, SlideGpuRecord& );
+
 
 /**
  * @brief createSlideAnnotationGpuRecord
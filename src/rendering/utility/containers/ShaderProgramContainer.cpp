@@ -393,6 +393,11 @@ void ShaderProgramContainer::generateMeshFragmentShaders()
         fsStdUniforms.insertUniform( frag::labelTex3D, UniformType::Sampler, Uniforms::SamplerIndexType{4}, ! sk_isRequired );
         fsStdUniforms.insertUniform( frag::labelColormapTexture, UniformType::Sampler, Uniforms::SamplerIndexType{5}, ! sk_isRequired );
         fsStdUniforms.insertUniform( frag::imageColorMapTexture, UniformType::Sampler, Uniforms::SamplerIndexType{6}, ! sk_isRequired );
+        fsStdUniforms.insertUniform( frag::tex2DAtlas, UniformType::Sampler, Uniforms::SamplerIndexType{7}, ! sk_isRequired );
+        fsStdUniforms.insertUniform( frag::tex2DPageTable, UniformType::Sampler, Uniforms::SamplerIndexType{8}, ! sk_isRequired );
+
+        fsStdUniforms.insertUniform( frag::tex2DPageScale, UniformType::Vec2, glm::vec2{ 0.0f }, ! sk_isRequired );
+        fsStdUniforms.insertUniform( frag::tex2DVirtual, UniformType::Bool, false, ! sk_isRequired );
 
         fsStdUniforms.insertUniform( frag::slope, UniformType::Float, 1.0f, sk_isRequired );
         fsStdUniforms.insertUniform( frag::intercept, UniformType::Float, 0.0f, sk_isRequired );
@@ -0,0 +1,225 @@
+#include "rendering/utility/gl/GLTextureUploader.h"
+#include "rendering/utility/gl/GLTexture.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+
+namespace
+{
+
+/// Time to wait for the GPU to finish reading a staging buffer before waiting again (1 s)
+static constexpr GLuint64 sk_fenceTimeoutNanoseconds = 1000000000u;
+
+} // anonymous
+
+
+GLTextureUploader::GLTextureUploader(
+        std::shared_ptr<GLTexture> texture,
+        GLint level,
+        const tex::BufferPixelFormat& format,
+        const tex::BufferPixelDataType& type,
+        size_t bytesPerPixel,
+        const void* data,
+        size_t stagingSizeInBytes )
+    :
+      m_errorChecker(),
+      m_texture( std::move( texture ) ),
+      m_level( level ),
+      m_format( format ),
+      m_type( type ),
+      m_data( static_cast<const uint8_t*>( data ) ),
+      m_levelSize( 0 ),
+      m_numSlices( 0 ),
+      m_slabSlices( 1 ),
+      m_sliceSizeInBytes( 0 ),
+      m_nextSlice( 0 ),
+      m_nextBuffer( 0 ),
+      m_failed( false ),
+      m_stagingBuffers()
+{
+    initializeOpenGLFunctions();
+
+    if ( ! m_texture || ! m_data || tex::Target::Texture3D != m_texture->target() )
+    {
+        std::cerr << "Invalid texture or data for chunked texture upload" << std::endl;
+        m_failed = true;
+        return;
+    }
+
+    // Dimensions of the mipmap level
+    for ( int i = 0; i < 3; ++i )
+    {
+        m_levelSize[i] = std::max( m_texture->size()[i] >> m_level, 1u );
+    }
+
+    m_numSlices = m_levelSize.z;
+    m_sliceSizeInBytes = bytesPerPixel * m_levelSize.x * m_levelSize.y;
+
+    if ( 0 == m_sliceSizeInBytes )
+    {
+        m_failed = true;
+        return;
+    }
+
+    // Each staging buffer holds a whole number of slices, and at least one
+    const size_t bufferSize = std::max( stagingSizeInBytes / sk_numStagingBuffers, m_sliceSizeInBytes );
+
+    m_slabSlices = static_cast<uint32_t>( std::min<size_t>( bufferSize / m_sliceSizeInBytes, m_numSlices ) );
+
+    const size_t numSlabs = ( m_numSlices + m_slabSlices - 1 ) / m_slabSlices;
+    const size_t numBuffers = std::min( sk_numStagingBuffers, numSlabs );
+
+    for ( size_t i = 0; i < numBuffers; ++i )
+    {
+        auto stagingBuffer = std::make_unique<StagingBuffer>(
+                    StagingBuffer{ GLBufferObject( BufferType::PixelUnpack, BufferUsagePattern::StreamDraw ), nullptr } );
+
+        stagingBuffer->m_buffer.generate();
+        stagingBuffer->m_buffer.allocate( m_slabSlices * m_sliceSizeInBytes, nullptr );
+        stagingBuffer->m_buffer.unbind();
+
+        m_stagingBuffers.emplace_back( std::move( stagingBuffer ) );
+    }
+}
+
+
+GLTextureUploader::~GLTextureUploader()
+{
+    for ( auto& stagingBuffer : m_stagingBuffers )
+    {
+        if ( stagingBuffer->m_fence )
+        {
+            glDeleteSync( stagingBuffer->m_fence );
+        }
+    }
+}
+
+
+bool GLTextureUploader::uploadNextSlab()
+{
+    if ( m_failed || isComplete() )
+    {
+        return false;
+    }
+
+    StagingBuffer& stagingBuffer = *m_stagingBuffers[m_nextBuffer];
+
+    if ( ! waitForBuffer( stagingBuffer ) )
+    {
+        std::cerr << "Error waiting for texture staging buffer" << std::endl;
+        m_failed = true;
+        return false;
+    }
+
+    const uint32_t numSlices = std::min( m_slabSlices, m_numSlices - m_nextSlice );
+    const size_t numBytes = numSlices * m_sliceSizeInBytes;
+    const uint8_t* src = m_data + m_nextSlice * m_sliceSizeInBytes;
+
+    GLBufferObject& buffer = stagingBuffer.m_buffer;
+    buffer.bind();
+
+    // The GPU has finished reading the buffer, so it can be mapped without synchronization.
+    // Invalidating the buffer lets the driver discard its old contents.
+    void* dest = buffer.mapRange( 0, static_cast<GLsizeiptr>( numBytes ),
+                                  { BufferMapRangeAccessFlag::MapWriteBit,
+                                    BufferMapRangeAccessFlag::InvalidateBufferBit,
+                                    BufferMapRangeAccessFlag::UnsynchronizedBit } );
+
+    if ( dest )
+    {
+        std::memcpy( dest, src, numBytes );
+
+        if ( ! buffer.unmap() )
+        {
+            // The buffer contents were lost (e.g. due to a display mode change)
+            buffer.write( 0, numBytes, src );
+        }
+    }
+    else
+    {
+        buffer.write( 0, numBytes, src );
+    }
+
+    // With the pixel unpack buffer bound, the data pointer is an offset into the buffer
+    m_texture->setSubData( m_level,
+                           glm::uvec3{ 0, 0, m_nextSlice },
+                           glm::uvec3{ m_levelSize.x, m_levelSize.y, numSlices },
+                           m_format, m_type, nullptr );
+
+    buffer.unbind();
+
+    stagingBuffer.m_fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+
+    CHECK_GL_ERROR( m_errorChecker );
+
+    m_nextSlice += numSlices;
+    m_nextBuffer = ( m_nextBuffer + 1 ) % m_stagingBuffers.size();
+
+    return true;
+}
+
+
+bool GLTextureUploader::uploadAll()
+{
+    while ( uploadNextSlab() ) {}
+
+    return isComplete();
+}
+
+
+bool GLTextureUploader::isComplete() const
+{
+    return ( ! m_failed && m_nextSlice >= m_numSlices );
+}
+
+
+bool GLTextureUploader::hasFailed() const
+{
+    return m_failed;
+}
+
+
+double GLTextureUploader::progress() const
+{
+    if ( 0 == m_numSlices )
+    {
+        return 0.0;
+    }
+
+    return static_cast<double>( m_nextSlice ) / static_cast<double>( m_numSlices );
+}
+
+
+std::shared_ptr<GLTexture> GLTextureUploader::texture() const
+{
+    return m_texture;
+}
+
+
+bool GLTextureUploader::waitForBuffer( StagingBuffer& stagingBuffer )
+{
+    if ( ! stagingBuffer.m_fence )
+    {
+        return true;
+    }
+
+    GLenum status = GL_TIMEOUT_EXPIRED;
+
+    // Flush on the first wait, so that the fence is guaranteed to be signaled eventually
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+
+    while ( GL_TIMEOUT_EXPIRED == status )
+    {
+        status = glClientWaitSync( stagingBuffer.m_fence, flags, sk_fenceTimeoutNanoseconds );
+        flags = 0;
+    }
+
+    glDeleteSync( stagingBuffer.m_fence );
+    stagingBuffer.m_fence = nullptr;
+
+    return ( GL_WAIT_FAILED != status );
+}
@@ -0,0 +1,126 @@
+#ifndef GL_TEXTURE_UPLOADER_H
+#define GL_TEXTURE_UPLOADER_H
+
+#include "rendering/utility/gl/GLBufferObject.h"
+#include "rendering/utility/gl/GLErrorChecker.h"
+#include "rendering/utility/gl/GLTextureTypes.h"
+
+#include <glm/vec3.hpp>
+
+#include <QOpenGLFunctions_3_3_Core>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+class GLTexture;
+
+
+/**
+ * @brief Uploads the pixels of a 3D texture level in slabs of slices along z, rather than in
+ * one call. Each slab is copied into one of a ring of pixel unpack buffers, from which the
+ * texture is written. A buffer is not refilled until the GPU has finished reading it, so the
+ * staging memory in use by the driver is bounded by the total size of the ring.
+ *
+ * Slabs can be uploaded one at a time, with control returned to the caller in between
+ * (e.g. to process GUI events), or all at once. The OpenGL context in which the uploader
+ * was created must be current whenever it is used or destroyed.
+ */
+class GLTextureUploader final : protected QOpenGLFunctions_3_3_Core
+{
+public:
+
+    /// Default total size of the ring of staging buffers (16 MiB)
+    static constexpr size_t sk_defaultStagingSizeInBytes = size_t( 1 ) << 24;
+
+    /// Number of staging buffers in the ring
+    static constexpr size_t sk_numStagingBuffers = 3;
+
+
+    /**
+     * @param texture 3D texture, whose storage for the level must have been allocated
+     * (e.g. by \c GLTexture::setData with null data)
+     * @param level Mipmap level to write
+     * @param format Pixel format of the data
+     * @param type Pixel component type of the data
+     * @param bytesPerPixel Number of bytes of a pixel of the data
+     * @param data Pixels of the level, with x varying fastest and rows tightly packed.
+     * They must remain valid until the upload is complete.
+     * @param stagingSizeInBytes Total size of the ring of staging buffers. The ring holds
+     * at least one slice per buffer, even if this exceeds the size.
+     */
+    GLTextureUploader( std::shared_ptr<GLTexture> texture,
+                       GLint level,
+                       const tex::BufferPixelFormat& format,
+                       const tex::BufferPixelDataType& type,
+                       size_t bytesPerPixel,
+                       const void* data,
+                       size_t stagingSizeInBytes = sk_defaultStagingSizeInBytes );
+
+    GLTextureUploader( const GLTextureUploader& ) = delete;
+    GLTextureUploader& operator=( const GLTextureUploader& ) = delete;
+
+    GLTextureUploader( GLTextureUploader&& ) = delete;
+    GLTextureUploader& operator=( GLTextureUploader&& ) = delete;
+
+    ~GLTextureUploader();
+
+    /**
+     * @brief Upload the next slab of slices
+     * @return True iff a slab was uploaded; false if the upload is complete or failed
+     */
+    bool uploadNextSlab();
+
+    /**
+     * @brief Upload all remaining slabs
+     * @return True iff the upload is complete
+     */
+    bool uploadAll();
+
+    /// Get whether all slices have been uploaded
+    bool isComplete() const;
+
+    /// Get whether the upload failed
+    bool hasFailed() const;
+
+    /// Get the fraction of slices that have been uploaded, from 0 to 1
+    double progress() const;
+
+    /// Get the texture being uploaded
+    std::shared_ptr<GLTexture> texture() const;
+
+
+private:
+
+    struct StagingBuffer
+    {
+        GLBufferObject m_buffer;
+        GLsync m_fence; //!< Signaled once the GPU has read the buffer; null if not in use
+    };
+
+    /// Wait until the GPU has finished reading a staging buffer
+    bool waitForBuffer( StagingBuffer& stagingBuffer );
+
+    GLErrorChecker m_errorChecker;
+
+    std::shared_ptr<GLTexture> m_texture;
+    GLint m_level;
+    tex::BufferPixelFormat m_format;
+    tex::BufferPixelDataType m_type;
+    const uint8_t* m_data;
+
+    glm::uvec3 m_levelSize; //!< Dimensions of the mipmap level
+    uint32_t m_numSlices; //!< Number of slices of the texture
+    uint32_t m_slabSlices; //!< Number of slices per slab
+    size_t m_sliceSizeInBytes;
+
+    uint32_t m_nextSlice; //!< First slice of the next slab
+    size_t m_nextBuffer; //!< Index of the staging buffer for the next slab
+    bool m_failed;
+
+    std::vector< std::unique_ptr<StagingBuffer> > m_stagingBuffers;
+};
+
+#endif // GL_TEXTURE_UPLOADER_H
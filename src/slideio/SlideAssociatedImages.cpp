@@ -5,55 +5,262 @@ namespace slideio
 
 SlideAssociatedImages::SlideAssociatedImages()
     :
-      m_thumbImageData( nullptr ),
-      m_macroImageData( nullptr ),
-      m_labelImageData( nullptr ),
+      m_state( std::make_shared<State>() )
+{
+}
+
 
-      m_thumbImageDims( 0, 0 ),
-      m_macroImageDims( 0, 0 ),
-      m_labelImageDims( 0, 0 )
+SlideAssociatedImages::SlideAssociatedImages( const SlideAssociatedImages& other )
+    :
+      m_state( std::make_shared<State>() )
 {
+    *this = other;
+}
+
+
+SlideAssociatedImages& SlideAssociatedImages::operator=( const SlideAssociatedImages& other )
+{
+    if ( this == &other )
+    {
+        return *this;
+    }
+
+    std::unique_lock<std::mutex> otherLock( other.m_state->m_mutex, std::defer_lock );
+    std::unique_lock<std::mutex> lock( m_state->m_mutex, std::defer_lock );
+    std::lock( otherLock, lock );
+
+    for ( auto image : { &State::m_thumbImage, &State::m_macroImage, &State::m_labelImage } )
+    {
+        const Image& src = ( *other.m_state ).*image;
+        set( ( *m_state ).*image, src.m_data, src.m_dims, src.m_loader );
+    }
+
+    m_state->m_thumbImageGenerated = other.m_state->m_thumbImageGenerated;
+    m_state->m_loadRequestHandler = other.m_state->m_loadRequestHandler;
+
+    return *this;
 }
 
 
 std::pair< std::weak_ptr< std::vector<uint32_t> >, glm::i64vec2 >
 SlideAssociatedImages::thumbImage() const
 {
-    return std::make_pair( m_thumbImageData, m_thumbImageDims );
+    return request( &State::m_thumbImage );
 }
 
 std::pair< std::weak_ptr< std::vector<uint32_t> >, glm::i64vec2 >
 SlideAssociatedImages::macroImage() const
 {
-    return std::make_pair( m_macroImageData, m_macroImageDims );
+    return request( &State::m_macroImage );
 }
 
 std::pair< std::weak_ptr< std::vector<uint32_t> >, glm::i64vec2 >
 SlideAssociatedImages::labelImage() const
 {
-    return std::make_pair( m_labelImageData, m_labelImageDims );
+    return request( &State::m_labelImage );
+}
+
+
+glm::i64vec2 SlideAssociatedImages::thumbImageDims() const
+{
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+    return m_state->m_thumbImage.m_dims;
+}
+
+glm::i64vec2 SlideAssociatedImages::macroImageDims() const
+{
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+    return m_state->m_macroImage.m_dims;
+}
+
+glm::i64vec2 SlideAssociatedImages::labelImageDims() const
+{
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+    return m_state->m_labelImage.m_dims;
+}
+
+
+bool SlideAssociatedImages::isThumbImageGenerated() const
+{
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+    return m_state->m_thumbImageGenerated;
 }
 
 
 void SlideAssociatedImages::setThumbImage(
-        std::shared_ptr< std::vector<uint32_t> > data, const glm::i64vec2& dims )
+        std::shared_ptr< std::vector<uint32_t> > data, const glm::i64vec2& dims, bool generated )
 {
-    m_thumbImageData = data;
-    m_thumbImageDims = dims;
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+    set( m_state->m_thumbImage, std::move( data ), dims, nullptr );
+    m_state->m_thumbImageGenerated = generated;
 }
 
 void SlideAssociatedImages::setMacroImage(
         std::shared_ptr< std::vector<uint32_t> > data, const glm::i64vec2& dims )
 {
-    m_macroImageData = data;
-    m_macroImageDims = dims;
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+    set( m_state->m_macroImage, std::move( data ), dims, nullptr );
 }
 
 void SlideAssociatedImages::setLabelImage(
         std::shared_ptr< std::vector<uint32_t> > data, const glm::i64vec2& dims )
 {
-    m_labelImageData = data;
-    m_labelImageDims = dims;
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+    set( m_state->m_labelImage, std::move( data ), dims, nullptr );
+}
+
+
+void SlideAssociatedImages::setThumbImage( const glm::i64vec2& dims, ImageLoader loader )
+{
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+    set( m_state->m_thumbImage, nullptr, dims, std::move( loader ) );
+    m_state->m_thumbImageGenerated = false;
+}
+
+void SlideAssociatedImages::setMacroImage( const glm::i64vec2& dims, ImageLoader loader )
+{
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+    set( m_state->m_macroImage, nullptr, dims, std::move( loader ) );
+}
+
+void SlideAssociatedImages::setLabelImage( const glm::i64vec2& dims, ImageLoader loader )
+{
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+    set( m_state->m_labelImage, nullptr, dims, std::move( loader ) );
+}
+
+
+void SlideAssociatedImages::setLoadRequestHandler( LoadRequestHandler handler )
+{
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+    m_state->m_loadRequestHandler = std::move( handler );
+}
+
+
+void SlideAssociatedImages::releaseImages()
+{
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+
+    for ( Image* image : { &m_state->m_macroImage, &m_state->m_labelImage } )
+    {
+        // Only release pixels that can be read again
+        if ( image->m_loader )
+        {
+            image->m_data = nullptr;
+        }
+    }
+}
+
+
+size_t SlideAssociatedImages::numLoadedBytes() const
+{
+    std::lock_guard<std::mutex> lock( m_state->m_mutex );
+
+    size_t numBytes = 0;
+
+    for ( const Image* image : { &m_state->m_thumbImage, &m_state->m_macroImage, &m_state->m_labelImage } )
+    {
+        if ( image->m_data )
+        {
+            numBytes += image->m_data->size() * sizeof( uint32_t );
+        }
+    }
+
+    return numBytes;
+}
+
+
+std::pair< std::weak_ptr< std::vector<uint32_t> >, glm::i64vec2 >
+SlideAssociatedImages::request( Image State::* image ) const
+{
+    std::unique_lock<std::mutex> lock( m_state->m_mutex );
+
+    Image& I = ( *m_state ).*image;
+    const auto result = std::make_pair( std::weak_ptr< std::vector<uint32_t> >( I.m_data ), I.m_dims );
+
+    if ( I.m_data || ! I.m_loader || I.m_requested )
+    {
+        return result;
+    }
+
+    I.m_requested = true;
+
+    LoadRequestHandler handler = m_state->m_loadRequestHandler;
+    lock.unlock();
+
+    // The task holds the state, so that it may outlive this object
+    auto loadTask = [state = m_state] () { return loadRequested( *state ); };
+
+    if ( handler )
+    {
+        handler( std::move( loadTask ) );
+        return result;
+    }
+
+    // Without a handler, read the pixels on this thread
+    loadTask();
+
+    lock.lock();
+    return std::make_pair( std::weak_ptr< std::vector<uint32_t> >( I.m_data ), I.m_dims );
+}
+
+
+void SlideAssociatedImages::set(
+        Image& image, std::shared_ptr< std::vector<uint32_t> > data,
+        const glm::i64vec2& dims, ImageLoader loader )
+{
+    image.m_data = std::move( data );
+    image.m_dims = dims;
+    image.m_loader = std::move( loader );
+    image.m_requested = false;
+    ++image.m_version;
+}
+
+
+bool SlideAssociatedImages::loadRequested( State& state )
+{
+    bool loaded = false;
+
+    for ( auto image : { &State::m_thumbImage, &State::m_macroImage, &State::m_labelImage } )
+    {
+        Image& I = state.*image;
+
+        std::unique_lock<std::mutex> lock( state.m_mutex );
+
+        if ( ! I.m_requested )
+        {
+            continue;
+        }
+
+        const ImageLoader loader = I.m_loader;
+        const uint64_t version = I.m_version;
+
+        // Read the pixels without holding the lock
+        lock.unlock();
+        std::shared_ptr< std::vector<uint32_t> > data = ( loader ) ? loader() : nullptr;
+        lock.lock();
+
+        if ( version != I.m_version )
+        {
+            // The image was set while its pixels were read
+            continue;
+        }
+
+        I.m_requested = false;
+        I.m_data = std::move( data );
+
+        if ( I.m_data )
+        {
+            loaded = true;
+        }
+        else
+        {
+            // Do not attempt to read the image again
+            I.m_loader = nullptr;
+        }
+    }
+
+    return loaded;
 }
 
 } // namespace slideio
@@ -4,7 +4,9 @@
 #include <glm/vec2.hpp>
 #include <glm/gtc/type_precision.hpp>
 
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <utility>
 #include <vector>
 
@@ -12,40 +14,131 @@
 namespace slideio
 {
 
+/**
+ * @brief Associated images of a slide: thumbnail, macro, and label.
+ *
+ * Images may be set either with their pixel data or with a function that reads the data
+ * from file. In the latter case, only the dimensions of an image are held until its pixels
+ * are first requested. Pixels read from file can be released (e.g. under memory pressure)
+ * and are read again when next requested.
+ *
+ * Requesting the pixels of an image that are not loaded does not read them: the accessor
+ * passes a task that reads them to the load request handler, which should run it on a
+ * background thread. Until the task has run, the accessor returns expired data. Only without
+ * a handler are pixels read by the accessor itself. All members may be called concurrently.
+ */
 class SlideAssociatedImages
 {
 public:
 
+    /// Function that reads the pre-multiplied ARGB pixels of an image from file.
+    /// It returns nullptr on failure.
+    using ImageLoader = std::function< std::shared_ptr< std::vector<uint32_t> > () >;
+
+    /// Function that is given a task that reads the requested images from file. The task
+    /// returns true iff it loaded the pixels of any image.
+    using LoadRequestHandler = std::function< void ( std::function< bool () > loadTask ) >;
+
     SlideAssociatedImages();
     ~SlideAssociatedImages() = default;
 
+    /// Copies share the pixel data, loaders, and load request handler of the source,
+    /// but not its lock
+    SlideAssociatedImages( const SlideAssociatedImages& );
+    SlideAssociatedImages& operator=( const SlideAssociatedImages& );
+
+    /// Get the pixel data and dimensions of an image, requesting the pixels if not yet loaded.
+    /// The data pointer is expired if the slide has no such image, if reading it failed,
+    /// or if the pixels are still being read.
     std::pair< std::weak_ptr< std::vector<uint32_t> >, glm::i64vec2 > thumbImage() const;
     std::pair< std::weak_ptr< std::vector<uint32_t> >, glm::i64vec2 > macroImage() const;
     std::pair< std::weak_ptr< std::vector<uint32_t> >, glm::i64vec2 > labelImage() const;
 
-    void setThumbImage( std::shared_ptr< std::vector<uint32_t> > data, const glm::i64vec2& dims );
+    /// Get the dimensions of an image without reading its pixels.
+    /// Dimensions are zero if the slide has no such image.
+    glm::i64vec2 thumbImageDims() const;
+    glm::i64vec2 macroImageDims() const;
+    glm::i64vec2 labelImageDims() const;
+
+    /// Return true iff the thumbnail was generated by this program rather than read from file
+    bool isThumbImageGenerated() const;
+
+    void setThumbImage( std::shared_ptr< std::vector<uint32_t> > data, const glm::i64vec2& dims,
+                        bool generated = false );
     void setMacroImage( std::shared_ptr< std::vector<uint32_t> > data, const glm::i64vec2& dims );
     void setLabelImage( std::shared_ptr< std::vector<uint32_t> > data, const glm::i64vec2& dims );
 
+    /// Set images whose pixels are read from file on first request
+    void setThumbImage( const glm::i64vec2& dims, ImageLoader loader );
+    void setMacroImage( const glm::i64vec2& dims, ImageLoader loader );
+    void setLabelImage( const glm::i64vec2& dims, ImageLoader loader );
+
+    /// Set the function that runs the tasks that read requested images from file
+    void setLoadRequestHandler( LoadRequestHandler handler );
+
+    /// Release the pixels of the macro and label images that were read from file.
+    /// They are read again when next requested. The thumbnail is kept, since it is
+    /// shown for all slides.
+    void releaseImages();
+
+    /// Get the number of bytes of pixel data held in memory
+    size_t numLoadedBytes() const;
+
 
 private:
 
-    // All images are stored in pre-multiplied ARGB format.
-    // If not loaded, the pointers are null.
+    struct Image
+    {
+        glm::i64vec2 m_dims{ 0, 0 };
+
+        /// Reads the image from file. Null if the pixels cannot be read again once released
+        /// (or if reading them failed).
+        ImageLoader m_loader = nullptr;
+
+        /// Pixels in pre-multiplied ARGB format. Null if not loaded.
+        std::shared_ptr< std::vector<uint32_t> > m_data = nullptr;
+
+        /// Flag that the pixels were requested and are to be read by a load task
+        bool m_requested = false;
+
+        /// Number of times that the image was set, so that a load task does not overwrite
+        /// an image that was set while it read the pixels
+        uint64_t m_version = 0;
+    };
+
+    /// Images and flags, which are shared with load tasks
+    struct State
+    {
+        std::mutex m_mutex;
+
+        /// Thumbnail image from slide file. The image is generated from the lowest resolution
+        /// slide layer if no thumbnail is provided in the slide.
+        Image m_thumbImage;
+
+        /// Macro image from slide file
+        Image m_macroImage;
+
+        /// Label image from slide file
+        Image m_labelImage;
+
+        /// Flag that the thumbnail was generated rather than read from file
+        bool m_thumbImageGenerated = false;
+
+        LoadRequestHandler m_loadRequestHandler = nullptr;
+    };
 
-    /// Thumbnail image from slide file. The image is generated from the lowest resolution
-    /// slide layer if no thumbanil is provided in the slide.
-    std::shared_ptr< std::vector<uint32_t> > m_thumbImageData;
+    /// Get the pixels and dimensions of an image, requesting the pixels if necessary
+    std::pair< std::weak_ptr< std::vector<uint32_t> >, glm::i64vec2 > request( Image State::* image ) const;
 
-    /// Macro image from slide file
-    std::shared_ptr< std::vector<uint32_t> > m_macroImageData;
+    /// Set an image. The mutex must be held by the caller.
+    static void set( Image& image, std::shared_ptr< std::vector<uint32_t> > data,
+                     const glm::i64vec2& dims, ImageLoader loader );
 
-    /// Label image from slide file
-    std::shared_ptr< std::vector<uint32_t> > m_labelImageData;
+    /// Read the pixels of the requested images from file
+    /// @return True iff the pixels of any image were loaded
+    static bool loadRequested( State& state );
 
-    glm::i64vec2 m_thumbImageDims;
-    glm::i64vec2 m_macroImageDims;
-    glm::i64vec2 m_labelImageDims;
+    std::shared_ptr<State> m_state;
 };
 
 } // namespace slideio
@@ -1,4 +1,6 @@
 #include "slideio/SlideCpuRecord.h"
+#include "slideio/SlideTileReader.h"
+#include "slideio/SlideTissueMask.h"
 #include "common/HZeeException.hpp"
 
 #include <glm/glm.hpp>
@@ -21,7 +23,9 @@ SlideCpuRecord::SlideCpuRecord( SlideHeader header, SlideProperties props )
       m_properties( std::move( props ) ),
       m_transformation(),
       m_fileLevels(),
-      m_createdLevels()
+      m_createdLevels(),
+      m_tileReader( nullptr ),
+      m_tissueMask( nullptr )
 {
 }
 
@@ -114,4 +118,29 @@ void SlideCpuRecord::addCreatedLevel( SlideLevel level )
     m_createdLevels.push_back( std::move( level ) );
 }
 
+void SlideCpuRecord::clearCreatedLevels()
+{
+    m_createdLevels.clear();
+}
+
+std::shared_ptr<SlideTileReader> SlideCpuRecord::tileReader() const
+{
+    return m_tileReader;
+}
+
+void SlideCpuRecord::setTileReader( std::shared_ptr<SlideTileReader> reader )
+{
+    m_tileReader = std::move( reader );
+}
+
+std::shared_ptr<const SlideTissueMask> SlideCpuRecord::tissueMask() const
+{
+    return m_tissueMask;
+}
+
+void SlideCpuRecord::setTissueMask( std::shared_ptr<const SlideTissueMask> mask )
+{
+    m_tissueMask = std::move( mask );
+}
+
 } // namespace slideio
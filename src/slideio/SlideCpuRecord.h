@@ -6,11 +6,15 @@
 #include "slideio/SlideProperties.h"
 #include "slideio/SlideTransformation.h"
 
+#include <memory>
 #include <vector>
 
 namespace slideio
 {
 
+class SlideTileReader;
+class SlideTissueMask;
+
 class SlideCpuRecord
 {
 public:
@@ -46,6 +50,19 @@ public:
     void addFileLevel( SlideLevel );
     void addCreatedLevel( SlideLevel );
 
+    /// Remove all created levels, e.g. to replace a placeholder level with decoded data
+    void clearCreatedLevels();
+
+    /// Get the reader of tiles from all levels of the slide file.
+    /// @note Returns nullptr if the slide file is not open for tiled reading.
+    std::shared_ptr<SlideTileReader> tileReader() const;
+    void setTileReader( std::shared_ptr<SlideTileReader> );
+
+    /// Get the low-resolution mask of the tissue in the slide.
+    /// @note Returns nullptr until the slide is decoded.
+    std::shared_ptr<const SlideTissueMask> tissueMask() const;
+    void setTissueMask( std::shared_ptr<const SlideTissueMask> );
+
 
 private:
 
@@ -60,6 +77,12 @@ private:
     /// Levels created by this program
     /// @note Levels are arranged from largest to smallest
     std::vector< SlideLevel > m_createdLevels;
+
+    /// Reader of tiles on demand from the file levels
+    std::shared_ptr<SlideTileReader> m_tileReader;
+
+    /// Mask of the tissue, with which background tiles are read last (or skipped)
+    std::shared_ptr<const SlideTissueMask> m_tissueMask;
 };
 
 } // namespace slideio
@@ -0,0 +1,572 @@
+#include "slideio/SlideDecodeService.h"
+#include "slideio/SlideTileCache.h"
+#include "slideio/SlideTileReader.h"
+
+extern "C"
+{
+#include <openslide/openslide.h>
+}
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <iostream>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+
+
+namespace
+{
+
+/// Maximum number of slide files that a worker keeps open at once
+static constexpr size_t sk_maxHandlesPerWorker = 8;
+
+/// Maximum number of worker threads created by default
+static constexpr size_t sk_maxDefaultNumWorkers = 8;
+
+/// Priority of the job that is running on this thread, if it is a worker thread. Helper jobs
+/// submitted by the job inherit it, since the priority function may only be called on the
+/// thread that owns the state it reads.
+static thread_local std::optional<slideio::SlideDecodePriority> s_runningJobPriority;
+
+
+/**
+ * @brief OpenSlide handles owned by a single worker thread. The most recently used handles
+ * are kept open, up to a maximum number.
+ */
+class WorkerHandles
+{
+public:
+
+    WorkerHandles() = default;
+
+    WorkerHandles( const WorkerHandles& ) = delete;
+    WorkerHandles& operator=( const WorkerHandles& ) = delete;
+
+    ~WorkerHandles()
+    {
+        for ( auto& h : m_handles )
+        {
+            openslide_close( h.second );
+        }
+    }
+
+    /// Get the handle to a slide file, opening the file if needed
+    /// @return The handle; nullptr if the file could not be opened
+    openslide_t* get( const std::string& fileName )
+    {
+        auto it = std::find_if( std::begin( m_handles ), std::end( m_handles ),
+                                [&fileName] ( const auto& h ) { return ( h.first == fileName ); } );
+
+        if ( std::end( m_handles ) != it )
+        {
+            m_handles.splice( std::begin( m_handles ), m_handles, it );
+            return it->second;
+        }
+
+        openslide_t* handle = openslide_open( fileName.c_str() );
+
+        if ( ! handle )
+        {
+            return nullptr;
+        }
+
+        if ( const char* error = openslide_get_error( handle ) )
+        {
+            std::cerr << "OpenSlide error in file " << fileName << ": " << error << std::endl;
+            openslide_close( handle );
+            return nullptr;
+        }
+
+        m_handles.emplace_front( fileName, handle );
+
+        if ( m_handles.size() > sk_maxHandlesPerWorker )
+        {
+            openslide_close( m_handles.back().second );
+            m_handles.pop_back();
+        }
+
+        return handle;
+    }
+
+
+private:
+
+    /// Pairs of file name and handle, ordered from most to least recently used
+    std::list< std::pair< std::string, openslide_t* > > m_handles;
+};
+
+
+/**
+ * @brief Parallel loop over indices that is shared by a job and its helper jobs. Helpers that
+ * start after the loop is closed do nothing, so the loop outlives the call that created it.
+ */
+class SharedIndexLoop
+{
+public:
+
+    SharedIndexLoop( size_t count, const slideio::SlideDecodeService::IndexWork& work )
+        :
+          m_count( count ),
+          m_work( work )
+    {}
+
+    /// Run indices until none are left or the loop is closed
+    void run( openslide_t* handle )
+    {
+        while ( auto index = claim() )
+        {
+            try
+            {
+                m_work( *index, handle );
+            }
+            catch ( ... )
+            {
+                std::lock_guard<std::mutex> lock( m_mutex );
+                m_closed = true;
+                if ( ! m_error ) m_error = std::current_exception();
+            }
+
+            finish();
+        }
+    }
+
+    /// Close the loop and wait for the indices that are running on other threads.
+    /// The first exception thrown by the work is rethrown.
+    void close()
+    {
+        std::exception_ptr error;
+
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_closed = true;
+            m_finished.wait( lock, [this] () { return ( 0 == m_numRunning ); } );
+            std::swap( error, m_error );
+        }
+
+        if ( error )
+        {
+            std::rethrow_exception( error );
+        }
+    }
+
+
+private:
+
+    std::optional<size_t> claim()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+
+        if ( m_closed || m_next >= m_count )
+        {
+            return std::nullopt;
+        }
+
+        ++m_numRunning;
+        return m_next++;
+    }
+
+    void finish()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+
+        if ( 0 == --m_numRunning )
+        {
+            m_finished.notify_all();
+        }
+    }
+
+    const size_t m_count;
+
+    /// The work is referenced only while the loop is open
+    const slideio::SlideDecodeService::IndexWork& m_work;
+
+    std::mutex m_mutex;
+    std::condition_variable m_finished;
+    size_t m_next = 0;
+    size_t m_numRunning = 0;
+    bool m_closed = false;
+    std::exception_ptr m_error;
+};
+
+} // anonymous
+
+
+namespace slideio
+{
+
+struct SlideDecodeService::Impl
+{
+    struct Job
+    {
+        JobRegion m_region;
+        SlideDecodePriority m_priority;
+        uint64_t m_sequence; //!< Submission order, used to break ties in priority
+        std::shared_ptr<SlideTileReader> m_reader;
+        Work m_work;
+        std::optional<SlideTileKey> m_tile; //!< Tile read by the job, if it prefetches a tile
+    };
+
+    /// Heap comparator that places the most urgent job at the top
+    struct LessUrgent
+    {
+        bool operator() ( const Job& a, const Job& b ) const
+        {
+            if ( b.m_priority < a.m_priority ) return true;
+            if ( a.m_priority < b.m_priority ) return false;
+            return ( a.m_sequence > b.m_sequence );
+        }
+    };
+
+    Impl()
+        :
+          m_mutex(),
+          m_jobAvailable(),
+          m_stop( false ),
+          m_jobs(),
+          m_pendingTiles(),
+          m_nextSequence( 0 ),
+          m_priorityFunction( nullptr ),
+          m_workers()
+    {}
+
+    void workerLoop()
+    {
+        WorkerHandles handles;
+
+        while ( true )
+        {
+            Job job;
+
+            {
+                std::unique_lock<std::mutex> lock( m_mutex );
+                m_jobAvailable.wait( lock, [this] () { return ( m_stop || ! m_jobs.empty() ); } );
+
+                if ( m_stop )
+                {
+                    return;
+                }
+
+                std::pop_heap( std::begin( m_jobs ), std::end( m_jobs ), LessUrgent() );
+                job = std::move( m_jobs.back() );
+                m_jobs.pop_back();
+            }
+
+            if ( job.m_reader && job.m_work )
+            {
+                s_runningJobPriority = job.m_priority;
+
+                try
+                {
+                    job.m_work( *job.m_reader, handles.get( job.m_reader->fileName() ) );
+                }
+                catch ( const std::exception& e )
+                {
+                    std::cerr << "Exception while decoding slide " << job.m_reader->fileName()
+                              << ": " << e.what() << std::endl;
+                }
+
+                s_runningJobPriority = std::nullopt;
+            }
+
+            if ( job.m_tile )
+            {
+                std::lock_guard<std::mutex> lock( m_mutex );
+                m_pendingTiles.erase( *job.m_tile );
+            }
+        }
+    }
+
+    /// Compute the priority of a job region. The mutex must be held by the caller.
+    SlideDecodePriority priority( const JobRegion& region ) const
+    {
+        SlideDecodePriority p = ( m_priorityFunction )
+                ? m_priorityFunction( region )
+                : SlideDecodePriority();
+
+        p.m_background = region.m_background;
+        return p;
+    }
+
+    /// Push a job onto the heap, with a given priority or else the priority of its region.
+    /// The mutex must be held by the caller.
+    void pushJob( JobRegion region,
+                  std::shared_ptr<SlideTileReader> reader,
+                  Work work,
+                  std::optional<SlideTileKey> tile,
+                  const std::optional<SlideDecodePriority>& givenPriority = std::nullopt )
+    {
+        const SlideDecodePriority priority = ( givenPriority )
+                ? *givenPriority
+                : this->priority( region );
+
+        m_jobs.push_back( Job{ std::move( region ), priority, m_nextSequence++,
+                               std::move( reader ), std::move( work ), std::move( tile ) } );
+
+        std::push_heap( std::begin( m_jobs ), std::end( m_jobs ), LessUrgent() );
+    }
+
+    /// Stop tracking the tiles of jobs that will never run. The mutex must be held by the caller.
+    template< class JobIterator >
+    void forgetPendingTiles( JobIterator first, JobIterator last )
+    {
+        for ( auto it = first; it != last; ++it )
+        {
+            if ( it->m_tile )
+            {
+                m_pendingTiles.erase( *( it->m_tile ) );
+            }
+        }
+    }
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_jobAvailable;
+    bool m_stop;
+
+    /// Heap of pending jobs
+    std::vector<Job> m_jobs;
+
+    /// Tiles that are read by pending or running jobs
+    std::unordered_set< SlideTileKey, SlideTileKeyHash > m_pendingTiles;
+
+    uint64_t m_nextSequence;
+
+    PriorityFunction m_priorityFunction;
+
+    std::vector<std::thread> m_workers;
+};
+
+
+SlideDecodeService::SlideDecodeService( size_t numWorkers )
+    :
+      m_impl( std::make_unique<Impl>() )
+{
+    numWorkers = std::max( numWorkers, size_t( 1 ) );
+
+    for ( size_t i = 0; i < numWorkers; ++i )
+    {
+        m_impl->m_workers.emplace_back( &Impl::workerLoop, m_impl.get() );
+    }
+}
+
+
+SlideDecodeService::~SlideDecodeService()
+{
+    {
+        std::lock_guard<std::mutex> lock( m_impl->m_mutex );
+        m_impl->m_stop = true;
+        m_impl->m_jobs.clear();
+    }
+
+    m_impl->m_jobAvailable.notify_all();
+
+    for ( auto& worker : m_impl->m_workers )
+    {
+        if ( worker.joinable() )
+        {
+            worker.join();
+        }
+    }
+}
+
+
+size_t SlideDecodeService::defaultNumWorkers()
+{
+    // Leave one core for the GUI thread
+    const size_t numCores = std::thread::hardware_concurrency();
+    return std::clamp( ( numCores > 1 ) ? numCores - 1 : size_t( 1 ), size_t( 1 ), sk_maxDefaultNumWorkers );
+}
+
+
+size_t SlideDecodeService::numWorkers() const
+{
+    return m_impl->m_workers.size();
+}
+
+
+void SlideDecodeService::setPriorityFunction( PriorityFunction func )
+{
+    std::lock_guard<std::mutex> lock( m_impl->m_mutex );
+    m_impl->m_priorityFunction = std::move( func );
+}
+
+
+void SlideDecodeService::reprioritize()
+{
+    std::lock_guard<std::mutex> lock( m_impl->m_mutex );
+
+    if ( ! m_impl->m_priorityFunction )
+    {
+        return;
+    }
+
+    for ( auto& job : m_impl->m_jobs )
+    {
+        job.m_priority = m_impl->priority( job.m_region );
+    }
+
+    std::make_heap( std::begin( m_impl->m_jobs ), std::end( m_impl->m_jobs ), Impl::LessUrgent() );
+}
+
+
+void SlideDecodeService::submit(
+        JobRegion region,
+        std::shared_ptr<SlideTileReader> reader,
+        Work work )
+{
+    if ( ! reader || ! work )
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock( m_impl->m_mutex );
+        m_impl->pushJob( std::move( region ), std::move( reader ), std::move( work ), std::nullopt );
+    }
+
+    m_impl->m_jobAvailable.notify_one();
+}
+
+
+void SlideDecodeService::forEachIndex(
+        const JobRegion& region,
+        const std::shared_ptr<SlideTileReader>& reader,
+        size_t count,
+        const IndexWork& work,
+        openslide_t* handle )
+{
+    if ( 0 == count || ! work )
+    {
+        return;
+    }
+
+    auto loop = std::make_shared<SharedIndexLoop>( count, work );
+
+    const size_t numHelpers = ( reader ) ? std::min( count, numWorkers() ) - 1 : 0;
+
+    if ( numHelpers > 0 )
+    {
+        {
+            std::lock_guard<std::mutex> lock( m_impl->m_mutex );
+
+            // Helpers are as urgent as the calling job. Its priority is reused rather than
+            // computed for the region, because the priority function must not run on workers.
+            for ( size_t i = 0; i < numHelpers; ++i )
+            {
+                m_impl->pushJob( region, reader,
+                                 [loop] ( SlideTileReader&, openslide_t* h ) { loop->run( h ); },
+                                 std::nullopt, s_runningJobPriority );
+            }
+        }
+
+        m_impl->m_jobAvailable.notify_all();
+    }
+
+    loop->run( handle );
+    loop->close();
+}
+
+
+void SlideDecodeService::prefetchTiles(
+        const UID& slideUid,
+        const std::shared_ptr<SlideTileReader>& reader,
+        int level,
+        const std::vector< glm::i64vec2 >& tileIndices,
+        TileReadHandler onTileRead )
+{
+    if ( ! reader )
+    {
+        return;
+    }
+
+    const double k_tileSize = static_cast<double>( reader->tileSize() );
+    const double k_downsample = reader->levelDownsample( level );
+
+    size_t numSubmitted = 0;
+
+    {
+        std::lock_guard<std::mutex> lock( m_impl->m_mutex );
+
+        for ( const glm::i64vec2& tileIndex : tileIndices )
+        {
+            const bool background = reader->isBackgroundTile( level, tileIndex );
+
+            // Cached tiles need not be read, and background tiles are not read if skipped
+            if ( reader->isTileCached( level, tileIndex ) || ( background && reader->skipBackgroundTiles() ) )
+            {
+                continue;
+            }
+
+            SlideTileKey key{ reader->slideUid(), level, tileIndex };
+
+            if ( ! m_impl->m_pendingTiles.insert( key ).second )
+            {
+                // The tile is already being read
+                continue;
+            }
+
+            // Center of the tile in level 0 pixel coordinates
+            const glm::dvec2 center = k_downsample * k_tileSize * ( glm::dvec2( tileIndex ) + 0.5 );
+
+            m_impl->pushJob( JobRegion{ slideUid, center, background }, reader,
+                             [level, tileIndex, onTileRead] ( SlideTileReader& r, openslide_t* handle )
+            {
+                // The tile may have been read since the job was submitted
+                if ( r.isTileCached( level, tileIndex ) || r.readTile( level, tileIndex, handle ) )
+                {
+                    if ( onTileRead )
+                    {
+                        onTileRead( level, tileIndex );
+                    }
+                }
+            },
+            std::move( key ) );
+
+            ++numSubmitted;
+        }
+    }
+
+    if ( numSubmitted > 0 )
+    {
+        m_impl->m_jobAvailable.notify_all();
+    }
+}
+
+
+void SlideDecodeService::cancel( const UID& slideUid )
+{
+    std::lock_guard<std::mutex> lock( m_impl->m_mutex );
+
+    auto& jobs = m_impl->m_jobs;
+
+    auto cancelled = std::partition( std::begin( jobs ), std::end( jobs ),
+                                     [&slideUid] ( const Impl::Job& job ) { return ( job.m_region.m_slideUid != slideUid ); } );
+
+    m_impl->forgetPendingTiles( cancelled, std::end( jobs ) );
+    jobs.erase( cancelled, std::end( jobs ) );
+
+    std::make_heap( std::begin( jobs ), std::end( jobs ), Impl::LessUrgent() );
+}
+
+
+void SlideDecodeService::cancelAll()
+{
+    std::lock_guard<std::mutex> lock( m_impl->m_mutex );
+
+    m_impl->forgetPendingTiles( std::begin( m_impl->m_jobs ), std::end( m_impl->m_jobs ) );
+    m_impl->m_jobs.clear();
+}
+
+
+size_t SlideDecodeService::numPendingJobs() const
+{
+    std::lock_guard<std::mutex> lock( m_impl->m_mutex );
+    return m_impl->m_jobs.size();
+}
+
+} // namespace slideio
@@ -0,0 +1,181 @@
+#ifndef SLIDE_DECODE_SERVICE_H
+#define SLIDE_DECODE_SERVICE_H
+
+#include "common/UID.h"
+
+#include <glm/vec2.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+typedef struct _openslide openslide_t;
+
+
+namespace slideio
+{
+
+class SlideTileReader;
+
+
+/**
+ * @brief Priority of a slide decoding job. Jobs are ordered first by the distance of their
+ * slide from the active slide in the stack, then by whether their region holds tissue,
+ * then by the distance of their region from the center of the view.
+ */
+struct SlideDecodePriority
+{
+    /// Number of slides between the job's slide and the active slide in the stack
+    size_t m_stackDistance = 0;
+
+    /// Flag that the tissue mask shows the job's region to hold only background
+    bool m_background = false;
+
+    /// Distance between the job's region and the view center, in level 0 pixels
+    double m_viewDistance = 0.0;
+
+    /// Return true iff this priority is more urgent than the other one
+    bool operator<( const SlideDecodePriority& other ) const
+    {
+        if ( m_stackDistance != other.m_stackDistance )
+        {
+            return ( m_stackDistance < other.m_stackDistance );
+        }
+        if ( m_background != other.m_background )
+        {
+            return ( ! m_background );
+        }
+        return ( m_viewDistance < other.m_viewDistance );
+    }
+};
+
+
+/**
+ * @brief Pool of background threads that decode slide pixel data with OpenSlide, so that
+ * the GUI thread never blocks on slide files.
+ *
+ * Each worker thread keeps its own OpenSlide handles to the slide files that it decodes.
+ * Pending jobs are held in a priority queue: the priority of a job is computed from its slide
+ * and region by a function that is supplied by the application. Priorities of all pending
+ * jobs are recomputed upon request, e.g. when the active slide or the view changes.
+ *
+ * Jobs run on the worker threads: any work that must be done on the GUI thread (such as
+ * updating records or textures) must be posted to it by the job.
+ */
+class SlideDecodeService
+{
+public:
+
+    /// Slide region decoded by a job. Used to compute the job's priority.
+    struct JobRegion
+    {
+        UID m_slideUid; //!< UID of the slide record
+        glm::dvec2 m_center; //!< Center of the region in level 0 pixel coordinates
+        bool m_background = false; //!< Flag that the region holds only background
+    };
+
+    using PriorityFunction = std::function< SlideDecodePriority ( const JobRegion& ) >;
+
+    /// Work of a job. It is given the worker's OpenSlide handle to the slide file,
+    /// which is null if the worker could not open the file.
+    using Work = std::function< void ( SlideTileReader& reader, openslide_t* handle ) >;
+
+
+    /// Create a service with the given number of worker threads
+    explicit SlideDecodeService( size_t numWorkers = defaultNumWorkers() );
+
+    SlideDecodeService( const SlideDecodeService& ) = delete;
+    SlideDecodeService& operator=( const SlideDecodeService& ) = delete;
+
+    /// Cancel all pending jobs and join the worker threads after their current jobs finish
+    ~SlideDecodeService();
+
+    /// Get the default number of worker threads, which is based on the hardware concurrency
+    static size_t defaultNumWorkers();
+
+    size_t numWorkers() const;
+
+    /// Set the function that computes job priorities. Jobs submitted while no function
+    /// is set are run in order of submission. Jobs of background regions are run after the
+    /// others of equal stack distance, whatever the function. The function is called on the
+    /// threads that submit jobs and recompute priorities, but never on the worker threads.
+    void setPriorityFunction( PriorityFunction );
+
+    /// Recompute the priorities of all pending jobs
+    void reprioritize();
+
+    /**
+     * @brief Submit a job
+     * @param region Region of the slide decoded by the job
+     * @param reader Tile reader of the slide. The reader is kept alive until the job finishes.
+     * @param work Work of the job
+     */
+    void submit( JobRegion region, std::shared_ptr<SlideTileReader> reader, Work work );
+
+    /// Work of one index of a parallel loop. It is given the OpenSlide handle of the worker
+    /// that runs it, which is null if the worker could not open the slide file.
+    using IndexWork = std::function< void ( size_t index, openslide_t* handle ) >;
+
+    /**
+     * @brief Call a function for each index in [0, count) on the calling worker thread and on
+     * idle worker threads. This must be called from within a job, which thereby splits its work
+     * among workers without creating threads. Helper jobs are submitted for the job's region
+     * with the job's priority, so they are as urgent as the job (the priority function is not
+     * called for them); workers that are busy with other jobs join in only once they finish
+     * them. The calling worker runs any indices that no helper takes.
+     *
+     * @param region Region of the calling job
+     * @param reader Tile reader of the calling job's slide
+     * @param count Number of indices
+     * @param work Function called for each index
+     * @param handle OpenSlide handle of the calling worker
+     *
+     * The call returns once all indices are done. If the function throws, then no further
+     * indices are started and the first exception is rethrown on the calling thread.
+     */
+    void forEachIndex( const JobRegion& region,
+                       const std::shared_ptr<SlideTileReader>& reader,
+                       size_t count,
+                       const IndexWork& work,
+                       openslide_t* handle );
+
+    /// Function called on a worker thread after a prefetched tile has been read into the cache
+    using TileReadHandler = std::function< void ( int level, const glm::i64vec2& tileIndex ) >;
+
+    /**
+     * @brief Submit jobs that read tiles of a slide level into the tile cache.
+     * Tiles that are already cached or already pending are skipped, as are tiles of background
+     * if the reader skips them. Other tiles of background are read after tiles of tissue.
+     * @param slideUid UID of the slide record
+     * @param reader Tile reader of the slide
+     * @param level File level
+     * @param tileIndices Tile (column, row) indices within the level
+     * @param onTileRead Optional function called after each tile is read
+     */
+    void prefetchTiles( const UID& slideUid,
+                        const std::shared_ptr<SlideTileReader>& reader,
+                        int level,
+                        const std::vector< glm::i64vec2 >& tileIndices,
+                        TileReadHandler onTileRead = nullptr );
+
+    /// Cancel all pending jobs of a slide. Jobs that are running are not interrupted.
+    void cancel( const UID& slideUid );
+
+    /// Cancel all pending jobs
+    void cancelAll();
+
+    /// Get the number of jobs that have not yet started
+    size_t numPendingJobs() const;
+
+
+private:
+
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace slideio
+
+#endif // SLIDE_DECODE_SERVICE_H
@@ -0,0 +1,503 @@
+#include "slideio/SlideDiskCache.h"
+#include "slideio/SlideReading.h"
+
+#include <boost/filesystem.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+
+namespace
+{
+
+namespace fs = boost::filesystem;
+
+/// Identifies files as cache entries
+static constexpr std::array<char, 8> sk_magic{ { 'H', 'Z', 'S', 'L', 'I', 'D', 'E', 'C' } };
+
+/// Version of the entry format. Increment it whenever the format or the decoded data change.
+static constexpr uint32_t sk_version = 1;
+
+/// Extension of cache entry files
+static const std::string sk_entryExtension( ".hzslide" );
+
+
+/// Fixed-size header at the start of every cache entry
+struct EntryHeader
+{
+    std::array<char, 8> m_magic;
+    uint32_t m_version;
+    uint32_t m_keyLength; //!< Length of the entry key that follows the header
+    int64_t m_gpuLevel;
+    int64_t m_gpuDims[2];
+    double m_gpuDownsampleFactors[2];
+    int64_t m_thumbDims[2]; //!< Zero if the entry has no thumbnail
+};
+
+static_assert( sizeof( EntryHeader ) % 8 == 0, "Entry header size must be a multiple of 8 bytes" );
+
+
+/// Round a byte count up to a multiple of 8
+uint64_t padded( uint64_t numBytes )
+{
+    return ( numBytes + 7 ) & ~uint64_t( 7 );
+}
+
+
+/// 64-bit FNV-1a hash, which is stable across runs and platforms
+uint64_t fnv1aHash( const std::string& s )
+{
+    uint64_t hash = 14695981039346656037ull;
+
+    for ( const char c : s )
+    {
+        hash ^= static_cast<uint8_t>( c );
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+
+bool writePadding( std::ostream& os, uint64_t numBytes )
+{
+    static const char sk_zeros[8] = { 0 };
+    os.write( sk_zeros, static_cast<std::streamsize>( padded( numBytes ) - numBytes ) );
+    return os.good();
+}
+
+
+bool skipPadding( std::istream& is, uint64_t numBytes )
+{
+    is.seekg( static_cast<std::streamoff>( padded( numBytes ) - numBytes ), std::ios::cur );
+    return is.good();
+}
+
+
+/// Key of the cache entry of a slide file: its canonical path, size, and modification time.
+/// std::nullopt if the slide file does not exist.
+std::optional<std::string> slideKey( const std::string& slideFileName )
+{
+    boost::system::error_code ec;
+
+    const fs::path path = fs::canonical( slideFileName, ec );
+    if ( ec ) return std::nullopt;
+
+    const auto fileSize = fs::file_size( path, ec );
+    if ( ec ) return std::nullopt;
+
+    const auto modifiedTime = fs::last_write_time( path, ec );
+    if ( ec ) return std::nullopt;
+
+    std::ostringstream ss;
+    ss << path.string() << '\n' << fileSize << '\n' << modifiedTime;
+    return ss.str();
+}
+
+
+/// Read the key of a cache entry; std::nullopt if the file is not an entry of the current version
+std::optional<std::string> readEntryKey( const fs::path& entryPath )
+{
+    std::ifstream is( entryPath.string(), std::ios::binary );
+
+    EntryHeader header;
+    is.read( reinterpret_cast<char*>( &header ), sizeof( EntryHeader ) );
+
+    if ( ! is || header.m_magic != sk_magic || header.m_version != sk_version )
+    {
+        return std::nullopt;
+    }
+
+    std::string key( header.m_keyLength, '\0' );
+    is.read( &key[0], static_cast<std::streamsize>( key.size() ) );
+
+    if ( ! is )
+    {
+        return std::nullopt;
+    }
+
+    return key;
+}
+
+
+/// Get whether the key of a cache entry is that of the slide file whose path it holds,
+/// i.e. whether the slide file still exists and has not been modified
+bool isKeyCurrent( const std::string& key )
+{
+    // The path is followed by the size and modification time, each on its own line
+    const size_t timePos = key.rfind( '\n' );
+
+    if ( std::string::npos == timePos || 0 == timePos )
+    {
+        return false;
+    }
+
+    const size_t sizePos = key.rfind( '\n', timePos - 1 );
+
+    if ( std::string::npos == sizePos )
+    {
+        return false;
+    }
+
+    const auto currentKey = slideKey( key.substr( 0, sizePos ) );
+    return ( currentKey && *currentKey == key );
+}
+
+} // anonymous
+
+
+namespace slideio
+{
+
+SlideDiskCache::SlideDiskCache( std::string directory, uint64_t byteBudget )
+    :
+      m_directory( std::move( directory ) ),
+      m_isValid( false ),
+      m_byteBudget( byteBudget ),
+      m_removalMutex()
+{
+    boost::system::error_code ec;
+    fs::create_directories( m_directory, ec );
+
+    m_isValid = ( ! ec && fs::is_directory( m_directory, ec ) );
+
+    if ( ! m_isValid )
+    {
+        std::cerr << "Unable to create slide cache directory " << m_directory << std::endl;
+        return;
+    }
+
+    removeStaleEntries();
+    enforceByteBudget();
+}
+
+
+const std::string& SlideDiskCache::directory() const
+{
+    return m_directory;
+}
+
+
+bool SlideDiskCache::isValid() const
+{
+    return m_isValid;
+}
+
+
+uint64_t SlideDiskCache::byteBudget() const
+{
+    return m_byteBudget;
+}
+
+
+std::optional<std::string> SlideDiskCache::entryPath(
+        const std::string& slideFileName, std::string& key ) const
+{
+    const auto currentKey = slideKey( slideFileName );
+
+    if ( ! currentKey )
+    {
+        return std::nullopt;
+    }
+
+    key = *currentKey;
+
+    std::ostringstream name;
+    name << std::hex << std::setw( 16 ) << std::setfill( '0' ) << fnv1aHash( key ) << sk_entryExtension;
+
+    return ( fs::path( m_directory ) / name.str() ).string();
+}
+
+
+std::unique_ptr<DecodedSlideData> SlideDiskCache::load(
+        const std::string& slideFileName, bool requireThumbnail ) const
+{
+    if ( ! m_isValid )
+    {
+        return nullptr;
+    }
+
+    std::string key;
+    const auto path = entryPath( slideFileName, key );
+
+    if ( ! path )
+    {
+        return nullptr;
+    }
+
+    std::ifstream is( *path, std::ios::binary );
+
+    if ( ! is )
+    {
+        return nullptr;
+    }
+
+    EntryHeader header;
+    is.read( reinterpret_cast<char*>( &header ), sizeof( EntryHeader ) );
+
+    if ( ! is || header.m_magic != sk_magic || header.m_version != sk_version ||
+         header.m_keyLength != key.size() )
+    {
+        return nullptr;
+    }
+
+    // Entries of different slides may have the same hash, so compare the full keys
+    std::string entryKey( header.m_keyLength, '\0' );
+    is.read( &entryKey[0], static_cast<std::streamsize>( entryKey.size() ) );
+
+    if ( ! is || entryKey != key || ! skipPadding( is, entryKey.size() ) )
+    {
+        return nullptr;
+    }
+
+    const glm::i64vec2 gpuDims{ header.m_gpuDims[0], header.m_gpuDims[1] };
+    const glm::i64vec2 thumbDims{ header.m_thumbDims[0], header.m_thumbDims[1] };
+    const bool hasThumbnail = ( thumbDims.x > 0 && thumbDims.y > 0 );
+
+    if ( gpuDims.x <= 0 || gpuDims.y <= 0 || ( requireThumbnail && ! hasThumbnail ) )
+    {
+        return nullptr;
+    }
+
+    auto decoded = std::make_unique<DecodedSlideData>();
+
+    SlideLevel& gpuLevel = decoded->m_gpuLevel;
+    gpuLevel.m_level = static_cast<int>( header.m_gpuLevel );
+    gpuLevel.m_dims = gpuDims;
+    gpuLevel.m_downsampleFactors = glm::dvec2{ header.m_gpuDownsampleFactors[0],
+                                               header.m_gpuDownsampleFactors[1] };
+
+    const size_t numGpuPixels = static_cast<size_t>( gpuDims.x * gpuDims.y );
+    gpuLevel.m_data = std::make_unique< uint32_t[] >( numGpuPixels );
+
+    is.read( reinterpret_cast<char*>( gpuLevel.m_data.get() ),
+             static_cast<std::streamsize>( numGpuPixels * sizeof( uint32_t ) ) );
+
+    if ( ! is )
+    {
+        return nullptr;
+    }
+
+    if ( requireThumbnail )
+    {
+        if ( ! skipPadding( is, numGpuPixels * sizeof( uint32_t ) ) )
+        {
+            return nullptr;
+        }
+
+        auto thumbData = std::make_shared< std::vector<uint32_t> >(
+                    static_cast<size_t>( thumbDims.x * thumbDims.y ) );
+
+        is.read( reinterpret_cast<char*>( thumbData->data() ),
+                 static_cast<std::streamsize>( thumbData->size() * sizeof( uint32_t ) ) );
+
+        if ( ! is )
+        {
+            return nullptr;
+        }
+
+        decoded->m_thumbImage = std::make_pair( thumbData, thumbDims );
+    }
+
+    is.close();
+
+    // Mark the entry as recently used
+    boost::system::error_code ec;
+    fs::last_write_time( *path, std::time( nullptr ), ec );
+
+    return decoded;
+}
+
+
+bool SlideDiskCache::store( const std::string& slideFileName, const DecodedSlideData& data ) const
+{
+    const SlideLevel& gpuLevel = data.m_gpuLevel;
+
+    if ( ! m_isValid || ! gpuLevel.m_data || gpuLevel.m_dims.x <= 0 || gpuLevel.m_dims.y <= 0 )
+    {
+        return false;
+    }
+
+    std::string key;
+    const auto path = entryPath( slideFileName, key );
+
+    if ( ! path )
+    {
+        return false;
+    }
+
+    const auto& thumb = data.m_thumbImage;
+    const bool hasThumbnail = ( thumb.first && thumb.second.x > 0 && thumb.second.y > 0 &&
+                                thumb.first->size() == static_cast<size_t>( thumb.second.x * thumb.second.y ) );
+
+    EntryHeader header;
+    std::memset( &header, 0, sizeof( EntryHeader ) );
+
+    header.m_magic = sk_magic;
+    header.m_version = sk_version;
+    header.m_keyLength = static_cast<uint32_t>( key.size() );
+    header.m_gpuLevel = gpuLevel.m_level;
+    header.m_gpuDims[0] = gpuLevel.m_dims.x;
+    header.m_gpuDims[1] = gpuLevel.m_dims.y;
+    header.m_gpuDownsampleFactors[0] = gpuLevel.m_downsampleFactors.x;
+    header.m_gpuDownsampleFactors[1] = gpuLevel.m_downsampleFactors.y;
+    header.m_thumbDims[0] = ( hasThumbnail ) ? thumb.second.x : 0;
+    header.m_thumbDims[1] = ( hasThumbnail ) ? thumb.second.y : 0;
+
+    // Write to a uniquely named temporary file, then rename it to the entry
+    boost::system::error_code ec;
+    const fs::path tempPath = fs::path( m_directory ) / fs::unique_path( "%%%%-%%%%-%%%%.tmp", ec );
+
+    if ( ec )
+    {
+        return false;
+    }
+
+    {
+        std::ofstream os( tempPath.string(), std::ios::binary | std::ios::trunc );
+
+        const uint64_t numGpuBytes = static_cast<uint64_t>(
+                    gpuLevel.m_dims.x * gpuLevel.m_dims.y ) * sizeof( uint32_t );
+
+        os.write( reinterpret_cast<const char*>( &header ), sizeof( EntryHeader ) );
+        os.write( key.data(), static_cast<std::streamsize>( key.size() ) );
+        writePadding( os, key.size() );
+
+        os.write( reinterpret_cast<const char*>( gpuLevel.m_data.get() ),
+                  static_cast<std::streamsize>( numGpuBytes ) );
+
+        if ( hasThumbnail )
+        {
+            writePadding( os, numGpuBytes );
+            os.write( reinterpret_cast<const char*>( thumb.first->data() ),
+                      static_cast<std::streamsize>( thumb.first->size() * sizeof( uint32_t ) ) );
+        }
+
+        if ( ! os.good() )
+        {
+            os.close();
+            fs::remove( tempPath, ec );
+
+            std::cerr << "Unable to write slide cache entry for " << slideFileName << std::endl;
+            return false;
+        }
+    }
+
+    fs::rename( tempPath, *path, ec );
+
+    if ( ec )
+    {
+        fs::remove( tempPath, ec );
+        return false;
+    }
+
+    enforceByteBudget();
+
+    return true;
+}
+
+
+void SlideDiskCache::removeStaleEntries() const
+{
+    std::lock_guard<std::mutex> lock( m_removalMutex );
+
+    boost::system::error_code ec;
+    size_t numRemoved = 0;
+
+    for ( fs::directory_iterator it( m_directory, ec ), end; ! ec && it != end; it.increment( ec ) )
+    {
+        const fs::path& path = it->path();
+
+        if ( ! fs::is_regular_file( path, ec ) )
+        {
+            continue;
+        }
+
+        bool isStale = ( ".tmp" == path.extension() );
+
+        if ( sk_entryExtension == path.extension() )
+        {
+            const auto key = readEntryKey( path );
+            isStale = ( ! key || ! isKeyCurrent( *key ) );
+        }
+
+        if ( isStale && fs::remove( path, ec ) )
+        {
+            ++numRemoved;
+        }
+    }
+
+    if ( numRemoved > 0 )
+    {
+        std::cout << "Removed " << numRemoved << " stale entries from slide cache "
+                  << m_directory << std::endl;
+    }
+}
+
+
+void SlideDiskCache::enforceByteBudget() const
+{
+    struct Entry
+    {
+        std::time_t m_lastUse;
+        uint64_t m_numBytes;
+        fs::path m_path;
+    };
+
+    std::lock_guard<std::mutex> lock( m_removalMutex );
+
+    boost::system::error_code ec;
+
+    std::vector<Entry> entries;
+    uint64_t totalNumBytes = 0;
+
+    for ( fs::directory_iterator it( m_directory, ec ), end; ! ec && it != end; it.increment( ec ) )
+    {
+        const fs::path& path = it->path();
+
+        if ( sk_entryExtension != path.extension() || ! fs::is_regular_file( path, ec ) )
+        {
+            continue;
+        }
+
+        const uint64_t numBytes = fs::file_size( path, ec );
+        if ( ec ) continue;
+
+        const std::time_t lastUse = fs::last_write_time( path, ec );
+        if ( ec ) continue;
+
+        entries.push_back( Entry{ lastUse, numBytes, path } );
+        totalNumBytes += numBytes;
+    }
+
+    if ( totalNumBytes <= m_byteBudget )
+    {
+        return;
+    }
+
+    std::sort( std::begin( entries ), std::end( entries ),
+               [] ( const Entry& a, const Entry& b ) { return ( a.m_lastUse < b.m_lastUse ); } );
+
+    for ( const Entry& entry : entries )
+    {
+        if ( totalNumBytes <= m_byteBudget )
+        {
+            break;
+        }
+
+        if ( fs::remove( entry.m_path, ec ) )
+        {
+            totalNumBytes -= entry.m_numBytes;
+        }
+    }
+}
+
+} // namespace slideio
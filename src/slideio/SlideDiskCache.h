@@ -0,0 +1,104 @@
+#ifndef SLIDE_DISK_CACHE_H
+#define SLIDE_DISK_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+
+namespace slideio
+{
+
+struct DecodedSlideData;
+
+
+/**
+ * @brief Cache on disk of the data decoded from slide files: the level that is uploaded to the
+ * GPU and the generated thumbnail. Re-opening a slide whose data are in the cache avoids
+ * decoding and downsampling the slide with OpenSlide.
+ *
+ * Entries are content-addressed: each is a file named by the hash of the slide file's
+ * canonical path, size, and modification time, so that entries of modified slides are never
+ * used. An entry holds a small fixed-size header followed by the raw premultiplied ARGB pixels
+ * of the GPU level and of the thumbnail, each starting at an 8-byte aligned offset, so that the
+ * file can be memory-mapped. Entries are written to a temporary file that is then renamed,
+ * so that readers never see partially written entries.
+ *
+ * The total size of the entries is bounded by a byte budget. Loading an entry updates its
+ * modification time, and once a stored entry puts the cache over budget, entries are deleted
+ * in order of modification time, i.e. least recently used first. On construction, entries of
+ * slide files that have since been modified or removed, entries of other format versions,
+ * and temporary files left by interrupted stores are deleted.
+ *
+ * All member functions are thread-safe.
+ */
+class SlideDiskCache
+{
+public:
+
+    /// Default byte budget of the cache entries
+    static constexpr uint64_t sk_defaultByteBudget = ( uint64_t( 4 ) << 30 );
+
+    /**
+     * @brief Construct the cache, creating its directory if it does not exist,
+     * and delete its stale entries
+     * @param directory Directory that holds the cache entries
+     * @param byteBudget Maximum total size in bytes of the cache entries
+     */
+    explicit SlideDiskCache( std::string directory, uint64_t byteBudget = sk_defaultByteBudget );
+
+    SlideDiskCache( const SlideDiskCache& ) = delete;
+    SlideDiskCache& operator=( const SlideDiskCache& ) = delete;
+
+    ~SlideDiskCache() = default;
+
+    const std::string& directory() const;
+
+    /// Get whether the cache directory exists and entries can be stored in it
+    bool isValid() const;
+
+    uint64_t byteBudget() const;
+
+    /**
+     * @brief Load the decoded data of a slide file from the cache
+     * @param slideFileName Slide file name
+     * @param requireThumbnail Flag that the data must include a generated thumbnail
+     * @return Decoded data; nullptr if the slide is not in the cache
+     */
+    std::unique_ptr<DecodedSlideData> load(
+            const std::string& slideFileName, bool requireThumbnail ) const;
+
+    /**
+     * @brief Store the decoded data of a slide file in the cache
+     * @param slideFileName Slide file name
+     * @param data Decoded data of the slide
+     * @return True iff the data were stored
+     */
+    bool store( const std::string& slideFileName, const DecodedSlideData& data ) const;
+
+
+private:
+
+    /// Path of the cache entry of a slide file; std::nullopt if the slide file does not exist
+    std::optional<std::string> entryPath( const std::string& slideFileName, std::string& key ) const;
+
+    /// Delete the entries of modified or removed slide files, the entries of other format
+    /// versions, and temporary files
+    void removeStaleEntries() const;
+
+    /// Delete the least recently used entries until the entries fit within the byte budget
+    void enforceByteBudget() const;
+
+    std::string m_directory;
+    bool m_isValid;
+    uint64_t m_byteBudget;
+
+    /// Serializes the scans of the cache directory that delete entries
+    mutable std::mutex m_removalMutex;
+};
+
+} // namespace slideio
+
+#endif // SLIDE_DISK_CACHE_H
@@ -0,0 +1,386 @@
+#include "slideio/SlideDownsampling.h"
+#include "slideio/SlideTileReader.h"
+
+#include "imageio/util/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+
+namespace
+{
+
+/**
+ * @brief Overlap of the source pixels along one axis with the output pixels. Since the output
+ * is no larger than the source, each source pixel overlaps at most two output pixels:
+ * the pixel at m_index[i] with weight m_weight[i], and the next pixel with weight 1 - m_weight[i].
+ */
+struct AxisWeights
+{
+    AxisWeights( int64_t srcSize, int64_t dstSize )
+        :
+          m_index( static_cast<size_t>( srcSize ) ),
+          m_weight( static_cast<size_t>( srcSize ) )
+    {
+        const double scale = static_cast<double>( srcSize ) / static_cast<double>( dstSize );
+
+        for ( int64_t s = 0; s < srcSize; ++s )
+        {
+            const int64_t d = std::min( static_cast<int64_t>( std::floor( s / scale ) ), dstSize - 1 );
+            const double boundary = static_cast<double>( d + 1 ) * scale;
+
+            m_index[static_cast<size_t>( s )] = d;
+            m_weight[static_cast<size_t>( s )] = static_cast<float>(
+                        std::clamp( boundary - static_cast<double>( s ), 0.0, 1.0 ) );
+        }
+    }
+
+    std::vector<int64_t> m_index;
+    std::vector<float> m_weight;
+};
+
+
+/// Number of tile strips in each band of the file level that is reduced as one unit of work
+static constexpr int64_t sk_numStripsPerBand = 2;
+
+
+uint32_t toByte( float sum, float normalization )
+{
+    return static_cast<uint32_t>( std::min( sum * normalization + 0.5f, 255.0f ) );
+}
+
+
+/// Write a row of accumulated (blue, green, red, alpha) sums as pre-multiplied ARGB pixels
+void writeRow( const float* sums, uint32_t* out, int64_t numPixels, float normalization )
+{
+    for ( int64_t x = 0; x < numPixels; ++x )
+    {
+        const float* c = sums + 4 * x;
+        out[x] = ( toByte( c[3], normalization ) << 24 ) | ( toByte( c[2], normalization ) << 16 ) |
+                 ( toByte( c[1], normalization ) << 8 ) | toByte( c[0], normalization );
+    }
+}
+
+
+/**
+ * @brief Output row that is covered by source rows of two bands. The band that finishes the row
+ * first keeps its partial sums here; the other band adds its own sums and writes the row.
+ */
+class SeamRow
+{
+public:
+
+    void merge( const float* sums, uint32_t* out, int64_t numPixels, float normalization )
+    {
+        const size_t numSums = static_cast<size_t>( 4 * numPixels );
+
+        std::lock_guard<std::mutex> lock( m_mutex );
+
+        if ( ! m_merged )
+        {
+            m_sums.assign( sums, sums + numSums );
+            m_merged = true;
+            return;
+        }
+
+        for ( size_t i = 0; i < numSums; ++i )
+        {
+            m_sums[i] += sums[i];
+        }
+
+        writeRow( m_sums.data(), out, numPixels, normalization );
+        std::vector<float>().swap( m_sums );
+    }
+
+
+private:
+
+    std::mutex m_mutex;
+    std::vector<float> m_sums;
+    bool m_merged = false;
+};
+
+
+/**
+ * @brief Area-averages a band of source rows into the output rows that they cover. Output rows
+ * are accumulated in a window that slides down the band as strips of tiles are streamed through
+ * it. The first and last output rows of the band are merged with the neighboring bands if they
+ * share them.
+ */
+class BandReducer
+{
+public:
+
+    BandReducer( const AxisWeights& colWeights, const AxisWeights& rowWeights,
+                 const glm::i64vec2& dstDims, uint32_t* dst, float normalization,
+                 int64_t firstRow, int64_t endRow, int64_t windowRows,
+                 SeamRow* topSeam, SeamRow* bottomSeam )
+        :
+          m_colWeights( colWeights ),
+          m_rowWeights( rowWeights ),
+          m_dstDims( dstDims ),
+          m_dst( dst ),
+          m_normalization( normalization ),
+          m_firstRow( firstRow ),
+          m_endRow( endRow ),
+          m_topSeam( topSeam ),
+          m_bottomSeam( bottomSeam ),
+          m_windowBegin( firstRow ),
+          m_windowRows( windowRows ),
+          m_window( static_cast<size_t>( 4 * windowRows * dstDims.x ), 0.0f )
+    {}
+
+    /// Accumulate a row segment of a tile. All output rows above the one that the segment
+    /// first covers must have been flushed.
+    void accumulate( int64_t srcRow, int64_t srcColBegin, const uint32_t* pixels, int64_t numPixels )
+    {
+        const int64_t d = m_rowWeights.m_index[static_cast<size_t>( srcRow )];
+        const float w = m_rowWeights.m_weight[static_cast<size_t>( srcRow )];
+
+        if ( m_firstRow <= d && d < m_endRow )
+        {
+            accumulateRow( d, w, srcColBegin, pixels, numPixels );
+        }
+
+        if ( w < 1.0f && m_firstRow <= d + 1 && d + 1 < m_endRow )
+        {
+            accumulateRow( d + 1, 1.0f - w, srcColBegin, pixels, numPixels );
+        }
+    }
+
+    /// Write all output rows above a row to the output and slide the window down to that row
+    void flushTo( int64_t row )
+    {
+        row = std::min( row, m_endRow );
+
+        if ( row <= m_windowBegin )
+        {
+            return;
+        }
+
+        const int64_t numFlushed = std::min( row - m_windowBegin, m_windowRows );
+        const size_t rowSize = static_cast<size_t>( 4 * m_dstDims.x );
+
+        for ( int64_t r = 0; r < numFlushed; ++r )
+        {
+            const int64_t dstRow = m_windowBegin + r;
+            const float* acc = m_window.data() + static_cast<size_t>( r ) * rowSize;
+            uint32_t* out = m_dst + dstRow * m_dstDims.x;
+
+            if ( m_topSeam && m_firstRow == dstRow )
+            {
+                m_topSeam->merge( acc, out, m_dstDims.x, m_normalization );
+            }
+            else if ( m_bottomSeam && m_endRow - 1 == dstRow )
+            {
+                m_bottomSeam->merge( acc, out, m_dstDims.x, m_normalization );
+            }
+            else
+            {
+                writeRow( acc, out, m_dstDims.x, m_normalization );
+            }
+        }
+
+        // Move the rows still being accumulated to the top of the window and clear the rest
+        const auto kept = std::begin( m_window ) + static_cast<std::ptrdiff_t>( numFlushed * static_cast<int64_t>( rowSize ) );
+        std::move( kept, std::end( m_window ), std::begin( m_window ) );
+        std::fill( std::end( m_window ) - ( kept - std::begin( m_window ) ), std::end( m_window ), 0.0f );
+
+        m_windowBegin = row;
+    }
+
+
+private:
+
+    void accumulateRow( int64_t dstRow, float rowWeight,
+                        int64_t srcColBegin, const uint32_t* pixels, int64_t numPixels )
+    {
+        float* acc = m_window.data() + static_cast<size_t>( 4 * ( dstRow - m_windowBegin ) * m_dstDims.x );
+
+        for ( int64_t i = 0; i < numPixels; ++i )
+        {
+            const size_t s = static_cast<size_t>( srcColBegin + i );
+            const int64_t d = m_colWeights.m_index[s];
+            const float w0 = rowWeight * m_colWeights.m_weight[s];
+            const float w1 = rowWeight - w0;
+
+            const uint32_t p = pixels[i];
+            const float b = static_cast<float>( p & 0xff );
+            const float g = static_cast<float>( ( p >> 8 ) & 0xff );
+            const float r = static_cast<float>( ( p >> 16 ) & 0xff );
+            const float a = static_cast<float>( p >> 24 );
+
+            float* c = acc + 4 * d;
+            c[0] += w0 * b; c[1] += w0 * g; c[2] += w0 * r; c[3] += w0 * a;
+
+            if ( w1 > 0.0f && d + 1 < m_dstDims.x )
+            {
+                c += 4;
+                c[0] += w1 * b; c[1] += w1 * g; c[2] += w1 * r; c[3] += w1 * a;
+            }
+        }
+    }
+
+    const AxisWeights& m_colWeights;
+    const AxisWeights& m_rowWeights;
+
+    const glm::i64vec2 m_dstDims;
+    uint32_t* m_dst;
+    const float m_normalization; //!< Inverse of the source area covered by an output pixel
+
+    /// Output rows covered by the band
+    const int64_t m_firstRow;
+    const int64_t m_endRow;
+
+    /// Seams of the first and last output rows; null if the rows are not shared with another band
+    SeamRow* m_topSeam;
+    SeamRow* m_bottomSeam;
+
+    /// First output row and number of rows held in the accumulation window
+    int64_t m_windowBegin;
+    const int64_t m_windowRows;
+
+    /// Accumulated (blue, green, red, alpha) sums of the window rows
+    std::vector<float> m_window;
+};
+
+
+/// Band of source rows, which are whole tile strips, and the output rows that it covers
+struct Band
+{
+    int64_t m_firstStrip;
+    int64_t m_endStrip;
+    int64_t m_firstRow;
+    int64_t m_endRow;
+};
+
+} // anonymous
+
+
+namespace slideio
+{
+
+bool downsampleLevel( SlideTileReader& reader,
+                      int level,
+                      const glm::i64vec2& dstDims,
+                      uint32_t* dst,
+                      openslide_t* handle,
+                      const ParallelRunner& runner )
+{
+    if ( ! dst || ! reader.isValid() || level < 0 || level >= reader.numLevels() )
+    {
+        return false;
+    }
+
+    const glm::i64vec2 srcDims = reader.levelDims( level );
+
+    if ( dstDims.x <= 0 || dstDims.y <= 0 || dstDims.x > srcDims.x || dstDims.y > srcDims.y )
+    {
+        return false;
+    }
+
+    const int64_t T = reader.tileSize();
+    const glm::i64vec2 tileCounts = reader.levelTileCounts( level );
+
+    const AxisWeights colWeights( srcDims.x, dstDims.x );
+    const AxisWeights rowWeights( srcDims.y, dstDims.y );
+
+    const glm::dvec2 scale = glm::dvec2( srcDims ) / glm::dvec2( dstDims );
+    const float normalization = static_cast<float>( 1.0 / ( scale.x * scale.y ) );
+
+    // A strip of tiles covers at most this many output rows
+    const int64_t windowRows = static_cast<int64_t>( std::ceil( static_cast<double>( T ) / scale.y ) ) + 2;
+
+    // Bands span at least two output rows, so that no output row is shared by more than two bands
+    const int64_t numStripsPerBand = std::max( sk_numStripsPerBand, static_cast<int64_t>(
+                                                   std::ceil( 2.0 * scale.y / static_cast<double>( T ) ) ) );
+
+    std::vector<Band> bands;
+
+    for ( int64_t strip = 0; strip < tileCounts.y; strip += numStripsPerBand )
+    {
+        Band band;
+        band.m_firstStrip = strip;
+        band.m_endStrip = std::min( strip + numStripsPerBand, tileCounts.y );
+
+        const size_t srcBegin = static_cast<size_t>( band.m_firstStrip * T );
+        const size_t srcLast = static_cast<size_t>( std::min( band.m_endStrip * T, srcDims.y ) - 1 );
+
+        band.m_firstRow = rowWeights.m_index[srcBegin];
+        band.m_endRow = rowWeights.m_index[srcLast] + 1;
+
+        if ( rowWeights.m_weight[srcLast] < 1.0f )
+        {
+            band.m_endRow = std::min( band.m_endRow + 1, dstDims.y );
+        }
+
+        bands.push_back( band );
+    }
+
+    // Seam i is shared by bands i - 1 and i
+    std::vector<SeamRow> seams( bands.size() );
+
+    auto isSeamShared = [&bands] ( size_t i )
+    {
+        return ( 0 < i && i < bands.size() && bands[i - 1].m_endRow - 1 == bands[i].m_firstRow );
+    };
+
+    std::atomic<bool> success( true );
+
+    auto reduceBand = [&] ( size_t b, openslide_t* bandHandle )
+    {
+        const Band& band = bands[b];
+
+        BandReducer reducer( colWeights, rowWeights, dstDims, dst, normalization,
+                             band.m_firstRow, band.m_endRow, windowRows,
+                             isSeamShared( b ) ? &seams[b] : nullptr,
+                             isSeamShared( b + 1 ) ? &seams[b + 1] : nullptr );
+
+        // Tiles are read once, so they would only evict the cached tiles being viewed
+        static constexpr bool sk_cacheTile = false;
+
+        for ( int64_t ty = band.m_firstStrip; ty < band.m_endStrip && success; ++ty )
+        {
+            const int64_t stripBegin = ty * T;
+            const int64_t stripEnd = std::min( ( ty + 1 ) * T, srcDims.y );
+
+            // Rows above the first row covered by this strip are complete
+            reducer.flushTo( rowWeights.m_index[static_cast<size_t>( stripBegin )] );
+
+            for ( int64_t tx = 0; tx < tileCounts.x; ++tx )
+            {
+                const auto tile = reader.readTile( level, glm::i64vec2{ tx, ty }, bandHandle, sk_cacheTile );
+
+                if ( ! tile || ! tile->m_data )
+                {
+                    success = false;
+                    return;
+                }
+
+                for ( int64_t y = stripBegin; y < stripEnd; ++y )
+                {
+                    reducer.accumulate( y, tx * T, tile->m_data.get() + ( y - stripBegin ) * tile->m_dims.x,
+                                        tile->m_dims.x );
+                }
+            }
+        }
+
+        reducer.flushTo( band.m_endRow );
+    };
+
+    if ( runner )
+    {
+        runner( bands.size(), reduceBand );
+    }
+    else
+    {
+        imageio::parallel::forEachIndex( bands.size(), [&] ( size_t, size_t b ) { reduceBand( b, handle ); } );
+    }
+
+    return success;
+}
+
+} // namespace slideio
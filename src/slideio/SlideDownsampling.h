@@ -0,0 +1,59 @@
+#ifndef SLIDE_DOWNSAMPLING_H
+#define SLIDE_DOWNSAMPLING_H
+
+#include <glm/vec2.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+
+typedef struct _openslide openslide_t;
+
+
+namespace slideio
+{
+
+class SlideTileReader;
+
+/**
+ * @brief Function that calls a function for each index in [0, count), possibly concurrently
+ * on several threads, and returns once all calls are done. Each call is given an OpenSlide
+ * handle to the slide file that is owned by its thread, or null to use the tile reader's handle.
+ */
+using ParallelRunner = std::function< void (
+    size_t count, const std::function< void ( size_t index, openslide_t* handle ) >& func ) >;
+
+
+/**
+ * @brief Create a downsampled level of a slide by area-averaging a file level. Each output
+ * pixel is the mean of the file level pixels that it covers, weighted by their overlap with it
+ * (like OpenCV's INTER_AREA resizing).
+ *
+ * The file level is streamed one tile at a time, so it is never held in memory in full:
+ * besides the output, memory use is a few rows of the output per thread. Tiles are decoded
+ * exactly once and bypass the tile cache. The file level is split into bands of tile strips
+ * that are reduced concurrently. Output rows that straddle two bands are merged from the
+ * partial sums of both.
+ *
+ * @param reader Tile reader of the slide
+ * @param level File level to downsample
+ * @param dstDims Dimensions of the output. Must not exceed the file level dimensions.
+ * @param dst Output buffer of pre-multiplied ARGB pixels of size dstDims.x * dstDims.y
+ * @param handle Optional OpenSlide handle with which to decode tiles (see SlideTileReader)
+ * @param runner Optional function that runs the bands, e.g. on the workers of a
+ * SlideDecodeService. If null, the bands run on the shared thread pool using \c handle.
+ *
+ * @return True iff all tiles of the file level were read and the output was written
+ */
+bool downsampleLevel( SlideTileReader& reader,
+                      int level,
+                      const glm::i64vec2& dstDims,
+                      uint32_t* dst,
+                      openslide_t* handle = nullptr,
+                      const ParallelRunner& runner = nullptr );
+
+} // namespace slideio
+
+#endif // SLIDE_DOWNSAMPLING_H
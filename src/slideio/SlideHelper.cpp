@@ -1,7 +1,10 @@
 #include "slideio/SlideHelper.h"
+#include "slideio/SlideTileReader.h"
 #include "common/AABB.h"
 #include "common/HZeeException.hpp"
 
+#include <glm/glm.hpp>
+
 
 namespace slideio
 {
@@ -18,6 +21,12 @@ glm::mat4 stack_O_slide_rigid( const SlideCpuRecord& record )
 }
 
 
+glm::mat4 slide_O_world( const SlideCpuRecord& record, const glm::mat4& world_O_slideStack )
+{
+    return glm::inverse( world_O_slideStack * stack_O_slide( record ) );
+}
+
+
 SlideTransformation translateXyInStack( const SlideCpuRecord& record, const glm::vec2& stackVec )
 {
     const glm::vec3 dims = physicalSlideDims( record );
@@ -216,4 +225,30 @@ float slideStackPositiveExtent( weak_record_range_t<SlideRecord> slideRecords )
     return maxZ;
 }
 
+
+std::optional< std::pair< int, std::vector< glm::i64vec2 > > > tilesInSlideRegion(
+        const SlideCpuRecord& record,
+        const glm::vec2& slideRegionMin,
+        const glm::vec2& slideRegionMax,
+        double downsample )
+{
+    const auto reader = record.tileReader();
+
+    if ( ! reader || ! reader->isValid() )
+    {
+        return std::nullopt;
+    }
+
+    const int level = reader->bestLevelForDownsample( downsample );
+    const glm::dvec2 levelDims( reader->levelDims( level ) );
+
+    const glm::dvec2 lo = glm::clamp( glm::dvec2( glm::min( slideRegionMin, slideRegionMax ) ), 0.0, 1.0 );
+    const glm::dvec2 hi = glm::clamp( glm::dvec2( glm::max( slideRegionMin, slideRegionMax ) ), 0.0, 1.0 );
+
+    const glm::i64vec2 regionOrigin( glm::floor( lo * levelDims ) );
+    const glm::i64vec2 regionSize = glm::i64vec2( glm::ceil( hi * levelDims ) ) - regionOrigin;
+
+    return std::make_pair( level, reader->tilesInRegion( level, regionOrigin, regionSize ) );
+}
+
 } // slideio
@@ -5,8 +5,10 @@
 #include "common/UID.h"
 #include "logic/records/SlideRecord.h"
 
+#include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
 #include <glm/mat4x4.hpp>
+#include <glm/gtc/type_precision.hpp>
 
 #include <boost/range/any_range.hpp>
 
@@ -14,6 +16,7 @@
 #include <memory>
 #include <optional>
 #include <utility>
+#include <vector>
 
 
 template< class Record >
@@ -42,6 +45,14 @@ glm::mat4 stack_O_slide( const SlideCpuRecord& );
 glm::mat4 stack_O_slide_rigid( const SlideCpuRecord& );
 
 
+/**
+ * @brief Compute and return the transformation from World space to local Slide space
+ * (i.e. normalized coordinates [0,1]^3).
+ * @param world_O_slideStack Transformation from Slide Stack to World space
+ */
+glm::mat4 slide_O_world( const SlideCpuRecord&, const glm::mat4& world_O_slideStack );
+
+
 /**
  * @brief Compute and return the transformation of a slide following a translation in Stack space
  * @param stackVec Stack-space translation vector applied to the slide
@@ -108,6 +119,24 @@ float slideStackHeight( weak_record_range_t<SlideRecord> );
  */
 float slideStackPositiveExtent( weak_record_range_t<SlideRecord> );
 
+
+/**
+ * @brief Get the file level and the tiles of that level that cover a region of a slide
+ * being viewed at a given resolution.
+ *
+ * @param[in] slideRegionMin Minimum corner of the region in normalized Slide space [0,1]^2
+ * @param[in] slideRegionMax Maximum corner of the region in normalized Slide space [0,1]^2
+ * @param[in] downsample Viewed downsample factor relative to the highest resolution level
+ *
+ * @return Pair of the file level index and the (column, row) indices of its tiles that
+ * cover the region. If the slide has no tile reader, then std::nullopt is returned.
+ */
+std::optional< std::pair< int, std::vector< glm::i64vec2 > > > tilesInSlideRegion(
+        const SlideCpuRecord&,
+        const glm::vec2& slideRegionMin,
+        const glm::vec2& slideRegionMax,
+        double downsample );
+
 } // namespace slideio
 
 #endif // SLIDE_HELPER_H
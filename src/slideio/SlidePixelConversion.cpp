@@ -0,0 +1,289 @@
+#include "slideio/SlidePixelConversion.h"
+
+#if defined(__AVX2__) || defined(__SSE4_1__)
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace
+{
+
+using slideio::SlidePixelFormat;
+
+
+/// Integer luminance weights (Rec. 601) that sum to 256
+static constexpr uint32_t sk_redWeight = 77;
+static constexpr uint32_t sk_greenWeight = 150;
+static constexpr uint32_t sk_blueWeight = 29;
+
+
+/// Un-premultiply a color channel by its alpha
+inline uint32_t unpremultiplyChannel( uint32_t c, uint32_t a )
+{
+    if ( 0 == a )
+    {
+        return 0;
+    }
+
+    return std::min( ( 255 * c + a / 2 ) / a, uint32_t( 255 ) );
+}
+
+
+void convertScalar(
+        const uint32_t* src, size_t numPixels, uint8_t* dst,
+        const SlidePixelFormat& format, bool unpremultiply )
+{
+    for ( size_t i = 0; i < numPixels; ++i )
+    {
+        const uint32_t p = src[i];
+        const uint32_t a = ( p >> 24 );
+
+        uint32_t r = ( p >> 16 ) & 0xff;
+        uint32_t g = ( p >> 8 ) & 0xff;
+        uint32_t b = p & 0xff;
+
+        if ( unpremultiply )
+        {
+            r = unpremultiplyChannel( r, a );
+            g = unpremultiplyChannel( g, a );
+            b = unpremultiplyChannel( b, a );
+        }
+
+        switch ( format )
+        {
+        case SlidePixelFormat::RGBA:
+        {
+            dst[4*i + 0] = static_cast<uint8_t>( r );
+            dst[4*i + 1] = static_cast<uint8_t>( g );
+            dst[4*i + 2] = static_cast<uint8_t>( b );
+            dst[4*i + 3] = static_cast<uint8_t>( a );
+            break;
+        }
+        case SlidePixelFormat::BGRA:
+        {
+            dst[4*i + 0] = static_cast<uint8_t>( b );
+            dst[4*i + 1] = static_cast<uint8_t>( g );
+            dst[4*i + 2] = static_cast<uint8_t>( r );
+            dst[4*i + 3] = static_cast<uint8_t>( a );
+            break;
+        }
+        case SlidePixelFormat::Gray:
+        {
+            dst[i] = static_cast<uint8_t>(
+                        ( sk_redWeight * r + sk_greenWeight * g + sk_blueWeight * b + 128 ) >> 8 );
+            break;
+        }
+        }
+    }
+}
+
+
+/*
+ * The vectorized paths compute ( 255 * c + a / 2 ) / a by dividing in single precision.
+ * Numerator and denominator are exact integers below 2^24, and the integer quotient is never
+ * closer than 1/255 to the next integer, so truncation of the correctly rounded floating point
+ * quotient equals the integer quotient of the scalar path. Division by zero alpha gives
+ * NaN or infinity, which is masked to zero.
+ */
+
+#if defined(__AVX2__)
+
+/// Convert as many pixels as fill whole AVX2 registers
+/// @return Number of pixels converted
+size_t convertAvx2(
+        const uint32_t* src, size_t numPixels, uint8_t* dst,
+        const SlidePixelFormat& format, bool unpremultiply )
+{
+    const __m256i k_zero = _mm256_setzero_si256();
+    const __m256i k_byteMask = _mm256_set1_epi32( 0xff );
+    const __m256i k_255 = _mm256_set1_epi32( 255 );
+
+    size_t i = 0;
+
+    for ( ; i + 8 <= numPixels; i += 8 )
+    {
+        const __m256i p = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( src + i ) );
+
+        const __m256i a = _mm256_srli_epi32( p, 24 );
+        __m256i r = _mm256_and_si256( _mm256_srli_epi32( p, 16 ), k_byteMask );
+        __m256i g = _mm256_and_si256( _mm256_srli_epi32( p, 8 ), k_byteMask );
+        __m256i b = _mm256_and_si256( p, k_byteMask );
+
+        if ( unpremultiply )
+        {
+            const __m256 af = _mm256_cvtepi32_ps( a );
+            const __m256i halfA = _mm256_srli_epi32( a, 1 );
+            const __m256i transparent = _mm256_cmpeq_epi32( a, k_zero );
+
+            auto unpremultiplyChannels = [&] ( const __m256i& c )
+            {
+                const __m256i num = _mm256_add_epi32( _mm256_mullo_epi32( c, k_255 ), halfA );
+                const __m256i q = _mm256_cvttps_epi32( _mm256_div_ps( _mm256_cvtepi32_ps( num ), af ) );
+                return _mm256_andnot_si256( transparent, _mm256_min_epi32( q, k_255 ) );
+            };
+
+            r = unpremultiplyChannels( r );
+            g = unpremultiplyChannels( g );
+            b = unpremultiplyChannels( b );
+        }
+
+        switch ( format )
+        {
+        case SlidePixelFormat::RGBA:
+        case SlidePixelFormat::BGRA:
+        {
+            const __m256i first = ( SlidePixelFormat::RGBA == format ) ? r : b;
+            const __m256i third = ( SlidePixelFormat::RGBA == format ) ? b : r;
+
+            const __m256i out = _mm256_or_si256(
+                        _mm256_or_si256( first, _mm256_slli_epi32( g, 8 ) ),
+                        _mm256_or_si256( _mm256_slli_epi32( third, 16 ), _mm256_slli_epi32( a, 24 ) ) );
+
+            _mm256_storeu_si256( reinterpret_cast<__m256i*>( dst + 4*i ), out );
+            break;
+        }
+        case SlidePixelFormat::Gray:
+        {
+            const __m256i y = _mm256_srli_epi32(
+                        _mm256_add_epi32(
+                            _mm256_add_epi32( _mm256_mullo_epi32( r, _mm256_set1_epi32( sk_redWeight ) ),
+                                              _mm256_mullo_epi32( g, _mm256_set1_epi32( sk_greenWeight ) ) ),
+                            _mm256_add_epi32( _mm256_mullo_epi32( b, _mm256_set1_epi32( sk_blueWeight ) ),
+                                              _mm256_set1_epi32( 128 ) ) ), 8 );
+
+            // Packing operates within 128-bit lanes, so pack the two halves separately
+            const __m128i y16 = _mm_packus_epi32( _mm256_castsi256_si128( y ),
+                                                  _mm256_extracti128_si256( y, 1 ) );
+
+            _mm_storel_epi64( reinterpret_cast<__m128i*>( dst + i ), _mm_packus_epi16( y16, y16 ) );
+            break;
+        }
+        }
+    }
+
+    return i;
+}
+
+#elif defined(__SSE4_1__)
+
+/// Convert as many pixels as fill whole SSE registers
+/// @return Number of pixels converted
+size_t convertSse41(
+        const uint32_t* src, size_t numPixels, uint8_t* dst,
+        const SlidePixelFormat& format, bool unpremultiply )
+{
+    const __m128i k_zero = _mm_setzero_si128();
+    const __m128i k_byteMask = _mm_set1_epi32( 0xff );
+    const __m128i k_255 = _mm_set1_epi32( 255 );
+
+    size_t i = 0;
+
+    for ( ; i + 4 <= numPixels; i += 4 )
+    {
+        const __m128i p = _mm_loadu_si128( reinterpret_cast<const __m128i*>( src + i ) );
+
+        const __m128i a = _mm_srli_epi32( p, 24 );
+        __m128i r = _mm_and_si128( _mm_srli_epi32( p, 16 ), k_byteMask );
+        __m128i g = _mm_and_si128( _mm_srli_epi32( p, 8 ), k_byteMask );
+        __m128i b = _mm_and_si128( p, k_byteMask );
+
+        if ( unpremultiply )
+        {
+            const __m128 af = _mm_cvtepi32_ps( a );
+            const __m128i halfA = _mm_srli_epi32( a, 1 );
+            const __m128i transparent = _mm_cmpeq_epi32( a, k_zero );
+
+            auto unpremultiplyChannels = [&] ( const __m128i& c )
+            {
+                const __m128i num = _mm_add_epi32( _mm_mullo_epi32( c, k_255 ), halfA );
+                const __m128i q = _mm_cvttps_epi32( _mm_div_ps( _mm_cvtepi32_ps( num ), af ) );
+                return _mm_andnot_si128( transparent, _mm_min_epi32( q, k_255 ) );
+            };
+
+            r = unpremultiplyChannels( r );
+            g = unpremultiplyChannels( g );
+            b = unpremultiplyChannels( b );
+        }
+
+        switch ( format )
+        {
+        case SlidePixelFormat::RGBA:
+        case SlidePixelFormat::BGRA:
+        {
+            const __m128i first = ( SlidePixelFormat::RGBA == format ) ? r : b;
+            const __m128i third = ( SlidePixelFormat::RGBA == format ) ? b : r;
+
+            const __m128i out = _mm_or_si128(
+                        _mm_or_si128( first, _mm_slli_epi32( g, 8 ) ),
+                        _mm_or_si128( _mm_slli_epi32( third, 16 ), _mm_slli_epi32( a, 24 ) ) );
+
+            _mm_storeu_si128( reinterpret_cast<__m128i*>( dst + 4*i ), out );
+            break;
+        }
+        case SlidePixelFormat::Gray:
+        {
+            const __m128i y = _mm_srli_epi32(
+                        _mm_add_epi32(
+                            _mm_add_epi32( _mm_mullo_epi32( r, _mm_set1_epi32( sk_redWeight ) ),
+                                           _mm_mullo_epi32( g, _mm_set1_epi32( sk_greenWeight ) ) ),
+                            _mm_add_epi32( _mm_mullo_epi32( b, _mm_set1_epi32( sk_blueWeight ) ),
+                                           _mm_set1_epi32( 128 ) ) ), 8 );
+
+            const __m128i y16 = _mm_packus_epi32( y, y );
+            const int32_t y8 = _mm_cvtsi128_si32( _mm_packus_epi16( y16, y16 ) );
+
+            std::memcpy( dst + i, &y8, sizeof( int32_t ) );
+            break;
+        }
+        }
+    }
+
+    return i;
+}
+
+#endif
+
+} // anonymous
+
+
+namespace slideio
+{
+
+size_t bytesPerPixel( const SlidePixelFormat& format )
+{
+    switch ( format )
+    {
+    case SlidePixelFormat::RGBA:
+    case SlidePixelFormat::BGRA: return 4;
+    case SlidePixelFormat::Gray: return 1;
+    }
+
+    return 0;
+}
+
+
+void convertPremultipliedArgb(
+        const uint32_t* src, size_t numPixels, uint8_t* dst,
+        const SlidePixelFormat& format, bool unpremultiply )
+{
+    if ( ! src || ! dst )
+    {
+        return;
+    }
+
+    size_t numConverted = 0;
+
+#if defined(__AVX2__)
+    numConverted = convertAvx2( src, numPixels, dst, format, unpremultiply );
+#elif defined(__SSE4_1__)
+    numConverted = convertSse41( src, numPixels, dst, format, unpremultiply );
+#endif
+
+    convertScalar( src + numConverted, numPixels - numConverted,
+                   dst + numConverted * bytesPerPixel( format ), format, unpremultiply );
+}
+
+} // namespace slideio
@@ -0,0 +1,49 @@
+#ifndef SLIDE_PIXEL_CONVERSION_H
+#define SLIDE_PIXEL_CONVERSION_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace slideio
+{
+
+/// Pixel formats to which premultiplied ARGB slide pixels are converted.
+/// The formats name the order of the channel bytes in memory.
+enum class SlidePixelFormat
+{
+    RGBA, //!< Four bytes per pixel: red, green, blue, alpha
+    BGRA, //!< Four bytes per pixel: blue, green, red, alpha (OpenCV's channel order)
+    Gray  //!< One byte per pixel: luminance of the red, green, and blue channels
+};
+
+
+/// Get the number of bytes per pixel of a format
+size_t bytesPerPixel( const SlidePixelFormat& format );
+
+
+/**
+ * @brief Convert slide pixels from the premultiplied ARGB format returned by OpenSlide
+ * (i.e. 32-bit values 0xAARRGGBB) to another format.
+ *
+ * Un-premultiplied (straight alpha) color channels are computed in integer arithmetic as
+ * ( 255 * c + a / 2 ) / a, clamped to 255, with fully transparent pixels set to zero.
+ * Luminance is computed with the integer Rec. 601 weights ( 77 R + 150 G + 29 B ) / 256.
+ *
+ * The conversion is vectorized with AVX2 or SSE4.1 if the build targets those instruction
+ * sets, with a scalar loop for the remaining pixels. All paths give identical results.
+ *
+ * @param[in] src Premultiplied ARGB pixels
+ * @param[in] numPixels Number of pixels to convert
+ * @param[out] dst Converted pixels. Must hold numPixels * bytesPerPixel( format ) bytes.
+ * @param[in] format Format of converted pixels
+ * @param[in] unpremultiply If true, color channels are divided by alpha;
+ * if false, channels are only reordered
+ */
+void convertPremultipliedArgb(
+        const uint32_t* src, size_t numPixels, uint8_t* dst,
+        const SlidePixelFormat& format, bool unpremultiply = true );
+
+} // namespace slideio
+
+#endif // SLIDE_PIXEL_CONVERSION_H
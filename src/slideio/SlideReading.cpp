@@ -1,6 +1,10 @@
 #include "slideio/SlideReading.h"
 #include "slideio/SlideCpuRecord.h"
 #include "slideio/SlideAssociatedImages.h"
+#include "slideio/SlideDiskCache.h"
+#include "slideio/SlideDownsampling.h"
+#include "slideio/SlideTileReader.h"
+#include "slideio/SlideTissueMask.h"
 
 #include "rendering/utility/gl/GLTexture.h"
 
@@ -50,9 +54,14 @@ extern "C"
 namespace
 {
 
-static const glm::i64vec2 sk_maxSlideDimsToLoad( 4096, 4096 );
 static const glm::i64vec2 sk_maxSlideDimsForGPU( 2048, 2048 );
 
+/// Maximum dimensions of the placeholder level that is shown until a slide is decoded
+static const glm::i64vec2 sk_maxPlaceholderDims( 64, 64 );
+
+/// Dimensions of thumbnails generated for slides without them
+static const glm::i64vec2 sk_thumbnailDims( 64, 64 );
+
 
 /**
  * @brief Check for an error in the OpenSlide reader. Print its text if present.
@@ -159,31 +168,123 @@ void downsample( uint32_t* srcData, const glm::i32vec2& srcSize,
 }
 
 
-slideio::SlideAssociatedImages readSlideAssociatedImages( openslide_t* reader )
+/**
+ * @brief Select the file level from which the level uploaded to the GPU is created.
+ * This is the smallest file level that is at least as large as the maximum GPU slide
+ * dimensions, so that the GPU level loses no detail. If no file level is that large,
+ * then the largest level (which fits entirely on the GPU) is selected.
+ *
+ * @param levels File levels, arranged from largest to smallest
+ * @return Index of the selected level
+ */
+size_t selectGpuSourceLevel( const std::vector< slideio::SlideLevel >& levels )
+{
+    size_t selected = 0;
+
+    for ( size_t i = 0; i < levels.size(); ++i )
+    {
+        if ( glm::any( glm::greaterThanEqual( levels[i].m_dims, sk_maxSlideDimsForGPU ) ) )
+        {
+            selected = i;
+        }
+    }
+
+    return selected;
+}
+
+
+/// Pack a color into an opaque (and hence trivially pre-multiplied) ARGB pixel
+uint32_t packOpaqueArgb( const glm::vec3& color )
+{
+    const glm::u32vec3 c( glm::clamp( 255.0f * color + 0.5f, 0.0f, 255.0f ) );
+    return ( 0xFF000000u | ( c.x << 16 ) | ( c.y << 8 ) | c.z );
+}
+
+
+/// Create the tissue mask of a slide from its decoded GPU level
+void createDecodedTissueMask( slideio::DecodedSlideData& decoded,
+                              const slideio::SlideTileReader& reader,
+                              const glm::vec3& backgroundColor )
+{
+    decoded.m_tissueMask = slideio::createTissueMask(
+                decoded.m_gpuLevel, reader.levelDims( 0 ), backgroundColor );
+
+    if ( decoded.m_tissueMask )
+    {
+        std::cout << "\ttissue fraction = " << decoded.m_tissueMask->tissueFraction() << std::endl;
+    }
+}
+
+
+/**
+ * @brief Read the dimensions of the associated images of a slide. Pixels are not read here:
+ * each image is given a loader that reads its pixels from file when they are first requested.
+ */
+slideio::SlideAssociatedImages readSlideAssociatedImages( openslide_t* reader, const std::string& fileName )
 {
     static const char* sk_thumbName = "thumbnail";
     static const char* sk_macroName = "macro";
     static const char* sk_labelName = "label";
 
-    slideio::AssociatedImage thumbImage = readAssociatedImage( reader, sk_thumbName );
-    slideio::AssociatedImage macroImage = readAssociatedImage( reader, sk_macroName );
-    slideio::AssociatedImage labelImage = readAssociatedImage( reader, sk_labelName );
+    auto imageDims = [reader] ( const char* name )
+    {
+        glm::i64vec2 dims;
+
+        // OpenSlide returns -1 dimensions if the image does not exist or an error occurred
+        openslide_get_associated_image_dimensions( reader, name, &(dims.x), &(dims.y) );
+        return dims;
+    };
+
+    auto imageLoader = [&fileName] ( const char* name ) -> slideio::SlideAssociatedImages::ImageLoader
+    {
+        return [fileName, imageName = std::string( name )] ()
+                -> std::shared_ptr< std::vector<uint32_t> >
+        {
+            openslide_t* fileReader = openslide_open( fileName.c_str() );
+
+            if ( ! fileReader )
+            {
+                std::cerr << "Unable to open slide " << fileName << " to read its "
+                          << imageName << " image" << std::endl;
+                return nullptr;
+            }
+
+            if ( checkOpenSlideError( fileReader ) )
+            {
+                return nullptr;
+            }
+
+            const slideio::AssociatedImage image = readAssociatedImage( fileReader, imageName.c_str() );
+
+            if ( checkOpenSlideError( fileReader ) )
+            {
+                return nullptr;
+            }
+
+            openslide_close( fileReader );
+            return image.first;
+        };
+    };
 
     slideio::SlideAssociatedImages images;
 
-    if ( thumbImage.first )
+    const glm::i64vec2 thumbDims = imageDims( sk_thumbName );
+    const glm::i64vec2 macroDims = imageDims( sk_macroName );
+    const glm::i64vec2 labelDims = imageDims( sk_labelName );
+
+    if ( checkValidDims( thumbDims ) )
     {
-        images.setThumbImage( thumbImage.first, thumbImage.second );
+        images.setThumbImage( thumbDims, imageLoader( sk_thumbName ) );
     }
 
-    if ( macroImage.first )
+    if ( checkValidDims( macroDims ) )
     {
-        images.setMacroImage( macroImage.first, macroImage.second );
+        images.setMacroImage( macroDims, imageLoader( sk_macroName ) );
     }
 
-    if ( labelImage.first )
+    if ( checkValidDims( labelDims ) )
     {
-        images.setLabelImage( labelImage.first, labelImage.second );
+        images.setLabelImage( labelDims, imageLoader( sk_labelName ) );
     }
 
     return images;
@@ -192,14 +293,16 @@ slideio::SlideAssociatedImages readSlideAssociatedImages( openslide_t* reader )
 } // anonymous
 
 
+
+
 namespace slideio
 {
 
-/// @todo Break this function into pieces
-std::unique_ptr<SlideCpuRecord> readSlide(
+std::unique_ptr<SlideCpuRecord> openSlide(
         const std::string& fileName,
         const glm::vec2& pixelSize,
-        float thickness )
+        float thickness,
+        std::shared_ptr<SlideTileCache> tileCache )
 {
     openslide_t* reader = openslide_open( fileName.c_str() );
 
@@ -221,20 +324,22 @@ std::unique_ptr<SlideCpuRecord> readSlide(
     if ( ! vendor )
     {
         std::cerr << "Vendor for file format not recognized." << std::endl;
+        openslide_close( reader );
         return nullptr;
     }
 
     const int32_t k_numFileLevels = openslide_get_level_count( reader );
 
-    if ( k_numFileLevels < 0 )
+    if ( k_numFileLevels <= 0 )
     {
         std::cerr << "An error occurred while reading image levels in slide." << std::endl;
+        openslide_close( reader );
         return nullptr;
     }
 
 
     /// @todo Log
-    std::cout << "Loading slide " << fileName << std::endl;
+    std::cout << "Opening slide " << fileName << std::endl;
     std::cout << "\tLevel count = " << k_numFileLevels << std::endl;
 
 
@@ -244,7 +349,7 @@ std::unique_ptr<SlideCpuRecord> readSlide(
     header.setPixelSize( pixelSize );
     header.setThickness( thickness );
 
-    header.setAssociatedImages( readSlideAssociatedImages( reader ) );
+    header.setAssociatedImages( readSlideAssociatedImages( reader, fileName ) );
     header.setBackgroundColor( readSlideBackgroundColor( reader ) );
 
 
@@ -271,15 +376,18 @@ std::unique_ptr<SlideCpuRecord> readSlide(
             std::make_unique<SlideCpuRecord>( std::move( header ), std::move( props ) );
 
 
+    // Read the header information of all file levels. No pixel data is read here:
+    // tiles of the file levels are read on demand by the tile reader.
+    std::vector< SlideLevel > fileLevels;
+
     for ( int i = 0; i < k_numFileLevels; ++i )
     {
         SlideLevel level;
         level.m_level = i;
+        level.m_data = nullptr;
 
         openslide_get_level_dimensions( reader, i, &(level.m_dims.x), &(level.m_dims.y) );
 
-        // Not used: double downsampleFactor = openslide_get_level_downsample( reader, i );
-
         if ( checkOpenSlideError( reader ) )
         {
             return nullptr;
@@ -288,6 +396,7 @@ std::unique_ptr<SlideCpuRecord> readSlide(
         if ( ! checkValidDims( level.m_dims ) )
         {
             std::cerr << "Dimensions of slide " << i << " are out of valid range." << std::endl;
+            openslide_close( reader );
             return nullptr;
         }
 
@@ -296,17 +405,12 @@ std::unique_ptr<SlideCpuRecord> readSlide(
             // First level is defined to have 1.0 downsample factors in x and y
             level.m_downsampleFactors = glm::dvec2{ 1.0, 1.0 };
         }
-        else if ( cpuRecord->numFileLevels() > 0 )
+        else
         {
-            const glm::i64vec2 baseDims = cpuRecord->fileLevel( 0 ).m_dims;
+            const glm::i64vec2 baseDims = fileLevels.front().m_dims;
             level.m_downsampleFactors.x = baseDims.x / static_cast<double>( level.m_dims.x );
             level.m_downsampleFactors.y = baseDims.y / static_cast<double>( level.m_dims.y );
         }
-        else
-        {
-            // error
-            return nullptr;
-        }
 
         std::cout << "\tdims[" << i << "] = "
                   << glm::to_string( level.m_dims ) << std::endl;
@@ -314,110 +418,219 @@ std::unique_ptr<SlideCpuRecord> readSlide(
         std::cout << "\tdownsampleFactor[" << i << "] = "
                   << glm::to_string( level.m_downsampleFactors ) << std::endl;
 
-        ///////////////////// Only load data for last level:
-        ///////////////////////if ( ( k_numFileLevels - 1 ) == i )
-        // temporarily, load only the first level:
-        if ( 0 == i )
-        {
-            if ( glm::any( glm::greaterThan( level.m_dims, sk_maxSlideDimsToLoad ) ) )
-            {
-                std::cerr << "Slide level " << i << " dimensions "
-                          << glm::to_string( level.m_dims )
-                          << " exceed maximum size "
-                          << glm::to_string( sk_maxSlideDimsToLoad ) << std::endl;
+        fileLevels.push_back( std::move( level ) );
+    }
 
-                return nullptr;
-            }
+    openslide_close( reader );
 
-            level.m_data = std::make_unique< uint32_t[] >(
-                        static_cast<size_t>( level.m_dims.x * level.m_dims.y ) );
 
-            // Copy pre-multiplied ARGB data from a whole slide image
-            openslide_read_region( reader, level.m_data.get(), 0, 0,
-                                   i, level.m_dims.x, level.m_dims.y );
+    auto tileReader = std::make_shared<SlideTileReader>( fileName, std::move( tileCache ) );
 
-            if ( ! level.m_data )
-            {
-                std::cerr << "Unable to read data for slide level " << i << std::endl;
-                return nullptr;
-            }
-        }
-        else
+    if ( ! tileReader->isValid() || tileReader->numLevels() != k_numFileLevels )
+    {
+        std::cerr << "Unable to open slide " << fileName << " for tiled reading." << std::endl;
+        return nullptr;
+    }
+
+
+    // Create the placeholder GPU level with the aspect ratio of the slide,
+    // filled with the slide background color
+    const uint32_t k_background = packOpaqueArgb( cpuRecord->header().backgroundColor() );
+
+    const glm::dvec2 k_baseDims = glm::dvec2( fileLevels.front().m_dims );
+    const double k_placeholderScale = std::min( sk_maxPlaceholderDims.x / k_baseDims.x,
+                                                sk_maxPlaceholderDims.y / k_baseDims.y );
+
+    SlideLevel placeholder;
+    placeholder.m_level = k_numFileLevels;
+    placeholder.m_dims = glm::clamp( glm::i64vec2( glm::round( k_placeholderScale * k_baseDims ) ),
+                                     glm::i64vec2{ 1, 1 }, sk_maxPlaceholderDims );
+    placeholder.m_downsampleFactors = k_baseDims / glm::dvec2( placeholder.m_dims );
+
+    const size_t k_numPlaceholderPixels = static_cast<size_t>( placeholder.m_dims.x * placeholder.m_dims.y );
+    placeholder.m_data = std::make_unique< uint32_t[] >( k_numPlaceholderPixels );
+    std::fill_n( placeholder.m_data.get(), k_numPlaceholderPixels, k_background );
+
+    for ( auto& level : fileLevels )
+    {
+        cpuRecord->addFileLevel( std::move( level ) );
+    }
+
+    cpuRecord->addCreatedLevel( std::move( placeholder ) );
+    cpuRecord->setTileReader( tileReader );
+
+
+    // Fill a placeholder thumbnail if none was provided in the slide
+    if ( ! checkValidDims( cpuRecord->header().associatedImages().thumbImageDims() ) )
+    {
+        auto data = std::make_shared< std::vector<uint32_t> >(
+                    static_cast<size_t>( sk_thumbnailDims.x * sk_thumbnailDims.y ), k_background );
+
+        static constexpr bool sk_generated = true;
+        cpuRecord->header().associatedImages().setThumbImage( data, sk_thumbnailDims, sk_generated );
+    }
+
+    return cpuRecord;
+}
+
+
+std::unique_ptr<DecodedSlideData> decodeSlide(
+        SlideTileReader& reader, bool createThumbnail, const glm::vec3& backgroundColor,
+        openslide_t* handle, const SlideDiskCache* diskCache, const ParallelRunner& runner )
+{
+    if ( ! reader.isValid() )
+    {
+        return nullptr;
+    }
+
+    if ( diskCache )
+    {
+        if ( auto cached = diskCache->load( reader.fileName(), createThumbnail ) )
         {
-            level.m_data = nullptr;
+            std::cout << "Loaded decoded slide " << reader.fileName() << " from cache" << std::endl;
+            createDecodedTissueMask( *cached, reader, backgroundColor );
+            return cached;
         }
+    }
 
-        cpuRecord->addFileLevel( std::move( level ) );
+    // Read the level that gets uploaded to the GPU from the best-fitting file level
+    std::vector< SlideLevel > fileLevels;
 
-        ///////////////////////// so that we only load the first level
-        break;
+    for ( int i = 0; i < reader.numLevels(); ++i )
+    {
+        SlideLevel level;
+        level.m_level = i;
+        level.m_dims = reader.levelDims( i );
+        fileLevels.push_back( std::move( level ) );
     }
 
+    const size_t gpuSourceIndex = selectGpuSourceLevel( fileLevels );
+    const SlideLevel& gpuSourceLevel = fileLevels[gpuSourceIndex];
 
-    //////////////////////const size_t lastFileLevelIndex = cpuRecord->numFileLevels() - 1;
-    //////////////////////// Changed so that we only check the first level
-    const size_t lastFileLevelIndex = 0;
-    const SlideLevel& k_lastFileLevel = cpuRecord->fileLevel( lastFileLevelIndex );
+    const glm::dvec2 k_baseDims = glm::dvec2( fileLevels.front().m_dims );
 
-    if ( glm::any( glm::greaterThan( k_lastFileLevel.m_dims, sk_maxSlideDimsForGPU ) ) )
+    auto decoded = std::make_unique<DecodedSlideData>();
+    SlideLevel& gpuLevel = decoded->m_gpuLevel;
+    gpuLevel.m_level = reader.numLevels();
+
+    if ( glm::any( glm::greaterThan( gpuSourceLevel.m_dims, sk_maxSlideDimsForGPU ) ) )
     {
-        const int64_t k_downsampleFactor = std::max(
-                    k_lastFileLevel.m_dims.x / sk_maxSlideDimsForGPU.x,
-                    k_lastFileLevel.m_dims.y / sk_maxSlideDimsForGPU.y );
+        // The source level is too large for the GPU, so downsample it. The source level is
+        // streamed tile by tile, so that it is never held in memory in full.
+        const double k_downsampleFactor = std::max(
+                    static_cast<double>( gpuSourceLevel.m_dims.x ) / sk_maxSlideDimsForGPU.x,
+                    static_cast<double>( gpuSourceLevel.m_dims.y ) / sk_maxSlideDimsForGPU.y );
 
-        SlideLevel newLevel;
-        newLevel.m_level = k_numFileLevels;
-        newLevel.m_dims = k_lastFileLevel.m_dims / k_downsampleFactor;
+        gpuLevel.m_dims = glm::max( glm::i64vec2{ 1, 1 }, glm::i64vec2(
+                    glm::ceil( glm::dvec2( gpuSourceLevel.m_dims ) / k_downsampleFactor ) ) );
 
-        const glm::dvec2 k_baseDims = glm::dvec2( cpuRecord->fileLevel( 0 ).m_dims );
-        newLevel.m_downsampleFactors.x = k_baseDims.x / newLevel.m_dims.x;
-        newLevel.m_downsampleFactors.y = k_baseDims.y / newLevel.m_dims.y;
+        gpuLevel.m_dims = glm::min( gpuLevel.m_dims, sk_maxSlideDimsForGPU );
 
-        newLevel.m_data = std::make_unique< uint32_t[] >(
-                    static_cast<size_t>( newLevel.m_dims.x * newLevel.m_dims.y ) );
+        gpuLevel.m_data = std::make_unique< uint32_t[] >(
+                    static_cast<size_t>( gpuLevel.m_dims.x * gpuLevel.m_dims.y ) );
 
-        static const glm::i64vec2 sk_maxDimsForOpenCV( std::numeric_limits<int32_t>::max() );
+        if ( ! downsampleLevel( reader, gpuSourceLevel.m_level, gpuLevel.m_dims,
+                                gpuLevel.m_data.get(), handle, runner ) )
+        {
+            std::cerr << "Unable to downsample data of slide level " << gpuSourceIndex << std::endl;
+            return nullptr;
+        }
+    }
+    else
+    {
+        // The source level fits on the GPU, so use its data as is
+        gpuLevel.m_dims = gpuSourceLevel.m_dims;
+        gpuLevel.m_data = std::make_unique< uint32_t[] >(
+                    static_cast<size_t>( gpuLevel.m_dims.x * gpuLevel.m_dims.y ) );
 
-        if ( glm::any( glm::greaterThan( k_lastFileLevel.m_dims, sk_maxDimsForOpenCV ) ) )
+        if ( ! reader.readRegion( gpuSourceLevel.m_level, glm::i64vec2{ 0, 0 },
+                                  gpuSourceLevel.m_dims, gpuLevel.m_data.get(), handle ) )
         {
-            std::cerr << "Slide too large to downsample" << std::endl;
+            std::cerr << "Unable to read data for slide level " << gpuSourceIndex << std::endl;
             return nullptr;
         }
+    }
+
+    gpuLevel.m_downsampleFactors = k_baseDims / glm::dvec2( gpuLevel.m_dims );
+
+    std::cout << "Decoded slide " << reader.fileName() << std::endl;
+
+    std::cout << "\tdims[" << gpuLevel.m_level << "] = "
+              << glm::to_string( gpuLevel.m_dims ) << std::endl;
+
+    std::cout << "\tdownsampleFactor[" << gpuLevel.m_level << "] = "
+              << glm::to_string( gpuLevel.m_downsampleFactors ) << std::endl;
 
-        downsample( k_lastFileLevel.m_data.get(),
-                    glm::i32vec2( k_lastFileLevel.m_dims ),
-                    newLevel.m_data.get(),
-                    glm::i32vec2( newLevel.m_dims ) );
 
-        std::cout << "\tdims[" << k_numFileLevels << "] = "
-                  << glm::to_string( newLevel.m_dims ) << std::endl;
+    if ( createThumbnail )
+    {
+        auto data = std::make_shared< std::vector<uint32_t> >(
+                    static_cast<size_t>( sk_thumbnailDims.x * sk_thumbnailDims.y ) );
 
-        std::cout << "\tdownsampleFactor[" << k_numFileLevels << "] = "
-                  << glm::to_string( newLevel.m_downsampleFactors ) << std::endl;
+        downsample( gpuLevel.m_data.get(),
+                    glm::i32vec2( gpuLevel.m_dims ),
+                    data->data(), glm::i32vec2( sk_thumbnailDims ) );
 
-        cpuRecord->addCreatedLevel( std::move( newLevel ) );
+        decoded->m_thumbImage = std::make_pair( data, sk_thumbnailDims );
     }
 
+    createDecodedTissueMask( *decoded, reader, backgroundColor );
 
-    // Create thumbnail image if none was created
-    auto thumbImage = cpuRecord->header().associatedImages().thumbImage();
-    auto thumbImageData = thumbImage.first.lock();
+    if ( diskCache )
+    {
+        diskCache->store( reader.fileName(), *decoded );
+    }
+
+    return decoded;
+}
 
-    if ( ! thumbImageData )
+
+void applyDecodedSlide( SlideCpuRecord& record, DecodedSlideData data )
+{
+    record.clearCreatedLevels();
+    record.addCreatedLevel( std::move( data.m_gpuLevel ) );
+
+    if ( data.m_thumbImage.first )
     {
-        const glm::i64vec2 dims( 64, 64 );
+        static constexpr bool sk_generated = true;
+        record.header().associatedImages().setThumbImage(
+                    data.m_thumbImage.first, data.m_thumbImage.second, sk_generated );
+    }
+
+    if ( auto reader = record.tileReader() )
+    {
+        reader->setTissueMask( data.m_tissueMask );
+    }
+
+    record.setTissueMask( std::move( data.m_tissueMask ) );
+}
 
-        auto data = std::make_shared< std::vector<uint32_t> >( static_cast<size_t>( dims.x * dims.y ) );
 
-        downsample( k_lastFileLevel.m_data.get(),
-                    glm::i32vec2( k_lastFileLevel.m_dims ),
-                    data->data(), dims );
+std::unique_ptr<SlideCpuRecord> readSlide(
+        const std::string& fileName,
+        const glm::vec2& pixelSize,
+        float thickness,
+        std::shared_ptr<SlideTileCache> tileCache,
+        const SlideDiskCache* diskCache )
+{
+    auto cpuRecord = openSlide( fileName, pixelSize, thickness, std::move( tileCache ) );
 
-        cpuRecord->header().associatedImages().setThumbImage( data, dims );
+    if ( ! cpuRecord || ! cpuRecord->tileReader() )
+    {
+        return nullptr;
     }
 
+    const bool createThumbnail = cpuRecord->header().associatedImages().isThumbImageGenerated();
 
-    openslide_close( reader );
+    auto decoded = decodeSlide( *cpuRecord->tileReader(), createThumbnail,
+                                cpuRecord->header().backgroundColor(), nullptr, diskCache );
+
+    if ( ! decoded )
+    {
+        return nullptr;
+    }
+
+    applyDecodedSlide( *cpuRecord, std::move( *decoded ) );
 
     return cpuRecord;
 }
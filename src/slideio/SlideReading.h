@@ -2,24 +2,114 @@
 #define SLIDE_READING_H
 
 #include "logic/records/SlideRecord.h"
+#include "slideio/SlideDownsampling.h"
+#include "slideio/SlideLevel.h"
 
 #include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
 
 #include <memory>
 #include <string>
 
 
+typedef struct _openslide openslide_t;
+
+
 namespace slideio
 {
 
 class SlideCpuRecord;
+class SlideDiskCache;
+class SlideTileCache;
+class SlideTileReader;
+class SlideTissueMask;
 
 using AssociatedImage = std::pair< std::shared_ptr< std::vector<uint32_t> >, glm::i64vec2 >;
 
+
+/**
+ * @brief Pixel data of a slide that is decoded after the slide is opened
+ */
+struct DecodedSlideData
+{
+    /// Level that is uploaded to the GPU, created from the best-fitting file level
+    SlideLevel m_gpuLevel;
+
+    /// Thumbnail generated from the GPU level. Null if the slide file provides a thumbnail.
+    AssociatedImage m_thumbImage;
+
+    /// Mask of the tissue, created from the GPU level
+    std::shared_ptr<const SlideTissueMask> m_tissueMask;
+};
+
+
+/**
+ * @brief Open a slide file without decoding any of its pixel data. Header information is read
+ * for all file levels and the slide's tile reader is created. The record holds a placeholder
+ * GPU level (and thumbnail, if the file has none) filled with the slide background color,
+ * until decoded data is applied to it.
+ *
+ * @param fileName Slide file name
+ * @param pixelSize Pixel size (x, y) in mm of the highest resolution level
+ * @param thickness Slide thickness in mm
+ * @param tileCache Cache of tiles shared among all slides; may be nullptr
+ *
+ * @return Placeholder slide record; nullptr on failure
+ */
+std::unique_ptr<SlideCpuRecord> openSlide(
+        const std::string& fileName,
+        const glm::vec2& pixelSize,
+        float thickness,
+        std::shared_ptr<SlideTileCache> tileCache );
+
+
+/**
+ * @brief Decode the pixel data of the GPU level of a slide. This does not access the slide's
+ * record, so it may run on any thread. If a disk cache is provided, then data are loaded from
+ * the cache if present there; otherwise, the decoded data are stored in the cache.
+ *
+ * @param reader Tile reader of the slide
+ * @param createThumbnail Flag to generate a thumbnail from the GPU level
+ * @param backgroundColor Slide background color, against which the tissue mask is created
+ * @param handle Optional OpenSlide handle with which to decode tiles (see SlideTileReader)
+ * @param diskCache Optional cache on disk of decoded slide data
+ * @param runner Optional function that runs the parallel work of downsampling a file level
+ * (see downsampleLevel)
+ *
+ * @return Decoded data; nullptr on failure
+ */
+std::unique_ptr<DecodedSlideData> decodeSlide(
+        SlideTileReader& reader, bool createThumbnail, const glm::vec3& backgroundColor,
+        openslide_t* handle = nullptr, const SlideDiskCache* diskCache = nullptr,
+        const ParallelRunner& runner = nullptr );
+
+
+/**
+ * @brief Replace the placeholder GPU level and thumbnail of a slide record with decoded data.
+ * The tissue mask is set on both the record and its tile reader.
+ */
+void applyDecodedSlide( SlideCpuRecord& record, DecodedSlideData data );
+
+/**
+ * @brief Read a slide from file. Header information is read for all file levels,
+ * but pixel data is read only for the level that is uploaded to the GPU.
+ * Tiles of the file levels are read on demand with the slide's tile reader.
+ * This opens, decodes, and applies the decoded data to the slide on the calling thread.
+ *
+ * @param fileName Slide file name
+ * @param pixelSize Pixel size (x, y) in mm of the highest resolution level
+ * @param thickness Slide thickness in mm
+ * @param tileCache Cache of tiles shared among all slides; may be nullptr
+ * @param diskCache Cache on disk of decoded slide data; may be nullptr
+ *
+ * @return Slide record; nullptr on failure
+ */
 std::unique_ptr<SlideCpuRecord> readSlide(
         const std::string& fileName,
         const glm::vec2& pixelSize,
-        float thickness );
+        float thickness,
+        std::shared_ptr<SlideTileCache> tileCache,
+        const SlideDiskCache* diskCache = nullptr );
 
 } // namespace slideio
 
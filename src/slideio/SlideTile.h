@@ -0,0 +1,28 @@
+#ifndef SLIDE_TILE_H
+#define SLIDE_TILE_H
+
+#include <glm/vec2.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <memory>
+
+
+namespace slideio
+{
+
+/**
+ * @brief Fixed-size tile of a slide file level. Tiles along the right and bottom edges
+ * of a level are clipped to the level, so their dimensions may be less than the tile size.
+ * Pixels are stored in pre-multiplied ARGB format.
+ */
+struct SlideTile
+{
+    int m_level; //!< File level of the tile
+    glm::i64vec2 m_index; //!< Tile (column, row) index within the level
+    glm::i64vec2 m_dims; //!< Tile dimensions in pixels
+    std::unique_ptr< uint32_t[] > m_data;
+};
+
+} // namespace slideio
+
+#endif // SLIDE_TILE_H
@@ -0,0 +1,168 @@
+#include "slideio/SlideTileCache.h"
+
+
+namespace slideio
+{
+
+SlideTileCache::SlideTileCache( size_t byteBudget )
+    :
+      m_mutex(),
+      m_byteBudget( byteBudget ),
+      m_byteSize( 0 ),
+      m_entries(),
+      m_entryMap(),
+      m_stats()
+{}
+
+
+std::shared_ptr<const SlideTile> SlideTileCache::find( const SlideTileKey& key )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    auto it = m_entryMap.find( key );
+
+    if ( std::end( m_entryMap ) == it )
+    {
+        ++m_stats.m_misses;
+        return nullptr;
+    }
+
+    // Move the entry to the front of the list
+    m_entries.splice( std::begin( m_entries ), m_entries, it->second );
+
+    ++m_stats.m_hits;
+    return it->second->m_tile;
+}
+
+
+bool SlideTileCache::contains( const SlideTileKey& key ) const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return ( std::end( m_entryMap ) != m_entryMap.find( key ) );
+}
+
+
+void SlideTileCache::insert( const SlideTileKey& key, std::shared_ptr<const SlideTile> tile )
+{
+    if ( ! tile )
+    {
+        return;
+    }
+
+    const size_t byteSize = tileByteSize( *tile );
+
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    auto it = m_entryMap.find( key );
+
+    if ( std::end( m_entryMap ) != it )
+    {
+        // Replace the existing entry
+        m_byteSize -= it->second->m_byteSize;
+        m_entries.erase( it->second );
+        m_entryMap.erase( it );
+    }
+
+    m_entries.push_front( Entry{ key, std::move( tile ), byteSize } );
+    m_entryMap[key] = std::begin( m_entries );
+    m_byteSize += byteSize;
+
+    evict();
+}
+
+
+void SlideTileCache::erase( const UID& slideUid )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    for ( auto it = std::begin( m_entries ); it != std::end( m_entries ); )
+    {
+        if ( it->m_key.m_slideUid == slideUid )
+        {
+            m_byteSize -= it->m_byteSize;
+            m_entryMap.erase( it->m_key );
+            it = m_entries.erase( it );
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+
+void SlideTileCache::clear()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    m_entries.clear();
+    m_entryMap.clear();
+    m_byteSize = 0;
+}
+
+
+size_t SlideTileCache::byteBudget() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_byteBudget;
+}
+
+
+void SlideTileCache::setByteBudget( size_t byteBudget )
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+
+    m_byteBudget = byteBudget;
+    evict();
+}
+
+
+size_t SlideTileCache::byteSize() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_byteSize;
+}
+
+
+size_t SlideTileCache::numTiles() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_entries.size();
+}
+
+
+SlideTileCache::Statistics SlideTileCache::statistics() const
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    return m_stats;
+}
+
+
+void SlideTileCache::resetStatistics()
+{
+    std::lock_guard<std::mutex> lock( m_mutex );
+    m_stats = Statistics();
+}
+
+
+size_t SlideTileCache::tileByteSize( const SlideTile& tile )
+{
+    return sizeof( SlideTile ) + static_cast<size_t>( tile.m_dims.x * tile.m_dims.y ) * sizeof( uint32_t );
+}
+
+
+void SlideTileCache::evict()
+{
+    while ( m_byteSize > m_byteBudget && ! m_entries.empty() )
+    {
+        const Entry& lru = m_entries.back();
+
+        m_byteSize -= lru.m_byteSize;
+        m_entryMap.erase( lru.m_key );
+        m_entries.pop_back();
+
+        ++m_stats.m_evictions;
+    }
+}
+
+} // namespace slideio
@@ -0,0 +1,151 @@
+#ifndef SLIDE_TILE_CACHE_H
+#define SLIDE_TILE_CACHE_H
+
+#include "slideio/SlideTile.h"
+
+#include "common/UID.h"
+
+#include <glm/vec2.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+
+namespace slideio
+{
+
+/**
+ * @brief Key that identifies a tile of a slide level in the cache
+ */
+struct SlideTileKey
+{
+    UID m_slideUid; //!< UID of the slide whose file the tile was read from
+    int m_level; //!< File level of the tile
+    glm::i64vec2 m_index; //!< Tile (column, row) index within the level
+
+    bool operator==( const SlideTileKey& other ) const
+    {
+        return ( m_slideUid == other.m_slideUid &&
+                 m_level == other.m_level &&
+                 m_index.x == other.m_index.x &&
+                 m_index.y == other.m_index.y );
+    }
+};
+
+
+struct SlideTileKeyHash
+{
+    size_t operator() ( const SlideTileKey& key ) const
+    {
+        size_t seed = key.m_slideUid.hash();
+        hashCombine( seed, static_cast<size_t>( key.m_level ) );
+        hashCombine( seed, static_cast<size_t>( key.m_index.x ) );
+        hashCombine( seed, static_cast<size_t>( key.m_index.y ) );
+        return seed;
+    }
+
+    static void hashCombine( size_t& seed, size_t value )
+    {
+        seed ^= value + 0x9e3779b9 + ( seed << 6 ) + ( seed >> 2 );
+    }
+};
+
+
+/**
+ * @brief Cache of decoded slide tiles that is shared by all slides. The cache holds
+ * at most a fixed budget of bytes: once the budget is exceeded, the least recently
+ * used tiles are evicted. All member functions are thread-safe.
+ */
+class SlideTileCache
+{
+public:
+
+    /// Default budget of 1 GiB
+    static constexpr size_t sk_defaultByteBudget = ( size_t( 1 ) << 30 );
+
+    /// Cache usage counters
+    struct Statistics
+    {
+        uint64_t m_hits = 0; //!< Number of lookups that found their tile
+        uint64_t m_misses = 0; //!< Number of lookups that did not find their tile
+        uint64_t m_evictions = 0; //!< Number of tiles evicted to stay within budget
+    };
+
+
+    explicit SlideTileCache( size_t byteBudget = sk_defaultByteBudget );
+
+    SlideTileCache( const SlideTileCache& ) = delete;
+    SlideTileCache& operator=( const SlideTileCache& ) = delete;
+
+    ~SlideTileCache() = default;
+
+    /// Look up a tile, marking it as most recently used if found
+    /// @return The tile; nullptr if it is not in the cache
+    std::shared_ptr<const SlideTile> find( const SlideTileKey& key );
+
+    /// Return true iff a tile is in the cache, without marking it as used
+    bool contains( const SlideTileKey& key ) const;
+
+    /// Insert a tile as the most recently used one, evicting tiles as needed
+    void insert( const SlideTileKey& key, std::shared_ptr<const SlideTile> tile );
+
+    /// Remove all tiles of a slide
+    void erase( const UID& slideUid );
+
+    /// Remove all tiles
+    void clear();
+
+    size_t byteBudget() const;
+
+    /// Set the byte budget, evicting tiles as needed to stay within it
+    void setByteBudget( size_t byteBudget );
+
+    /// Get the number of bytes of all tiles in the cache
+    size_t byteSize() const;
+
+    /// Get the number of tiles in the cache
+    size_t numTiles() const;
+
+    Statistics statistics() const;
+    void resetStatistics();
+
+    /// Get the number of bytes used by a tile
+    static size_t tileByteSize( const SlideTile& tile );
+
+
+private:
+
+    struct Entry
+    {
+        SlideTileKey m_key;
+        std::shared_ptr<const SlideTile> m_tile;
+        size_t m_byteSize;
+    };
+
+    using EntryList = std::list<Entry>;
+
+    /// Evict least recently used tiles until the cache fits within its budget.
+    /// @note Must be called with the mutex locked.
+    void evict();
+
+    mutable std::mutex m_mutex;
+
+    size_t m_byteBudget;
+    size_t m_byteSize;
+
+    /// Entries ordered from most to least recently used
+    EntryList m_entries;
+
+    /// Map from tile key to its entry
+    std::unordered_map< SlideTileKey, EntryList::iterator, SlideTileKeyHash > m_entryMap;
+
+    Statistics m_stats;
+};
+
+} // namespace slideio
+
+#endif // SLIDE_TILE_CACHE_H
@@ -0,0 +1,442 @@
+#include "slideio/SlideTileReader.h"
+#include "slideio/SlideTileCache.h"
+#include "slideio/SlideTissueMask.h"
+
+extern "C"
+{
+#include <openslide/openslide.h>
+}
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+
+namespace
+{
+
+struct LevelInfo
+{
+    glm::i64vec2 m_dims;
+    double m_downsample;
+};
+
+} // anonymous
+
+
+namespace slideio
+{
+
+struct SlideTileReader::Impl
+{
+    Impl( std::string fileName, std::shared_ptr<SlideTileCache> tileCache, int64_t tileSize )
+        :
+          m_fileName( std::move( fileName ) ),
+          m_tileSize( std::max( tileSize, int64_t( 1 ) ) ),
+          m_slideUid(),
+          m_tileCache( std::move( tileCache ) ),
+          m_reader( nullptr ),
+          m_levels(),
+          m_tissueMask( nullptr ),
+          m_skipBackgroundTiles( false )
+    {}
+
+    ~Impl()
+    {
+        // The tiles of this slide can no longer be requested
+        if ( m_tileCache )
+        {
+            m_tileCache->erase( m_slideUid );
+        }
+
+        if ( m_reader )
+        {
+            openslide_close( m_reader );
+        }
+    }
+
+    /// Check for an error in an OpenSlide handle and print it if present.
+    /// @return True iff there is an error
+    bool hasError( openslide_t* handle ) const
+    {
+        if ( ! handle )
+        {
+            return true;
+        }
+
+        if ( const char* error = openslide_get_error( handle ) )
+        {
+            std::cerr << "OpenSlide error in file " << m_fileName << ": " << error << std::endl;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool hasError() const
+    {
+        return hasError( m_reader );
+    }
+
+    bool isValidLevel( int level ) const
+    {
+        return ( 0 <= level && level < static_cast<int>( m_levels.size() ) );
+    }
+
+    std::string m_fileName;
+    int64_t m_tileSize;
+
+    UID m_slideUid;
+    std::shared_ptr<SlideTileCache> m_tileCache;
+
+    openslide_t* m_reader;
+
+    /// Dimensions and downsample factors of the file levels,
+    /// arranged from largest to smallest
+    std::vector< LevelInfo > m_levels;
+
+    /// Tissue mask of the slide. It is set after the slide is decoded, possibly while tiles
+    /// are read on other threads, so it is only accessed atomically.
+    std::shared_ptr<const SlideTissueMask> m_tissueMask;
+
+    /// Flag to fill tiles of background instead of reading them
+    std::atomic<bool> m_skipBackgroundTiles;
+};
+
+
+SlideTileReader::SlideTileReader(
+        std::string fileName,
+        std::shared_ptr<SlideTileCache> tileCache,
+        int64_t tileSize )
+    :
+      m_impl( std::make_unique<Impl>( std::move( fileName ), std::move( tileCache ), tileSize ) )
+{
+    m_impl->m_reader = openslide_open( m_impl->m_fileName.c_str() );
+
+    if ( ! m_impl->m_reader )
+    {
+        std::cerr << "File " << m_impl->m_fileName
+                  << " is not recognized or has unsupported format." << std::endl;
+        return;
+    }
+
+    if ( m_impl->hasError() )
+    {
+        return;
+    }
+
+    const int32_t numLevels = openslide_get_level_count( m_impl->m_reader );
+
+    for ( int32_t i = 0; i < numLevels; ++i )
+    {
+        LevelInfo info;
+        openslide_get_level_dimensions( m_impl->m_reader, i, &( info.m_dims.x ), &( info.m_dims.y ) );
+        info.m_downsample = openslide_get_level_downsample( m_impl->m_reader, i );
+
+        if ( m_impl->hasError() || info.m_dims.x <= 0 || info.m_dims.y <= 0 )
+        {
+            m_impl->m_levels.clear();
+            return;
+        }
+
+        m_impl->m_levels.push_back( info );
+    }
+}
+
+SlideTileReader::~SlideTileReader() = default;
+
+
+bool SlideTileReader::isValid() const
+{
+    return ( m_impl->m_reader && ! m_impl->m_levels.empty() );
+}
+
+const std::string& SlideTileReader::fileName() const
+{
+    return m_impl->m_fileName;
+}
+
+int64_t SlideTileReader::tileSize() const
+{
+    return m_impl->m_tileSize;
+}
+
+const UID& SlideTileReader::slideUid() const
+{
+    return m_impl->m_slideUid;
+}
+
+int SlideTileReader::numLevels() const
+{
+    return static_cast<int>( m_impl->m_levels.size() );
+}
+
+glm::i64vec2 SlideTileReader::levelDims( int level ) const
+{
+    if ( ! m_impl->isValidLevel( level ) )
+    {
+        return glm::i64vec2{ 0, 0 };
+    }
+
+    return m_impl->m_levels[ static_cast<size_t>( level ) ].m_dims;
+}
+
+double SlideTileReader::levelDownsample( int level ) const
+{
+    if ( ! m_impl->isValidLevel( level ) )
+    {
+        return 1.0;
+    }
+
+    return m_impl->m_levels[ static_cast<size_t>( level ) ].m_downsample;
+}
+
+glm::i64vec2 SlideTileReader::levelTileCounts( int level ) const
+{
+    const glm::i64vec2 dims = levelDims( level );
+    const int64_t T = m_impl->m_tileSize;
+
+    return glm::i64vec2{ ( dims.x + T - 1 ) / T, ( dims.y + T - 1 ) / T };
+}
+
+int SlideTileReader::bestLevelForDownsample( double downsample ) const
+{
+    int bestLevel = 0;
+
+    for ( int i = 0; i < numLevels(); ++i )
+    {
+        if ( m_impl->m_levels[ static_cast<size_t>( i ) ].m_downsample <= downsample )
+        {
+            bestLevel = i;
+        }
+    }
+
+    return bestLevel;
+}
+
+
+std::vector< glm::i64vec2 > SlideTileReader::tilesInRegion(
+        int level,
+        const glm::i64vec2& regionOrigin,
+        const glm::i64vec2& regionSize ) const
+{
+    std::vector< glm::i64vec2 > tiles;
+
+    if ( ! m_impl->isValidLevel( level ) || regionSize.x <= 0 || regionSize.y <= 0 )
+    {
+        return tiles;
+    }
+
+    const glm::i64vec2 dims = levelDims( level );
+    const int64_t T = m_impl->m_tileSize;
+
+    // Clip the region to the level
+    const glm::i64vec2 regionMin = glm::clamp( regionOrigin, glm::i64vec2{ 0 }, dims );
+    const glm::i64vec2 regionMax = glm::clamp( regionOrigin + regionSize, glm::i64vec2{ 0 }, dims );
+
+    if ( regionMax.x <= regionMin.x || regionMax.y <= regionMin.y )
+    {
+        return tiles;
+    }
+
+    const glm::i64vec2 tileMin = regionMin / T;
+    const glm::i64vec2 tileMax = ( regionMax - int64_t( 1 ) ) / T;
+
+    for ( int64_t j = tileMin.y; j <= tileMax.y; ++j )
+    {
+        for ( int64_t i = tileMin.x; i <= tileMax.x; ++i )
+        {
+            tiles.emplace_back( i, j );
+        }
+    }
+
+    return tiles;
+}
+
+
+void SlideTileReader::setTissueMask( std::shared_ptr<const SlideTissueMask> mask )
+{
+    std::atomic_store( &m_impl->m_tissueMask, std::move( mask ) );
+}
+
+
+std::shared_ptr<const SlideTissueMask> SlideTileReader::tissueMask() const
+{
+    return std::atomic_load( &m_impl->m_tissueMask );
+}
+
+
+bool SlideTileReader::isBackgroundTile( int level, const glm::i64vec2& tileIndex ) const
+{
+    const auto mask = tissueMask();
+
+    if ( ! mask || ! m_impl->isValidLevel( level ) )
+    {
+        return false;
+    }
+
+    const LevelInfo& info = m_impl->m_levels[ static_cast<size_t>( level ) ];
+
+    const glm::i64vec2 tileOrigin = tileIndex * m_impl->m_tileSize;
+    const glm::i64vec2 tileEnd = glm::min( tileOrigin + m_impl->m_tileSize, info.m_dims );
+
+    return ( ! mask->regionHasTissue( info.m_downsample * glm::dvec2( tileOrigin ),
+                                      info.m_downsample * glm::dvec2( tileEnd ) ) );
+}
+
+
+void SlideTileReader::setSkipBackgroundTiles( bool skip )
+{
+    m_impl->m_skipBackgroundTiles = skip;
+}
+
+
+bool SlideTileReader::skipBackgroundTiles() const
+{
+    return m_impl->m_skipBackgroundTiles;
+}
+
+
+bool SlideTileReader::isTileCached( int level, const glm::i64vec2& tileIndex ) const
+{
+    if ( ! m_impl->m_tileCache )
+    {
+        return false;
+    }
+
+    return m_impl->m_tileCache->contains( SlideTileKey{ m_impl->m_slideUid, level, tileIndex } );
+}
+
+
+std::shared_ptr<const SlideTile> SlideTileReader::findCachedTile(
+        int level, const glm::i64vec2& tileIndex ) const
+{
+    if ( ! m_impl->m_tileCache )
+    {
+        return nullptr;
+    }
+
+    return m_impl->m_tileCache->find( SlideTileKey{ m_impl->m_slideUid, level, tileIndex } );
+}
+
+
+std::shared_ptr<const SlideTile> SlideTileReader::readTile(
+        int level, const glm::i64vec2& tileIndex, openslide_t* handle, bool cacheTile )
+{
+    if ( ! isValid() || ! m_impl->isValidLevel( level ) )
+    {
+        return nullptr;
+    }
+
+    const glm::i64vec2 counts = levelTileCounts( level );
+
+    if ( glm::any( glm::lessThan( tileIndex, glm::i64vec2{ 0 } ) ) ||
+         glm::any( glm::greaterThanEqual( tileIndex, counts ) ) )
+    {
+        return nullptr;
+    }
+
+    const SlideTileKey key{ m_impl->m_slideUid, level, tileIndex };
+
+    if ( m_impl->m_tileCache )
+    {
+        if ( auto cachedTile = m_impl->m_tileCache->find( key ) )
+        {
+            return cachedTile;
+        }
+    }
+
+    if ( ! handle )
+    {
+        handle = m_impl->m_reader;
+    }
+
+    const LevelInfo& info = m_impl->m_levels[ static_cast<size_t>( level ) ];
+
+    const glm::i64vec2 tileOrigin = tileIndex * m_impl->m_tileSize;
+    const glm::i64vec2 tileDims = glm::min( glm::i64vec2{ m_impl->m_tileSize }, info.m_dims - tileOrigin );
+    const size_t numPixels = static_cast<size_t>( tileDims.x * tileDims.y );
+
+    auto tile = std::make_shared<SlideTile>();
+    tile->m_level = level;
+    tile->m_index = tileIndex;
+    tile->m_dims = tileDims;
+    tile->m_data = std::make_unique< uint32_t[] >( numPixels );
+
+    // Background tiles are cheaper to fill than to decode or to keep in the cache
+    const auto mask = tissueMask();
+
+    if ( mask && skipBackgroundTiles() && isBackgroundTile( level, tileIndex ) )
+    {
+        std::fill_n( tile->m_data.get(), numPixels, mask->backgroundPixel() );
+        return tile;
+    }
+
+    // OpenSlide expects the tile origin in the level 0 reference frame
+    const int64_t x0 = static_cast<int64_t>( std::floor( tileOrigin.x * info.m_downsample ) );
+    const int64_t y0 = static_cast<int64_t>( std::floor( tileOrigin.y * info.m_downsample ) );
+
+    // Copy pre-multiplied ARGB data from the whole slide image
+    openslide_read_region( handle, tile->m_data.get(),
+                           x0, y0, level, tileDims.x, tileDims.y );
+
+    if ( m_impl->hasError( handle ) )
+    {
+        std::cerr << "Unable to read tile (" << tileIndex.x << ", " << tileIndex.y
+                  << ") of slide level " << level << std::endl;
+        return nullptr;
+    }
+
+    if ( m_impl->m_tileCache && cacheTile )
+    {
+        m_impl->m_tileCache->insert( key, tile );
+    }
+
+    return tile;
+}
+
+
+bool SlideTileReader::readRegion(
+        int level,
+        const glm::i64vec2& regionOrigin,
+        const glm::i64vec2& regionSize,
+        uint32_t* buffer,
+        openslide_t* handle )
+{
+    if ( ! buffer )
+    {
+        return false;
+    }
+
+    const int64_t T = m_impl->m_tileSize;
+
+    for ( const glm::i64vec2& tileIndex : tilesInRegion( level, regionOrigin, regionSize ) )
+    {
+        const auto tile = readTile( level, tileIndex, handle );
+
+        if ( ! tile || ! tile->m_data )
+        {
+            return false;
+        }
+
+        // Intersection of the tile with the region, in level coordinates
+        const glm::i64vec2 tileOrigin = tileIndex * T;
+        const glm::i64vec2 lo = glm::max( tileOrigin, regionOrigin );
+        const glm::i64vec2 hi = glm::min( tileOrigin + tile->m_dims, regionOrigin + regionSize );
+
+        for ( int64_t y = lo.y; y < hi.y; ++y )
+        {
+            const uint32_t* src = tile->m_data.get() + ( y - tileOrigin.y ) * tile->m_dims.x + ( lo.x - tileOrigin.x );
+            uint32_t* dst = buffer + ( y - regionOrigin.y ) * regionSize.x + ( lo.x - regionOrigin.x );
+
+            std::copy( src, src + ( hi.x - lo.x ), dst );
+        }
+    }
+
+    return true;
+}
+
+} // namespace slideio
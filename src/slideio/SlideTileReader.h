@@ -0,0 +1,159 @@
+#ifndef SLIDE_TILE_READER_H
+#define SLIDE_TILE_READER_H
+
+#include "slideio/SlideTile.h"
+
+#include "common/UID.h"
+
+#include <glm/vec2.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+
+typedef struct _openslide openslide_t;
+
+
+namespace slideio
+{
+
+class SlideTileCache;
+class SlideTissueMask;
+
+/**
+ * @brief Reads fixed-size tiles from all levels of a whole-slide image file on demand.
+ * The reader keeps its OpenSlide handle open for its lifetime, so that only the tiles
+ * covering the region being viewed ever need to be held in memory.
+ *
+ * Tiles are looked up in a cache that may be shared with the readers of other slides.
+ * The reader identifies its tiles in the cache with a UID that is unique to the slide.
+ *
+ * @note OpenSlide handles are thread-safe, so tiles may be read concurrently. Threads that
+ * decode many tiles may pass their own handle to the slide file, so that they do not
+ * contend for the reader's handle.
+ */
+class SlideTileReader
+{
+public:
+
+    /// Default width and height of tiles in pixels
+    static constexpr int64_t sk_defaultTileSize = 512;
+
+    /**
+     * @brief Open a slide file for tiled reading
+     * @param fileName Slide file name
+     * @param tileCache Cache of tiles shared among slides; nullptr if tiles are not cached
+     * @param tileSize Width and height of tiles in pixels
+     */
+    SlideTileReader( std::string fileName,
+                     std::shared_ptr<SlideTileCache> tileCache,
+                     int64_t tileSize = sk_defaultTileSize );
+
+    SlideTileReader( const SlideTileReader& ) = delete;
+    SlideTileReader& operator=( const SlideTileReader& ) = delete;
+
+    ~SlideTileReader();
+
+    /// Return true iff the slide file was opened without error
+    bool isValid() const;
+
+    const std::string& fileName() const;
+    int64_t tileSize() const;
+
+    /// Get the UID that identifies the tiles of this slide in the cache
+    const UID& slideUid() const;
+
+    int numLevels() const;
+    glm::i64vec2 levelDims( int level ) const;
+    double levelDownsample( int level ) const;
+
+    /// Get the number of tile columns and rows in a level
+    glm::i64vec2 levelTileCounts( int level ) const;
+
+    /// Get the index of the smallest level whose downsample factor does not exceed the given one
+    int bestLevelForDownsample( double downsample ) const;
+
+    /**
+     * @brief Get indices of all tiles of a level that intersect a region
+     * @param level File level
+     * @param regionOrigin Minimum pixel corner of region in level coordinates
+     * @param regionSize Pixel size of region in level coordinates
+     */
+    std::vector< glm::i64vec2 > tilesInRegion(
+            int level,
+            const glm::i64vec2& regionOrigin,
+            const glm::i64vec2& regionSize ) const;
+
+    /// Set the tissue mask of the slide, with which tiles that are fully background are
+    /// read after tiles of tissue (or skipped, see \c setSkipBackgroundTiles).
+    /// This may be called while tiles are being read on other threads.
+    void setTissueMask( std::shared_ptr<const SlideTissueMask> mask );
+
+    /// Get the tissue mask of the slide; nullptr if it has not been set
+    std::shared_ptr<const SlideTissueMask> tissueMask() const;
+
+    /// Return true iff the tissue mask shows that a tile holds only background.
+    /// Without a tissue mask, no tile is background.
+    bool isBackgroundTile( int level, const glm::i64vec2& tileIndex ) const;
+
+    /// Set whether tiles that the tissue mask shows to be background are skipped: they are then
+    /// filled with the background color instead of being read. Since the mask is created from
+    /// a low-resolution level, faint tissue in such tiles is lost, so tiles are not skipped
+    /// by default: the mask then only makes tiles of tissue be read first.
+    void setSkipBackgroundTiles( bool skip );
+
+    /// Return true iff tiles that the tissue mask shows to be background are skipped
+    bool skipBackgroundTiles() const;
+
+    /// Return true iff a tile is held in the cache. This does not affect the cache usage order.
+    bool isTileCached( int level, const glm::i64vec2& tileIndex ) const;
+
+    /// Get a tile from the cache without ever reading it from the slide file
+    /// @return The tile; nullptr if it is not cached
+    std::shared_ptr<const SlideTile> findCachedTile( int level, const glm::i64vec2& tileIndex ) const;
+
+    /**
+     * @brief Read a single tile, either from the cache or from the slide file.
+     * Tiles read from the file are inserted into the cache. If background tiles are skipped,
+     * then tiles that the tissue mask shows to be fully background are not read: they are
+     * filled with the background color and not cached.
+     * @param level File level
+     * @param tileIndex Tile (column, row) index within the level
+     * @param handle Optional OpenSlide handle to the slide file with which to decode the tile.
+     * If null, the reader's own handle is used.
+     * @param cacheTile Flag to insert a tile read from the file into the cache. Tiles that are
+     * read only once (such as those streamed to create downsampled levels) should bypass the
+     * cache, so that they do not evict the tiles being viewed.
+     * @return The tile; nullptr if the tile index is invalid or reading failed
+     */
+    std::shared_ptr<const SlideTile> readTile(
+            int level, const glm::i64vec2& tileIndex, openslide_t* handle = nullptr,
+            bool cacheTile = true );
+
+    /**
+     * @brief Read a region of a level into a buffer, assembling it from tiles
+     * @param level File level
+     * @param regionOrigin Minimum pixel corner of region in level coordinates
+     * @param regionSize Pixel size of region in level coordinates
+     * @param buffer Destination buffer of pre-multiplied ARGB pixels of size regionSize.x * regionSize.y
+     * @param handle Optional OpenSlide handle with which to decode tiles (see readTile)
+     * @return True iff all tiles of the region were read successfully
+     */
+    bool readRegion( int level,
+                     const glm::i64vec2& regionOrigin,
+                     const glm::i64vec2& regionSize,
+                     uint32_t* buffer,
+                     openslide_t* handle = nullptr );
+
+
+private:
+
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
+} // namespace slideio
+
+#endif // SLIDE_TILE_READER_H
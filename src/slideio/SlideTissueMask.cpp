@@ -0,0 +1,188 @@
+#include "slideio/SlideTissueMask.h"
+#include "slideio/SlideLevel.h"
+#include "slideio/SlidePixelConversion.h"
+
+#include <opencv2/opencv.hpp>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+
+
+namespace
+{
+
+/// Maximum dimensions of tissue masks. Larger levels are downsampled to these dimensions.
+static const glm::i64vec2 sk_maxMaskDims( 1024, 1024 );
+
+/// Minimum difference of any color channel from the background for a pixel to be tissue
+static constexpr int sk_colorThreshold = 20;
+
+/// Minimum alpha of tissue pixels. Transparent pixels lie outside of the scanned regions.
+static constexpr int sk_minTissueAlpha = 128;
+
+/// Sizes of the structuring elements used to clean up the mask
+static constexpr int sk_openingSize = 3;
+static constexpr int sk_closingSize = 7;
+
+/// Margin in mask pixels by which tissue is dilated
+static constexpr int sk_marginPixels = 2;
+
+} // anonymous
+
+
+namespace slideio
+{
+
+SlideTissueMask::SlideTissueMask(
+        const glm::i64vec2& dims,
+        const glm::i64vec2& level0Dims,
+        std::vector<uint8_t> mask,
+        uint32_t backgroundPixel )
+    :
+      m_dims( dims ),
+      m_level0Dims( level0Dims ),
+      m_mask( std::move( mask ) ),
+      m_backgroundPixel( backgroundPixel ),
+      m_tissueFraction( 0.0 )
+{
+    if ( ! m_mask.empty() )
+    {
+        const auto numTissuePixels = std::count_if( std::begin( m_mask ), std::end( m_mask ),
+                                                    [] ( uint8_t m ) { return ( 0 != m ); } );
+
+        m_tissueFraction = static_cast<double>( numTissuePixels ) / static_cast<double>( m_mask.size() );
+    }
+}
+
+const glm::i64vec2& SlideTissueMask::dims() const
+{
+    return m_dims;
+}
+
+uint32_t SlideTissueMask::backgroundPixel() const
+{
+    return m_backgroundPixel;
+}
+
+double SlideTissueMask::tissueFraction() const
+{
+    return m_tissueFraction;
+}
+
+bool SlideTissueMask::regionHasTissue( const glm::dvec2& level0Min, const glm::dvec2& level0Max ) const
+{
+    if ( m_mask.size() != static_cast<size_t>( m_dims.x * m_dims.y ) )
+    {
+        // Without a valid mask, assume that the slide is all tissue
+        return true;
+    }
+
+    if ( level0Max.x <= level0Min.x || level0Max.y <= level0Min.y )
+    {
+        return false;
+    }
+
+    const glm::dvec2 scale = glm::dvec2( m_dims ) / m_level0Dims;
+
+    // Mask pixels that overlap the region
+    const glm::i64vec2 lo = glm::clamp( glm::i64vec2( glm::floor( level0Min * scale ) ),
+                                        glm::i64vec2{ 0 }, m_dims );
+    const glm::i64vec2 hi = glm::clamp( glm::i64vec2( glm::ceil( level0Max * scale ) ),
+                                        glm::i64vec2{ 0 }, m_dims );
+
+    for ( int64_t y = lo.y; y < hi.y; ++y )
+    {
+        const auto row = std::begin( m_mask ) + static_cast<std::ptrdiff_t>( y * m_dims.x );
+
+        if ( std::any_of( row + static_cast<std::ptrdiff_t>( lo.x ), row + static_cast<std::ptrdiff_t>( hi.x ),
+                          [] ( uint8_t m ) { return ( 0 != m ); } ) )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+std::unique_ptr<SlideTissueMask> createTissueMask(
+        const SlideLevel& level,
+        const glm::i64vec2& level0Dims,
+        const glm::vec3& backgroundColor )
+{
+    if ( ! level.m_data || level.m_dims.x <= 0 || level.m_dims.y <= 0 )
+    {
+        return nullptr;
+    }
+
+    // Downsample the pre-multiplied pixels, so that transparent pixels are averaged correctly.
+    // No data is copied into the source matrix, which is only read.
+    cv::Mat levelImage( cv::Size( static_cast<int>( level.m_dims.x ), static_cast<int>( level.m_dims.y ) ),
+                        CV_8UC4, const_cast<uint32_t*>( level.m_data.get() ), cv::Mat::AUTO_STEP );
+
+    const double scale = std::min( { 1.0,
+                                     static_cast<double>( sk_maxMaskDims.x ) / level.m_dims.x,
+                                     static_cast<double>( sk_maxMaskDims.y ) / level.m_dims.y } );
+
+    const glm::i64vec2 maskDims = glm::max( glm::i64vec2{ 1, 1 },
+                                            glm::i64vec2( glm::round( scale * glm::dvec2( level.m_dims ) ) ) );
+
+    cv::Mat maskImage;
+
+    if ( maskDims == level.m_dims )
+    {
+        maskImage = levelImage;
+    }
+    else
+    {
+        cv::resize( levelImage, maskImage, cv::Size( static_cast<int>( maskDims.x ), static_cast<int>( maskDims.y ) ),
+                    0, 0, cv::INTER_AREA );
+    }
+
+    if ( ! maskImage.isContinuous() )
+    {
+        maskImage = maskImage.clone();
+    }
+
+    const size_t numPixels = static_cast<size_t>( maskDims.x * maskDims.y );
+
+    std::vector<uint8_t> bgra( 4 * numPixels );
+    convertPremultipliedArgb( reinterpret_cast<const uint32_t*>( maskImage.data ), numPixels,
+                              bgra.data(), SlidePixelFormat::BGRA );
+
+    const glm::ivec3 background( glm::clamp( 255.0f * backgroundColor + 0.5f, 0.0f, 255.0f ) );
+
+    // Threshold the distance of straight (un-premultiplied) colors from the background
+    cv::Mat mask( cv::Size( static_cast<int>( maskDims.x ), static_cast<int>( maskDims.y ) ), CV_8UC1 );
+
+    for ( size_t i = 0; i < numPixels; ++i )
+    {
+        const uint8_t* p = bgra.data() + 4 * i;
+
+        const int diff = std::max( { std::abs( p[2] - background.x ),
+                                     std::abs( p[1] - background.y ),
+                                     std::abs( p[0] - background.z ) } );
+
+        mask.data[i] = ( p[3] >= sk_minTissueAlpha && diff > sk_colorThreshold ) ? 255 : 0;
+    }
+
+    cv::morphologyEx( mask, mask, cv::MORPH_OPEN, cv::getStructuringElement(
+                          cv::MORPH_ELLIPSE, cv::Size( sk_openingSize, sk_openingSize ) ) );
+
+    cv::morphologyEx( mask, mask, cv::MORPH_CLOSE, cv::getStructuringElement(
+                          cv::MORPH_ELLIPSE, cv::Size( sk_closingSize, sk_closingSize ) ) );
+
+    cv::dilate( mask, mask, cv::getStructuringElement(
+                    cv::MORPH_RECT, cv::Size( 2 * sk_marginPixels + 1, 2 * sk_marginPixels + 1 ) ) );
+
+    const glm::u32vec3 c( background );
+    const uint32_t backgroundPixel = ( 0xFF000000u | ( c.x << 16 ) | ( c.y << 8 ) | c.z );
+
+    return std::make_unique<SlideTissueMask>(
+                maskDims, level0Dims, std::vector<uint8_t>( mask.data, mask.data + numPixels ),
+                backgroundPixel );
+}
+
+} // namespace slideio
@@ -0,0 +1,88 @@
+#ifndef SLIDE_TISSUE_MASK_H
+#define SLIDE_TISSUE_MASK_H
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+
+namespace slideio
+{
+
+struct SlideLevel;
+
+/**
+ * @brief Low-resolution mask of the tissue in a slide. Each mask pixel flags whether the
+ * area of the slide that it covers holds tissue or only background (i.e. glass or the
+ * unscanned area of the slide). The mask is used to read and upload tiles of tissue before
+ * tiles that are fully background, or optionally to skip the latter altogether.
+ *
+ * The mask is conservative: tissue is dilated by a margin, so that a region is reported as
+ * background only if it certainly holds no tissue.
+ */
+class SlideTissueMask
+{
+public:
+
+    /**
+     * @param dims Mask dimensions in pixels
+     * @param level0Dims Dimensions of the slide's highest resolution level in pixels
+     * @param mask Mask values of size dims.x * dims.y, arranged by rows: non-zero for tissue
+     * @param backgroundPixel Pre-multiplied ARGB pixel of the slide background color
+     */
+    SlideTissueMask( const glm::i64vec2& dims,
+                     const glm::i64vec2& level0Dims,
+                     std::vector<uint8_t> mask,
+                     uint32_t backgroundPixel );
+
+    const glm::i64vec2& dims() const;
+
+    /// Get the pre-multiplied ARGB pixel with which background regions are filled
+    uint32_t backgroundPixel() const;
+
+    /// Get the fraction of the slide area covered by tissue, in [0, 1]
+    double tissueFraction() const;
+
+    /**
+     * @brief Check whether a region of the slide may hold tissue
+     * @param level0Min Minimum pixel corner of region in level 0 coordinates
+     * @param level0Max Maximum pixel corner of region in level 0 coordinates
+     * @return False iff the region holds only background
+     */
+    bool regionHasTissue( const glm::dvec2& level0Min, const glm::dvec2& level0Max ) const;
+
+
+private:
+
+    glm::i64vec2 m_dims;
+    glm::dvec2 m_level0Dims;
+    std::vector<uint8_t> m_mask;
+    uint32_t m_backgroundPixel;
+    double m_tissueFraction;
+};
+
+
+/**
+ * @brief Create the tissue mask of a slide from a low-resolution level of it. Pixels whose
+ * color differs from the background color by more than a threshold are tissue. The mask is
+ * cleaned up with morphological opening (to drop specks of dust and noise) and closing
+ * (to fill holes in the tissue), then dilated by a safety margin.
+ *
+ * @param level Low-resolution level of the slide with pixel data, e.g. the GPU level
+ * @param level0Dims Dimensions of the slide's highest resolution level in pixels
+ * @param backgroundColor Slide background color, with components in [0, 1]
+ *
+ * @return Tissue mask; nullptr if the level has no data
+ */
+std::unique_ptr<SlideTissueMask> createTissueMask(
+        const SlideLevel& level,
+        const glm::i64vec2& level0Dims,
+        const glm::vec3& backgroundColor );
+
+} // namespace slideio
+
+#endif // SLIDE_TISSUE_MASK_H